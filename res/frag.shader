@@ -32,7 +32,7 @@
 #version ${GLSL_VERSION}
 
 #define t_real float
-#define MAX_LIGHTS ${MAX_LIGHTS}
+#define LIGHT_TILE_SIZE ${LIGHT_TILE_SIZE}
 
 const t_real pi = ${PI};
 
@@ -49,6 +49,8 @@ in VertexOut
 	vec4 norm;
 
 	vec4 pos_shadow;
+
+	flat uint pick_id;
 } frag_in;
 // ----------------------------------------------------------------------------
 
@@ -56,20 +58,28 @@ in VertexOut
 // ----------------------------------------------------------------------------
 // outputs from fragment shader
 // ----------------------------------------------------------------------------
-out vec4 frag_out_col;
+layout(location = 0) out vec4 frag_out_col;
+
+// object ids, only written in the picking pass
+layout(location = 1) out uint frag_out_id;
+uniform bool pick_renderpass = false;
 // ----------------------------------------------------------------------------
 
 
 // ----------------------------------------------------------------------------
 // transformations
 // ----------------------------------------------------------------------------
-uniform mat4 trafos_proj = mat4(1.);
-uniform mat4 trafos_cam = mat4(1.);
-uniform mat4 trafos_cam_inv = mat4(1.);
+// per-frame camera and light matrices, shared by all passes
+layout(std140) uniform Frame
+{
+	mat4 trafos_proj;
+	mat4 trafos_cam;
+	mat4 trafos_cam_inv;
 
-uniform mat4 trafos_light_proj = mat4(1.);
-uniform mat4 trafos_light = mat4(1.);
-uniform mat4 trafos_light_inv = mat4(1.);
+	mat4 trafos_light_proj;
+	mat4 trafos_light;
+	mat4 trafos_light_inv;
+};
 
 uniform mat4 trafos_obj = mat4(1.);
 // ----------------------------------------------------------------------------
@@ -87,10 +97,22 @@ uniform sampler2D texture_image;
 // lighting
 // ----------------------------------------------------------------------------
 uniform vec4 lights_const_col = vec4(1, 1, 1, 1);
-uniform vec3 lights_pos[MAX_LIGHTS];
-uniform int lights_numactive = 1;	// how many lights to use?
 uniform bool lights_enabled = true;
 
+// light counts, only updated when a light or the viewport changes
+layout(std140) uniform Lights
+{
+	int lights_numactive;	// how many lights to use?
+	ivec2 light_tiles_count;	// number of screen tiles in x and y
+};
+
+// light positions in xyz and their ranges in w, a range of 0 is unbounded
+uniform samplerBuffer lights;
+
+// per screen tile: offset and number of its light indices, followed by the index lists
+uniform usamplerBuffer light_tiles;
+uniform bool light_tiles_enabled = false;
+
 uniform sampler2DShadow shadow_map;
 uniform bool shadow_enabled = false;
 uniform bool shadow_renderpass = false;
@@ -142,17 +164,30 @@ t_real lighting(vec4 objVert, vec4 objNorm)
 	if(g_specular > 0.)
 		dirToCam = normalize(get_campos() - objVert.xyz);
 
+	// either only the lights reaching the fragment's screen tile or all of them
+	int tile_offs = 0;
+	int num_lights = lights_numactive;
+	if(light_tiles_enabled)
+	{
+		ivec2 tile = clamp(ivec2(gl_FragCoord.xy) / LIGHT_TILE_SIZE,
+			ivec2(0, 0), light_tiles_count - ivec2(1, 1));
+		int tileidx = tile.y*light_tiles_count.x + tile.x;
+		tile_offs = int(texelFetch(light_tiles, 2*tileidx).r);
+		num_lights = int(texelFetch(light_tiles, 2*tileidx + 1).r);
+	}
+
 	// iterate (active) light sources
-	for(int lightidx=0;
-		lightidx<min(lights_pos.length(), lights_numactive);
-		++lightidx)
+	for(int i=0; i<num_lights; ++i)
 	{
+		int lightidx = light_tiles_enabled ? int(texelFetch(light_tiles, tile_offs + i).r) : i;
+		vec4 light = texelFetch(lights, lightidx);
+
 		t_real atten = 1.;
 		t_real I_diff = 0.;
 		t_real I_spec = 0.;
 
 		// diffuse lighting
-		vec3 vertToLight = lights_pos[lightidx] - objVert.xyz;
+		vec3 vertToLight = light.xyz - objVert.xyz;
 		t_real distVertLight = length(vertToLight);
 		vec3 dirLight = vertToLight / distVertLight;
 
@@ -192,6 +227,13 @@ t_real lighting(vec4 objVert, vec4 objNorm)
 		if(atten < 0.)
 			atten = 0.;
 
+		// fade out towards the light's range
+		if(light.w > 0.)
+		{
+			t_real fade = clamp(1. - pow(distVertLight / light.w, 4.), 0., 1.);
+			atten *= fade*fade;
+		}
+
 		I_total += (I_diff + I_spec) * atten;
 	}
 
@@ -205,6 +247,15 @@ t_real lighting(vec4 objVert, vec4 objNorm)
 
 void main()
 {
+	frag_out_id = frag_in.pick_id;
+
+	// picking pass, @see https://www.khronos.org/opengl/wiki/Fragment_Shader#Output_buffers
+	if(pick_renderpass)
+	{
+		frag_out_col = vec4(1, 1, 1, 1);
+		return;
+	}
+
 	if(texture_active)
 		frag_out_col = texture(texture_image, frag_in.coords);
 	else
@@ -213,14 +264,14 @@ void main()
 	// shadow rendering pass, @see (Sellers 2014), pp. 534-540
 	if(shadow_renderpass)
 	{
-		// use colours for z value
-		frag_out_col = vec4(frag_in.pos.z/frag_in.pos.w);
+		// only the depth values are written to the shadow map
+		frag_out_col = vec4(1, 1, 1, 1);
 	}
 
 	// normal rendering pass
 	else
 	{
-		const t_real z_eps = 0.05;
+		const t_real z_bias = 0.0005;
 
 		t_real I = 1.;
 		if(lights_enabled)
@@ -231,14 +282,15 @@ void main()
 		frag_out_col *= lights_const_col;
 
 		// shadows, @see (Sellers 2014), pp. 534-540
-		if(shadow_enabled)
+		if(shadow_enabled && frag_in.pos_shadow.w > 0.)
 		{
-			// get the shadow z value
-			t_real shadow_val = textureProj(shadow_map, frag_in.pos_shadow);
+			// compare the fragment's depth from the light with the shadow map's depth:
+			// 1 if the fragment is lit, 0 if it is in shadow
+			vec4 pos_shadow = frag_in.pos_shadow;
+			pos_shadow.z -= z_bias * pos_shadow.w;
+			t_real lit = textureProj(shadow_map, pos_shadow);
 
-			// is the shadow z value larger than the current object z value?
-			if(shadow_val > frag_in.pos.z + z_eps)
-				frag_out_col.rgb *= g_shadow_atten;
+			frag_out_col.rgb *= mix(g_shadow_atten, 1., lit);
 		}
 	}
 }
@@ -0,0 +1,24 @@
+/**
+ * scaled frame, fragment shader
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ */
+
+#version ${GLSL_VERSION}
+
+
+in vec2 frag_coords;
+out vec4 frag_out_col;
+
+uniform sampler2D frame;
+
+// texel centres at the borders of the rendered frame, the rest of the texture is not filtered in
+uniform vec2 tex_min = vec2(0., 0.);
+uniform vec2 tex_max = vec2(1., 1.);
+
+
+void main()
+{
+	frag_out_col = texture(frame, clamp(frag_coords, tex_min, tex_max));
+}
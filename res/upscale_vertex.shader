@@ -0,0 +1,24 @@
+/**
+ * scaled frame, vertex shader
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ */
+
+#version ${GLSL_VERSION}
+
+
+// part of the texture covered by the rendered frame
+uniform vec2 tex_scale = vec2(1., 1.);
+
+out vec2 frag_coords;
+
+
+void main()
+{
+	// triangle covering the whole screen, generated from the vertex index
+	vec2 pos = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+
+	frag_coords = pos * tex_scale;
+	gl_Position = vec4(pos*2. - 1., 0., 1.);
+}
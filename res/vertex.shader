@@ -39,10 +39,13 @@ const t_real pi = ${PI};
 // ----------------------------------------------------------------------------
 // inputs to vertex shader
 // ----------------------------------------------------------------------------
-in vec4 vertex;
-in vec4 normal;
-in vec4 vertex_col;
+in vec3 vertex;
+in vec3 normal;
 in vec2 tex_coords;
+
+// per-instance attributes
+in mat4 instance_trafo;
+in vec4 instance_col;
 // ----------------------------------------------------------------------------
 
 
@@ -58,6 +61,8 @@ out VertexOut
 	vec4 norm;
 
 	vec4 pos_shadow;
+
+	flat uint pick_id;
 } vertex_out;
 // ----------------------------------------------------------------------------
 
@@ -65,15 +70,23 @@ out VertexOut
 // ----------------------------------------------------------------------------
 // transformations
 // ----------------------------------------------------------------------------
-uniform mat4 trafos_proj = mat4(1.);
-uniform mat4 trafos_cam = mat4(1.);
-uniform mat4 trafos_cam_inv = mat4(1.);
+// per-frame camera and light matrices, shared by all passes
+layout(std140) uniform Frame
+{
+	mat4 trafos_proj;
+	mat4 trafos_cam;
+	mat4 trafos_cam_inv;
 
-uniform mat4 trafos_light_proj = mat4(1.);
-uniform mat4 trafos_light = mat4(1.);
-uniform mat4 trafos_light_inv = mat4(1.);
+	mat4 trafos_light_proj;
+	mat4 trafos_light;
+	mat4 trafos_light_inv;
+};
 
 uniform mat4 trafos_obj = mat4(1.);
+uniform vec4 obj_col = vec4(1.);
+
+// trafos_obj is applied on top of instance_trafo for instanced rendering
+uniform bool instancing_enabled = false;
 // ----------------------------------------------------------------------------
 
 
@@ -85,6 +98,14 @@ uniform bool shadow_renderpass = false;
 // ----------------------------------------------------------------------------
 
 
+// ----------------------------------------------------------------------------
+// picking
+// ----------------------------------------------------------------------------
+// id of the object, or of the first instance for instanced rendering
+uniform uint pick_id = 0u;
+// ----------------------------------------------------------------------------
+
+
 /**
  * for shadow rendering, see (Sellers 2014), pp. 534-540.
  * for perspective transformation and divide, see
@@ -92,8 +113,16 @@ uniform bool shadow_renderpass = false;
  */
 void main()
 {
-	vec4 objPos = trafos_obj * vertex;
-	vec4 objNorm = normalize(trafos_obj * normal);
+	mat4 trafo = trafos_obj;
+	vec4 col = obj_col;
+	if(instancing_enabled)
+	{
+		trafo = trafos_obj * instance_trafo;
+		col = instance_col;
+	}
+
+	vec4 objPos = trafo * vec4(vertex, 1.);
+	vec4 objNorm = normalize(trafo * vec4(normal, 0.));
 	vec4 shadowPos = trafos_light_proj * trafos_light * objPos;
 
 	if(shadow_renderpass)
@@ -103,11 +132,15 @@ void main()
 
 	vertex_out.pos = objPos;
 	vertex_out.norm = objNorm;
-	vertex_out.col = vertex_col;
+	vertex_out.col = col;
 	//vertex_out.col.a = 1;
 
 	vertex_out.coords = tex_coords;
 
+	vertex_out.pick_id = pick_id;
+	if(instancing_enabled && pick_id != 0u)
+		vertex_out.pick_id += uint(gl_InstanceID);
+
 	shadowPos.xyz *= 0.5;
 	shadowPos.xyz += 0.5 * shadowPos.w;
 	vertex_out.pos_shadow = shadowPos;
@@ -16,6 +16,11 @@
 #include "mathlibs/libs/poly_algos.h"
 
 #include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <typeindex>
+#include <functional>
+#include <mutex>
 
 namespace pt = boost::property_tree;
 
@@ -39,11 +44,17 @@ std::string geo_val_to_str(const t_val& val)
 
 /**
  * convert a serialised string to a value
+ * plain numbers are converted directly, only expressions need the parser,
+ * which is re-used by all conversions of a thread
  */
 template<class t_var = t_real>
 t_var geo_str_to_val(const std::string& str)
 {
-	ExprParser<t_var> parser;
+	if(t_var val{}; ExprParser<t_var>::ParseLiteral(str, val))
+		return val;
+
+	static thread_local ExprParser<t_var> parser;
+	parser.ResetSymbols();
 	return parser.Parse(str);
 }
 
@@ -84,8 +95,7 @@ t_vec geo_str_to_vec(const std::string& str, const char* _seps)
 	for(std::size_t tokidx=0; tokidx<tokens.size(); ++tokidx)
 	{
 		// parse the vector component expression to yield a real value
-		ExprParser<t_real> parser;
-		vec[tokidx] = parser.Parse(tokens[tokidx]);
+		vec[tokidx] = geo_str_to_val<t_real>(tokens[tokidx]);
 	}
 
 	return vec;
@@ -150,8 +160,7 @@ t_mat geo_str_to_mat(const std::string& str, const char* _seprow, const char* _s
 			// parse the matrix component expression to yield a real value
 			if(j < coltokens.size())
 			{
-				ExprParser<t_real> parser;
-				mat(i,j) = parser.Parse(coltokens[j]);
+				mat(i,j) = geo_str_to_val<t_real>(coltokens[j]);
 			}
 			else
 			{
@@ -171,7 +180,7 @@ t_mat geo_str_to_mat(const std::string& str, const char* _seprow, const char* _s
 // geometry base class
 // ----------------------------------------------------------------------------
 
-Geometry::Geometry()
+Geometry::Geometry(const std::shared_ptr<t_pool>& pool) : m_pool{pool}
 {
 }
 
@@ -194,6 +203,7 @@ Geometry& Geometry::operator=(const Geometry& geo)
 	this->m_portal_id = geo.m_portal_id;
 	this->m_portal_trafo = geo.m_portal_trafo;
 	this->m_portal_det = geo.m_portal_det;
+	this->m_animations = geo.m_animations;
 	this->SetRotation(geo.GetRotation());
 	this->SetPosition(geo.GetPosition());
 
@@ -205,17 +215,17 @@ Geometry& Geometry::operator=(const Geometry& geo)
 }
 
 
-t_vec Geometry::GetPosition() const
+t_vec3 Geometry::GetPosition() const
 {
-	t_vec pos = m::col<t_mat, t_vec>(m_trafo, 3);
-	pos.resize(3);
-	return pos;
+	return m::create<t_vec3>({ m_trafo(0, 3), m_trafo(1, 3), m_trafo(2, 3) });
 }
 
 
-void Geometry::SetPosition(const t_vec& vec)
+void Geometry::SetPosition(const t_vec3& vec)
 {
-	m::set_col<t_mat, t_vec>(m_trafo, vec, 3);
+	for(std::size_t i=0; i<3; ++i)
+		m_trafo(i, 3) = vec[i];
+	m_trafo_changed = true;
 
 #ifdef USE_BULLET
 	SetStateFromMatrix();
@@ -223,15 +233,15 @@ void Geometry::SetPosition(const t_vec& vec)
 }
 
 
-t_mat Geometry::GetRotation() const
+t_mat44 Geometry::GetRotation() const
 {
-	t_mat rot = m_trafo;
+	t_mat44 rot = m_trafo;
 	rot(0,3) = rot(1,3) = rot(2,3) = t_real(0);
 	return rot;
 }
 
 
-void Geometry::SetRotation(const t_mat& rot)
+void Geometry::SetRotation(const t_mat44& rot)
 {
 	// set rotation part
 	for(std::size_t i=0; i<3; ++i)
@@ -239,7 +249,8 @@ void Geometry::SetRotation(const t_mat& rot)
 			m_trafo(i, j) = rot(i, j);
 
 	// ignore translation part for determinant
-	m_det = m::det<t_mat, t_vec>(rot);
+	m_det = m::det<t_mat33, t_vec3>(m::convert<t_mat33>(rot));
+	m_trafo_changed = true;
 
 #ifdef USE_BULLET
 	SetStateFromMatrix();
@@ -247,7 +258,7 @@ void Geometry::SetRotation(const t_mat& rot)
 }
 
 
-void Geometry::SetPortalTrafo(const t_mat& trafo)
+void Geometry::SetPortalTrafo(const t_mat44& trafo)
 {
 	m_portal_trafo = trafo;
 	// ignore translation part for determinant
@@ -256,8 +267,35 @@ void Geometry::SetPortalTrafo(const t_mat& trafo)
 }
 
 
+/**
+ * create an empty geometry object of the given type
+ */
+std::shared_ptr<Geometry> Geometry::create(const std::string& geotype,
+	const std::shared_ptr<t_pool>& pool)
+{
+	if(geotype == "box")
+		return create<BoxGeometry>(pool);
+	else if(geotype == "plane")
+		return create<PlaneGeometry>(pool);
+	else if(geotype == "cylinder")
+		return create<CylinderGeometry>(pool);
+	else if(geotype == "sphere")
+		return create<SphereGeometry>(pool);
+	else if(geotype == "tetrahedron")
+		return create<TetrahedronGeometry>(pool);
+	else if(geotype == "octahedron")
+		return create<OctahedronGeometry>(pool);
+	else if(geotype == "dodecahedron")
+		return create<DodecahedronGeometry>(pool);
+	else if(geotype == "icosahedron")
+		return create<IcosahedronGeometry>(pool);
+
+	return nullptr;
+}
+
+
 std::tuple<bool, std::vector<std::shared_ptr<Geometry>>>
-Geometry::load(const pt::ptree& prop)
+Geometry::load(const pt::ptree& prop, const std::shared_ptr<t_pool>& pool)
 {
 	std::vector<std::shared_ptr<Geometry>> geo_objs;
 	geo_objs.reserve(prop.size());
@@ -269,76 +307,16 @@ Geometry::load(const pt::ptree& prop)
 		std::string geoid = geo.second.get<std::string>("<xmlattr>.id", "");
 		//std::cout << "type = " << geotype << ", id = " << geoid << std::endl;
 
-		if(geotype == "box")
-		{
-			auto box = std::make_shared<BoxGeometry>();
-			box->m_id = geoid;
-
-			if(box->Load(geo.second))
-				geo_objs.emplace_back(std::move(box));
-
-		}
-		else if(geotype == "plane")
-		{
-			auto plane = std::make_shared<PlaneGeometry>();
-			plane->m_id = geoid;
-
-			if(plane->Load(geo.second))
-				geo_objs.emplace_back(std::move(plane));
-		}
-		else if(geotype == "cylinder")
-		{
-			auto cyl = std::make_shared<CylinderGeometry>();
-			cyl->m_id = geoid;
-
-			if(cyl->Load(geo.second))
-				geo_objs.emplace_back(std::move(cyl));
-		}
-		else if(geotype == "sphere")
-		{
-			auto sph = std::make_shared<SphereGeometry>();
-			sph->m_id = geoid;
-
-			if(sph->Load(geo.second))
-				geo_objs.emplace_back(std::move(sph));
-		}
-		else if(geotype == "tetrahedron")
-		{
-			auto tetr = std::make_shared<TetrahedronGeometry>();
-			tetr->m_id = geoid;
-
-			if(tetr->Load(geo.second))
-				geo_objs.emplace_back(std::move(tetr));
-		}
-		else if(geotype == "octahedron")
-		{
-			auto octa = std::make_shared<OctahedronGeometry>();
-			octa->m_id = geoid;
-
-			if(octa->Load(geo.second))
-				geo_objs.emplace_back(std::move(octa));
-		}
-		else if(geotype == "dodecahedron")
-		{
-			auto dode = std::make_shared<DodecahedronGeometry>();
-			dode->m_id = geoid;
-
-			if(dode->Load(geo.second))
-				geo_objs.emplace_back(std::move(dode));
-		}
-		else if(geotype == "icosahedron")
-		{
-			auto icosa = std::make_shared<IcosahedronGeometry>();
-			icosa->m_id = geoid;
-
-			if(icosa->Load(geo.second))
-				geo_objs.emplace_back(std::move(icosa));
-		}
-		else
+		std::shared_ptr<Geometry> geoobj = create(geotype, pool);
+		if(!geoobj)
 		{
 			std::cerr << "Unknown geometry type \"" << geotype << "\"." << std::endl;
 			continue;
 		}
+
+		geoobj->m_id = geoid;
+		if(geoobj->Load(geo.second))
+			geo_objs.emplace_back(std::move(geoobj));
 	}
 
 	return std::make_tuple(true, geo_objs);
@@ -368,11 +346,201 @@ void Geometry::Rotate(t_real angle, char axis)
  */
 void Geometry::Rotate(t_real angle, const t_vec& axis)
 {
-	t_mat R = m::hom_rotation<t_mat, t_vec>(axis, angle);
+	t_mat44 R = m::convert<t_mat44>(m::hom_rotation<t_mat, t_vec>(axis, angle));
 	SetRotation(R * GetRotation());
 }
 
 
+/**
+ * identifier of the mesh shape, objects with equal keys share their triangles
+ * an empty key means that the mesh cannot be shared
+ */
+std::string Geometry::GetMeshKey() const
+{
+	return "";
+}
+
+
+/**
+ * get the triangles of a level of detail, by default there is only the full mesh
+ */
+Geometry::t_triangles Geometry::GetLodTriangles([[maybe_unused]] std::size_t lod) const
+{
+	return GetTriangles();
+}
+
+
+// tessellations of the meshes, indexed by mesh key and level of detail,
+// they are released with the last object referring to them
+static std::mutex g_triangle_cache_mtx{};
+static std::unordered_map<std::string, std::weak_ptr<const Geometry::t_triangles>> g_triangle_cache{};
+static std::size_t g_triangle_cache_pruned_size = 0;
+
+
+/**
+ * insert triangles into the cache unless another object has already done so,
+ * the cache mutex has to be held by the caller
+ */
+static std::shared_ptr<const Geometry::t_triangles> insert_cached_triangles(
+	const std::string& key, const std::shared_ptr<const Geometry::t_triangles>& triags)
+{
+	std::weak_ptr<const Geometry::t_triangles>& entry = g_triangle_cache[key];
+	if(auto existing = entry.lock(); existing)
+		return existing;
+	entry = triags;
+
+	// remove the entries of the released tessellations once the cache has grown
+	if(g_triangle_cache.size() > 2*g_triangle_cache_pruned_size + 64)
+	{
+		std::erase_if(g_triangle_cache, [](const auto& item) -> bool
+		{
+			return item.second.expired();
+		});
+		g_triangle_cache_pruned_size = g_triangle_cache.size();
+	}
+
+	return triags;
+}
+
+
+/**
+ * get the triangles of a level of detail, they are only calculated once per mesh key
+ */
+std::shared_ptr<const Geometry::t_triangles> Geometry::GetCachedTriangles(std::size_t lod) const
+{
+	lod = std::min(lod, GetNumLods() - 1);
+
+	// geometry cannot be shared
+	const std::string mesh_key = GetMeshKey();
+	if(mesh_key == "")
+		return std::make_shared<const t_triangles>(GetLodTriangles(lod));
+
+	const std::string key = mesh_key + "#" + std::to_string(lod);
+	auto& [cached_key, cached_triags] = m_triangles[lod];
+	{
+		std::lock_guard<std::mutex> _lock{g_triangle_cache_mtx};
+		if(cached_triags && cached_key == key)
+			return cached_triags;
+
+		if(auto iter = g_triangle_cache.find(key); iter != g_triangle_cache.end())
+		{
+			if(auto triags = iter->second.lock(); triags)
+			{
+				cached_key = key;
+				cached_triags = triags;
+				return triags;
+			}
+		}
+	}
+
+	// tessellate outside the lock
+	auto triags = std::make_shared<const t_triangles>(GetLodTriangles(lod));
+
+	std::lock_guard<std::mutex> _lock{g_triangle_cache_mtx};
+	cached_key = key;
+	cached_triags = insert_cached_triangles(key, triags);
+	return cached_triags;
+}
+
+
+/**
+ * use a tessellation that is already known, e.g. from a baked scene file,
+ * it is shared with the objects having the same mesh key
+ */
+void Geometry::SetCachedTriangles(std::size_t lod, const std::shared_ptr<const t_triangles>& triags)
+{
+	const std::string mesh_key = GetMeshKey();
+	if(mesh_key == "" || !triags || lod >= GetNumLods())
+		return;
+
+	const std::string key = mesh_key + "#" + std::to_string(lod);
+
+	std::lock_guard<std::mutex> _lock{g_triangle_cache_mtx};
+	g_triangle_cache[key] = triags;
+	m_triangles[lod] = std::make_pair(key, triags);
+}
+
+
+#ifdef USE_BULLET
+/**
+ * primitive type and dimensions of a collision shape
+ */
+struct ShapeKey
+{
+	std::type_index type;
+	btScalar dims[3];
+
+	bool operator==(const ShapeKey& key) const
+	{
+		return type == key.type && dims[0] == key.dims[0] &&
+			dims[1] == key.dims[1] && dims[2] == key.dims[2];
+	}
+};
+
+
+struct ShapeKeyHash
+{
+	std::size_t operator()(const ShapeKey& key) const
+	{
+		std::size_t hash = key.type.hash_code();
+		for(btScalar dim : key.dims)
+			hash ^= std::hash<btScalar>{}(dim) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+		return hash;
+	}
+};
+
+
+// collision shapes, they are released with the last rigid body using them
+static std::mutex g_shape_cache_mtx{};
+static std::unordered_map<ShapeKey, std::weak_ptr<btConvexInternalShape>, ShapeKeyHash> g_shape_cache{};
+static std::size_t g_shape_cache_pruned_size = 0;
+
+
+/**
+ * get the shape with the given type and dimensions, it is only created if no object uses it yet;
+ * the shapes are immutable, as bullet's scaling would apply to all of their rigid bodies
+ */
+template<class t_shape>
+static std::shared_ptr<btConvexInternalShape> get_cached_shape(const btVector3& dims,
+	const std::function<std::shared_ptr<t_shape>()>& create_shape)
+{
+	const ShapeKey key{ .type = typeid(t_shape), .dims = { dims[0], dims[1], dims[2] } };
+
+	std::lock_guard<std::mutex> _lock{g_shape_cache_mtx};
+	std::weak_ptr<btConvexInternalShape>& entry = g_shape_cache[key];
+	if(std::shared_ptr<btConvexInternalShape> shape = entry.lock(); shape)
+		return shape;
+
+	std::shared_ptr<btConvexInternalShape> shape = create_shape();
+	entry = shape;
+
+	// remove the entries of the released shapes once the cache has grown
+	if(g_shape_cache.size() > 2*g_shape_cache_pruned_size + 64)
+	{
+		std::erase_if(g_shape_cache, [](const auto& item) -> bool
+		{
+			return item.second.expired();
+		});
+		g_shape_cache_pruned_size = g_shape_cache.size();
+	}
+
+	return shape;
+}
+
+
+/**
+ * box shape with the given half extents
+ */
+static std::shared_ptr<btConvexInternalShape> get_cached_box(const btVector3& half_extents)
+{
+	return get_cached_shape<btBoxShape>(half_extents, [&half_extents]()
+	{
+		return std::make_shared<btBoxShape>(half_extents);
+	});
+}
+#endif
+
+
 void Geometry::tick([[maybe_unused]] const std::chrono::milliseconds& ms)
 {
 #ifdef USE_BULLET
@@ -391,6 +559,10 @@ void Geometry::SetMatrixFromState()
 	if(!m_rigid_body)
 		return;
 
+	// sleeping and static bodies don't move
+	if(!m_rigid_body->isActive() || m_rigid_body->isStaticObject())
+		return;
+
 	btTransform trafo;
 	m_rigid_body->getMotionState()->getWorldTransform(trafo);
 	btMatrix3x3 mat = trafo.getBasis();
@@ -403,6 +575,8 @@ void Geometry::SetMatrixFromState()
 
 		m_trafo(row, 3) = vec[row];
 	}
+
+	m_trafo_changed = true;
 }
 
 
@@ -414,21 +588,21 @@ void Geometry::SetStateFromMatrix()
 	if(!m_state)
 		return;
 
-	t_mat rot = GetRotation();
-	t_vec pos = GetPosition();
+	// read rotation and translation directly from the fixed-size matrix
+	const t_mat44& trafo = m_trafo;
 
 	btMatrix3x3 mat
 	{
-		btScalar(rot(0,0)), btScalar(rot(0,1)), btScalar(rot(0,2)),
-		btScalar(rot(1,0)), btScalar(rot(1,1)), btScalar(rot(1,2)),
-		btScalar(rot(2,0)), btScalar(rot(2,1)), btScalar(rot(2,2))
+		btScalar(trafo(0,0)), btScalar(trafo(0,1)), btScalar(trafo(0,2)),
+		btScalar(trafo(1,0)), btScalar(trafo(1,1)), btScalar(trafo(1,2)),
+		btScalar(trafo(2,0)), btScalar(trafo(2,1)), btScalar(trafo(2,2))
 	};
 
 	btVector3 vec
 	{
-		btScalar(pos[0]),
-		btScalar(pos[1]),
-		btScalar(pos[2])
+		btScalar(trafo(0,3)),
+		btScalar(trafo(1,3)),
+		btScalar(trafo(2,3))
 	};
 
 	btTransform trafo{mat, vec};
@@ -455,6 +629,27 @@ void Geometry::CreateRigidBody()
 void Geometry::UpdateRigidBody()
 {
 }
+
+
+void Geometry::SetShape(const std::shared_ptr<btConvexInternalShape>& shape)
+{
+	if(shape == m_shape)
+		return;
+
+	// the rigid body refers to the shape until it is replaced
+	std::shared_ptr<btConvexInternalShape> old_shape = m_shape;
+	m_shape = shape;
+	if(m_rigid_body)
+		m_rigid_body->setCollisionShape(m_shape.get());
+}
+
+
+void Geometry::SwapRigidBody(Geometry& geo)
+{
+	std::swap(m_shape, geo.m_shape);
+	std::swap(m_state, geo.m_state);
+	std::swap(m_rigid_body, geo.m_rigid_body);
+}
 #endif
 
 
@@ -465,20 +660,23 @@ std::vector<ObjectProperty> Geometry::GetProperties() const
 {
 	std::vector<ObjectProperty> props;
 
-	props.emplace_back(ObjectProperty{.key="position", .value=GetPosition()});
-	props.emplace_back(ObjectProperty{.key="rotation", .value=GetRotation()});
+	props.emplace_back(ObjectProperty{.key="position", .value=m::convert<t_vec>(GetPosition())});
+	props.emplace_back(ObjectProperty{.key="rotation", .value=m::convert<t_mat>(GetRotation())});
 	props.emplace_back(ObjectProperty{.key="fixed", .value=IsFixed()});
-	props.emplace_back(ObjectProperty{.key="colour", .value=GetColour()});
+	props.emplace_back(ObjectProperty{.key="colour", .value=m::convert<t_vec>(GetColour())});
 	props.emplace_back(ObjectProperty{.key="lighting", .value=IsLightingEnabled()});
 	props.emplace_back(ObjectProperty{.key="light_id", .value=GetLightId()});
 	props.emplace_back(ObjectProperty{.key="texture", .value=GetTexture()});
 	props.emplace_back(ObjectProperty{.key="portal_id", .value=GetPortalId()});
-	props.emplace_back(ObjectProperty{.key="portal_trafo", .value=GetPortalTrafo()});
+	props.emplace_back(ObjectProperty{.key="portal_trafo", .value=m::convert<t_mat>(GetPortalTrafo())});
 
 #ifdef USE_BULLET
 	props.emplace_back(ObjectProperty{.key="mass", .value=m_mass});
 #endif
 
+	for(const auto& [key, expr] : m_animations)
+		props.emplace_back(ObjectProperty{.key="anim_" + key, .value=expr});
+
 	return props;
 }
 
@@ -491,13 +689,13 @@ void Geometry::SetProperties(const std::vector<ObjectProperty>& props)
 	for(const auto& prop : props)
 	{
 		if(prop.key == "position")
-			SetPosition(std::get<t_vec>(prop.value));
+			SetPosition(m::convert<t_vec3>(std::get<t_vec>(prop.value)));
 		else if(prop.key == "rotation")
-			SetRotation(std::get<t_mat>(prop.value));
+			SetRotation(m::convert<t_mat44>(std::get<t_mat>(prop.value)));
 		else if(prop.key == "fixed")
 			SetFixed(std::get<bool>(prop.value));
 		else if(prop.key == "colour")
-			SetColour(std::get<t_vec>(prop.value));
+			SetColour(m::convert<t_vec3>(std::get<t_vec>(prop.value)));
 		else if(prop.key == "lighting")
 			SetLighting(std::get<bool>(prop.value));
 		else if(prop.key == "light_id")
@@ -507,11 +705,37 @@ void Geometry::SetProperties(const std::vector<ObjectProperty>& props)
 		else if(prop.key == "portal_id")
 			SetPortalId(std::get<int>(prop.value));
 		else if(prop.key == "portal_trafo")
-			SetPortalTrafo(std::get<t_mat>(prop.value));
+			SetPortalTrafo(m::convert<t_mat44>(std::get<t_mat>(prop.value)));
 #ifdef USE_BULLET
 		else if(prop.key == "mass")
 			m_mass = std::get<t_real>(prop.value);
 #endif
+		else if(prop.key.starts_with("anim_"))
+			SetAnimation(prop.key.substr(5), std::get<std::string>(prop.value));
+	}
+}
+
+
+/**
+ * set or, for an empty expression, remove the animation of a property
+ */
+void Geometry::SetAnimation(const std::string& key, const std::string& expr)
+{
+	auto iter = std::find_if(m_animations.begin(), m_animations.end(),
+		[&key](const auto& anim) -> bool { return anim.first == key; });
+
+	if(expr == "")
+	{
+		if(iter != m_animations.end())
+			m_animations.erase(iter);
+	}
+	else if(iter != m_animations.end())
+	{
+		iter->second = expr;
+	}
+	else
+	{
+		m_animations.emplace_back(std::make_pair(key, expr));
 	}
 }
 
@@ -520,11 +744,11 @@ bool Geometry::Load(const pt::ptree& prop)
 {
 	// position
 	if(auto optPos = prop.get_optional<std::string>("position"); optPos)
-		SetPosition(geo_str_to_vec(*optPos));
+		SetPosition(m::convert<t_vec3>(geo_str_to_vec(*optPos)));
 
 	// rotation
 	if(auto optRot = prop.get_optional<std::string>("rotation"); optRot)
-		SetRotation(geo_str_to_mat(*optRot));
+		SetRotation(m::convert<t_mat44>(geo_str_to_mat(*optRot)));
 
 	// fixed
 	if(auto optFixed = prop.get_optional<bool>("fixed"); optFixed)
@@ -533,9 +757,10 @@ bool Geometry::Load(const pt::ptree& prop)
 	// colour
 	if(auto col = prop.get_optional<std::string>("colour"); col)
 	{
-		m_colour = geo_str_to_vec(*col);
-		if(m_colour.size() < 3)
-			m_colour.resize(3);
+		t_vec colour = geo_str_to_vec(*col);
+		if(colour.size() < 3)
+			colour.resize(3);
+		m_colour = m::convert<t_vec3>(colour);
 	}
 
 	// lighting
@@ -554,13 +779,24 @@ bool Geometry::Load(const pt::ptree& prop)
 	if(auto optPort = prop.get_optional<int>("portal_id"); optPort)
 		SetPortalId(*optPort);
 	if(auto optPort = prop.get_optional<std::string>("portal_trafo"); optPort)
-		SetPortalTrafo(geo_str_to_mat(*optPort));
+		SetPortalTrafo(m::convert<t_mat44>(geo_str_to_mat(*optPort)));
 
 #ifdef USE_BULLET
 	if(auto optMass = prop.get_optional<std::string>("mass"); optMass)
 		m_mass = geo_str_to_val<t_real>(*optMass);
 #endif
 
+	// animated properties
+	m_animations.clear();
+	if(auto anims = prop.get_child_optional("animation"); anims)
+	{
+		for(const auto& [key, expr] : *anims)
+		{
+			if(key != "<xmlattr>")
+				SetAnimation(key, expr.get_value<std::string>());
+		}
+	}
+
 	return true;
 }
 
@@ -570,20 +806,23 @@ pt::ptree Geometry::Save() const
 	pt::ptree prop;
 
 	prop.put<std::string>("<xmlattr>.id", GetId());
-	prop.put<std::string>("position", geo_vec_to_str(GetPosition()));
-	prop.put<std::string>("rotation", geo_mat_to_str(GetRotation()));
+	prop.put<std::string>("position", geo_vec_to_str(m::convert<t_vec>(GetPosition())));
+	prop.put<std::string>("rotation", geo_mat_to_str(m::convert<t_mat>(GetRotation())));
 	prop.put<std::string>("fixed", IsFixed() ? "1" : "0");
-	prop.put<std::string>("colour", geo_vec_to_str(GetColour()));
+	prop.put<std::string>("colour", geo_vec_to_str(m::convert<t_vec>(GetColour())));
 	prop.put<std::string>("lighting", IsLightingEnabled() ? "1" : "0");
 	prop.put<std::string>("light_id", geo_val_to_str(GetLightId()));
 	prop.put<std::string>("texture", GetTexture());
 	prop.put<std::string>("portal_id", geo_val_to_str(GetPortalId()));
-	prop.put<std::string>("portal_trafo", geo_mat_to_str(GetPortalTrafo()));
+	prop.put<std::string>("portal_trafo", geo_mat_to_str(m::convert<t_mat>(GetPortalTrafo())));
 
 #ifdef USE_BULLET
 	prop.put<t_real>("mass", m_mass);
 #endif
 
+	for(const auto& [key, expr] : m_animations)
+		prop.put<std::string>("animation." + key, expr);
+
 	return prop;
 }
 // ----------------------------------------------------------------------------
@@ -594,7 +833,7 @@ pt::ptree Geometry::Save() const
 // plane
 // ----------------------------------------------------------------------------
 
-PlaneGeometry::PlaneGeometry() : Geometry()
+PlaneGeometry::PlaneGeometry(const std::shared_ptr<t_pool>& pool) : Geometry(pool)
 {
 #ifdef USE_BULLET
 	CreateRigidBody();
@@ -625,9 +864,7 @@ PlaneGeometry& PlaneGeometry::operator=(const Geometry& _geo)
 
 std::shared_ptr<Geometry> PlaneGeometry::clone() const
 {
-	auto geo = std::make_shared<PlaneGeometry>();
-	geo->operator=(dynamic_cast<const Geometry&>(*this));
-	return geo;
+	return CloneInPool<PlaneGeometry>();
 }
 
 
@@ -664,10 +901,10 @@ void PlaneGeometry::SetHeight(t_real h)
 #ifdef USE_BULLET
 void PlaneGeometry::CreateRigidBody()
 {
-	m_state = std::make_shared<btDefaultMotionState>();
+	m_state = make_pooled<btDefaultMotionState>(m_pool);
 	SetStateFromMatrix();
 
-	m_shape = std::make_shared<btBoxShape>(
+	m_shape = get_cached_box(
 		btVector3
 		{
 			btScalar(m_width * 0.5),
@@ -675,7 +912,7 @@ void PlaneGeometry::CreateRigidBody()
 			btScalar(0.01)
 		});
 
-	m_rigid_body = std::make_shared<btRigidBody>(
+	m_rigid_body = make_pooled<btRigidBody>(m_pool,
 		btRigidBody::btRigidBodyConstructionInfo{
 			0, m_state.get(), m_shape.get(),
 			{0, 0, 0}});
@@ -687,13 +924,13 @@ void PlaneGeometry::UpdateRigidBody()
 	if(!m_rigid_body)
 		return;
 
-	m_shape->setImplicitShapeDimensions(
+	SetShape(get_cached_box(
 		btVector3
 		{
 			btScalar(m_width * 0.5),
 			btScalar(m_height * 0.5),
 			btScalar(0.01)
-		});
+		}));
 }
 #endif
 
@@ -747,6 +984,16 @@ PlaneGeometry::GetTriangles() const
 }
 
 
+/**
+ * identifier of the mesh shape
+ */
+std::string PlaneGeometry::GetMeshKey() const
+{
+	return "plane:" + geo_vec_to_str(m_norm, ",") + ":"
+		+ geo_val_to_str(m_width) + ":" + geo_val_to_str(m_height);
+}
+
+
 /**
  * obtain all defining properties of the geometry object
  */
@@ -792,7 +1039,7 @@ void PlaneGeometry::SetProperties(const std::vector<ObjectProperty>& props)
 // box
 // ----------------------------------------------------------------------------
 
-BoxGeometry::BoxGeometry() : Geometry()
+BoxGeometry::BoxGeometry(const std::shared_ptr<t_pool>& pool) : Geometry(pool)
 {
 #ifdef USE_BULLET
 	CreateRigidBody();
@@ -823,9 +1070,7 @@ BoxGeometry& BoxGeometry::operator=(const Geometry& _geo)
 
 std::shared_ptr<Geometry> BoxGeometry::clone() const
 {
-	auto geo = std::make_shared<BoxGeometry>();
-	geo->operator=(dynamic_cast<const Geometry&>(*this));
-	return geo;
+	return CloneInPool<BoxGeometry>();
 }
 
 
@@ -865,7 +1110,7 @@ void BoxGeometry::CreateRigidBody()
 	btScalar mass = m_fixed ? btScalar(0) : btScalar(m_mass);
 	btVector3 com{0, 0, 0};
 
-	m_shape = std::make_shared<btBoxShape>(
+	m_shape = get_cached_box(
 		btVector3
 		{
 			btScalar(m_length * 0.5),
@@ -875,10 +1120,10 @@ void BoxGeometry::CreateRigidBody()
 
 	m_shape->calculateLocalInertia(mass, com);
 
-	m_state = std::make_shared<btDefaultMotionState>();
+	m_state = make_pooled<btDefaultMotionState>(m_pool);
 	SetStateFromMatrix();
 
-	m_rigid_body = std::make_shared<btRigidBody>(
+	m_rigid_body = make_pooled<btRigidBody>(m_pool,
 		btRigidBody::btRigidBodyConstructionInfo{
 			mass,
 			m_state.get(), m_shape.get(),
@@ -891,13 +1136,13 @@ void BoxGeometry::UpdateRigidBody()
 	if(!m_rigid_body)
 		return;
 
-	m_shape->setImplicitShapeDimensions(
+	SetShape(get_cached_box(
 		btVector3
 		{
 			btScalar(m_length * 0.5),
 			btScalar(m_depth * 0.5),
 			btScalar(m_height * 0.5),
-		});
+		}));
 
 	btScalar mass = m_fixed ? btScalar(0) : btScalar(m_mass);
 	btVector3 com{0, 0, 0};
@@ -949,6 +1194,16 @@ BoxGeometry::GetTriangles() const
 }
 
 
+/**
+ * identifier of the mesh shape
+ */
+std::string BoxGeometry::GetMeshKey() const
+{
+	return "box:" + geo_val_to_str(m_length) + ":"
+		+ geo_val_to_str(m_depth) + ":" + geo_val_to_str(m_height);
+}
+
+
 /**
  * obtain all defining properties of the geometry object
  */
@@ -994,7 +1249,7 @@ void BoxGeometry::SetProperties(const std::vector<ObjectProperty>& props)
 // cylinder
 // ----------------------------------------------------------------------------
 
-CylinderGeometry::CylinderGeometry() : Geometry()
+CylinderGeometry::CylinderGeometry(const std::shared_ptr<t_pool>& pool) : Geometry(pool)
 {
 #ifdef USE_BULLET
 	CreateRigidBody();
@@ -1024,9 +1279,7 @@ CylinderGeometry& CylinderGeometry::operator=(const Geometry& _geo)
 
 std::shared_ptr<Geometry> CylinderGeometry::clone() const
 {
-	auto geo = std::make_shared<CylinderGeometry>();
-	geo->operator=(dynamic_cast<const Geometry&>(*this));
-	return geo;
+	return CloneInPool<CylinderGeometry>();
 }
 
 
@@ -1056,20 +1309,24 @@ void CylinderGeometry::CreateRigidBody()
 	btScalar mass = m_fixed ? btScalar(0) : btScalar(m_mass);
 	btVector3 com{0, 0, 0};
 
-	m_shape = std::make_shared<btCylinderShapeZ>(
-		btVector3
-		{
-			btScalar(m_radius),
-			btScalar(0.),
-			btScalar(m_height * 0.5),
-		});
+	const btVector3 half_extents
+	{
+		btScalar(m_radius),
+		btScalar(0.),
+		btScalar(m_height * 0.5),
+	};
+
+	m_shape = get_cached_shape<btCylinderShapeZ>(half_extents, [&half_extents]()
+	{
+		return std::make_shared<btCylinderShapeZ>(half_extents);
+	});
 
 	m_shape->calculateLocalInertia(mass, com);
 
-	m_state = std::make_shared<btDefaultMotionState>();
+	m_state = make_pooled<btDefaultMotionState>(m_pool);
 	SetStateFromMatrix();
 
-	m_rigid_body = std::make_shared<btRigidBody>(
+	m_rigid_body = make_pooled<btRigidBody>(m_pool,
 		btRigidBody::btRigidBodyConstructionInfo{
 			mass,
 			m_state.get(), m_shape.get(),
@@ -1082,13 +1339,17 @@ void CylinderGeometry::UpdateRigidBody()
 	if(!m_rigid_body)
 		return;
 
-	m_shape->setImplicitShapeDimensions(
-		btVector3
-		{
-			btScalar(m_radius),
-			btScalar(0.),
-			btScalar(m_height * 0.5),
-		});
+	const btVector3 half_extents
+	{
+		btScalar(m_radius),
+		btScalar(0.),
+		btScalar(m_height * 0.5),
+	};
+
+	SetShape(get_cached_shape<btCylinderShapeZ>(half_extents, [&half_extents]()
+	{
+		return std::make_shared<btCylinderShapeZ>(half_extents);
+	}));
 
 	btScalar mass = m_fixed ? btScalar(0) : btScalar(m_mass);
 	btVector3 com{0, 0, 0};
@@ -1130,13 +1391,32 @@ pt::ptree CylinderGeometry::Save() const
 std::tuple<std::vector<t_vec>, std::vector<t_vec>, std::vector<t_vec>>
 CylinderGeometry::GetTriangles() const
 {
-	auto solid = m::create_cylinder<t_vec>(m_radius, m_height, 1, 32);
+	return GetLodTriangles(0);
+}
+
+
+/**
+ * halve the number of segments per level of detail
+ */
+Geometry::t_triangles CylinderGeometry::GetLodTriangles(std::size_t lod) const
+{
+	const int numsegs = 32 >> std::min<std::size_t>(lod, MAX_LODS - 1);
+	auto solid = m::create_cylinder<t_vec>(m_radius, m_height, 1, numsegs);
 	auto [verts, norms, uvs] = m::create_triangles<t_vec>(solid);
 
 	return std::make_tuple(verts, norms, uvs);
 }
 
 
+/**
+ * identifier of the mesh shape
+ */
+std::string CylinderGeometry::GetMeshKey() const
+{
+	return "cylinder:" + geo_val_to_str(m_radius) + ":" + geo_val_to_str(m_height);
+}
+
+
 /**
  * obtain all defining properties of the geometry object
  */
@@ -1179,7 +1459,7 @@ void CylinderGeometry::SetProperties(const std::vector<ObjectProperty>& props)
 // sphere
 // ----------------------------------------------------------------------------
 
-SphereGeometry::SphereGeometry() : Geometry()
+SphereGeometry::SphereGeometry(const std::shared_ptr<t_pool>& pool) : Geometry(pool)
 {
 #ifdef USE_BULLET
 	CreateRigidBody();
@@ -1208,9 +1488,7 @@ SphereGeometry& SphereGeometry::operator=(const Geometry& _geo)
 
 std::shared_ptr<Geometry> SphereGeometry::clone() const
 {
-	auto geo = std::make_shared<SphereGeometry>();
-	geo->operator=(dynamic_cast<const Geometry&>(*this));
-	return geo;
+	return CloneInPool<SphereGeometry>();
 }
 
 
@@ -1230,12 +1508,16 @@ void SphereGeometry::CreateRigidBody()
 	btScalar mass = m_fixed ? btScalar(0) : btScalar(m_mass);
 	btVector3 com{0, 0, 0};
 
-	m_shape = std::make_shared<btSphereShape>(btScalar(m_radius));
+	const btScalar radius = btScalar(m_radius);
+	m_shape = get_cached_shape<btSphereShape>(btVector3{ radius, radius, radius }, [radius]()
+	{
+		return std::make_shared<btSphereShape>(radius);
+	});
 	m_shape->calculateLocalInertia(mass, com);
-	m_state = std::make_shared<btDefaultMotionState>();
+	m_state = make_pooled<btDefaultMotionState>(m_pool);
 	SetStateFromMatrix();
 
-	m_rigid_body = std::make_shared<btRigidBody>(
+	m_rigid_body = make_pooled<btRigidBody>(m_pool,
 		btRigidBody::btRigidBodyConstructionInfo{
 			mass,
 			m_state.get(), m_shape.get(),
@@ -1248,13 +1530,11 @@ void SphereGeometry::UpdateRigidBody()
 	if(!m_rigid_body)
 		return;
 
-	m_shape->setImplicitShapeDimensions(
-		btVector3
-		{
-			btScalar(m_radius),
-			btScalar(m_radius),
-			btScalar(m_radius),
-		});
+	const btScalar radius = btScalar(m_radius);
+	SetShape(get_cached_shape<btSphereShape>(btVector3{ radius, radius, radius }, [radius]()
+	{
+		return std::make_shared<btSphereShape>(radius);
+	}));
 
 	btScalar mass = m_fixed ? btScalar(0) : btScalar(m_mass);
 	btVector3 com{0, 0, 0};
@@ -1295,7 +1575,16 @@ pt::ptree SphereGeometry::Save() const
 std::tuple<std::vector<t_vec>, std::vector<t_vec>, std::vector<t_vec>>
 SphereGeometry::GetTriangles() const
 {
-	const int numsubdivs = 2;
+	return GetLodTriangles(0);
+}
+
+
+/**
+ * one subdivision less per level of detail: 320, 80, and 20 triangles
+ */
+Geometry::t_triangles SphereGeometry::GetLodTriangles(std::size_t lod) const
+{
+	const int numsubdivs = int(MAX_LODS - 1) - int(std::min<std::size_t>(lod, MAX_LODS - 1));
 	auto solid = m::create_icosahedron<t_vec>(1.);
 	auto [verts, norms, uvs] = m::spherify<t_vec>(
 		m::subdivide_triangles<t_vec>(
@@ -1307,6 +1596,15 @@ SphereGeometry::GetTriangles() const
 }
 
 
+/**
+ * identifier of the mesh shape
+ */
+std::string SphereGeometry::GetMeshKey() const
+{
+	return "sphere:" + geo_val_to_str(m_radius);
+}
+
+
 /**
  * obtain all defining properties of the geometry object
  */
@@ -1346,7 +1644,7 @@ void SphereGeometry::SetProperties(const std::vector<ObjectProperty>& props)
 // tetrahedron
 // ----------------------------------------------------------------------------
 
-TetrahedronGeometry::TetrahedronGeometry() : Geometry()
+TetrahedronGeometry::TetrahedronGeometry(const std::shared_ptr<t_pool>& pool) : Geometry(pool)
 {
 }
 
@@ -1372,9 +1670,7 @@ TetrahedronGeometry& TetrahedronGeometry::operator=(const Geometry& _geo)
 
 std::shared_ptr<Geometry> TetrahedronGeometry::clone() const
 {
-	auto geo = std::make_shared<TetrahedronGeometry>();
-	geo->operator=(dynamic_cast<const Geometry&>(*this));
-	return geo;
+	return CloneInPool<TetrahedronGeometry>();
 }
 
 
@@ -1411,6 +1707,15 @@ TetrahedronGeometry::GetTriangles() const
 }
 
 
+/**
+ * identifier of the mesh shape
+ */
+std::string TetrahedronGeometry::GetMeshKey() const
+{
+	return "tetrahedron:" + geo_val_to_str(m_radius);
+}
+
+
 /**
  * obtain all defining properties of the geometry object
  */
@@ -1445,7 +1750,7 @@ void TetrahedronGeometry::SetProperties(const std::vector<ObjectProperty>& props
 // octahedron
 // ----------------------------------------------------------------------------
 
-OctahedronGeometry::OctahedronGeometry() : Geometry()
+OctahedronGeometry::OctahedronGeometry(const std::shared_ptr<t_pool>& pool) : Geometry(pool)
 {
 }
 
@@ -1471,9 +1776,7 @@ OctahedronGeometry& OctahedronGeometry::operator=(const Geometry& _geo)
 
 std::shared_ptr<Geometry> OctahedronGeometry::clone() const
 {
-	auto geo = std::make_shared<OctahedronGeometry>();
-	geo->operator=(dynamic_cast<const Geometry&>(*this));
-	return geo;
+	return CloneInPool<OctahedronGeometry>();
 }
 
 
@@ -1510,6 +1813,15 @@ OctahedronGeometry::GetTriangles() const
 }
 
 
+/**
+ * identifier of the mesh shape
+ */
+std::string OctahedronGeometry::GetMeshKey() const
+{
+	return "octahedron:" + geo_val_to_str(m_radius);
+}
+
+
 /**
  * obtain all defining properties of the geometry object
  */
@@ -1544,7 +1856,7 @@ void OctahedronGeometry::SetProperties(const std::vector<ObjectProperty>& props)
 // dodecahedron
 // ----------------------------------------------------------------------------
 
-DodecahedronGeometry::DodecahedronGeometry() : Geometry()
+DodecahedronGeometry::DodecahedronGeometry(const std::shared_ptr<t_pool>& pool) : Geometry(pool)
 {
 }
 
@@ -1570,9 +1882,7 @@ DodecahedronGeometry& DodecahedronGeometry::operator=(const Geometry& _geo)
 
 std::shared_ptr<Geometry> DodecahedronGeometry::clone() const
 {
-	auto geo = std::make_shared<DodecahedronGeometry>();
-	geo->operator=(dynamic_cast<const Geometry&>(*this));
-	return geo;
+	return CloneInPool<DodecahedronGeometry>();
 }
 
 
@@ -1612,6 +1922,15 @@ DodecahedronGeometry::GetTriangles() const
 }
 
 
+/**
+ * identifier of the mesh shape
+ */
+std::string DodecahedronGeometry::GetMeshKey() const
+{
+	return "dodecahedron:" + geo_val_to_str(m_radius);
+}
+
+
 /**
  * obtain all defining properties of the geometry object
  */
@@ -1646,7 +1965,7 @@ void DodecahedronGeometry::SetProperties(const std::vector<ObjectProperty>& prop
 // icosahedron
 // ----------------------------------------------------------------------------
 
-IcosahedronGeometry::IcosahedronGeometry() : Geometry()
+IcosahedronGeometry::IcosahedronGeometry(const std::shared_ptr<t_pool>& pool) : Geometry(pool)
 {
 }
 
@@ -1672,9 +1991,7 @@ IcosahedronGeometry& IcosahedronGeometry::operator=(const Geometry& _geo)
 
 std::shared_ptr<Geometry> IcosahedronGeometry::clone() const
 {
-	auto geo = std::make_shared<IcosahedronGeometry>();
-	geo->operator=(dynamic_cast<const Geometry&>(*this));
-	return geo;
+	return CloneInPool<IcosahedronGeometry>();
 }
 
 
@@ -1711,6 +2028,15 @@ IcosahedronGeometry::GetTriangles() const
 }
 
 
+/**
+ * identifier of the mesh shape
+ */
+std::string IcosahedronGeometry::GetMeshKey() const
+{
+	return "icosahedron:" + geo_val_to_str(m_radius);
+}
+
+
 /**
  * obtain all defining properties of the geometry object
  */
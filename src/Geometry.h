@@ -10,6 +10,7 @@
 #define __GEO_OBJ_H__
 
 #include <tuple>
+#include <array>
 #include <memory>
 #include <string>
 #include <variant>
@@ -24,6 +25,7 @@
 #endif
 
 #include "types.h"
+#include "common/Pool.h"
 
 
 // ----------------------------------------------------------------------------
@@ -69,39 +71,68 @@ struct ObjectProperty
 class Geometry
 {
 public:
-	Geometry();
+	// vertices, normals, and uv coordinates of the triangles
+	using t_triangles = std::tuple<std::vector<t_vec>, std::vector<t_vec>, std::vector<t_vec>>;
+
+	// maximum number of levels of detail of a mesh
+	static constexpr std::size_t MAX_LODS = 3;
+
+
+public:
+	explicit Geometry(const std::shared_ptr<t_pool>& pool = nullptr);
 	virtual ~Geometry();
 
 	virtual Geometry& operator=(const Geometry& geo);
 	virtual std::shared_ptr<Geometry> clone() const = 0;
 
+	// type name, as used in the scene files
+	virtual const char* GetType() const = 0;
+
 	virtual bool Load(const boost::property_tree::ptree& prop);
 	virtual boost::property_tree::ptree Save() const;
 
-	virtual const t_mat& GetTrafo() const { return m_trafo; }
-	virtual void SetTrafo(const t_mat& trafo) { m_trafo = trafo; }
+	virtual const t_mat44& GetTrafo() const { return m_trafo; }
+	virtual void SetTrafo(const t_mat44& trafo) { m_trafo = trafo; m_trafo_changed = true; }
 
-	virtual t_vec GetPosition() const;
-	virtual void SetPosition(const t_vec& vec);
+	// has the transformation changed since the last scene update?
+	bool IsTrafoChanged() const { return m_trafo_changed; }
+	void SetTrafoChanged(bool b) { m_trafo_changed = b; }
 
-	virtual t_mat GetRotation() const;
-	virtual void SetRotation(const t_mat& rot);
+	virtual t_vec3 GetPosition() const;
+	virtual void SetPosition(const t_vec3& vec);
+
+	virtual t_mat44 GetRotation() const;
+	virtual void SetRotation(const t_mat44& rot);
 	virtual t_real GetDeterminant() const { return m_det; }
 
 	virtual std::tuple<std::vector<t_vec>, std::vector<t_vec>, std::vector<t_vec>>
 		GetTriangles() const = 0;
+	virtual std::string GetMeshKey() const;
+
+	// coarser tessellations, lod 0 is the full-detail mesh
+	virtual std::size_t GetNumLods() const { return 1; }
+	virtual t_triangles GetLodTriangles(std::size_t lod) const;
+
+	// triangles shared between all objects with the same mesh key,
+	// they are kept as long as one of these objects refers to them
+	std::shared_ptr<const t_triangles> GetCachedTriangles(std::size_t lod = 0) const;
+	void SetCachedTriangles(std::size_t lod, const std::shared_ptr<const t_triangles>& triags);
 
 	virtual const std::string& GetId() const { return m_id; }
 	virtual void SetId(const std::string& id) { m_id = id; }
 
+	// handle assigned by the scene, 0: not in a scene
+	std::size_t GetHandle() const { return m_handle; }
+	void SetHandle(std::size_t handle) { m_handle = handle; }
+
 	virtual bool IsFixed() const { return m_fixed; }
 	virtual void SetFixed(bool b) { m_fixed = b; }
 
 	virtual int GetPortalId() const { return m_portal_id; }
 	virtual void SetPortalId(int id) { m_portal_id = id; }
 
-	virtual const t_mat& GetPortalTrafo() const { return m_portal_trafo; }
-	virtual void SetPortalTrafo(const t_mat& trafo);
+	virtual const t_mat44& GetPortalTrafo() const { return m_portal_trafo; }
+	virtual void SetPortalTrafo(const t_mat44& trafo);
 	virtual t_real GetPortalDeterminant() const { return m_portal_det; }
 
 	virtual bool IsLightingEnabled() const { return m_lighting; }
@@ -109,8 +140,8 @@ public:
 	virtual int GetLightId() const { return m_light_id; }
 	virtual void SetLightId(int id) { m_light_id = id; }
 
-	virtual const t_vec& GetColour() const { return m_colour; }
-	virtual void SetColour(const t_vec& col) { m_colour = col; }
+	virtual const t_vec3& GetColour() const { return m_colour; }
+	virtual void SetColour(const t_vec3& col) { m_colour = col; }
 
 	virtual const std::string& GetTexture() const { return m_texture; }
 	virtual void SetTexture(std::string ident) { m_texture = ident; }
@@ -121,10 +152,25 @@ public:
 	virtual std::vector<ObjectProperty> GetProperties() const ;
 	virtual void SetProperties(const std::vector<ObjectProperty>& props);
 
+	// expressions of the time t animating a property, e.g. position = "3*sin(t); 0; 1"
+	const std::vector<std::pair<std::string, std::string>>& GetAnimations() const { return m_animations; }
+	void SetAnimation(const std::string& key, const std::string& expr);
+
 	virtual void tick(const std::chrono::milliseconds& ms);
 
+	// the objects are allocated from the pool, or on the heap without one
 	static std::tuple<bool, std::vector<std::shared_ptr<Geometry>>>
-		load(const boost::property_tree::ptree& prop);
+		load(const boost::property_tree::ptree& prop, const std::shared_ptr<t_pool>& pool = nullptr);
+	static std::shared_ptr<Geometry> create(const std::string& geotype,
+		const std::shared_ptr<t_pool>& pool = nullptr);
+
+	template<class t_geo>
+	static std::shared_ptr<t_geo> create(const std::shared_ptr<t_pool>& pool)
+	{
+		return make_pooled<t_geo>(pool, pool);
+	}
+
+	const std::shared_ptr<t_pool>& GetPool() const { return m_pool; }
 
 #ifdef USE_BULLET
 	virtual void SetMatrixFromState();
@@ -132,27 +178,58 @@ public:
 	virtual void CreateRigidBody();
 	virtual void UpdateRigidBody();
 	virtual std::shared_ptr<btRigidBody> GetRigidBody() { return m_rigid_body; }
+	virtual std::shared_ptr<btConvexInternalShape> GetShape() { return m_shape; }
+
+	// exchange the simulation state with another object, e.g. with a copy replacing this one
+	void SwapRigidBody(Geometry& geo);
 #endif
 
 
 protected:
+	// copy of the object in the same pool
+	template<class t_geo>
+	std::shared_ptr<Geometry> CloneInPool() const
+	{
+		auto geo = create<t_geo>(m_pool);
+		geo->operator=(*this);
+		return geo;
+	}
+
+
+protected:
+	// pool of the object and of its simulation state
+	std::shared_ptr<t_pool> m_pool{};
+
 	std::string m_id{};
+	std::size_t m_handle{0};
 
-	t_vec m_colour = m::create<t_vec>({1, 0, 0});
+	t_vec3 m_colour = m::create<t_vec3>({1, 0, 0});
 	bool m_lighting = true;
 	int m_light_id = -1;  // <0 -> not a light source
 
 	std::string m_texture{};
 
 	bool m_fixed = false;
-	t_mat m_trafo = m::unit<t_mat>(4);
+	// fixed-size matrices, converted to dynamic ones only for loading, saving and properties
+	t_mat44 m_trafo = m::unit<t_mat44>(4);
 	t_real m_det = 1.;
+	bool m_trafo_changed = true;
 
 	int m_portal_id = -1;  // <0 -> deactivated
-	t_mat m_portal_trafo = m::unit<t_mat>(4);
+	t_mat44 m_portal_trafo = m::unit<t_mat44>(4);
 	t_real m_portal_det = 1.;
 
+	// animated properties and their expressions, compiled by the scene
+	std::vector<std::pair<std::string, std::string>> m_animations{};
+
+	// the object's references to the cached triangles and their cache keys
+	mutable std::array<std::pair<std::string, std::shared_ptr<const t_triangles>>, MAX_LODS> m_triangles{};
+
 #ifdef USE_BULLET
+	// replace the collision shape, the rigid body must not be in a world
+	void SetShape(const std::shared_ptr<btConvexInternalShape>& shape);
+
+	// shared with all objects having the same primitive type and dimensions
 	std::shared_ptr<btConvexInternalShape> m_shape{};
 	std::shared_ptr<btDefaultMotionState> m_state{};
 	std::shared_ptr<btRigidBody> m_rigid_body{};
@@ -170,17 +247,19 @@ protected:
 class PlaneGeometry : public Geometry
 {
 public:
-	PlaneGeometry();
+	explicit PlaneGeometry(const std::shared_ptr<t_pool>& pool = nullptr);
 	virtual ~PlaneGeometry();
 
 	virtual PlaneGeometry& operator=(const Geometry& geo) override;
 	virtual std::shared_ptr<Geometry> clone() const override;
+	virtual const char* GetType() const override { return "plane"; }
 
 	virtual bool Load(const boost::property_tree::ptree& prop) override;
 	virtual boost::property_tree::ptree Save() const override;
 
 	virtual std::tuple<std::vector<t_vec>, std::vector<t_vec>, std::vector<t_vec>>
 	GetTriangles() const override;
+	virtual std::string GetMeshKey() const override;
 
 	const t_vec& GetNormal() const { return m_norm; }
 	t_real GetWidth() const { return m_width; }
@@ -212,17 +291,19 @@ private:
 class BoxGeometry : public Geometry
 {
 public:
-	BoxGeometry();
+	explicit BoxGeometry(const std::shared_ptr<t_pool>& pool = nullptr);
 	virtual ~BoxGeometry();
 
 	virtual BoxGeometry& operator=(const Geometry& geo) override;
 	virtual std::shared_ptr<Geometry> clone() const override;
+	virtual const char* GetType() const override { return "box"; }
 
 	virtual bool Load(const boost::property_tree::ptree& prop) override;
 	virtual boost::property_tree::ptree Save() const override;
 
 	virtual std::tuple<std::vector<t_vec>, std::vector<t_vec>, std::vector<t_vec>>
 	GetTriangles() const override;
+	virtual std::string GetMeshKey() const override;
 
 	t_real GetLength() const { return m_length; }
 	t_real GetDepth() const { return m_depth; }
@@ -254,17 +335,21 @@ private:
 class CylinderGeometry : public Geometry
 {
 public:
-	CylinderGeometry();
+	explicit CylinderGeometry(const std::shared_ptr<t_pool>& pool = nullptr);
 	virtual ~CylinderGeometry();
 
 	virtual CylinderGeometry& operator=(const Geometry& geo) override;
 	virtual std::shared_ptr<Geometry> clone() const override;
+	virtual const char* GetType() const override { return "cylinder"; }
 
 	virtual bool Load(const boost::property_tree::ptree& prop) override;
 	virtual boost::property_tree::ptree Save() const override;
 
 	virtual std::tuple<std::vector<t_vec>, std::vector<t_vec>, std::vector<t_vec>>
 		GetTriangles() const override;
+	virtual std::string GetMeshKey() const override;
+	virtual std::size_t GetNumLods() const override { return MAX_LODS; }
+	virtual t_triangles GetLodTriangles(std::size_t lod) const override;
 
 	t_real GetHeight() const { return m_height; }
 	t_real GetRadius() const { return m_radius; }
@@ -294,17 +379,21 @@ private:
 class SphereGeometry : public Geometry
 {
 public:
-	SphereGeometry();
+	explicit SphereGeometry(const std::shared_ptr<t_pool>& pool = nullptr);
 	virtual ~SphereGeometry();
 
 	virtual SphereGeometry& operator=(const Geometry& geo) override;
 	virtual std::shared_ptr<Geometry> clone() const override;
+	virtual const char* GetType() const override { return "sphere"; }
 
 	virtual bool Load(const boost::property_tree::ptree& prop) override;
 	virtual boost::property_tree::ptree Save() const override;
 
 	virtual std::tuple<std::vector<t_vec>, std::vector<t_vec>, std::vector<t_vec>>
 	GetTriangles() const override;
+	virtual std::string GetMeshKey() const override;
+	virtual std::size_t GetNumLods() const override { return MAX_LODS; }
+	virtual t_triangles GetLodTriangles(std::size_t lod) const override;
 
 	t_real GetRadius() const { return m_radius; }
 	void SetRadius(t_real rad);
@@ -331,17 +420,19 @@ private:
 class TetrahedronGeometry : public Geometry
 {
 public:
-	TetrahedronGeometry();
+	explicit TetrahedronGeometry(const std::shared_ptr<t_pool>& pool = nullptr);
 	virtual ~TetrahedronGeometry();
 
 	virtual TetrahedronGeometry& operator=(const Geometry& geo) override;
 	virtual std::shared_ptr<Geometry> clone() const override;
+	virtual const char* GetType() const override { return "tetrahedron"; }
 
 	virtual bool Load(const boost::property_tree::ptree& prop) override;
 	virtual boost::property_tree::ptree Save() const override;
 
 	virtual std::tuple<std::vector<t_vec>, std::vector<t_vec>, std::vector<t_vec>>
 	GetTriangles() const override;
+	virtual std::string GetMeshKey() const override;
 
 	t_real GetRadius() const { return m_radius; }
 	void SetRadius(t_real rad) { m_radius = rad; }
@@ -363,17 +454,19 @@ private:
 class OctahedronGeometry : public Geometry
 {
 public:
-	OctahedronGeometry();
+	explicit OctahedronGeometry(const std::shared_ptr<t_pool>& pool = nullptr);
 	virtual ~OctahedronGeometry();
 
 	virtual OctahedronGeometry& operator=(const Geometry& geo) override;
 	virtual std::shared_ptr<Geometry> clone() const override;
+	virtual const char* GetType() const override { return "octahedron"; }
 
 	virtual bool Load(const boost::property_tree::ptree& prop) override;
 	virtual boost::property_tree::ptree Save() const override;
 
 	virtual std::tuple<std::vector<t_vec>, std::vector<t_vec>, std::vector<t_vec>>
 	GetTriangles() const override;
+	virtual std::string GetMeshKey() const override;
 
 	t_real GetRadius() const { return m_radius; }
 	void SetRadius(t_real rad) { m_radius = rad; }
@@ -395,17 +488,19 @@ private:
 class DodecahedronGeometry : public Geometry
 {
 public:
-	DodecahedronGeometry();
+	explicit DodecahedronGeometry(const std::shared_ptr<t_pool>& pool = nullptr);
 	virtual ~DodecahedronGeometry();
 
 	virtual DodecahedronGeometry& operator=(const Geometry& geo) override;
 	virtual std::shared_ptr<Geometry> clone() const override;
+	virtual const char* GetType() const override { return "dodecahedron"; }
 
 	virtual bool Load(const boost::property_tree::ptree& prop) override;
 	virtual boost::property_tree::ptree Save() const override;
 
 	virtual std::tuple<std::vector<t_vec>, std::vector<t_vec>, std::vector<t_vec>>
 	GetTriangles() const override;
+	virtual std::string GetMeshKey() const override;
 
 	t_real GetRadius() const { return m_radius; }
 	void SetRadius(t_real rad) { m_radius = rad; }
@@ -427,17 +522,19 @@ private:
 class IcosahedronGeometry : public Geometry
 {
 public:
-	IcosahedronGeometry();
+	explicit IcosahedronGeometry(const std::shared_ptr<t_pool>& pool = nullptr);
 	virtual ~IcosahedronGeometry();
 
 	virtual IcosahedronGeometry& operator=(const Geometry& geo) override;
 	virtual std::shared_ptr<Geometry> clone() const override;
+	virtual const char* GetType() const override { return "icosahedron"; }
 
 	virtual bool Load(const boost::property_tree::ptree& prop) override;
 	virtual boost::property_tree::ptree Save() const override;
 
 	virtual std::tuple<std::vector<t_vec>, std::vector<t_vec>, std::vector<t_vec>>
 	GetTriangles() const override;
+	virtual std::string GetMeshKey() const override;
 
 	t_real GetRadius() const { return m_radius; }
 	void SetRadius(t_real rad) { m_radius = rad; }
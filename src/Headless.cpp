@@ -0,0 +1,347 @@
+/**
+ * headless rendering of camera poses into image files
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * Job file format, one frame per line, angles in degrees:
+ *   # image             x    y    z    phi  theta  [viewing angle]
+ *   frames/0001.png     0   -10   5    0    30     60
+ * Relative image paths refer to the directory of the job file.
+ */
+
+#include "Headless.h"
+#include "Scene.h"
+#include "settings_variables.h"
+#include "renderer/GlRenderer.h"
+
+#include <QtGui/QImage>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <optional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#if __has_include(<filesystem>)
+	#include <filesystem>
+	namespace fs = std::filesystem;
+#else
+	#include <boost/filesystem.hpp>
+	namespace fs = boost::filesystem;
+#endif
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+namespace pt = boost::property_tree;
+
+
+/**
+ * camera pose of a frame
+ */
+struct HeadlessFrame
+{
+	std::string image{};
+	t_real_gl pos[3]{ 0, 0, 0 };
+	t_real_gl phi{0}, theta{0};    // in degrees
+	std::optional<t_real_gl> viewing_angle{};
+};
+
+
+/**
+ * encodes and writes the images in worker threads,
+ * so that encoding a frame overlaps with rendering the next ones
+ */
+class ImageWriter
+{
+public:
+	ImageWriter(std::size_t num_threads, std::size_t max_queued)
+		: m_max_queued{std::max<std::size_t>(max_queued, 1)}
+	{
+		for(std::size_t thread = 0; thread < std::max<std::size_t>(num_threads, 1); ++thread)
+			m_threads.emplace_back(&ImageWriter::Run, this);
+	}
+
+
+	~ImageWriter()
+	{
+		Finish();
+	}
+
+
+	/**
+	 * queue an image, blocks while too many images are waiting
+	 */
+	void Add(const std::string& filename, QImage&& img)
+	{
+		std::unique_lock<std::mutex> lock{m_mtx};
+		m_cond_space.wait(lock, [this]() -> bool { return m_queue.size() < m_max_queued; });
+
+		m_queue.emplace_back(filename, std::move(img));
+		m_cond_work.notify_one();
+	}
+
+
+	/**
+	 * write the remaining images and stop the threads
+	 */
+	void Finish()
+	{
+		{
+			std::lock_guard<std::mutex> lock{m_mtx};
+			m_stop = true;
+		}
+		m_cond_work.notify_all();
+
+		for(std::thread& thread : m_threads)
+		{
+			if(thread.joinable())
+				thread.join();
+		}
+		m_threads.clear();
+	}
+
+
+	std::size_t GetNumErrors() const { return m_errors; }
+
+
+protected:
+	void Run()
+	{
+		while(true)
+		{
+			std::pair<std::string, QImage> item;
+			{
+				std::unique_lock<std::mutex> lock{m_mtx};
+				m_cond_work.wait(lock, [this]() -> bool { return m_stop || m_queue.size(); });
+				if(m_queue.empty())
+					break;  // stopped and nothing left
+
+				item = std::move(m_queue.front());
+				m_queue.pop_front();
+			}
+			m_cond_space.notify_one();
+
+			if(!item.second.save(item.first.c_str()))
+			{
+				std::cerr << "Error: Could not write image \"" << item.first << "\"." << std::endl;
+				++m_errors;
+			}
+		}
+	}
+
+
+private:
+	std::size_t m_max_queued{1};
+	std::deque<std::pair<std::string, QImage>> m_queue{};
+	std::vector<std::thread> m_threads{};
+
+	std::mutex m_mtx{};
+	std::condition_variable m_cond_work{}, m_cond_space{};
+	bool m_stop{false};
+
+	std::atomic<std::size_t> m_errors{0};
+};
+
+
+/**
+ * read the camera poses from the job file
+ */
+static bool read_job_file(const std::string& filename, std::vector<HeadlessFrame>& frames)
+{
+	std::ifstream ifstr{filename};
+	if(!ifstr)
+	{
+		std::cerr << "Error: Could not open job file \"" << filename << "\"." << std::endl;
+		return false;
+	}
+
+	const fs::path jobdir = fs::absolute(filename).parent_path();
+
+	std::string line;
+	for(std::size_t linenr = 1; std::getline(ifstr, line); ++linenr)
+	{
+		if(std::size_t comment = line.find('#'); comment != std::string::npos)
+			line.resize(comment);
+
+		std::istringstream istr{line};
+		HeadlessFrame frame;
+		if(!(istr >> frame.image))
+			continue;  // empty line
+
+		if(!(istr >> frame.pos[0] >> frame.pos[1] >> frame.pos[2] >> frame.phi >> frame.theta))
+		{
+			std::cerr << "Error: Invalid camera pose in line " << linenr
+				<< " of job file \"" << filename << "\"." << std::endl;
+			return false;
+		}
+
+		if(t_real_gl angle{}; istr >> angle)
+			frame.viewing_angle = angle;
+
+		if(fs::path img{frame.image}; img.is_relative())
+			frame.image = (jobdir / img).string();
+
+		frames.emplace_back(std::move(frame));
+	}
+
+	return true;
+}
+
+
+/**
+ * load a binary or xml scene file and get its configuration
+ */
+static bool load_scene(const std::string& filename, Scene& scene, pt::ptree& prop)
+{
+	std::pair<bool, std::string> sceneload;
+
+	if(Scene::is_binary(filename))
+	{
+		sceneload = Scene::load_binary(filename, scene, &prop);
+	}
+	else
+	{
+		std::ifstream ifstr{filename};
+		if(!ifstr)
+		{
+			std::cerr << "Error: Could not read scene file \"" << filename << "\"." << std::endl;
+			return false;
+		}
+
+		pt::read_xml(ifstr, prop);
+		if(auto opt = prop.get_optional<std::string>(FILE_BASENAME "ident");
+			!opt || *opt != APPL_IDENT)
+		{
+			std::cerr << "Error: Scene file \"" << filename << "\" has invalid identifier." << std::endl;
+			return false;
+		}
+
+		sceneload = Scene::load(prop, scene, &filename);
+	}
+
+	if(!sceneload.first)
+	{
+		std::cerr << "Error: " << sceneload.second << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * load the scene and render all frames of the job file
+ */
+int run_headless(const HeadlessOptions& opts)
+{
+	std::vector<HeadlessFrame> frames;
+	if(!read_job_file(opts.job_file, frames))
+		return -1;
+	if(frames.size() == 0)
+	{
+		std::cerr << "Error: No frames given in job file \"" << opts.job_file << "\"." << std::endl;
+		return -1;
+	}
+
+	Scene scene;
+	pt::ptree prop;
+	if(!load_scene(opts.scene_file, scene, prop))
+		return -1;
+
+	// the renderer widget is never shown, it draws into its offscreen framebuffer
+	GlSceneRenderer renderer;
+	if(!renderer.InitOffscreen(opts.width, opts.height))
+	{
+		std::cerr << "Error: Could not initialise offscreen renderer." << std::endl;
+		return -1;
+	}
+
+	// setting defaults, independent of the gui configuration
+	renderer.EnableShadowRendering(g_enable_shadow_rendering);
+	renderer.EnableShadowMapCache(g_shadow_map_cache);
+	renderer.SetShadowMapSize(int(std::clamp(g_shadow_map_size, 16u, 16384u)));
+	renderer.EnablePortalRendering(g_enable_portal_rendering);
+	renderer.SetPortalDepth(g_portal_depth);
+	renderer.EnableInstancing(g_enable_instancing);
+	renderer.EnableOcclusionCulling(g_enable_occlusion_culling);
+	renderer.SetLodPixels(g_lod_pixels);
+	renderer.SetLightRange(g_light_range);
+	renderer.EnableSmoothing(g_polygon_smoothing);
+	renderer.SetRenderScale(g_render_scale);
+	renderer.SetTextureMemory(std::size_t(g_texture_memory) * 1024 * 1024);
+
+	// scene objects and textures
+	renderer.LoadScene(scene);
+	if(auto textures = prop.get_child_optional(FILE_BASENAME "configuration.textures"); textures)
+	{
+		for(const auto &texture : *textures)
+		{
+			auto id = texture.second.get<std::string>("<xmlattr>.id", "");
+			auto filename = texture.second.get<std::string>("filename", "");
+			if(id != "" && filename != "")
+				renderer.ChangeTextureProperty(id.c_str(), filename.c_str());
+		}
+	}
+	renderer.EnableTextures(prop.get<bool>(
+		FILE_BASENAME "configuration.textures.<xmlattr>.enabled", false));
+	renderer.FinishLoading();
+
+	// default camera settings from the scene file
+	GlSceneRenderer::t_cam& cam = renderer.GetCamera();
+	if(auto opt = prop.get_optional<t_real_gl>(FILE_BASENAME "configuration.camera.viewing_angle"); opt)
+		cam.SetFOV(*opt / t_real_gl{180} * m::pi<t_real_gl>);
+	if(auto opt = prop.get_optional<t_real_gl>(FILE_BASENAME "configuration.camera.zoom"); opt)
+		cam.SetZoom(*opt);
+	if(auto opt = prop.get_optional<int>(FILE_BASENAME "configuration.camera.perspective_proj"); opt)
+		cam.SetPerspectiveProjection(*opt != 0);
+
+	// render the frames
+	const std::size_t num_writers = std::max<std::size_t>(std::thread::hardware_concurrency(), 2) - 1;
+	ImageWriter writer{num_writers, 2*num_writers};
+	std::size_t num_failed = 0;
+
+	auto write_frame = [&frames, &writer, &num_failed](std::size_t frame, QImage&& img) -> void
+	{
+		if(img.isNull())
+			++num_failed;
+		else
+			writer.Add(frames[frame].image, std::move(img));
+	};
+
+	const auto start_time = std::chrono::steady_clock::now();
+
+	for(std::size_t frame = 0; frame < frames.size(); ++frame)
+	{
+		const HeadlessFrame& pose = frames[frame];
+
+		cam.SetPosition(m::create<t_vec3_gl>({ pose.pos[0], pose.pos[1], pose.pos[2] }));
+		cam.SetRotation(pose.phi / t_real_gl{180} * m::pi<t_real_gl>,
+			pose.theta / t_real_gl{180} * m::pi<t_real_gl>);
+		if(pose.viewing_angle)
+			cam.SetFOV(*pose.viewing_angle / t_real_gl{180} * m::pi<t_real_gl>);
+
+		if(!renderer.RenderOffscreen(frame, write_frame))
+			++num_failed;
+	}
+
+	renderer.FinishOffscreen(write_frame);
+	writer.Finish();
+	num_failed += writer.GetNumErrors();
+
+	const t_real secs = std::chrono::duration<t_real>(
+		std::chrono::steady_clock::now() - start_time).count();
+	std::cout << "Rendered " << frames.size() - num_failed << " of " << frames.size()
+		<< " frames in " << secs << " s (" << t_real(frames.size()) / secs
+		<< " frames/s)." << std::endl;
+
+	return num_failed ? -1 : 0;
+}
@@ -0,0 +1,31 @@
+/**
+ * headless rendering of camera poses into image files
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ */
+
+#ifndef __GLSCENE_HEADLESS_H__
+#define __GLSCENE_HEADLESS_H__
+
+#include <string>
+
+
+/**
+ * command-line options of the headless mode
+ */
+struct HeadlessOptions
+{
+	std::string scene_file{};
+	std::string job_file{};
+
+	int width{1920};
+	int height{1080};
+};
+
+
+// load the scene and render all frames of the job file, returns the program's exit code
+extern int run_headless(const HeadlessOptions& opts);
+
+
+#endif
@@ -23,6 +23,7 @@
 namespace pt = boost::property_tree;
 
 #include <chrono>
+#include <algorithm>
 
 
 // instantiate the settings dialog class
@@ -66,14 +67,17 @@ MainWnd::MainWnd(QWidget* pParent) : QMainWindow{pParent}
 	// --------------------------------------------------------------------
 	// set gl surface format
 	m_renderer->setFormat(gl_format(true, _GL_MAJ_VER, _GL_MIN_VER,
-		m_multisamples, m_renderer->format()));
+		int(std::min(g_msaa_samples, 32u)), m_renderer->format()));
 
 	auto plotpanel = new QWidget(this);
 
 	connect(m_renderer.get(), &GlSceneRenderer::CursorCoordsChanged, this, &MainWnd::CursorCoordsChanged);
+	connect(m_renderer.get(), &GlSceneRenderer::CullingStatsChanged, this, &MainWnd::CullingStatsChanged);
+	connect(m_renderer.get(), &GlSceneRenderer::SceneLoadProgress, this, &MainWnd::SceneLoadProgress);
 	connect(m_renderer.get(), &GlSceneRenderer::PickerIntersection, this, &MainWnd::PickerIntersection);
 	connect(m_renderer.get(), &GlSceneRenderer::ObjectClicked, this, &MainWnd::ObjectClicked);
 	connect(m_renderer.get(), &GlSceneRenderer::ObjectDragged, this, &MainWnd::ObjectDragged);
+	connect(m_renderer.get(), &GlSceneRenderer::InputReceived, this, &MainWnd::InputReceived);
 	connect(m_renderer.get(), &GlSceneRenderer::AfterGLInitialisation, this, &MainWnd::AfterGLInitialisation);
 
 	// camera position
@@ -220,6 +224,8 @@ MainWnd::MainWnd(QWidget* pParent) : QMainWindow{pParent}
 		[this](t_real t) -> void
 		{
 			this->m_timescale = t;
+			if(this->m_sim)
+				this->m_sim->SetTimeScale(t);
 		});
 
 	// max. time stepping
@@ -229,6 +235,14 @@ MainWnd::MainWnd(QWidget* pParent) : QMainWindow{pParent}
 			this->m_maxtimestep = dt;
 		});
 
+	// number of simulation threads
+	simwidget->SetMaxNumThreads(Scene::GetMaxNumThreads());
+	connect(simwidget, &SimPropertiesWidget::NumThreadsChanged,
+		[this](t_int num) -> void
+		{
+			this->m_scene.SetNumThreads(num);
+		});
+
 	// selection plane normal
 	connect(selwidget, &SelectionPropertiesWidget::PlaneNormChanged,
 		[this](t_real _x, t_real _y, t_real _z) -> void
@@ -284,6 +298,7 @@ MainWnd::MainWnd(QWidget* pParent) : QMainWindow{pParent}
 	QAction *actionOpen = new QAction(QIcon::fromTheme("document-open"), "Open...", menuFile);
 	QAction *actionSave = new QAction(QIcon::fromTheme("document-save"), "Save", menuFile);
 	QAction *actionSaveAs = new QAction(QIcon::fromTheme("document-save-as"), "Save As...", menuFile);
+	QAction *actionExportXml = new QAction(QIcon::fromTheme("document-export"), "Export XML...", menuFile);
 	QAction *actionScreenshot = new QAction(QIcon::fromTheme("image-x-generic"), "Save Screenshot...", menuFile);
 	QAction *actionQuit = new QAction(QIcon::fromTheme("application-exit"), "Quit", menuFile);
 
@@ -327,6 +342,11 @@ MainWnd::MainWnd(QWidget* pParent) : QMainWindow{pParent}
 		this->SaveFileAs();
 	});
 
+	connect(actionExportXml, &QAction::triggered, this, [this]()
+	{
+		this->ExportXml();
+	});
+
 	connect(actionScreenshot, &QAction::triggered, this, [this]()
 	{
 		this->SaveScreenshot();
@@ -342,6 +362,7 @@ MainWnd::MainWnd(QWidget* pParent) : QMainWindow{pParent}
 	menuFile->addSeparator();
 	menuFile->addAction(actionSave);
 	menuFile->addAction(actionSaveAs);
+	menuFile->addAction(actionExportXml);
 	menuFile->addSeparator();
 	menuFile->addAction(actionScreenshot);
 	menuFile->addSeparator();
@@ -451,9 +472,45 @@ MainWnd::MainWnd(QWidget* pParent) : QMainWindow{pParent}
 		QIcon::fromTheme("accessories-calculator"),
 		"Transformation Calculator...", menuTools);
 
+	QAction *actionSaveProfile = new QAction(
+		QIcon::fromTheme("x-office-spreadsheet"),
+		"Save Frame Profile...", menuTools);
+
+	QAction *actionStartRecording = new QAction(
+		QIcon::fromTheme("media-record"),
+		"Start Recording...", menuTools);
+	QAction *actionStopRecording = new QAction(
+		QIcon::fromTheme("media-playback-stop"),
+		"Stop Recording", menuTools);
+
+	QAction *actionStartReplay = new QAction(
+		QIcon::fromTheme("media-playback-start"),
+		"Replay Recording...", menuTools);
+	QAction *actionRewindReplay = new QAction(
+		QIcon::fromTheme("media-skip-backward"),
+		"Rewind Replay", menuTools);
+	QAction *actionStopReplay = new QAction(
+		QIcon::fromTheme("media-playback-stop"),
+		"Stop Replay", menuTools);
+
 	connect(actionTrafoCalculator, &QAction::triggered, this, &MainWnd::ShowTrafoCalculator);
+	connect(actionSaveProfile, &QAction::triggered, this, &MainWnd::SaveProfile);
+	connect(actionStartRecording, &QAction::triggered, this, &MainWnd::StartRecording);
+	connect(actionStopRecording, &QAction::triggered, this, &MainWnd::StopRecording);
+	connect(actionStartReplay, &QAction::triggered, this, &MainWnd::StartReplay);
+	connect(actionRewindReplay, &QAction::triggered, this, &MainWnd::RewindReplay);
+	connect(actionStopReplay, &QAction::triggered, this, &MainWnd::StopReplay);
 
 	menuTools->addAction(actionTrafoCalculator);
+	menuTools->addSeparator();
+	menuTools->addAction(actionSaveProfile);
+	menuTools->addSeparator();
+	menuTools->addAction(actionStartRecording);
+	menuTools->addAction(actionStopRecording);
+	menuTools->addSeparator();
+	menuTools->addAction(actionStartReplay);
+	menuTools->addAction(actionRewindReplay);
+	menuTools->addAction(actionStopReplay);
 
 
 	// settings menu
@@ -683,10 +740,14 @@ MainWnd::MainWnd(QWidget* pParent) : QMainWindow{pParent}
 	setAcceptDrops(true);
 
 
+	// the renderer takes the object transformations from the simulation thread
+	m_renderer->SetSimThread(m_sim);
+
 	// timer callback function
+	// timer callback function, the interval is longer while the scene is at rest
 	connect(&m_timer, &QTimer::timeout, [this]()
 	{
-		this->tick(std::chrono::milliseconds(1000 / g_timer_tps));
+		this->tick(std::chrono::milliseconds(m_timer.interval()));
 	});
 
 	EnableTimer(true);
@@ -698,6 +759,33 @@ MainWnd::MainWnd(QWidget* pParent) : QMainWindow{pParent}
  */
 void MainWnd::tick(const std::chrono::milliseconds& ms)
 {
+	ProfilerScope _prof{"cpu: tick"};
+
+	// the recorded poses are shown instead of simulating
+	if(m_scene.IsReplaying())
+	{
+		m_replay_time = std::min(m_replay_time + t_real(ms.count()) / 1000. * m_timescale,
+			m_scene.GetReplayEndTime());
+		if(m_scene.Replay(m_replay_time))
+			m_scene.EmitUpdate();
+
+		if(m_renderer)
+			m_renderer->tick(ms);
+
+		SetTimerIdle(m_replay_time >= m_scene.GetReplayEndTime() && (!m_renderer || m_renderer->IsIdle()));
+		return;
+	}
+
+	// the simulation is advanced in its own thread
+	if(m_sim && m_sim->IsRunning())
+	{
+		if(m_renderer)
+			m_renderer->tick(ms);
+
+		SetTimerIdle(m_sim->IsIdle() && (!m_renderer || m_renderer->IsIdle()));
+		return;
+	}
+
 	// advance simulation
 	using t_val = decltype(ms.count());
 	t_val ms_total = t_val(t_real(ms.count()) * m_timescale);
@@ -724,10 +812,40 @@ void MainWnd::tick(const std::chrono::milliseconds& ms)
 
 	//std::cout << num_steps << "*" << ms_step << " + " << ms_total - ms_cur_val << std::endl;
 
+	m_scene.EmitUpdate();
+
 
 	// advance renderer
 	if(m_renderer)
 		m_renderer->tick(ms);
+
+	SetTimerIdle(m_scene.IsIdle() && (!m_renderer || m_renderer->IsIdle()));
+}
+
+
+/**
+ * switch between the full and the idle timer rate
+ */
+void MainWnd::SetTimerIdle(bool idle)
+{
+	if(!m_timer.isActive())
+		return;
+
+	const int interval = int(1000 / std::max(idle ? g_timer_idle_tps : g_timer_tps, 1u));
+	if(m_timer.interval() != interval)
+		m_timer.start(interval);
+}
+
+
+/**
+ * keyboard or mouse input in the renderer, return to the full timer rate
+ */
+void MainWnd::InputReceived()
+{
+	SetTimerIdle(false);
+
+	if(m_sim)
+		m_sim->Wake();
 }
 
 
@@ -737,9 +855,31 @@ void MainWnd::tick(const std::chrono::milliseconds& ms)
 void MainWnd::EnableTimer(bool enabled)
 {
 	if(enabled)
-		m_timer.start(std::chrono::milliseconds(1000 / g_timer_tps));
+	{
+		m_timer.start(std::chrono::milliseconds(1000 / std::max(g_timer_tps, 1u)));
+		if(m_sim && g_sim_thread && !m_scene.IsReplaying())
+			m_sim->Start();
+	}
 	else
+	{
 		m_timer.stop();
+		if(m_sim)
+			m_sim->Stop();
+	}
+}
+
+
+/**
+ * the simulation thread has to be stopped before the scene is destroyed
+ */
+MainWnd::~MainWnd()
+{
+	if(m_sim)
+		m_sim->Stop();
+
+	// finish writing the scene file
+	if(m_saving.valid())
+		m_saving.wait();
 }
 
 
@@ -844,6 +984,7 @@ void MainWnd::dropEvent(QDropEvent *evt)
  */
 void MainWnd::NewFile()
 {
+	StopReplay();
 	SetCurrentFile("");
 	m_scene.Clear();
 
@@ -865,7 +1006,7 @@ void MainWnd::OpenFile()
 		g_docpath.c_str()).toString();
 
 	QFileDialog filedlg(this, "Open Scene File", dirLast,
-		"Gl Scene Files (*.glscene)");
+		"Gl Scene Files (*.glscene *.xml)");
 	filedlg.setAcceptMode(QFileDialog::AcceptOpen);
 	filedlg.setDefaultSuffix("glscene");
 	filedlg.setViewMode(QFileDialog::Detail);
@@ -931,6 +1072,38 @@ void MainWnd::SaveFileAs()
 }
 
 
+/**
+ * File -> Export XML
+ */
+void MainWnd::ExportXml()
+{
+	QString dirLast = m_sett.value("cur_dir",
+		g_docpath.c_str()).toString();
+
+	QFileDialog filedlg(this, "Export Scene File", dirLast,
+		"XML Scene Files (*.xml)");
+	filedlg.setAcceptMode(QFileDialog::AcceptSave);
+	filedlg.setDefaultSuffix("xml");
+	filedlg.setFileMode(QFileDialog::AnyFile);
+	filedlg.setViewMode(QFileDialog::Detail);
+	filedlg.selectFile("untitled.xml");
+	filedlg.setSidebarUrls(QList<QUrl>({
+		QUrl::fromLocalFile(g_homepath.c_str()),
+		QUrl::fromLocalFile(g_desktoppath.c_str()),
+		QUrl::fromLocalFile(g_docpath.c_str())}));
+
+	if(!filedlg.exec())
+		return;
+
+	QStringList files = filedlg.selectedFiles();
+	if(!files.size() || files[0]=="")
+		return;
+
+	if(SaveFile(files[0], true))
+		m_sett.setValue("cur_dir", QFileInfo(files[0]).path());
+}
+
+
 /**
  * File -> Save Screenshot
  */
@@ -964,6 +1137,189 @@ void MainWnd::SaveScreenshot()
 }
 
 
+/**
+ * File -> Save Frame Profile
+ */
+void MainWnd::SaveProfile()
+{
+	if(!Profiler::GetInstance().IsEnabled())
+	{
+		QMessageBox::warning(this, "Warning",
+			"The frame profiler is disabled, it can be enabled in the preferences.");
+		return;
+	}
+
+	QString dirLast = m_sett.value("cur_profile_dir",
+		g_docpath.c_str()).toString();
+
+	QFileDialog filedlg(this, "Save Frame Profile", dirLast,
+		"CSV Files (*.csv);;JSON Files (*.json)");
+	filedlg.setAcceptMode(QFileDialog::AcceptSave);
+	filedlg.setDefaultSuffix("csv");
+	filedlg.setViewMode(QFileDialog::Detail);
+	filedlg.setFileMode(QFileDialog::AnyFile);
+	filedlg.selectFile("glscene_profile.csv");
+	filedlg.setSidebarUrls(QList<QUrl>({
+		QUrl::fromLocalFile(g_homepath.c_str()),
+		QUrl::fromLocalFile(g_desktoppath.c_str()),
+		QUrl::fromLocalFile(g_docpath.c_str())}));
+
+	if(!filedlg.exec())
+		return;
+
+	QStringList files = filedlg.selectedFiles();
+	if(!files.size() || files[0]=="")
+		return;
+
+	if(!Profiler::GetInstance().Save(files[0].toStdString()))
+	{
+		QMessageBox::critical(this, "Error",
+			"Frame profile could not be saved to \"" + files[0] + "\".");
+		return;
+	}
+
+	m_sett.setValue("cur_profile_dir", QFileInfo(files[0]).path());
+}
+
+
+/**
+ * Tools -> Start Recording
+ * the poses of the moving objects are written after every simulation step
+ */
+void MainWnd::StartRecording()
+{
+	QString dirLast = m_sett.value("cur_traj_dir",
+		g_docpath.c_str()).toString();
+
+	QFileDialog filedlg(this, "Record Trajectories", dirLast,
+		"Trajectory Files (*.gltraj)");
+	filedlg.setAcceptMode(QFileDialog::AcceptSave);
+	filedlg.setDefaultSuffix("gltraj");
+	filedlg.setViewMode(QFileDialog::Detail);
+	filedlg.setFileMode(QFileDialog::AnyFile);
+	filedlg.selectFile("glscene.gltraj");
+	filedlg.setSidebarUrls(QList<QUrl>({
+		QUrl::fromLocalFile(g_homepath.c_str()),
+		QUrl::fromLocalFile(g_desktoppath.c_str()),
+		QUrl::fromLocalFile(g_docpath.c_str())}));
+
+	if(!filedlg.exec())
+		return;
+
+	QStringList files = filedlg.selectedFiles();
+	if(!files.size() || files[0]=="")
+		return;
+
+	if(!m_scene.StartRecording(files[0].toStdString()))
+	{
+		QMessageBox::critical(this, "Error",
+			"Recording to \"" + files[0] + "\" could not be started.");
+		return;
+	}
+
+	m_sett.setValue("cur_traj_dir", QFileInfo(files[0]).path());
+	SetTmpStatus("Recording to \"" + files[0].toStdString() + "\"...");
+}
+
+
+/**
+ * Tools -> Stop Recording
+ */
+void MainWnd::StopRecording()
+{
+	if(!m_scene.IsRecording())
+		return;
+
+	if(!m_scene.StopRecording())
+	{
+		QMessageBox::critical(this, "Error", "The recording could not be written completely.");
+		return;
+	}
+
+	SetTmpStatus("Recording finished.");
+}
+
+
+/**
+ * Tools -> Replay Recording
+ * the simulation is stopped while the recorded poses are shown
+ */
+void MainWnd::StartReplay()
+{
+	QString dirLast = m_sett.value("cur_traj_dir",
+		g_docpath.c_str()).toString();
+
+	QFileDialog filedlg(this, "Replay Trajectories", dirLast,
+		"Trajectory Files (*.gltraj)");
+	filedlg.setAcceptMode(QFileDialog::AcceptOpen);
+	filedlg.setDefaultSuffix("gltraj");
+	filedlg.setViewMode(QFileDialog::Detail);
+	filedlg.setFileMode(QFileDialog::ExistingFile);
+	filedlg.setSidebarUrls(QList<QUrl>({
+		QUrl::fromLocalFile(g_homepath.c_str()),
+		QUrl::fromLocalFile(g_desktoppath.c_str()),
+		QUrl::fromLocalFile(g_docpath.c_str())}));
+
+	if(!filedlg.exec())
+		return;
+
+	QStringList files = filedlg.selectedFiles();
+	if(!files.size() || files[0]=="")
+		return;
+
+	StopRecording();
+	StopReplay();
+	if(m_sim)
+		m_sim->Stop();
+
+	if(!m_scene.StartReplay(files[0].toStdString()))
+	{
+		QMessageBox::critical(this, "Error",
+			"Recording \"" + files[0] + "\" could not be replayed.");
+		if(m_sim && g_sim_thread && m_timer.isActive())
+			m_sim->Start();
+		return;
+	}
+
+	m_replay_time = m_scene.GetReplayStartTime();
+	m_scene.EmitUpdate();
+	SetTimerIdle(false);
+
+	m_sett.setValue("cur_traj_dir", QFileInfo(files[0]).path());
+	SetTmpStatus("Replaying \"" + files[0].toStdString() + "\".");
+}
+
+
+/**
+ * Tools -> Rewind Replay
+ */
+void MainWnd::RewindReplay()
+{
+	if(!m_scene.IsReplaying())
+		return;
+
+	m_replay_time = m_scene.GetReplayStartTime();
+	SetTimerIdle(false);
+}
+
+
+/**
+ * Tools -> Stop Replay
+ * the objects return to their states from before the replay
+ */
+void MainWnd::StopReplay()
+{
+	if(!m_scene.IsReplaying())
+		return;
+
+	m_scene.StopReplay();
+	m_scene.EmitUpdate();
+
+	if(m_sim && g_sim_thread && m_timer.isActive())
+		m_sim->Start();
+}
+
+
 /**
  * load file
  */
@@ -973,6 +1329,12 @@ bool MainWnd::OpenFile(const QString& file)
 	if(file == "")
 		return false;
 
+	// the file could still be being written
+	if(m_saving.valid())
+		m_saving.wait();
+
+	auto _lock = m_scene.Lock();
+
 	try
 	{
 		NewFile();
@@ -985,32 +1347,43 @@ bool MainWnd::OpenFile(const QString& file)
 			return false;
 		}
 
-		// open xml
 		std::string filename = file.toStdString();
-		std::ifstream ifstr{filename};
-		if(!ifstr)
+		pt::ptree prop;
+		std::pair<bool, std::string> sceneload;
+
+		if(Scene::is_binary(filename))
 		{
-			QMessageBox::critical(this, "Error",
-				("Could not read scene file \"" + filename + "\".").c_str());
-			return false;
+			// load binary scene file, its configuration is returned in prop
+			sceneload = Scene::load_binary(filename, m_scene, &prop);
 		}
-
-		// read xml
-		pt::ptree prop;
-		pt::read_xml(ifstr, prop);
-		// check format and version
-		if(auto opt = prop.get_optional<std::string>(FILE_BASENAME "ident");
-			!opt || *opt != APPL_IDENT)
+		else
 		{
-			QMessageBox::critical(this, "Error",
-				("Scene file \"" + filename +
-				"\" has invalid identifier.").c_str());
-			return false;
+			// open xml
+			std::ifstream ifstr{filename};
+			if(!ifstr)
+			{
+				QMessageBox::critical(this, "Error",
+					("Could not read scene file \"" + filename + "\".").c_str());
+				return false;
+			}
+
+			// read xml
+			pt::read_xml(ifstr, prop);
+			// check format and version
+			if(auto opt = prop.get_optional<std::string>(FILE_BASENAME "ident");
+				!opt || *opt != APPL_IDENT)
+			{
+				QMessageBox::critical(this, "Error",
+					("Scene file \"" + filename +
+					"\" has invalid identifier.").c_str());
+				return false;
+			}
+
+			// load scene definition file
+			sceneload = Scene::load(prop, m_scene, &filename);
 		}
 
-		// load scene definition file
-		if(auto [sceneok, msg] =
-			Scene::load(prop, m_scene, &filename); !sceneok)
+		if(auto [sceneok, msg] = sceneload; !sceneok)
 		{
 			QMessageBox::critical(this, "Error", msg.c_str());
 			return false;
@@ -1075,10 +1448,11 @@ bool MainWnd::OpenFile(const QString& file)
 
 		// update slot for scene space (e.g. objects) changes
 		m_scene.AddUpdateSlot(
-			[this](const Scene& scene)
+			[this](const Scene& scene,
+				const std::vector<std::shared_ptr<Geometry>>& changed_objs)
 			{
 				if(m_renderer)
-					m_renderer->UpdateScene(scene);
+					m_renderer->UpdateScene(scene, changed_objs);
 			});
 	}
 	catch(const std::exception& ex)
@@ -1092,15 +1466,20 @@ bool MainWnd::OpenFile(const QString& file)
 
 
 /**
- * save file
+ * save file, either in the binary format or as xml for interchange
+ * the file is written in the background from a snapshot of the scene
  */
-bool MainWnd::SaveFile(const QString &file)
+bool MainWnd::SaveFile(const QString &file, bool xml)
 {
 	if(file=="")
 		return false;
 
-	// save scene space configuration
-	pt::ptree prop = m_scene.Save();
+	// only one file is written at a time
+	if(m_saving.valid())
+		m_saving.wait();
+
+	// save scene space configuration, the objects are written separately
+	pt::ptree prop;
 
 	// save dock window settings
 	prop.put_child(FILE_BASENAME "configuration.camera", m_camProperties->GetWidget()->Save());
@@ -1134,22 +1513,51 @@ bool MainWnd::SaveFile(const QString &file)
 		prop.put_child(FILE_BASENAME "configuration.textures", prop_textures);
 	}
 
-	std::string filename = file.toStdString();
-	std::ofstream ofstr{filename};
-	ofstr.precision(g_prec);
-	if(!ofstr)
+	// the snapshot shares the objects, they are only copied if the scene changes them meanwhile
+	std::shared_ptr<const SceneSnapshot> snapshot = m_scene.TakeSnapshot();
+	const bool bake_meshes = (g_scene_bake_meshes != 0);
+
+	m_saving = std::async(std::launch::async,
+		[this, snapshot, prop = std::move(prop), file, xml, bake_meshes]() -> bool
+	{
+		const std::string filename = file.toStdString();
+		bool ok = xml
+			? Scene::SaveXml(*snapshot, filename, prop)
+			: Scene::SaveBinary(*snapshot, filename, prop, bake_meshes);
+
+		QMetaObject::invokeMethod(this, [this, file, xml, ok]()
+		{
+			SaveFinished(file, xml, ok);
+		}, Qt::QueuedConnection);
+
+		return ok;
+	});
+
+	SetTmpStatus("Saving scene file \"" + file.toStdString() + "\"...");
+	return true;
+}
+
+
+/**
+ * the scene file has been written
+ */
+void MainWnd::SaveFinished(const QString &file, bool xml, bool ok)
+{
+	if(!ok)
 	{
 		QMessageBox::critical(this, "Error",
-			("Could not save scene file \"" + filename + "\".").c_str());
-		return false;
+			("Could not save scene file \"" + file.toStdString() + "\".").c_str());
+		return;
 	}
 
-	pt::write_xml(ofstr, prop,
-		pt::xml_writer_make_settings('\t', 1, std::string{"utf-8"}));
+	SetTmpStatus("Saved scene file \"" + file.toStdString() + "\".");
 
-	SetCurrentFile(file);
-	m_recent.AddRecentFile(file, m_open_func);
-	return true;
+	// exported files don't replace the current one
+	if(!xml)
+	{
+		SetCurrentFile(file);
+		m_recent.AddRecentFile(file, m_open_func);
+	}
 }
 
 
@@ -1168,6 +1576,8 @@ bool MainWnd::SaveScreenshot(const QString &file)
 
 void MainWnd::UpdateGeoTrees()
 {
+	auto _lock = m_scene.Lock();
+
 	// update object browser tree
 	if(m_dlgGeoBrowser)
 		m_dlgGeoBrowser->UpdateGeoTree(m_scene);
@@ -1285,6 +1695,33 @@ void MainWnd::CursorCoordsChanged(t_real_gl x, t_real_gl y, t_real_gl z)
 }
 
 
+/**
+ * number of rendered, culled, and occluded objects
+ */
+void MainWnd::CullingStatsChanged(std::size_t num_objs, std::size_t num_culled, std::size_t num_occluded)
+{
+	m_num_objs = num_objs;
+	m_num_objs_culled = num_culled;
+	m_num_objs_occluded = num_occluded;
+	UpdateStatusLabel();
+}
+
+
+/**
+ * number of objects uploaded to the renderer while loading a scene
+ */
+void MainWnd::SceneLoadProgress(std::size_t num_loaded, std::size_t num_objs)
+{
+	std::ostringstream ostr;
+	if(num_loaded < num_objs)
+		ostr << "Loading objects: " << num_loaded << " / " << num_objs << ".";
+	else
+		ostr << "Loaded " << num_objs << " objects.";
+
+	SetTmpStatus(ostr.str());
+}
+
+
 /**
  * mouse is over an object
  */
@@ -1330,6 +1767,7 @@ void MainWnd::ObjectClicked(const std::string& obj,
  */
 void MainWnd::ObjectDragged(bool drag_start, const std::string& objid)
 {
+	auto _lock = m_scene.Lock();
 	const std::shared_ptr<Geometry> obj = m_scene.FindObject(objid);
 
 	if(!m_renderer || !obj)
@@ -1378,7 +1816,7 @@ void MainWnd::ObjectDragged(bool drag_start, const std::string& objid)
 	// if the object is a light, set its new position
 	if(obj->GetLightId() >= 0)
 	{
-		const t_vec& pos = obj->GetPosition();
+		const t_vec3 pos = obj->GetPosition();
 		m_renderer->SetLight(obj->GetLightId(), m::convert<t_vec3_gl>(pos));
 	}
 }
@@ -1428,6 +1866,16 @@ void MainWnd::UpdateStatusLabel()
 	//if(m_curObj != "")
 	//	ostr << ", object: " << m_curObj;
 
+	// show rendered objects
+	if(m_num_objs)
+	{
+		ostr << std::noshowpos
+			<< ", objects: " << (m_num_objs - m_num_objs_culled - m_num_objs_occluded)
+			<< "/" << m_num_objs
+			<< " (culled: " << m_num_objs_culled
+			<< ", occluded: " << m_num_objs_occluded << ")";
+	}
+
 	ostr << ".";
 	m_labelStatus->setText(ostr.str().c_str());
 }
@@ -1461,11 +1909,39 @@ void MainWnd::InitSettings()
 
 	setAnimated(g_use_animations != 0);
 
+	Profiler::GetInstance().SetNumFrames(g_profiler_frames);
+	Profiler::GetInstance().SetEnabled(g_profiler != 0);
+
 	if(m_renderer)
 	{
 		m_renderer->SetLightFollowsCursor(g_light_follows_cursor);
 		m_renderer->EnableShadowRendering(g_enable_shadow_rendering);
+		m_renderer->EnableShadowMapCache(g_shadow_map_cache);
+		m_renderer->SetShadowMapSize(int(std::clamp(g_shadow_map_size, 16u, 16384u)));
 		m_renderer->EnablePortalRendering(g_enable_portal_rendering);
+		m_renderer->SetPortalDepth(g_portal_depth);
+		m_renderer->EnableInstancing(g_enable_instancing);
+		m_renderer->EnableOcclusionCulling(g_enable_occlusion_culling);
+		m_renderer->SetLodPixels(g_lod_pixels);
+		m_renderer->SetLightRange(g_light_range);
+		m_renderer->EnableGpuPicking(g_gpu_picking);
+		m_renderer->EnableSmoothing(g_polygon_smoothing);
+		m_renderer->SetRenderScale(g_render_scale);
+		m_renderer->EnableDynamicResolution(g_dynamic_resolution, t_real_gl(g_target_fps));
+		m_renderer->SetTextureMemory(std::size_t(g_texture_memory) * 1024 * 1024);
+		m_renderer->EnableProfilerOverlay(g_profiler_overlay);
+	}
+
+	if(m_sim)
+	{
+		m_sim->SetTimeStep(std::chrono::milliseconds(1000 / std::max(g_sim_tps, 1u)));
+		m_sim->SetInterpolation(g_sim_interpolation != 0);
+		m_sim->SetIdleTimeStep(std::chrono::milliseconds(1000 / std::max(g_timer_idle_tps, 1u)));
+
+		if(g_sim_thread && m_timer.isActive() && !m_scene.IsReplaying())
+			m_sim->Start();
+		else if(!g_sim_thread)
+			m_sim->Stop();
 	}
 }
 
@@ -1475,10 +1951,12 @@ void MainWnd::InitSettings()
  */
 void MainWnd::AddPlane()
 {
-	auto plane = std::make_shared<PlaneGeometry>();
+	auto _lock = m_scene.Lock();
+
+	auto plane = Geometry::create<PlaneGeometry>(m_scene.GetPool());
 	plane->SetWidth(2.);
 	plane->SetHeight(2.);
-	plane->SetPosition(m::create<t_vec>({0, 0, 0}));
+	plane->SetPosition(m::create<t_vec3>({0, 0, 0}));
 
 	static std::size_t cnt = 1;
 	std::ostringstream ostrId;
@@ -1500,11 +1978,13 @@ void MainWnd::AddPlane()
  */
 void MainWnd::AddCuboid()
 {
-	auto cuboid = std::make_shared<BoxGeometry>();
+	auto _lock = m_scene.Lock();
+
+	auto cuboid = Geometry::create<BoxGeometry>(m_scene.GetPool());
 	cuboid->SetHeight(2.);
 	cuboid->SetDepth(2.);
 	cuboid->SetLength(2.);
-	cuboid->SetPosition(m::create<t_vec>({0, 0, cuboid->GetHeight()*0.5}));
+	cuboid->SetPosition(m::create<t_vec3>({0, 0, cuboid->GetHeight()*0.5}));
 
 	static std::size_t cuboidcnt = 1;
 	std::ostringstream ostrId;
@@ -1526,9 +2006,11 @@ void MainWnd::AddCuboid()
  */
 void MainWnd::AddSphere()
 {
-	auto sphere = std::make_shared<SphereGeometry>();
+	auto _lock = m_scene.Lock();
+
+	auto sphere = Geometry::create<SphereGeometry>(m_scene.GetPool());
 	sphere->SetRadius(1.);
-	sphere->SetPosition(m::create<t_vec>({0, 0, sphere->GetRadius()}));
+	sphere->SetPosition(m::create<t_vec3>({0, 0, sphere->GetRadius()}));
 
 	static std::size_t sphcnt = 1;
 	std::ostringstream ostrId;
@@ -1550,9 +2032,11 @@ void MainWnd::AddSphere()
  */
 void MainWnd::AddCylinder()
 {
-	auto cyl = std::make_shared<CylinderGeometry>();
+	auto _lock = m_scene.Lock();
+
+	auto cyl = Geometry::create<CylinderGeometry>(m_scene.GetPool());
 	cyl->SetHeight(4.);
-	cyl->SetPosition(m::create<t_vec>({0, 0, cyl->GetHeight()*0.5}));
+	cyl->SetPosition(m::create<t_vec3>({0, 0, cyl->GetHeight()*0.5}));
 	cyl->SetRadius(0.5);
 
 	static std::size_t cylcnt = 1;
@@ -1575,9 +2059,11 @@ void MainWnd::AddCylinder()
  */
 void MainWnd::AddTetrahedron()
 {
-	auto tetr = std::make_shared<TetrahedronGeometry>();
+	auto _lock = m_scene.Lock();
+
+	auto tetr = Geometry::create<TetrahedronGeometry>(m_scene.GetPool());
 	tetr->SetRadius(1.);
-	tetr->SetPosition(m::create<t_vec>({0, 0, tetr->GetRadius()}));
+	tetr->SetPosition(m::create<t_vec3>({0, 0, tetr->GetRadius()}));
 
 	static std::size_t tetrcnt = 1;
 	std::ostringstream ostrId;
@@ -1599,9 +2085,11 @@ void MainWnd::AddTetrahedron()
  */
 void MainWnd::AddOctahedron()
 {
-	auto octa = std::make_shared<OctahedronGeometry>();
+	auto _lock = m_scene.Lock();
+
+	auto octa = Geometry::create<OctahedronGeometry>(m_scene.GetPool());
 	octa->SetRadius(1.);
-	octa->SetPosition(m::create<t_vec>({0, 0, octa->GetRadius()}));
+	octa->SetPosition(m::create<t_vec3>({0, 0, octa->GetRadius()}));
 
 	static std::size_t tetrcnt = 1;
 	std::ostringstream ostrId;
@@ -1623,9 +2111,11 @@ void MainWnd::AddOctahedron()
  */
 void MainWnd::AddDodecahedron()
 {
-	auto dode = std::make_shared<DodecahedronGeometry>();
+	auto _lock = m_scene.Lock();
+
+	auto dode = Geometry::create<DodecahedronGeometry>(m_scene.GetPool());
 	dode->SetRadius(1.);
-	dode->SetPosition(m::create<t_vec>({0, 0, dode->GetRadius()}));
+	dode->SetPosition(m::create<t_vec3>({0, 0, dode->GetRadius()}));
 
 	static std::size_t tetrcnt = 1;
 	std::ostringstream ostrId;
@@ -1647,9 +2137,11 @@ void MainWnd::AddDodecahedron()
  */
 void MainWnd::AddIcosahedron()
 {
-	auto icosa = std::make_shared<IcosahedronGeometry>();
+	auto _lock = m_scene.Lock();
+
+	auto icosa = Geometry::create<IcosahedronGeometry>(m_scene.GetPool());
 	icosa->SetRadius(1.);
-	icosa->SetPosition(m::create<t_vec>({0, 0, icosa->GetRadius()}));
+	icosa->SetPosition(m::create<t_vec3>({0, 0, icosa->GetRadius()}));
 
 	static std::size_t tetrcnt = 1;
 	std::ostringstream ostrId;
@@ -1718,6 +2210,8 @@ void MainWnd::CloneObject(const std::string& obj)
 	if(obj == "")
 		return;
 
+	auto _lock = m_scene.Lock();
+
 	// remove object from scene
 	if(auto geo = m_scene.CloneObject(obj); geo)
 	{
@@ -1752,17 +2246,16 @@ void MainWnd::RotateObject(const std::string& objname, t_real angle, char axis)
 	if(objname == "")
 		return;
 
+	auto _lock = m_scene.Lock();
+
 	// rotate the given object
 	if(auto [ok, objgeo] = m_scene.RotateObject(objname, angle, axis); ok)
 	{
 		UpdateGeoTrees();
 
-		// remove old 3d representation of object and create a new one
+		// update the 3d representation of the object
 		if(m_renderer && objgeo)
-		{
-			m_renderer->DeleteObject(objname);
-			m_renderer->AddObject(*objgeo);
-		}
+			m_renderer->UpdateObject(*objgeo);
 	}
 	else
 	{
@@ -1894,17 +2387,16 @@ void MainWnd::ChangeObjectProperty(const std::string& objname, const ObjectPrope
 	if(objname == "")
 		return;
 
+	auto _lock = m_scene.Lock();
+
 	// change object properties
 	if(auto [ok, objgeo] = m_scene.SetProperties(objname, { prop} ); ok)
 	{
 		UpdateGeoTrees();
 
-		// remove old 3d representation of object and create a new one
+		// update the 3d representation of the object
 		if(m_renderer && objgeo)
-		{
-			m_renderer->DeleteObject(objname);
-			m_renderer->AddObject(*objgeo);
-		}
+			m_renderer->UpdateObject(*objgeo);
 	}
 	else
 	{
@@ -26,10 +26,12 @@
 
 #include "types.h"
 #include "Scene.h"
+#include "SimThread.h"
 
 #include "settings_variables.h"
 #include "common/Resources.h"
 #include "common/Recent.h"
+#include "common/Profiler.h"
 
 #include "renderer/GlRenderer.h"
 
@@ -51,7 +53,7 @@ public:
 	 * create UI
 	 */
 	MainWnd(QWidget* pParent = nullptr);
-	virtual ~MainWnd() = default;
+	virtual ~MainWnd();
 
 	MainWnd(const MainWnd&) = delete;
 	const MainWnd& operator=(const MainWnd&) = delete;
@@ -62,7 +64,7 @@ public:
 	bool OpenFile(const QString &file);
 
 	// save file
-	bool SaveFile(const QString &file);
+	bool SaveFile(const QString &file, bool xml = false);
 
 
 private:
@@ -72,7 +74,6 @@ private:
 	// renderer
 	std::shared_ptr<GlSceneRenderer> m_renderer
 		{ std::make_shared<GlSceneRenderer>(this) };
-	int m_multisamples{ 8 };
 
 	// gl info strings
 	std::string m_gl_api_ver{}, m_glsl_api_ver{},
@@ -109,6 +110,9 @@ private:
 	// recently opened files
 	RecentFiles m_recent{this, g_maxnum_recents};
 
+	// scene file being written in the background
+	std::future<bool> m_saving{};
+
 	// function to call for the recent file menu items
 	std::function<bool(const QString& filename)> m_open_func
 		= [this](const QString& filename) -> bool
@@ -119,17 +123,26 @@ private:
 	// scene configuration
 	Scene m_scene{};
 
+	// fixed-step simulation thread
+	std::shared_ptr<SimThread> m_sim{ std::make_shared<SimThread>(m_scene) };
+
 	// timer
 	QTimer m_timer{};
 	t_real m_timescale{1};
 	t_int m_maxtimestep{100};
 
+	// simulation time shown by the replay
+	t_real m_replay_time{0};
+
 	// mouse picker
 	t_vec m_drag_start = m::create<t_vec>({0, 0, 0});
 	t_real m_mouseX{}, m_mouseY{}, m_mouseZ{};
 	t_vec3_gl m_curInters = m::create<t_vec3_gl>({0, 0, 0});
 	std::string m_curObj{};
 
+	// culling statistics
+	std::size_t m_num_objs{}, m_num_objs_culled{}, m_num_objs_occluded{};
+
 	MouseDragMode m_mousedragmode{ MouseDragMode::POSITION };
 
 
@@ -144,6 +157,7 @@ protected:
 	// timer ticks
 	void tick(const std::chrono::milliseconds& ms);
 	void EnableTimer(bool enabled = true);
+	void SetTimerIdle(bool idle);
 
 	// save a screenshot of the scene 3d view
 	bool SaveScreenshot(const QString& file);
@@ -151,6 +165,9 @@ protected:
 	// remember current file and set window title
 	void SetCurrentFile(const QString &file);
 
+	// the scene has been written in the background
+	void SaveFinished(const QString &file, bool xml, bool ok);
+
 	void UpdateGeoTrees();
 
 
@@ -168,15 +185,36 @@ protected slots:
 	// File -> Save As
 	void SaveFileAs();
 
+	// File -> Export XML
+	void ExportXml();
+
 	// File -> Save Screenshot
 	void SaveScreenshot();
 
+	// Tools -> Save Frame Profile
+	void SaveProfile();
+
+	// Tools -> Start/Stop Recording
+	void StartRecording();
+	void StopRecording();
+
+	// Tools -> Replay Recording
+	void StartReplay();
+	void RewindReplay();
+	void StopReplay();
+
 	// called after the plotter has initialised
 	void AfterGLInitialisation();
 
 	// mouse coordinates on base plane
 	void CursorCoordsChanged(t_real_gl x, t_real_gl y, t_real_gl z);
 
+	// number of rendered, culled, and occluded objects
+	void CullingStatsChanged(std::size_t num_objs, std::size_t num_culled, std::size_t num_occluded);
+
+	// progress of the scene upload
+	void SceneLoadProgress(std::size_t num_loaded, std::size_t num_objs);
+
 	// mouse is over an object
 	void PickerIntersection(const t_vec3_gl* pos, std::string obj_name);
 
@@ -185,6 +223,7 @@ protected slots:
 
 	// dragging an object
 	void ObjectDragged(bool drag_start, const std::string& obj);
+	void InputReceived();
 
 	// set temporary status message, by default for 2 seconds
 	void SetTmpStatus(const std::string& msg, int msg_duration=2000);
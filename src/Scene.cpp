@@ -11,6 +11,12 @@
 
 #include <unordered_map>
 #include <optional>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <boost/algorithm/string.hpp>
 
 #if __has_include(<filesystem>)
 	#include <filesystem>
@@ -21,6 +27,7 @@
 #endif
 
 #include "Scene.h"
+#include "common/Profiler.h"
 
 namespace pt = boost::property_tree;
 
@@ -28,14 +35,224 @@ namespace pt = boost::property_tree;
 Scene::Scene() : m_sigUpdate{std::make_shared<t_sig_update>()}
 {
 #ifdef USE_BULLET
-	m_coll = std::make_shared<btDefaultCollisionConfiguration>(
-		btDefaultCollisionConstructionInfo{});
-	m_disp = std::make_shared<btCollisionDispatcher/*Mt*/>(m_coll.get());
-	m_cache = std::make_shared<btDbvtBroadphase>();
-	m_solver = std::make_shared<btSequentialImpulseConstraintSolver>();
-	m_world = std::make_shared<btDiscreteDynamicsWorld>(
-		m_disp.get(), m_cache.get(), m_solver.get(), m_coll.get());
+	CreateWorld();
+#endif
+}
+
+
+#ifdef USE_BULLET
+/**
+ * get bullet's task scheduler, a sequential one is used if bullet is not thread-safe
+ */
+static btITaskScheduler* get_task_scheduler()
+{
+	static btITaskScheduler* sched = []() -> btITaskScheduler*
+	{
+		btITaskScheduler *sched = btCreateDefaultTaskScheduler();
+		if(!sched)
+			sched = btGetSequentialTaskScheduler();
+
+		btSetTaskScheduler(sched);
+		return sched;
+	}();
+
+	return sched;
+}
+
+
+/**
+ * (re-)create the simulation world for the given number of threads
+ */
+void Scene::CreateWorld()
+{
+	// remove the rigid bodies from a previous world
+	for(auto& obj : m_objs)
+		RemoveRigidBody(*obj);
+	RemoveStaticBody();
+
+	m_world.reset();
+	m_solver_pool.reset();
+	m_solver.reset();
+	m_cache.reset();
+	m_disp.reset();
+	m_coll.reset();
+
+	btDefaultCollisionConstructionInfo coll_info{};
+
+	if(m_num_threads > 1)
+	{
+		btITaskScheduler *sched = get_task_scheduler();
+		sched->setNumThreadsUsed(m_num_threads);
+
+		// the threads share these pools
+		coll_info.m_defaultMaxPersistentManifoldPoolSize = 80000;
+		coll_info.m_defaultMaxCollisionAlgorithmPoolSize = 80000;
+
+		m_coll = std::make_shared<btDefaultCollisionConfiguration>(coll_info);
+		m_disp = std::make_shared<btCollisionDispatcherMt>(m_coll.get());
+		m_cache = std::make_shared<btDbvtBroadphase>();
+		m_solver = std::make_shared<btSequentialImpulseConstraintSolverMt>();
+		m_solver_pool = std::make_shared<btConstraintSolverPoolMt>(m_num_threads);
+
+		auto world = std::make_shared<btDiscreteDynamicsWorldMt>(
+			m_disp.get(), m_cache.get(), m_solver_pool.get(),
+			m_solver.get(), m_coll.get());
+
+		// solve independent simulation islands in parallel
+		if(auto *islands = dynamic_cast<btSimulationIslandManagerMt*>(
+			world->getSimulationIslandManager()); islands)
+		{
+			islands->setIslandDispatchFunction(
+				btSimulationIslandManagerMt::parallelIslandDispatch);
+		}
+
+		m_world = world;
+	}
+	else
+	{
+		m_coll = std::make_shared<btDefaultCollisionConfiguration>(coll_info);
+		m_disp = std::make_shared<btCollisionDispatcher>(m_coll.get());
+		m_cache = std::make_shared<btDbvtBroadphase>();
+		m_solver = std::make_shared<btSequentialImpulseConstraintSolver>();
+		m_world = std::make_shared<btDiscreteDynamicsWorld>(
+			m_disp.get(), m_cache.get(), m_solver.get(), m_coll.get());
+	}
+
 	m_world->setGravity({0, 0, -9.81});
+
+	// only the moving objects need updated bounding boxes,
+	// the tree of the static proxies is then only rebuilt incrementally
+	m_world->setForceUpdateAllAabbs(false);
+	m_cache->m_deferedcollide = true;
+
+	// add the rigid bodies to the new world
+	for(auto& obj : m_objs)
+		AddRigidBody(*obj);
+}
+
+
+/**
+ * fixed, non-animated objects are part of the static compound body
+ */
+bool Scene::IsStaticBatched(Geometry& obj)
+{
+	auto *rigidbody = obj.GetRigidBody().get();
+	return rigidbody && rigidbody->isStaticObject() && obj.GetAnimations().size() == 0;
+}
+
+
+/**
+ * add an object's rigid body to the world, or schedule the rebuild of the static body
+ */
+void Scene::AddRigidBody(Geometry& obj)
+{
+	auto *rigidbody = obj.GetRigidBody().get();
+	if(!m_world || !rigidbody)
+		return;
+
+	if(IsStaticBatched(obj))
+		m_static_dirty = true;
+	else if(!rigidbody->isInWorld())
+		m_world->addRigidBody(rigidbody);
+}
+
+
+/**
+ * remove an object's rigid body from the world, or schedule the rebuild of the static body
+ */
+void Scene::RemoveRigidBody(Geometry& obj)
+{
+	auto *rigidbody = obj.GetRigidBody().get();
+	if(!m_world || !rigidbody)
+		return;
+
+	if(rigidbody->isInWorld())
+		m_world->removeRigidBody(rigidbody);
+	else
+		m_static_dirty = true;
+}
+
+
+/**
+ * remove the static body, it refers to the objects' shapes
+ */
+void Scene::RemoveStaticBody()
+{
+	if(m_world && m_static_body)
+		m_world->removeRigidBody(m_static_body.get());
+
+	m_static_body.reset();
+	m_static_shape.reset();
+	m_static_child_shapes.clear();
+	m_static_dirty = true;
+}
+
+
+/**
+ * merge the shapes of all fixed objects into a single static body,
+ * so that they only need one broadphase proxy
+ */
+void Scene::UpdateStaticBody()
+{
+	if(!m_static_dirty || !m_world)
+		return;
+
+	RemoveStaticBody();
+	m_static_dirty = false;
+
+	// the child shapes are shared with the objects, they are placed at their world transformations
+	auto shape = std::make_shared<btCompoundShape>(true);
+	for(auto& obj : m_objs)
+	{
+		if(!IsStaticBatched(*obj))
+			continue;
+
+		btRigidBody *rigidbody = obj->GetRigidBody().get();
+		m_static_child_shapes.push_back(obj->GetShape());
+		shape->addChildShape(rigidbody->getWorldTransform(), m_static_child_shapes.back().get());
+	}
+
+	Profiler::GetInstance().AddCount("static shapes", double(shape->getNumChildShapes()));
+	if(shape->getNumChildShapes() == 0)
+		return;
+
+	m_static_shape = shape;
+	m_static_body = std::make_shared<btRigidBody>(
+		btRigidBody::btRigidBodyConstructionInfo{
+			0, nullptr, m_static_shape.get(), {0, 0, 0}});
+	m_world->addRigidBody(m_static_body.get());
+}
+#endif
+
+
+/**
+ * maximum number of threads usable for the simulation
+ */
+t_int Scene::GetMaxNumThreads()
+{
+#ifdef USE_BULLET
+	return std::max<t_int>(1, get_task_scheduler()->getMaxNumThreads());
+#else
+	return 1;
+#endif
+}
+
+
+/**
+ * set the number of threads for the simulation
+ */
+void Scene::SetNumThreads(t_int num_threads)
+{
+	auto _lock = Lock();
+
+	num_threads = std::clamp<t_int>(num_threads, 1, GetMaxNumThreads());
+	if(num_threads == m_num_threads)
+		return;
+
+	m_num_threads = num_threads;
+
+#ifdef USE_BULLET
+	CreateWorld();
 #endif
 }
 
@@ -49,7 +266,7 @@ Scene::~Scene()
 /**
  * assign data from another scene
  */
-Scene::Scene(const Scene& scene)
+Scene::Scene(const Scene& scene) : Scene()
 {
 	*this = scene;
 }
@@ -60,7 +277,33 @@ Scene::Scene(const Scene& scene)
  */
 const Scene& Scene::operator=(const Scene& scene)
 {
-	this->m_objs = scene.m_objs;
+	if(this == &scene)
+		return *this;
+
+	const std::shared_ptr<const SceneSnapshot> snapshot = scene.TakeSnapshot();
+	this->RestoreSnapshot(snapshot);
+
+#ifdef USE_BULLET
+	// every scene simulates its own rigid bodies, so the objects are copied right away
+	for(auto& obj : m_objs)
+	{
+		const t_handle handle = obj->GetHandle();
+		std::shared_ptr<Geometry> copy = obj->clone();
+		copy->SetHandle(handle);
+
+		m_handles[handle] = copy;
+		m_owned_gen[handle] = m_snapshot_gen;
+		obj = copy;
+		AddRigidBody(*obj);
+	}
+#else
+	// the objects are shared until one of the scenes changes them
+	this->m_copied_snapshot = snapshot;
+	this->m_copied_gen = m_snapshot_gen;
+	this->m_num_copied_objs = m_objs.size();
+#endif
+
+	this->m_next_handle = std::max(this->m_next_handle, scene.m_next_handle);
 
 	this->m_drag_pos_axis_start = scene.m_drag_pos_axis_start;
 	this->m_sigUpdate = std::make_shared<t_sig_update>();
@@ -74,35 +317,400 @@ const Scene& Scene::operator=(const Scene& scene)
  */
 void Scene::Clear()
 {
+	auto _lock = Lock();
+
+	// the recorded handles and the replayed objects become invalid
+	StopRecording();
+	m_player.reset();
+	m_replayed_objs.clear();
+	m_replay_snapshot.reset();
+
 #ifdef USE_BULLET
 	for(auto& obj : m_objs)
-	{
-		if(auto *rigidbody = obj->GetRigidBody().get(); m_world && rigidbody)
-			m_world->removeRigidBody(rigidbody);
-	}
+		RemoveRigidBody(*obj);
+	RemoveStaticBody();
 #endif
 
 	// clear
 	m_objs.clear();
+	m_handles.clear();
+	m_ids.clear();
+	m_owned_gen.clear();
+	m_copied_snapshot.reset();
+	m_num_copied_objs = 0;
+	m_bvh_dirty = true;
+
+	m_anims.clear();
+	m_anim_progs.clear();
+	m_anims_dirty = true;
+	m_time = 0;
+
+	// the memory of the objects is freed in bulk with the pool
+	m_pool = create_pool();
 
 	// remove listeners
 	m_sigUpdate = std::make_shared<t_sig_update>();
 }
 
 
+/**
+ * get an immutable snapshot of the objects, sharing them with the scene
+ */
+std::shared_ptr<const SceneSnapshot> Scene::TakeSnapshot() const
+{
+	auto _lock = Lock();
+
+	auto snapshot = std::make_shared<SceneSnapshot>();
+	snapshot->m_objs.assign(m_objs.begin(), m_objs.end());
+	snapshot->m_time = m_time;
+
+	// all current objects are now shared and get copied before they are changed
+	m_snapshots.emplace_back(++m_snapshot_gen, snapshot);
+	return snapshot;
+}
+
+
+/**
+ * replace the objects with the ones of a snapshot, e.g. for undo
+ */
+void Scene::RestoreSnapshot(const std::shared_ptr<const SceneSnapshot>& snapshot)
+{
+	auto _lock = Lock();
+	if(!snapshot)
+		return;
+
+#ifdef USE_BULLET
+	for(auto& obj : m_objs)
+		RemoveRigidBody(*obj);
+	RemoveStaticBody();
+#endif
+
+	m_objs.clear();
+	m_handles.clear();
+	m_ids.clear();
+	m_owned_gen.clear();
+	m_copied_snapshot.reset();
+	m_num_copied_objs = 0;
+	m_objs.reserve(snapshot->m_objs.size());
+
+	// the objects stay shared with the snapshot
+	for(const auto& constobj : snapshot->m_objs)
+	{
+		auto obj = std::const_pointer_cast<Geometry>(constobj);
+		m_objs.push_back(obj);
+		RegisterObject(obj);
+#ifdef USE_BULLET
+		AddRigidBody(*obj);
+#endif
+	}
+
+	// the objects are only copied as long as the caller keeps the snapshot
+	m_snapshots.emplace_back(++m_snapshot_gen, snapshot);
+
+	m_time = snapshot->m_time;
+	m_bvh_dirty = true;
+	m_anims_dirty = true;
+}
+
+
+/**
+ * get the newest generation of the snapshots that still exist,
+ * objects that have been owned since an earlier generation are shared with it
+ */
+std::size_t Scene::GetSharedGeneration() const
+{
+	std::erase_if(m_snapshots, [](const auto& snapshot) -> bool
+	{
+		return snapshot.second.expired();
+	});
+
+	// the generations are in ascending order
+	return m_snapshots.size() ? m_snapshots.back().first : 0;
+}
+
+
+/**
+ * replace an object that is shared with a snapshot by a copy before it is changed,
+ * the copy takes over the object's handle and simulation state
+ */
+void Scene::Detach(std::shared_ptr<Geometry>& obj, std::size_t shared_gen)
+{
+	const t_handle handle = obj->GetHandle();
+	auto iter = m_owned_gen.find(handle);
+	const std::size_t owned_gen = (iter == m_owned_gen.end() ? 0 : iter->second);
+	if(owned_gen >= shared_gen)
+		return;
+	ReleaseCopiedObject(owned_gen);
+
+	std::shared_ptr<Geometry> copy = obj->clone();
+	copy->SetHandle(handle);
+	copy->SetTrafoChanged(obj->IsTrafoChanged());
+#ifdef USE_BULLET
+	// only this scene's world simulates the object
+	if(m_world)
+		copy->SwapRigidBody(*obj);
+#endif
+
+	m_handles[handle] = copy;
+	m_owned_gen[handle] = m_snapshot_gen;
+	obj = copy;
+}
+
+
+/**
+ * an object that has been shared with the scene this one was copied from
+ * is now owned or deleted, the snapshot is released with the last one
+ */
+void Scene::ReleaseCopiedObject(std::size_t owned_gen)
+{
+	if(m_copied_snapshot && owned_gen < m_copied_gen && --m_num_copied_objs == 0)
+		m_copied_snapshot.reset();
+}
+
+
+/**
+ * get an object that is about to be changed, it must not be shared with a snapshot
+ */
+std::shared_ptr<Geometry> Scene::GetOwnedObject(t_handle handle)
+{
+	auto iter = m_handles.find(handle);
+	if(iter == m_handles.end())
+		return nullptr;
+
+	if(const std::size_t shared_gen = GetSharedGeneration(); shared_gen)
+	{
+		if(auto objiter = std::find(m_objs.begin(), m_objs.end(), iter->second);
+			objiter != m_objs.end())
+		{
+			Detach(*objiter, shared_gen);
+			return *objiter;
+		}
+	}
+
+	return iter->second;
+}
+
+
 void Scene::tick(const std::chrono::milliseconds& ms)
 {
+	auto _lock = Lock();
+	ProfilerScope _prof{"cpu: physics"};
+
+	// the objects are moved by the replay
+	if(m_player)
+		return;
+
 #ifdef USE_BULLET
+	UpdateStaticBody();
 	if(m_world)
 		m_world->stepSimulation(t_real(ms.count()) / 1000.);
 #endif
 
+#ifdef USE_BULLET
+	const std::size_t shared_gen = GetSharedGeneration();
+#endif
 	for(auto& obj : m_objs)
+	{
+#ifdef USE_BULLET
+		// moving objects that are shared with snapshots are copied before being updated
+		if(auto *rigidbody = obj->GetRigidBody().get(); rigidbody &&
+			rigidbody->isActive() && !rigidbody->isStaticObject())
+			Detach(obj, shared_gen);
+#endif
 		obj->tick(ms);
+	}
+
+	// animations override the simulated state
+	m_time += t_real(ms.count()) / 1000.;
+	Animate();
+
+	m_bvh_moved = true;
+
+	if(m_recorder)
+		RecordFrame();
+}
+
+
+/**
+ * would the next tick leave the scene unchanged?
+ * this is the case if there are no animations and all bodies are asleep
+ */
+bool Scene::IsIdle() const
+{
+	auto _lock = Lock();
+
+	if(m_anims_dirty || m_anims.size())
+		return false;
 
 #ifdef USE_BULLET
-	EmitUpdate();
+	for(const auto& obj : m_objs)
+	{
+		if(auto *rigidbody = obj->GetRigidBody().get(); rigidbody &&
+			rigidbody->isActive() && !rigidbody->isStaticObject())
+			return false;
+	}
 #endif
+
+	return true;
+}
+
+
+/**
+ * compile the animation expressions of all objects
+ */
+void Scene::CompileAnimations()
+{
+	m_anims.clear();
+	m_anim_progs.clear();
+	m_anims_dirty = false;
+
+	// indices of already compiled expressions
+	std::unordered_map<std::string, std::size_t> prog_indices;
+	ExprParser<t_real> parser;
+	const std::vector<std::string> vars{ "t" };
+
+	for(std::size_t objidx = 0; objidx < m_objs.size(); ++objidx)
+	{
+		const std::shared_ptr<Geometry>& obj = m_objs[objidx];
+		for(const auto& [key, expr] : obj->GetAnimations())
+		{
+			Animation anim{ .objidx = objidx };
+			if(key == "position")
+				anim.target = AnimationTarget::POSITION;
+			else if(key == "rotation")
+				anim.target = AnimationTarget::ROTATION;
+			else
+			{
+				std::cerr << "Error: Property \"" << key << "\" of object \""
+					<< obj->GetId() << "\" cannot be animated." << std::endl;
+				continue;
+			}
+
+			std::vector<std::string> comps;
+			boost::split(comps, expr, boost::is_any_of("|;,"), boost::token_compress_on);
+			if(comps.size() != anim.exprs.size())
+			{
+				std::cerr << "Error: Animation of \"" << key << "\" of object \""
+					<< obj->GetId() << "\" needs " << anim.exprs.size()
+					<< " components." << std::endl;
+				continue;
+			}
+
+			try
+			{
+				for(std::size_t comp = 0; comp < comps.size(); ++comp)
+				{
+					boost::trim(comps[comp]);
+					auto iter = prog_indices.find(comps[comp]);
+					if(iter == prog_indices.end())
+					{
+						ExprProgram<t_real> prog = parser.Compile(comps[comp], vars);
+						if(!prog.IsValid())
+							throw std::runtime_error("Invalid expression \"" + comps[comp] + "\".");
+
+						iter = prog_indices.emplace(comps[comp], m_anim_progs.size()).first;
+						m_anim_progs.emplace_back(std::move(prog));
+					}
+
+					anim.exprs[comp] = iter->second;
+				}
+			}
+			catch(const std::exception& ex)
+			{
+				std::cerr << "Error: Animation of \"" << key << "\" of object \""
+					<< obj->GetId() << "\": " << ex.what() << std::endl;
+				continue;
+			}
+
+			m_anims.push_back(anim);
+		}
+	}
+}
+
+
+/**
+ * evaluate all animation expressions in one pass and apply them to the objects
+ */
+void Scene::Animate()
+{
+	if(m_anims_dirty)
+		CompileAnimations();
+	if(m_anims.size() == 0)
+		return;
+
+	m_anim_vals.resize(m_anim_progs.size());
+	ExprProgram<t_real>::EvaluateBatch(m_anim_progs.data(), m_anim_progs.size(),
+		&m_time, m_anim_vals.data());
+
+	const std::size_t shared_gen = GetSharedGeneration();
+	for(const Animation& anim : m_anims)
+	{
+		std::shared_ptr<Geometry>& obj = m_objs[anim.objidx];
+		Detach(obj, shared_gen);
+
+		const t_real x = m_anim_vals[anim.exprs[0]];
+		const t_real y = m_anim_vals[anim.exprs[1]];
+		const t_real z = m_anim_vals[anim.exprs[2]];
+
+		switch(anim.target)
+		{
+			case AnimationTarget::POSITION:
+			{
+				obj->SetPosition(m::create<t_vec3>({ x, y, z }));
+				break;
+			}
+			case AnimationTarget::ROTATION:
+			{
+				// rot_z(z) * rot_y(y) * rot_x(x), composed directly into the fixed-size matrix
+				const t_real cx = std::cos(x), sx = std::sin(x);
+				const t_real cy = std::cos(y), sy = std::sin(y);
+				const t_real cz = std::cos(z), sz = std::sin(z);
+
+				t_mat44 rot = m::unit<t_mat44>(4);
+				rot(0, 0) = cz*cy;
+				rot(0, 1) = cz*sy*sx - sz*cx;
+				rot(0, 2) = cz*sy*cx + sz*sx;
+				rot(1, 0) = sz*cy;
+				rot(1, 1) = sz*sy*sx + cz*cx;
+				rot(1, 2) = sz*sy*cx - cz*sx;
+				rot(2, 0) = -sy;
+				rot(2, 1) = cy*sx;
+				rot(2, 2) = cy*cx;
+				obj->SetRotation(rot);
+				break;
+			}
+		}
+	}
+}
+
+
+/**
+ * signal the objects that have been changed since the last update
+ * @return false if nothing has changed
+ */
+bool Scene::EmitUpdate()
+{
+	auto _lock = Lock();
+
+	m_changed_objs.clear();
+
+	for(auto& obj : m_objs)
+	{
+		if(!obj->IsTrafoChanged())
+			continue;
+
+		m_changed_objs.push_back(obj);
+		obj->SetTrafoChanged(false);
+	}
+
+	if(m_changed_objs.size())
+		m_bvh_moved = true;
+
+	if(m_changed_objs.size() == 0)
+		return false;
+
+	(*m_sigUpdate)(*this, m_changed_objs);
+	return true;
 }
 
 
@@ -111,6 +719,8 @@ void Scene::tick(const std::chrono::milliseconds& ms)
  */
 bool Scene::Load(const pt::ptree& prop)
 {
+	auto _lock = Lock();
+
 	Clear();
 
 	// objects
@@ -124,7 +734,7 @@ bool Scene::Load(const pt::ptree& prop)
 			if(!geo)
 				continue;
 
-			if(auto geoobj = Geometry::load(*geo); std::get<0>(geoobj))
+			if(auto geoobj = Geometry::load(*geo, m_pool); std::get<0>(geoobj))
 				AddObject(std::get<1>(geoobj), id);
 		}
 	}
@@ -138,6 +748,8 @@ bool Scene::Load(const pt::ptree& prop)
  */
 pt::ptree Scene::Save() const
 {
+	auto _lock = Lock();
+
 	pt::ptree prop;
 
 	// objects
@@ -161,6 +773,53 @@ pt::ptree Scene::Save() const
 }
 
 
+/**
+ * write the configuration and the objects of a snapshot as xml,
+ * the objects are streamed one by one instead of building the whole property tree
+ */
+bool Scene::SaveXml(const SceneSnapshot& snapshot, const std::string& filename,
+	const pt::ptree& config)
+{
+	std::ofstream ofstr{filename};
+	if(!ofstr)
+		return false;
+
+	const auto settings = pt::xml_writer_make_settings('\t', 1, std::string{"utf-8"});
+
+	ofstr << "<?xml version=\"1.0\" encoding=\"" << settings.encoding << "\"?>\n";
+	ofstr << "<" APPL_IDENT ">\n";
+
+	// configuration
+	if(auto sceneconfig = config.get_child_optional(APPL_IDENT); sceneconfig)
+	{
+		for(const auto& [key, child] : *sceneconfig)
+		{
+			if(key != "objects")
+				pt::xml_parser::write_xml_element(ofstr, key, child, 1, settings);
+		}
+	}
+
+	// objects
+	ofstr << settings.indent_char << "<objects>\n";
+
+	const auto& objs = snapshot.GetObjects();
+	for(std::size_t objidx=0; objidx<objs.size(); ++objidx)
+	{
+		pt::ptree propobj;
+		propobj.put<std::string>("<xmlattr>.id", "object " + std::to_string(objidx+1));
+		propobj.put_child("geometry", objs[objidx]->Save());
+
+		pt::xml_parser::write_xml_element(ofstr, std::string{"object"}, propobj, 2, settings);
+	}
+
+	ofstr << settings.indent_char << "</objects>\n";
+	ofstr << "</" APPL_IDENT ">\n";
+
+	ofstr.flush();
+	return !!ofstr;
+}
+
+
 /**
  * add an object to the scene
  */
@@ -168,16 +827,22 @@ void Scene::AddObject(
 	const std::vector<std::shared_ptr<Geometry>>& objs,
 	const std::string& id)
 {
+	auto _lock = Lock();
+
 	// get individual 3d primitives that comprise this object
 	for(auto& obj : objs)
 	{
 		if(obj->GetId() == "")
 			obj->SetId(id);
 		m_objs.push_back(obj);
+		RegisterObject(obj);
+		m_owned_gen[obj->GetHandle()] = m_snapshot_gen;
+		m_bvh_dirty = true;
+		if(obj->GetAnimations().size())
+			m_anims_dirty = true;
 
 #ifdef USE_BULLET
-		if(auto *rigidbody = obj->GetRigidBody().get(); m_world && rigidbody)
-			m_world->addRigidBody(rigidbody);
+		AddRigidBody(*obj);
 #endif
 	}
 }
@@ -188,19 +853,35 @@ void Scene::AddObject(
  */
 bool Scene::DeleteObject(const std::string& id)
 {
-	// find the object with the given id
-	if(auto iter = std::find_if(m_objs.begin(), m_objs.end(),
-		[&id](const std::shared_ptr<Geometry>& obj) -> bool
+	auto _lock = Lock();
+
+	// the object is only removed, so it isn't copied if it is shared with a snapshot
+	auto iter = m_objs.end();
+	if(auto handle_iter = m_ids.find(id); handle_iter != m_ids.end())
 	{
-		return obj->GetId() == id;
-	}); iter != m_objs.end())
+		if(auto obj_iter = m_handles.find(handle_iter->second); obj_iter != m_handles.end())
+			iter = std::find(m_objs.begin(), m_objs.end(), obj_iter->second);
+	}
+
+	if(iter != m_objs.end())
 	{
+		const std::shared_ptr<Geometry> obj = *iter;
 #ifdef USE_BULLET
-		if(auto *rigidbody = (*iter)->GetRigidBody().get(); m_world && rigidbody)
-			m_world->removeRigidBody(rigidbody);
+		RemoveRigidBody(*obj);
 #endif
 
+		UnregisterObject(*obj);
+		auto gen_iter = m_owned_gen.find(obj->GetHandle());
+		ReleaseCopiedObject(gen_iter == m_owned_gen.end() ? 0 : gen_iter->second);
+		if(gen_iter != m_owned_gen.end())
+			m_owned_gen.erase(gen_iter);
 		m_objs.erase(iter);
+		m_bvh_dirty = true;
+		m_anims_dirty = true;
+#ifdef USE_BULLET
+		// the static body could still refer to the deleted object's shape
+		UpdateStaticBody();
+#endif
 		return true;
 	}
 
@@ -213,14 +894,13 @@ bool Scene::DeleteObject(const std::string& id)
  */
 std::shared_ptr<Geometry> Scene::CloneObject(const std::string& id)
 {
+	auto _lock = Lock();
+
 	// find the object with the given id
-	if(auto iter = std::find_if(m_objs.begin(), m_objs.end(),
-		[&id](const std::shared_ptr<Geometry>& obj) -> bool
-	{
-		return obj->GetId() == id;
-	}); iter != m_objs.end())
+	const Scene* _this = this;
+	if(const std::shared_ptr<const Geometry> orgobj = _this->FindObject(id); orgobj)
 	{
-		auto obj = (*iter)->clone();
+		auto obj = orgobj->clone();
 
 		// assign a new, unique object id
 		std::size_t nr = 1;
@@ -229,17 +909,7 @@ std::shared_ptr<Geometry> Scene::CloneObject(const std::string& id)
 			std::ostringstream ostrid;
 			ostrid << id << " (clone " << (nr++) << ")";
 
-			bool already_assigned = false;
-			for(const auto& oldobj : m_objs)
-			{
-				if(oldobj->GetId() == ostrid.str())
-				{
-					already_assigned = true;
-					break;
-				}
-			}
-
-			if(!already_assigned)
+			if(!m_ids.contains(ostrid.str()))
 			{
 				obj->SetId(ostrid.str());
 				break;
@@ -259,9 +929,20 @@ std::shared_ptr<Geometry> Scene::CloneObject(const std::string& id)
  */
 bool Scene::RenameObject(const std::string& oldid, const std::string& newid)
 {
-	if(auto obj = FindObject(oldid); obj)
+	auto _lock = Lock();
+
+	const t_handle handle = GetHandle(oldid);
+	if(!handle)
+		return false;
+	if(oldid == newid)
+		return true;
+
+	if(auto obj = GetOwnedObject(handle); obj)
 	{
+		// the object keeps its handle
+		UnregisterObject(*obj);
 		obj->SetId(newid);
+		RegisterObject(obj);
 		return true;
 	}
 
@@ -275,9 +956,16 @@ bool Scene::RenameObject(const std::string& oldid, const std::string& newid)
 std::tuple<bool, std::shared_ptr<Geometry>> 
 Scene::RotateObject(const std::string& id, t_real angle, char axis)
 {
+	auto _lock = Lock();
+
 	if(auto obj = FindObject(id); obj)
 	{
 		obj->Rotate(angle, axis);
+		m_bvh_moved = true;
+#ifdef USE_BULLET
+		if(IsStaticBatched(*obj))
+			m_static_dirty = true;
+#endif
 		return std::make_tuple(true, obj);
 	}
 
@@ -294,6 +982,8 @@ void Scene::DragObject(bool drag_start,
 	const t_vec& pos_cur,
 	[[__maybe_unused__]] MouseDragMode drag_mode)
 {
+	auto _lock = Lock();
+
 	bool obj_dragged = false;
 
 	if(auto obj = FindObject(objid); obj)
@@ -301,7 +991,7 @@ void Scene::DragObject(bool drag_start,
 		if(obj->IsFixed())
 			return;
 
-		t_vec pos_obj = obj->GetPosition();
+		t_vec pos_obj = m::convert<t_vec>(obj->GetPosition());
 		if(pos_obj.size() < pos_cur.size())
 			pos_obj.resize(pos_cur.size());
 
@@ -326,12 +1016,12 @@ void Scene::DragObject(bool drag_start,
 		}
 		else if(drag_mode == MouseDragMode::POSITION)
 		{
-			obj->SetPosition(pos_cur - pos_startcur + m_drag_pos_axis_start);
+			obj->SetPosition(m::convert<t_vec3>(pos_cur - pos_startcur + m_drag_pos_axis_start));
 		}
 
 #else	// !USE_BULLET
 		// only position dragging possible
-		obj->SetPosition(pos_cur - pos_startcur + m_drag_pos_axis_start);
+		obj->SetPosition(m::convert<t_vec3>(pos_cur - pos_startcur + m_drag_pos_axis_start));
 
 #endif	// USE_BULLET
 
@@ -339,7 +1029,10 @@ void Scene::DragObject(bool drag_start,
 	}
 
 	if(obj_dragged)
+	{
+		m_bvh_moved = true;
 		EmitUpdate();
+	}
 }
 
 
@@ -348,8 +1041,12 @@ void Scene::DragObject(bool drag_start,
  */
 std::shared_ptr<Geometry> Scene::FindObject(const std::string& objid)
 {
-	const Scene* _this = this;
-	return std::const_pointer_cast<Geometry>(_this->FindObject(objid));
+	auto _lock = Lock();
+
+	if(auto iter = m_ids.find(objid); iter != m_ids.end())
+		return FindObject(iter->second);
+
+	return nullptr;
 }
 
 
@@ -358,16 +1055,280 @@ std::shared_ptr<Geometry> Scene::FindObject(const std::string& objid)
  */
 std::shared_ptr<const Geometry> Scene::FindObject(const std::string& objid) const
 {
-	if(auto iter = std::find_if(m_objs.begin(), m_objs.end(),
-		[&objid](const std::shared_ptr<Geometry>& obj) -> bool
+	auto _lock = Lock();
+
+	if(auto iter = m_ids.find(objid); iter != m_ids.end())
+		return FindObject(iter->second);
+
+	return nullptr;
+}
+
+
+/**
+ * find the object with the given handle
+ */
+std::shared_ptr<Geometry> Scene::FindObject(t_handle handle)
+{
+	auto _lock = Lock();
+
+	// the caller can change the object
+	return GetOwnedObject(handle);
+}
+
+
+/**
+ * find the object with the given handle
+ */
+std::shared_ptr<const Geometry> Scene::FindObject(t_handle handle) const
+{
+	auto _lock = Lock();
+
+	if(auto iter = m_handles.find(handle); iter != m_handles.end())
+		return iter->second;
+
+	return nullptr;
+}
+
+
+/**
+ * get the handle of the object with the given id, 0 if it doesn't exist
+ */
+Scene::t_handle Scene::GetHandle(const std::string& objid) const
+{
+	auto _lock = Lock();
+
+	if(auto iter = m_ids.find(objid); iter != m_ids.end())
+		return iter->second;
+
+	return 0;
+}
+
+
+/**
+ * add an object to the handle and id indices
+ */
+void Scene::RegisterObject(const std::shared_ptr<Geometry>& obj)
+{
+	// objects shared with a copied scene keep their handles
+	t_handle handle = obj->GetHandle();
+	if(auto iter = m_handles.find(handle); handle == 0 ||
+		(iter != m_handles.end() && iter->second != obj))
+	{
+		handle = m_next_handle++;
+		obj->SetHandle(handle);
+	}
+	m_next_handle = std::max(m_next_handle, handle + 1);
+
+	m_handles[handle] = obj;
+	m_ids.emplace(obj->GetId(), handle);
+}
+
+
+/**
+ * remove an object from the handle and id indices
+ */
+void Scene::UnregisterObject(const Geometry& obj)
+{
+	m_handles.erase(obj.GetHandle());
+
+	auto iter = m_ids.find(obj.GetId());
+	if(iter == m_ids.end() || iter->second != obj.GetHandle())
+		return;
+	m_ids.erase(iter);
+
+	// another object could have the same id
+	for(const auto& otherobj : m_objs)
+	{
+		if(otherobj.get() != &obj && otherobj->GetId() == obj.GetId())
 		{
-			return obj->GetId() == objid;
-		}); iter != m_objs.end())
+			m_ids.emplace(otherobj->GetId(), otherobj->GetHandle());
+			break;
+		}
+	}
+}
+
+
+/**
+ * get the world-space bounding box of an object from its local one
+ */
+static Bvh<t_real>::t_box get_world_box(const Bvh<t_real>::t_box& box, const t_mat44& trafo)
+{
+	Bvh<t_real>::t_box worldbox{};
+	if(box.min[0] > box.max[0])
+		return worldbox;  // empty
+
+	for(int corner=0; corner<8; ++corner)
 	{
-		return *iter;
+		const t_real pt[3]
+		{
+			(corner & 1) ? box.max[0] : box.min[0],
+			(corner & 2) ? box.max[1] : box.min[1],
+			(corner & 4) ? box.max[2] : box.min[2],
+		};
+
+		Bvh<t_real>::t_arr worldpt{};
+		for(int row=0; row<3; ++row)
+			worldpt[row] = trafo(row, 0)*pt[0] + trafo(row, 1)*pt[1] + trafo(row, 2)*pt[2] + trafo(row, 3);
+		worldbox.Add(worldpt);
 	}
 
-	return nullptr;
+	return worldbox;
+}
+
+
+/**
+ * rebuild the spatial index if objects have been added, removed, or reshaped,
+ * and refit it if they have moved
+ */
+void Scene::UpdateSpatialIndex() const
+{
+	if(m_bvh_dirty)
+	{
+		m_bvh_local_boxes.clear();
+		m_bvh_boxes.clear();
+		m_bvh_local_boxes.reserve(m_objs.size());
+		m_bvh_boxes.reserve(m_objs.size());
+
+		for(const auto& obj : m_objs)
+		{
+			t_bvh::t_box box{};
+			if(auto triags = obj->GetCachedTriangles(0); triags)
+			{
+				for(const t_vec& vert : std::get<0>(*triags))
+					box.Add(vert);
+			}
+
+			m_bvh_local_boxes.push_back(box);
+			m_bvh_boxes.push_back(get_world_box(box, obj->GetTrafo()));
+		}
+
+		m_bvh.Build(m_bvh_boxes.size(), [this](std::size_t idx) -> const t_bvh::t_box&
+		{
+			return m_bvh_boxes[idx];
+		});
+
+		m_bvh_dirty = false;
+		m_bvh_moved = false;
+	}
+	else if(m_bvh_moved)
+	{
+		for(std::size_t idx = 0; idx < m_objs.size(); ++idx)
+			m_bvh_boxes[idx] = get_world_box(m_bvh_local_boxes[idx], m_objs[idx]->GetTrafo());
+
+		m_bvh.Refit([this](std::size_t idx) -> const t_bvh::t_box&
+		{
+			return m_bvh_boxes[idx];
+		});
+
+		m_bvh_moved = false;
+	}
+}
+
+
+/**
+ * find the objects whose bounding boxes intersect the given box
+ */
+std::vector<std::shared_ptr<Geometry>> Scene::QueryObjects(const t_vec3& min, const t_vec3& max) const
+{
+	auto _lock = Lock();
+	UpdateSpatialIndex();
+
+	t_bvh::t_box box{};
+	box.Add(min);
+	box.Add(max);
+
+	std::vector<std::shared_ptr<Geometry>> objs;
+	m_bvh.Query(box, [this, &box, &objs](t_bvh::t_idx idx)
+	{
+		if(m_bvh_boxes[idx].Overlaps(box))
+			objs.push_back(m_objs[idx]);
+	});
+
+	return objs;
+}
+
+
+/**
+ * find the objects whose bounding boxes intersect the given sphere, e.g. the range of a light
+ */
+std::vector<std::shared_ptr<Geometry>> Scene::QueryObjectsNear(const t_vec3& pos, t_real radius) const
+{
+	auto _lock = Lock();
+	UpdateSpatialIndex();
+
+	t_bvh::t_box box{};
+	box.Add(t_bvh::t_arr{ pos[0] - radius, pos[1] - radius, pos[2] - radius });
+	box.Add(t_bvh::t_arr{ pos[0] + radius, pos[1] + radius, pos[2] + radius });
+
+	std::vector<std::shared_ptr<Geometry>> objs;
+	m_bvh.Query(box, [this, &pos, radius, &objs](t_bvh::t_idx idx)
+	{
+		// squared distance between the sphere centre and the box
+		const t_bvh::t_box& objbox = m_bvh_boxes[idx];
+		t_real dist = 0;
+		for(int i=0; i<3; ++i)
+		{
+			t_real d = std::max({ objbox.min[i] - pos[i], t_real(0), pos[i] - objbox.max[i] });
+			dist += d*d;
+		}
+
+		if(dist <= radius*radius)
+			objs.push_back(m_objs[idx]);
+	});
+
+	return objs;
+}
+
+
+/**
+ * find the objects whose bounding boxes are hit by a ray, e.g. the ones under the cursor,
+ * ordered by their distance to the ray origin
+ */
+std::vector<std::shared_ptr<Geometry>> Scene::QueryObjectsOnRay(const t_vec3& org, const t_vec3& dir) const
+{
+	auto _lock = Lock();
+	UpdateSpatialIndex();
+
+	const t_bvh::t_arr arr_org{ org[0], org[1], org[2] };
+	const t_bvh::t_arr arr_dir{ dir[0], dir[1], dir[2] };
+	t_bvh::t_arr inv_dir{};
+	for(int i=0; i<3; ++i)
+	{
+		inv_dir[i] = (dir[i] != t_real(0))
+			? t_real(1) / dir[i]
+			: std::numeric_limits<t_real>::max();
+	}
+
+	std::vector<std::pair<t_real, std::shared_ptr<Geometry>>> hits;
+	t_real lam_max = std::numeric_limits<t_real>::max();
+	t_bvh::t_idx closest{};
+
+	// the items are only collected, so that the whole ray is traversed
+	m_bvh.Intersect(arr_org, arr_dir, lam_max, closest,
+		[this, &arr_org, &inv_dir, &hits](t_bvh::t_idx idx, t_real lam) -> t_real
+	{
+		// the hits are ordered by the distance along the ray at which their boxes are entered
+		t_real lam_entry = 0;
+		const t_bvh::t_box& objbox = m_bvh_boxes[idx];
+		if(!objbox.Intersects(arr_org, inv_dir, lam, &lam_entry))
+			return -1;
+
+		hits.emplace_back(lam_entry, m_objs[idx]);
+		return -1;
+	});
+
+	std::stable_sort(hits.begin(), hits.end(),
+		[](const auto& hit1, const auto& hit2) -> bool
+	{
+		return hit1.first < hit2.first;
+	});
+
+	std::vector<std::shared_ptr<Geometry>> objs;
+	objs.reserve(hits.size());
+	for(auto& hit : hits)
+		objs.emplace_back(std::move(hit.second));
+
+	return objs;
 }
 
 
@@ -435,6 +1396,8 @@ std::pair<bool, std::string> Scene::load(
  */
 std::vector<ObjectProperty> Scene::GetProperties(const std::string& objid) const
 {
+	auto _lock = Lock();
+
 	// find the object with the given id
 	if(std::shared_ptr<const Geometry> obj = FindObject(objid); obj)
 	{
@@ -451,12 +1414,250 @@ std::vector<ObjectProperty> Scene::GetProperties(const std::string& objid) const
 std::tuple<bool, std::shared_ptr<Geometry>> Scene::SetProperties(
 	const std::string& objid, const std::vector<ObjectProperty>& props)
 {
-	// find the object with the given id
-	if(const std::shared_ptr<Geometry> obj = FindObject(objid); obj)
+	auto _lock = Lock();
+
+	// find the object with the given id, it is copied if it is shared with a snapshot
+	if(const std::shared_ptr<Geometry> obj = GetOwnedObject(GetHandle(objid)); obj)
 	{
+#ifdef USE_BULLET
+		// the object can change between the static and the dynamic bodies
+		RemoveRigidBody(*obj);
+		obj->SetProperties(props);
+		AddRigidBody(*obj);
+#else
 		obj->SetProperties(props);
+#endif
+		m_bvh_dirty = true;
+		m_anims_dirty = true;
 		return std::make_tuple(true, obj);
 	}
 
 	return std::make_tuple(false, nullptr);
 }
+
+
+/**
+ * start recording the objects that are simulated or animated,
+ * objects added afterwards are not part of the recording
+ */
+bool Scene::StartRecording(const std::string& filename)
+{
+	auto _lock = Lock();
+	StopRecording();
+
+	std::vector<std::string> ids;
+	m_recorded_objs.clear();
+	for(const auto& obj : m_objs)
+	{
+		if(obj->IsFixed() && obj->GetAnimations().size() == 0)
+			continue;
+
+		ids.push_back(obj->GetId());
+		m_recorded_objs.push_back(obj->GetHandle());
+	}
+
+	auto recorder = std::make_shared<TrajectoryRecorder>();
+	if(!recorder->Open(filename, ids))
+	{
+		m_recorded_objs.clear();
+		return false;
+	}
+
+	m_recorder = recorder;
+	m_recorded_trafos.assign(m_recorded_objs.size(), m::unit<t_mat44>(4));
+
+	// the current state is the first frame
+	RecordFrame();
+	return true;
+}
+
+
+/**
+ * finish the recording file
+ */
+bool Scene::StopRecording()
+{
+	auto _lock = Lock();
+	if(!m_recorder)
+		return true;
+
+	const bool ok = m_recorder->Close();
+	m_recorder.reset();
+	m_recorded_objs.clear();
+	m_recorded_trafos.clear();
+
+	return ok;
+}
+
+
+/**
+ * add the current poses to the recording, deleted objects keep their last ones
+ */
+void Scene::RecordFrame()
+{
+	ProfilerScope _prof{"cpu: recording"};
+
+	for(std::size_t idx = 0; idx < m_recorded_objs.size(); ++idx)
+	{
+		if(auto iter = m_handles.find(m_recorded_objs[idx]); iter != m_handles.end())
+			m_recorded_trafos[idx] = iter->second->GetTrafo();
+	}
+
+	m_recorder->AddFrame(m_time, m_recorded_trafos);
+}
+
+
+/**
+ * open a recording and move the scene's objects to its first frame
+ */
+bool Scene::StartReplay(const std::string& filename)
+{
+	auto _lock = Lock();
+	StopReplay();
+
+	auto player = std::make_shared<TrajectoryPlayer>();
+	if(!player->Open(filename))
+		return false;
+
+	std::unordered_map<t_handle, std::size_t> objindices;
+	for(std::size_t objidx = 0; objidx < m_objs.size(); ++objidx)
+		objindices.emplace(m_objs[objidx]->GetHandle(), objidx);
+
+	const std::vector<std::string>& ids = player->GetIds();
+	for(std::size_t poseidx = 0; poseidx < ids.size(); ++poseidx)
+	{
+		const t_handle handle = GetHandle(ids[poseidx]);
+		if(auto iter = objindices.find(handle); iter != objindices.end())
+		{
+			m_replayed_objs.emplace_back(ReplayedObject{
+				.objidx = iter->second, .handle = handle, .poseidx = poseidx });
+		}
+	}
+
+	if(m_replayed_objs.size() != ids.size())
+	{
+		std::cerr << "Warning: " << ids.size() - m_replayed_objs.size() << " of "
+			<< ids.size() << " recorded objects are not part of the scene." << std::endl;
+	}
+
+	if(m_replayed_objs.size() == 0)
+	{
+		std::cerr << "Error: No recorded objects are part of the scene." << std::endl;
+		return false;
+	}
+
+	// the replay changes copies of the objects
+	m_replay_snapshot = TakeSnapshot();
+	m_player = player;
+
+	return Replay(m_player->GetStartTime());
+}
+
+
+/**
+ * end the replay and return to the state from before it
+ */
+void Scene::StopReplay()
+{
+	auto _lock = Lock();
+	if(!m_player)
+		return;
+
+	m_player.reset();
+	m_replayed_objs.clear();
+
+#ifdef USE_BULLET
+	// the rigid bodies have been handed over to the replayed copies of the objects
+	struct ReplayedBody
+	{
+		std::shared_ptr<Geometry> obj{};
+		btVector3 lin_vel{}, ang_vel{};
+	};
+
+	std::unordered_map<t_handle, ReplayedBody> bodies;
+	for(const auto& obj : m_objs)
+	{
+		if(const auto body = obj->GetRigidBody(); body)
+		{
+			bodies.emplace(obj->GetHandle(), ReplayedBody{
+				.obj = obj,
+				.lin_vel = body->getLinearVelocity(),
+				.ang_vel = body->getAngularVelocity() });
+		}
+	}
+#endif
+
+	RestoreSnapshot(m_replay_snapshot);
+	m_replay_snapshot.reset();
+
+#ifdef USE_BULLET
+	// give the bodies back to the restored objects and move them to their poses
+	for(auto& obj : m_objs)
+	{
+		auto iter = bodies.find(obj->GetHandle());
+		if(iter == bodies.end())
+			continue;
+
+		ReplayedBody& replayed = iter->second;
+		if(replayed.obj != obj && !obj->GetRigidBody())
+		{
+			obj->SwapRigidBody(*replayed.obj);
+			obj->SetStateFromMatrix();
+			AddRigidBody(*obj);
+		}
+
+		if(const auto body = obj->GetRigidBody(); body)
+		{
+			body->setLinearVelocity(replayed.lin_vel);
+			body->setAngularVelocity(replayed.ang_vel);
+		}
+	}
+#endif
+
+	// the next update signal resets all of the objects' transformations
+	for(auto& obj : m_objs)
+		obj->SetTrafoChanged(true);
+}
+
+
+/**
+ * move the replayed objects to their recorded poses at the given simulation time,
+ * they are passed on to the listeners by the next update signal
+ */
+bool Scene::Replay(t_real time)
+{
+	auto _lock = Lock();
+	if(!m_player)
+		return false;
+
+	ProfilerScope _prof{"cpu: replay"};
+	if(!m_player->GetPoses(time, m_replay_poses))
+		return false;
+
+	const std::size_t shared_gen = GetSharedGeneration();
+	for(ReplayedObject& replayed : m_replayed_objs)
+	{
+		// the objects might have been reordered
+		if(replayed.objidx >= m_objs.size() || m_objs[replayed.objidx]->GetHandle() != replayed.handle)
+		{
+			auto iter = std::find_if(m_objs.begin(), m_objs.end(),
+				[&replayed](const std::shared_ptr<Geometry>& obj) -> bool
+			{
+				return obj->GetHandle() == replayed.handle;
+			});
+
+			if(iter == m_objs.end())
+				continue;
+			replayed.objidx = std::size_t(iter - m_objs.begin());
+		}
+
+		std::shared_ptr<Geometry>& obj = m_objs[replayed.objidx];
+		Detach(obj, shared_gen);
+		obj->SetTrafo(m_replay_poses[replayed.poseidx].GetTrafo());
+	}
+
+	m_time = time;
+	m_bvh_moved = true;
+
+	return true;
+}
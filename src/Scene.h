@@ -11,7 +11,10 @@
 
 #include <memory>
 #include <vector>
+#include <array>
 #include <chrono>
+#include <mutex>
+#include <unordered_map>
 
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
@@ -20,6 +23,39 @@
 #include "types.h"
 #include "Geometry.h"
 #include "Scene.h"
+#include "Trajectory.h"
+#include "common/ExprParser.h"
+#include "renderer/Bvh.h"
+
+#ifdef USE_BULLET
+	#include <LinearMath/btThreads.h>
+	#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+	#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#endif
+
+
+// ----------------------------------------------------------------------------
+// scene snapshot
+// ----------------------------------------------------------------------------
+/**
+ * immutable state of a scene's objects, e.g. for undo or for other threads;
+ * the objects are shared with the scene until the scene changes them
+ */
+class SceneSnapshot
+{
+public:
+	const std::vector<std::shared_ptr<const Geometry>>& GetObjects() const { return m_objs; }
+	t_real GetTime() const { return m_time; }
+
+
+private:
+	std::vector<std::shared_ptr<const Geometry>> m_objs{};
+	t_real m_time{0};
+
+	friend class Scene;
+};
+// ----------------------------------------------------------------------------
+
 
 
 // ----------------------------------------------------------------------------
@@ -27,6 +63,11 @@
 // ----------------------------------------------------------------------------
 class Scene
 {
+public:
+	// stable object handles, 0 is invalid
+	using t_handle = std::size_t;
+
+
 public:
 	// constructor and destructor
 	Scene();
@@ -49,8 +90,19 @@ public:
 
 	std::shared_ptr<Geometry> FindObject(const std::string& id);
 	std::shared_ptr<const Geometry> FindObject(const std::string& id) const;
+	std::shared_ptr<Geometry> FindObject(t_handle handle);
+	std::shared_ptr<const Geometry> FindObject(t_handle handle) const;
+	t_handle GetHandle(const std::string& id) const;
 	const std::vector<std::shared_ptr<Geometry>>& GetObjects() const { return m_objs; }
 
+	// pool for the scene's objects and their simulation states
+	const std::shared_ptr<t_pool>& GetPool() const { return m_pool; }
+
+	// objects whose world-space bounding boxes intersect a box, a sphere, or a ray
+	std::vector<std::shared_ptr<Geometry>> QueryObjects(const t_vec3& min, const t_vec3& max) const;
+	std::vector<std::shared_ptr<Geometry>> QueryObjectsNear(const t_vec3& pos, t_real radius) const;
+	std::vector<std::shared_ptr<Geometry>> QueryObjectsOnRay(const t_vec3& org, const t_vec3& dir) const;
+
 	void DragObject(bool drag_start, const std::string& obj,
 		const t_vec& start, const t_vec& pos,
 		MouseDragMode drag_mode = MouseDragMode::POSITION);
@@ -60,7 +112,7 @@ public:
 	void AddUpdateSlot(const t_slot& slot)
 		{ m_sigUpdate->connect(slot); }
 
-	void EmitUpdate() { (*m_sigUpdate)(*this); }
+	bool EmitUpdate();
 
 	std::vector<ObjectProperty> GetProperties(const std::string& obj) const;
 	std::tuple<bool, std::shared_ptr<Geometry>> SetProperties(
@@ -73,6 +125,36 @@ public:
 	void SetMouseDragMomentumScaling(t_real scale) { m_drag_scale_momentum = scale; }
 
 	void tick(const std::chrono::milliseconds& ms);
+	bool IsIdle() const;
+
+	// elapsed simulation time in seconds, the variable t of the animations
+	t_real GetTime() const { return m_time; }
+
+	// copy-on-write snapshots, only the objects changed afterwards are copied
+	std::shared_ptr<const SceneSnapshot> TakeSnapshot() const;
+	void RestoreSnapshot(const std::shared_ptr<const SceneSnapshot>& snapshot);
+
+	// recording of the moving objects' poses after every tick, see Trajectory.h
+	bool StartRecording(const std::string& filename);
+	bool StopRecording();
+	bool IsRecording() const { return m_recorder != nullptr; }
+
+	// replay of a recording without simulating, the scene is restored when it is stopped
+	bool StartReplay(const std::string& filename);
+	void StopReplay();
+	bool IsReplaying() const { return m_player != nullptr; }
+	bool Replay(t_real time);
+	t_real GetReplayStartTime() const { return m_player ? m_player->GetStartTime() : 0; }
+	t_real GetReplayEndTime() const { return m_player ? m_player->GetEndTime() : 0; }
+
+	// lock the scene against concurrent access from the simulation thread
+	std::unique_lock<std::recursive_mutex> Lock() const
+		{ return std::unique_lock<std::recursive_mutex>{m_mtx}; }
+
+	// number of threads for the physics simulation, 1: single-threaded
+	t_int GetNumThreads() const { return m_num_threads; }
+	void SetNumThreads(t_int num_threads);
+	static t_int GetMaxNumThreads();
 
 	static std::pair<bool, std::string> load(
 		/*const*/ boost::property_tree::ptree& prop,
@@ -83,30 +165,188 @@ public:
 		const std::string& filename,
 		Scene& scene);
 
+	// compact binary scene files, see SceneBinary.h
+	static bool is_binary(const std::string& filename);
+	static std::pair<bool, std::string> load_binary(
+		const std::string& filename,
+		Scene& scene,
+		boost::property_tree::ptree* config = nullptr);
+	bool SaveBinary(const std::string& filename,
+		const boost::property_tree::ptree& config,
+		bool bake_meshes = false) const;
+
+	// save the objects of a snapshot, e.g. from a worker thread
+	static bool SaveBinary(const SceneSnapshot& snapshot,
+		const std::string& filename,
+		const boost::property_tree::ptree& config,
+		bool bake_meshes = false);
+	static bool SaveXml(const SceneSnapshot& snapshot,
+		const std::string& filename,
+		const boost::property_tree::ptree& config);
+
 
 private:
 	// objects
 	std::vector<std::shared_ptr<Geometry>> m_objs{};
 
+	// replaced when the scene is cleared, the old one is released with its last object
+	std::shared_ptr<t_pool> m_pool{create_pool()};
+
+	// --------------------------------------------------------------------
+	// object registry
+	// --------------------------------------------------------------------
+	void RegisterObject(const std::shared_ptr<Geometry>& obj);
+	void UnregisterObject(const Geometry& obj);
+
+	t_handle m_next_handle{1};
+	std::unordered_map<t_handle, std::shared_ptr<Geometry>> m_handles{};
+
+	// the first object having a given id
+	std::unordered_map<std::string, t_handle> m_ids{};
+	// --------------------------------------------------------------------
+
+	// --------------------------------------------------------------------
+	// sharing of the objects with snapshots
+	// --------------------------------------------------------------------
+	std::size_t GetSharedGeneration() const;
+	void Detach(std::shared_ptr<Geometry>& obj, std::size_t shared_gen);
+
+	// get an object that is about to be changed, it is copied first if it is shared
+	std::shared_ptr<Geometry> GetOwnedObject(t_handle handle);
+	void ReleaseCopiedObject(std::size_t owned_gen);
+
+	// incremented by every snapshot
+	mutable std::size_t m_snapshot_gen{0};
+
+	// the snapshots that are still alive and their generations
+	mutable std::vector<std::pair<std::size_t, std::weak_ptr<const SceneSnapshot>>> m_snapshots{};
+
+	// generation in which the object has been added or copied,
+	// it is shared with all living snapshots of later generations
+	std::unordered_map<t_handle, std::size_t> m_owned_gen{};
+
+	// snapshot of the scene this one has been copied from,
+	// kept until all objects shared with it are owned or deleted
+	std::shared_ptr<const SceneSnapshot> m_copied_snapshot{};
+	std::size_t m_copied_gen{0};
+	std::size_t m_num_copied_objs{0};
+	// --------------------------------------------------------------------
+
+	// --------------------------------------------------------------------
+	// spatial index of the objects, updated lazily by the queries
+	// --------------------------------------------------------------------
+	using t_bvh = Bvh<t_real>;
+	void UpdateSpatialIndex() const;
+
+	// the items are the indices into m_objs
+	mutable t_bvh m_bvh{};
+	mutable std::vector<t_bvh::t_box> m_bvh_local_boxes{}, m_bvh_boxes{};
+
+	// rebuild after objects are added, removed, or reshaped, refit after they have moved
+	mutable bool m_bvh_dirty{true};
+	mutable bool m_bvh_moved{false};
+	// --------------------------------------------------------------------
+
 	// starting position for drag operation
 	t_vec m_drag_pos_axis_start{};
 
-	// update signal
-	using t_sig_update = boost::signals2::signal<void(const Scene&)>;
+	// update signal, passing the objects whose transformations have changed
+	using t_sig_update = boost::signals2::signal<void(
+		const Scene&, const std::vector<std::shared_ptr<Geometry>>&)>;
 	std::shared_ptr<t_sig_update> m_sigUpdate{};
 
+	// changed objects for the update signal
+	std::vector<std::shared_ptr<Geometry>> m_changed_objs{};
+
 	t_real m_eps{1e-6};
 
+	// mutex protecting the objects and the simulation world
+	mutable std::recursive_mutex m_mtx{};
+
 	// scaling factors for mouse dragging
 	t_real m_drag_scale_force{10.};
 	t_real m_drag_scale_momentum{0.1};
 
+	t_int m_num_threads{1};
+
+	// --------------------------------------------------------------------
+	// animated object properties, see Geometry::GetAnimations()
+	// --------------------------------------------------------------------
+	void CompileAnimations();
+	void Animate();
+
+	enum class AnimationTarget
+	{
+		POSITION,
+		ROTATION,    // angles around the x, y, and z axes
+	};
+
+	struct Animation
+	{
+		std::size_t objidx{0};  // index into m_objs
+		AnimationTarget target{AnimationTarget::POSITION};
+		std::array<std::size_t, 3> exprs{};  // component indices into m_anim_progs
+	};
+
+	// programs of all expression components, identical ones are shared
+	std::vector<ExprProgram<t_real>> m_anim_progs{};
+	std::vector<t_real> m_anim_vals{};
+	std::vector<Animation> m_anims{};
+
+	// recompile when objects or their properties have changed
+	bool m_anims_dirty{true};
+	t_real m_time{0};
+	// --------------------------------------------------------------------
+
+	// --------------------------------------------------------------------
+	// recording and replay, see Trajectory.h
+	// --------------------------------------------------------------------
+	void RecordFrame();
+
+	// the objects are fixed when the recording starts
+	std::shared_ptr<TrajectoryRecorder> m_recorder{};
+	std::vector<t_handle> m_recorded_objs{};
+	std::vector<t_mat44> m_recorded_trafos{};
+
+	struct ReplayedObject
+	{
+		std::size_t objidx{0};   // index into m_objs
+		t_handle handle{0};
+		std::size_t poseidx{0};  // index into the recorded objects
+	};
+
+	std::shared_ptr<TrajectoryPlayer> m_player{};
+	std::vector<ReplayedObject> m_replayed_objs{};
+	std::vector<TrajPose> m_replay_poses{};
+
+	// state from before the replay
+	std::shared_ptr<const SceneSnapshot> m_replay_snapshot{};
+	// --------------------------------------------------------------------
+
 #ifdef USE_BULLET
+	void CreateWorld();
+
+	// fixed objects are merged into one static body instead of being added individually
+	void AddRigidBody(Geometry& obj);
+	void RemoveRigidBody(Geometry& obj);
+	void UpdateStaticBody();
+	void RemoveStaticBody();
+	static bool IsStaticBatched(Geometry& obj);
+
 	std::shared_ptr<btDefaultCollisionConfiguration> m_coll{};
-	std::shared_ptr<btCollisionDispatcher/*Mt*/> m_disp{};
+	std::shared_ptr<btCollisionDispatcher> m_disp{};
 	std::shared_ptr<btDbvtBroadphase> m_cache{};
-	std::shared_ptr<btSequentialImpulseConstraintSolver> m_solver{};
+	std::shared_ptr<btConstraintSolver> m_solver{};
+	std::shared_ptr<btConstraintSolverPoolMt> m_solver_pool{};
 	std::shared_ptr<btDynamicsWorld> m_world{};
+
+	// compound of the fixed objects' shapes, rebuilt when they have changed
+	std::shared_ptr<btCompoundShape> m_static_shape{};
+	std::shared_ptr<btRigidBody> m_static_body{};
+
+	// the compound's children, kept alive when their objects switch to other shapes
+	std::vector<std::shared_ptr<btConvexInternalShape>> m_static_child_shapes{};
+	bool m_static_dirty{true};
 #endif
 };
 // ----------------------------------------------------------------------------
@@ -0,0 +1,560 @@
+/**
+ * binary scene file format
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ */
+
+#include "Scene.h"
+#include "SceneBinary.h"
+#include "settings_variables.h"
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <span>
+#include <cstring>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace pt = boost::property_tree;
+
+
+// general object properties, they are part of the fixed-layout object record
+static const char* g_binscene_record_props[] =
+{
+	"position", "rotation", "fixed", "colour", "lighting",
+	"light_id", "texture", "portal_id", "portal_trafo",
+};
+
+
+// the property types are stored as indices into the value variant
+static_assert(std::variant_size_v<decltype(ObjectProperty::value)> == 6);
+
+
+static constexpr std::uint64_t binscene_align(std::uint64_t offs)
+{
+	return (offs + 7) & ~std::uint64_t(7);
+}
+
+
+/**
+ * get the records of a section after checking that they lie within the file
+ */
+template<class t_rec>
+static std::span<const t_rec> binscene_section(const char* data, std::size_t size,
+	const BinSceneSection& sect, bool& ok)
+{
+	if(sect.offs > size || sect.size > size - sect.offs
+		|| sect.offs % alignof(t_rec) != 0 || sect.size % sizeof(t_rec) != 0)
+	{
+		ok = false;
+		return {};
+	}
+
+	return std::span<const t_rec>{
+		reinterpret_cast<const t_rec*>(data + sect.offs),
+		std::size_t(sect.size / sizeof(t_rec)) };
+}
+
+
+/**
+ * does the file have the binary scene format?
+ */
+bool Scene::is_binary(const std::string& filename)
+{
+	std::ifstream ifstr{filename, std::ios_base::binary};
+	if(!ifstr)
+		return false;
+
+	char magic[sizeof(BinSceneHeader::magic)]{};
+	if(!ifstr.read(magic, sizeof(magic)))
+		return false;
+
+	return std::memcmp(magic, BINSCENE_MAGIC, sizeof(magic)) == 0;
+}
+
+
+/**
+ * save the scene objects and the given configuration in the binary format
+ * with bake_meshes, the triangles of the shared meshes are stored as well
+ */
+bool Scene::SaveBinary(const std::string& filename,
+	const pt::ptree& config, bool bake_meshes) const
+{
+	return SaveBinary(*TakeSnapshot(), filename, config, bake_meshes);
+}
+
+
+/**
+ * save the objects of a snapshot and the given configuration in the binary format
+ */
+bool Scene::SaveBinary(const SceneSnapshot& snapshot, const std::string& filename,
+	const pt::ptree& config, bool bake_meshes)
+{
+	const std::vector<std::shared_ptr<const Geometry>>& sceneobjs = snapshot.GetObjects();
+
+	// string table
+	std::vector<BinSceneString> strings;
+	std::string string_data;
+	std::unordered_map<std::string, std::uint32_t> string_indices;
+
+	auto add_string = [&strings, &string_data, &string_indices](const std::string& str)
+		-> std::uint32_t
+	{
+		auto [iter, inserted] = string_indices.emplace(
+			std::make_pair(str, std::uint32_t(strings.size())));
+		if(inserted)
+		{
+			strings.emplace_back(BinSceneString{
+				.offs = string_data.size(), .len = str.size() });
+			string_data += str;
+		}
+		return iter->second;
+	};
+
+	std::vector<BinSceneObject> objs;
+	std::vector<BinSceneProperty> props;
+	std::vector<double> values;
+	std::vector<BinSceneMesh> meshes;
+	std::vector<float> mesh_data;
+	std::unordered_map<std::string, std::uint32_t> mesh_indices;
+
+	objs.reserve(sceneobjs.size());
+
+	for(const auto& obj : sceneobjs)
+	{
+		BinSceneObject rec
+		{
+			.type_str = add_string(obj->GetType()),
+			.id_str = add_string(obj->GetId()),
+			.texture_str = add_string(obj->GetTexture()),
+			.light_id = obj->GetLightId(),
+			.portal_id = obj->GetPortalId(),
+			.flags = (obj->IsFixed() ? BINSCENE_FIXED : 0u)
+				| (obj->IsLightingEnabled() ? BINSCENE_LIGHTING : 0u),
+		};
+
+		const t_mat44& trafo = obj->GetTrafo();
+		const t_mat44& portal_trafo = obj->GetPortalTrafo();
+		for(std::size_t i=0; i<4; ++i)
+		{
+			for(std::size_t j=0; j<4; ++j)
+			{
+				rec.trafo[i*4 + j] = trafo(i, j);
+				rec.portal_trafo[i*4 + j] = portal_trafo(i, j);
+			}
+		}
+
+		const t_vec3& col = obj->GetColour();
+		for(std::size_t i=0; i<3; ++i)
+			rec.colour[i] = col[i];
+
+		// shape-specific properties
+		rec.first_prop = std::uint32_t(props.size());
+		for(const ObjectProperty& prop : obj->GetProperties())
+		{
+			if(std::find_if(std::begin(g_binscene_record_props), std::end(g_binscene_record_props),
+				[&prop](const char* key) -> bool { return prop.key == key; })
+					!= std::end(g_binscene_record_props))
+				continue;
+
+			BinSceneProperty binprop
+			{
+				.key_str = add_string(prop.key),
+				.type = std::uint32_t(prop.value.index()),
+				.rows = 1, .cols = 1,
+				.value = values.size(),
+			};
+
+			std::visit([&](const auto& val)
+			{
+				using t_val = std::decay_t<decltype(val)>;
+
+				if constexpr(std::is_same_v<t_val, std::string>)
+				{
+					binprop.value = add_string(val);
+				}
+				else if constexpr(std::is_same_v<t_val, t_vec>)
+				{
+					binprop.rows = std::uint32_t(val.size());
+					for(std::size_t i=0; i<val.size(); ++i)
+						values.push_back(val[i]);
+				}
+				else if constexpr(std::is_same_v<t_val, t_mat>)
+				{
+					binprop.rows = std::uint32_t(val.size1());
+					binprop.cols = std::uint32_t(val.size2());
+					for(std::size_t i=0; i<val.size1(); ++i)
+						for(std::size_t j=0; j<val.size2(); ++j)
+							values.push_back(val(i, j));
+				}
+				else
+				{
+					values.push_back(double(val));
+				}
+			}, prop.value);
+
+			props.push_back(binprop);
+		}
+		rec.num_props = std::uint32_t(props.size()) - rec.first_prop;
+
+		// tessellated geometry, shared between objects with the same mesh key
+		if(const std::string mesh_key = obj->GetMeshKey(); bake_meshes && mesh_key != "")
+		{
+			auto [iter, inserted] = mesh_indices.emplace(
+				std::make_pair(mesh_key, std::uint32_t(meshes.size())));
+			if(inserted)
+			{
+				const auto triags = obj->GetCachedTriangles(0);
+				const auto& [verts, norms, uvs] = *triags;
+
+				BinSceneMesh mesh
+				{
+					.key_str = add_string(mesh_key),
+					.uv_dim = std::uint32_t(uvs.size() ? uvs[0].size() : 0),
+					.num_verts = verts.size(),
+					.num_norms = norms.size(),
+					.num_uvs = uvs.size(),
+				};
+
+				auto add_vecs = [&mesh_data](const std::vector<t_vec>& vecs, std::size_t dim)
+					-> std::uint64_t
+				{
+					std::uint64_t offs = mesh_data.size();
+					for(const t_vec& vec : vecs)
+						for(std::size_t i=0; i<dim; ++i)
+							mesh_data.push_back(i < vec.size() ? float(vec[i]) : 0.f);
+					return offs;
+				};
+
+				mesh.verts = add_vecs(verts, 3);
+				mesh.norms = add_vecs(norms, 3);
+				mesh.uvs = add_vecs(uvs, mesh.uv_dim);
+				meshes.push_back(mesh);
+			}
+
+			rec.mesh = iter->second;
+		}
+
+		objs.push_back(rec);
+	}
+
+	// the configuration is small, it is kept as xml
+	std::ostringstream ostrConfig;
+	ostrConfig.precision(g_prec);
+	pt::write_xml(ostrConfig, config);
+
+	BinSceneHeader hdr;
+	std::memcpy(hdr.magic, BINSCENE_MAGIC, sizeof(hdr.magic));
+	hdr.config_str = add_string(ostrConfig.str());
+
+	// section layout
+	std::uint64_t offs = binscene_align(sizeof(hdr));
+	auto place_section = [&offs](BinSceneSection& sect, std::uint64_t size)
+	{
+		sect.offs = offs;
+		sect.size = size;
+		offs = binscene_align(offs + size);
+	};
+
+	place_section(hdr.strings, strings.size() * sizeof(BinSceneString));
+	place_section(hdr.string_data, string_data.size());
+	place_section(hdr.objects, objs.size() * sizeof(BinSceneObject));
+	place_section(hdr.props, props.size() * sizeof(BinSceneProperty));
+	place_section(hdr.values, values.size() * sizeof(double));
+	place_section(hdr.meshes, meshes.size() * sizeof(BinSceneMesh));
+	place_section(hdr.mesh_data, mesh_data.size() * sizeof(float));
+
+	std::ofstream ofstr{filename, std::ios_base::binary};
+	if(!ofstr)
+		return false;
+
+	auto write_section = [&ofstr](const BinSceneSection& sect, const void* data)
+	{
+		ofstr.seekp(std::streamoff(sect.offs));
+		if(sect.size)
+			ofstr.write(reinterpret_cast<const char*>(data), std::streamsize(sect.size));
+	};
+
+	ofstr.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+	write_section(hdr.strings, strings.data());
+	write_section(hdr.string_data, string_data.data());
+	write_section(hdr.objects, objs.data());
+	write_section(hdr.props, props.data());
+	write_section(hdr.values, values.data());
+	write_section(hdr.meshes, meshes.data());
+	write_section(hdr.mesh_data, mesh_data.data());
+
+	// pad the last section
+	if(std::uint64_t end = std::uint64_t(ofstr.tellp()); end < offs)
+		ofstr.write("\0\0\0\0\0\0\0", std::streamsize(offs - end));
+
+	ofstr.flush();
+	return !!ofstr;
+}
+
+
+/**
+ * load a scene from a binary file, the records are read directly from the mapped file
+ * the xml configuration stored alongside the objects is returned in config
+ */
+std::pair<bool, std::string> Scene::load_binary(
+	const std::string& filename, Scene& scene, pt::ptree* config)
+{
+	boost::iostreams::mapped_file_source file;
+	try
+	{
+		file.open(filename);
+	}
+	catch(const std::exception&)
+	{
+		return std::make_pair(false, "Could not read scene file \"" + filename + "\".");
+	}
+
+	const char* data = file.data();
+	const std::size_t size = file.size();
+	const std::string invalid = "Scene file \"" + filename + "\" is invalid.";
+
+	// header
+	if(!data || size < sizeof(BinSceneHeader))
+		return std::make_pair(false, invalid);
+	const BinSceneHeader& hdr = *reinterpret_cast<const BinSceneHeader*>(data);
+
+	if(std::memcmp(hdr.magic, BINSCENE_MAGIC, sizeof(hdr.magic)) != 0)
+		return std::make_pair(false, "Scene file \"" + filename + "\" has invalid identifier.");
+	if(hdr.byteorder != BINSCENE_BYTEORDER)
+		return std::make_pair(false, "Scene file \"" + filename + "\" has an unsupported byte order.");
+	if(hdr.version > BINSCENE_VERSION)
+		return std::make_pair(false, "Scene file \"" + filename + "\" has an unsupported version.");
+
+	// sections
+	bool ok = true;
+	auto strings = binscene_section<BinSceneString>(data, size, hdr.strings, ok);
+	auto string_data = binscene_section<char>(data, size, hdr.string_data, ok);
+	auto objs = binscene_section<BinSceneObject>(data, size, hdr.objects, ok);
+	auto props = binscene_section<BinSceneProperty>(data, size, hdr.props, ok);
+	auto values = binscene_section<double>(data, size, hdr.values, ok);
+	auto meshes = binscene_section<BinSceneMesh>(data, size, hdr.meshes, ok);
+	auto mesh_data = binscene_section<float>(data, size, hdr.mesh_data, ok);
+	if(!ok)
+		return std::make_pair(false, invalid);
+
+	auto get_string = [&strings, &string_data, &ok](std::uint32_t idx) -> std::string_view
+	{
+		if(idx == BINSCENE_NO_INDEX)
+			return std::string_view{};
+
+		if(idx >= strings.size() || strings[idx].offs > string_data.size()
+			|| strings[idx].len > string_data.size() - strings[idx].offs)
+		{
+			ok = false;
+			return std::string_view{};
+		}
+
+		return std::string_view{string_data.data() + strings[idx].offs,
+			std::size_t(strings[idx].len)};
+	};
+
+	// ranges of the value pool and the mesh data
+	auto has_range = [&ok](std::uint64_t offs, std::uint64_t len, std::size_t size) -> bool
+	{
+		if(offs > size || len > size - offs)
+			ok = false;
+		return ok;
+	};
+
+	// range of num vectors of dimension dim, checked before multiplying to avoid overflows
+	auto has_vec_range = [&ok, &has_range](std::uint64_t offs, std::uint64_t num,
+		std::uint64_t dim, std::size_t size) -> bool
+	{
+		if(num && (dim == 0 || num > size / dim))
+			ok = false;
+		return ok && has_range(offs, num * dim, size);
+	};
+
+	// configuration
+	pt::ptree cfg;
+	if(std::string_view cfgstr = get_string(hdr.config_str); cfgstr.size())
+	{
+		try
+		{
+			std::istringstream istrConfig{std::string{cfgstr}};
+			pt::read_xml(istrConfig, cfg);
+		}
+		catch(const std::exception& ex)
+		{
+			return std::make_pair(false, "Scene file \"" + filename +
+				"\" has an invalid configuration: " + ex.what() + ".");
+		}
+	}
+
+	auto _lock = scene.Lock();
+	scene.Clear();
+
+	std::unordered_set<std::uint32_t> baked_meshes;
+
+	for(const BinSceneObject& rec : objs)
+	{
+		const std::string type{get_string(rec.type_str)};
+		const std::string id{get_string(rec.id_str)};
+		if(!ok)
+			break;
+
+		std::shared_ptr<Geometry> geo = Geometry::create(type, scene.GetPool());
+		if(!geo)
+		{
+			std::cerr << "Unknown geometry type \"" << type << "\"." << std::endl;
+			continue;
+		}
+
+		// general properties
+		t_mat44 trafo = m::unit<t_mat44>(4);
+		t_mat44 portal_trafo = m::unit<t_mat44>(4);
+		for(std::size_t i=0; i<4; ++i)
+		{
+			for(std::size_t j=0; j<4; ++j)
+			{
+				trafo(i, j) = rec.trafo[i*4 + j];
+				portal_trafo(i, j) = rec.portal_trafo[i*4 + j];
+			}
+		}
+
+		geo->SetId(id);
+		geo->SetRotation(trafo);
+		geo->SetPosition(m::create<t_vec3>({ trafo(0, 3), trafo(1, 3), trafo(2, 3) }));
+		geo->SetFixed((rec.flags & BINSCENE_FIXED) != 0);
+		geo->SetColour(m::create<t_vec3>({ rec.colour[0], rec.colour[1], rec.colour[2] }));
+		geo->SetLighting((rec.flags & BINSCENE_LIGHTING) != 0);
+		geo->SetLightId(rec.light_id);
+		geo->SetTexture(std::string{get_string(rec.texture_str)});
+		geo->SetPortalId(rec.portal_id);
+		geo->SetPortalTrafo(portal_trafo);
+
+		// shape-specific properties
+		if(!has_range(rec.first_prop, rec.num_props, props.size()))
+			break;
+
+		std::vector<ObjectProperty> objprops;
+		objprops.reserve(rec.num_props);
+		for(const BinSceneProperty& binprop : props.subspan(rec.first_prop, rec.num_props))
+		{
+			ObjectProperty prop{ .key = std::string{get_string(binprop.key_str)} };
+
+			if(binprop.type != 5 && !has_range(binprop.value,
+				std::uint64_t(binprop.rows) * std::uint64_t(binprop.cols), values.size()))
+				break;
+
+			switch(binprop.type)
+			{
+				case 0:
+					prop.value = t_real(values[binprop.value]);
+					break;
+				case 1:
+					prop.value = t_int(values[binprop.value]);
+					break;
+				case 2:
+					prop.value = bool(values[binprop.value] != 0.);
+					break;
+				case 3:
+				{
+					t_vec vec = m::create<t_vec>(binprop.rows);
+					for(std::size_t i=0; i<binprop.rows; ++i)
+						vec[i] = values[binprop.value + i];
+					prop.value = vec;
+					break;
+				}
+				case 4:
+				{
+					t_mat mat = m::zero<t_mat>(binprop.rows, binprop.cols);
+					for(std::size_t i=0; i<binprop.rows; ++i)
+						for(std::size_t j=0; j<binprop.cols; ++j)
+							mat(i, j) = values[binprop.value + i*binprop.cols + j];
+					prop.value = mat;
+					break;
+				}
+				case 5:
+					if(binprop.value > BINSCENE_NO_INDEX)
+						ok = false;
+					else
+						prop.value = std::string{get_string(std::uint32_t(binprop.value))};
+					break;
+				default:
+					ok = false;
+					break;
+			}
+
+			if(!ok)
+				break;
+			objprops.emplace_back(std::move(prop));
+		}
+
+		if(!ok)
+			break;
+		geo->SetProperties(objprops);
+
+		// baked triangles of the mesh, only used if the geometry still has the same shape
+		if(rec.mesh != BINSCENE_NO_INDEX && !baked_meshes.contains(rec.mesh))
+		{
+			if(rec.mesh >= meshes.size())
+			{
+				ok = false;
+				break;
+			}
+
+			const BinSceneMesh& mesh = meshes[rec.mesh];
+			const std::string mesh_key{get_string(mesh.key_str)};
+
+			if(ok && mesh_key == geo->GetMeshKey()
+				&& has_vec_range(mesh.verts, mesh.num_verts, 3, mesh_data.size())
+				&& has_vec_range(mesh.norms, mesh.num_norms, 3, mesh_data.size())
+				&& has_vec_range(mesh.uvs, mesh.num_uvs, mesh.uv_dim, mesh_data.size()))
+			{
+				auto get_vecs = [&mesh_data](std::uint64_t offs, std::uint64_t num, std::size_t dim)
+					-> std::vector<t_vec>
+				{
+					std::vector<t_vec> vecs;
+					vecs.reserve(num);
+					for(std::uint64_t idx=0; idx<num; ++idx)
+					{
+						t_vec vec = m::create<t_vec>(dim);
+						for(std::size_t i=0; i<dim; ++i)
+							vec[i] = mesh_data[offs + idx*dim + i];
+						vecs.emplace_back(std::move(vec));
+					}
+					return vecs;
+				};
+
+				geo->SetCachedTriangles(0,
+					std::make_shared<const Geometry::t_triangles>(
+						get_vecs(mesh.verts, mesh.num_verts, 3),
+						get_vecs(mesh.norms, mesh.num_norms, 3),
+						get_vecs(mesh.uvs, mesh.num_uvs, mesh.uv_dim)));
+			}
+
+			baked_meshes.insert(rec.mesh);
+		}
+
+		if(!ok)
+			break;
+		scene.AddObject({ geo }, id);
+	}
+
+	if(!ok)
+	{
+		scene.Clear();
+		return std::make_pair(false, invalid);
+	}
+
+	std::ostringstream timestamp;
+	if(auto optTime = cfg.get_optional<t_real>(FILE_BASENAME "timestamp"); optTime)
+		timestamp << *optTime;
+
+	if(config)
+		*config = std::move(cfg);
+	return std::make_pair(true, timestamp.str());
+}
@@ -0,0 +1,132 @@
+/**
+ * binary scene file format
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * File layout, all sections start at 8-byte aligned offsets from the beginning of the file:
+ *   header | string index | string data | objects | properties | values | meshes | mesh data
+ * The records are stored in native byte order and are read directly from the mapped file.
+ */
+
+#ifndef __SCENE_BINARY_H__
+#define __SCENE_BINARY_H__
+
+#include <cstdint>
+#include <type_traits>
+
+
+#define BINSCENE_MAGIC      "GLSCNBIN"
+#define BINSCENE_VERSION    1
+#define BINSCENE_BYTEORDER  0x01020304u
+#define BINSCENE_NO_INDEX   0xffffffffu
+
+
+/**
+ * location of a section in the file
+ */
+struct BinSceneSection
+{
+	std::uint64_t offs{0};     // in bytes from the start of the file
+	std::uint64_t size{0};     // in bytes
+};
+
+
+struct BinSceneHeader
+{
+	char magic[8]{};
+	std::uint32_t version{BINSCENE_VERSION};
+	std::uint32_t byteorder{BINSCENE_BYTEORDER};
+
+	BinSceneSection strings{};      // BinSceneString entries
+	BinSceneSection string_data{};  // characters of all strings
+	BinSceneSection objects{};      // BinSceneObject entries
+	BinSceneSection props{};        // BinSceneProperty entries
+	BinSceneSection values{};       // doubles, referenced by the properties
+	BinSceneSection meshes{};       // BinSceneMesh entries
+	BinSceneSection mesh_data{};    // floats, referenced by the meshes
+
+	std::uint32_t config_str{BINSCENE_NO_INDEX};  // xml configuration, e.g. camera and textures
+	std::uint32_t reserved{0};
+};
+
+
+/**
+ * entry in the string table
+ */
+struct BinSceneString
+{
+	std::uint64_t offs{0};     // in bytes from the start of the string data
+	std::uint64_t len{0};
+};
+
+
+enum BinSceneObjectFlags : std::uint32_t
+{
+	BINSCENE_FIXED    = 1u << 0,
+	BINSCENE_LIGHTING = 1u << 1,
+};
+
+
+/**
+ * fixed-layout record with the general properties of a geometry object,
+ * the shape-specific ones are stored as a range of property records
+ */
+struct BinSceneObject
+{
+	std::uint32_t type_str{BINSCENE_NO_INDEX};
+	std::uint32_t id_str{BINSCENE_NO_INDEX};
+	std::uint32_t texture_str{BINSCENE_NO_INDEX};
+	std::uint32_t mesh{BINSCENE_NO_INDEX};     // baked mesh, if any
+
+	std::int32_t light_id{-1};
+	std::int32_t portal_id{-1};
+	std::uint32_t flags{0};
+
+	std::uint32_t first_prop{0};
+	std::uint32_t num_props{0};
+	std::uint32_t reserved{0};
+
+	// row-major matrices
+	double trafo[16]{};
+	double portal_trafo[16]{};
+	double colour[3]{};
+	double reserved2{0};
+};
+
+
+/**
+ * property of a geometry object,
+ * the type is the index of the value type in ObjectProperty::value
+ */
+struct BinSceneProperty
+{
+	std::uint32_t key_str{BINSCENE_NO_INDEX};
+	std::uint32_t type{0};
+	std::uint32_t rows{0}, cols{0};  // vector or matrix dimensions, 1 for scalars
+	std::uint64_t value{0};          // index into the value pool or, for strings, the string table
+};
+
+
+/**
+ * pre-tessellated triangles of the full-detail level of a mesh
+ */
+struct BinSceneMesh
+{
+	std::uint32_t key_str{BINSCENE_NO_INDEX};
+	std::uint32_t uv_dim{0};
+
+	std::uint64_t num_verts{0}, num_norms{0}, num_uvs{0};
+
+	// indices into the mesh data (3 floats per vertex and normal)
+	std::uint64_t verts{0}, norms{0}, uvs{0};
+};
+
+
+static_assert(std::is_trivially_copyable_v<BinSceneHeader>);
+static_assert(sizeof(BinSceneObject) % 8 == 0);
+static_assert(sizeof(BinSceneProperty) % 8 == 0);
+static_assert(sizeof(BinSceneMesh) % 8 == 0);
+
+
+#endif
@@ -0,0 +1,302 @@
+/**
+ * simulation thread
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * References:
+ *   - https://gafferongames.com/post/fix_your_timestep/
+ */
+
+#include "SimThread.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+
+/**
+ * interpolate between two rigid-body transformations
+ * the rotational part is re-orthonormalised after the linear interpolation
+ */
+static t_mat44 interpolate_trafo(const t_mat44& mat1, const t_mat44& mat2, t_real t)
+{
+	t_mat44 mat = m::unit<t_mat44>(4);
+
+	// interpolate translation and rotation components
+	for(std::size_t i=0; i<3; ++i)
+		for(std::size_t j=0; j<4; ++j)
+			mat(i, j) = (t_real(1) - t)*mat1(i, j) + t*mat2(i, j);
+
+	// gram-schmidt orthonormalisation of the rotation columns
+	std::array<t_real, 3> lens{};
+	for(std::size_t col=0; col<3; ++col)
+	{
+		for(std::size_t prevcol=0; prevcol<col; ++prevcol)
+		{
+			t_real dot = 0;
+			for(std::size_t i=0; i<3; ++i)
+				dot += mat(i, col) * mat(i, prevcol);
+			for(std::size_t i=0; i<3; ++i)
+				mat(i, col) -= dot * mat(i, prevcol);
+		}
+
+		t_real len1 = 0, len2 = 0, len = 0;
+		for(std::size_t i=0; i<3; ++i)
+		{
+			len1 += mat1(i, col) * mat1(i, col);
+			len2 += mat2(i, col) * mat2(i, col);
+			len += mat(i, col) * mat(i, col);
+		}
+
+		len = std::sqrt(len);
+		if(len <= std::numeric_limits<t_real>::epsilon())
+			return mat2;
+
+		for(std::size_t i=0; i<3; ++i)
+			mat(i, col) /= len;
+
+		lens[col] = (t_real(1) - t)*std::sqrt(len1) + t*std::sqrt(len2);
+	}
+
+	// restore the interpolated column lengths
+	for(std::size_t col=0; col<3; ++col)
+		for(std::size_t i=0; i<3; ++i)
+			mat(i, col) *= lens[col];
+
+	return mat;
+}
+
+
+
+SimThread::SimThread(Scene& scene) : m_scene{scene}
+{
+}
+
+
+SimThread::~SimThread()
+{
+	Stop();
+}
+
+
+/**
+ * start the simulation thread
+ */
+void SimThread::Start()
+{
+	if(m_running)
+		return;
+
+	m_running = true;
+	m_thread = std::thread{&SimThread::Run, this};
+}
+
+
+/**
+ * stop the simulation thread
+ */
+void SimThread::Stop()
+{
+	m_running = false;
+	Wake();
+
+	if(m_thread.joinable())
+		m_thread.join();
+}
+
+
+/**
+ * collect the object transformations from the scene
+ * the scene has to be locked by the caller
+ */
+void SimThread::TakeSnapshot(SimSnapshot& snap) const
+{
+	const auto& objs = m_scene.GetObjects();
+	snap.objs.resize(objs.size());
+	snap.changed = false;
+
+	for(std::size_t idx=0; idx<objs.size(); ++idx)
+	{
+		const std::shared_ptr<Geometry>& geo = objs[idx];
+		SimSnapshotObj& obj = snap.objs[idx];
+
+		obj.handle = geo->GetHandle();
+		obj.trafo = geo->GetTrafo();
+		obj.changed = geo->IsTrafoChanged();
+		snap.changed |= obj.changed;
+
+		geo->SetTrafoChanged(false);
+	}
+}
+
+
+/**
+ * simulation thread main loop
+ */
+void SimThread::Run()
+{
+	std::uint64_t step = 0;
+	{
+		std::lock_guard<std::mutex> _lock{m_mtxSnap};
+		step = m_snaps[m_latest].step;
+	}
+
+	t_clock::time_point next = t_clock::now();
+
+	while(m_running)
+	{
+		const std::int64_t dt = std::max<std::int64_t>(1, m_timestep);
+		const t_real scale = m_timescale;
+
+		// simulation is paused
+		if(scale <= t_real(0))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(dt));
+			next = t_clock::now();
+			continue;
+		}
+
+		// wall-clock duration of a simulation step
+		const auto step_duration = std::chrono::duration_cast<t_clock::duration>(
+			std::chrono::duration<t_real, std::milli>(t_real(dt) / scale));
+
+		// advance the simulation by a fixed time step,
+		// only the simulation thread accesses the back buffer
+		SimSnapshot& snap = m_snaps[m_back];
+		{
+			auto _lock = m_scene.Lock();
+			m_scene.tick(std::chrono::milliseconds(dt));
+			TakeSnapshot(snap);
+			m_idle = m_scene.IsIdle();
+		}
+
+		snap.step = ++step;
+		snap.time = t_clock::now();
+
+		// publish the new snapshot
+		{
+			std::lock_guard<std::mutex> _lock{m_mtxSnap};
+
+			// keep the changes of a snapshot the reader has missed
+			const SimSnapshot& latest = m_snaps[m_latest];
+			if(!m_latest_read && latest.objs.size() == snap.objs.size())
+			{
+				for(std::size_t idx=0; idx<snap.objs.size(); ++idx)
+				{
+					if(latest.objs[idx].handle == snap.objs[idx].handle)
+						snap.objs[idx].changed |= latest.objs[idx].changed;
+				}
+				snap.changed |= latest.changed;
+			}
+
+			std::size_t prev = m_prev;
+			m_prev = m_latest;
+			m_latest = m_back;
+			m_back = prev;
+			m_latest_read = false;
+		}
+
+		// wait for the next step, but don't try to catch up after long stalls
+		next += step_duration;
+		if(t_clock::time_point now = t_clock::now(); now > next + 8*step_duration)
+			next = now;
+
+		// nothing moves, the simulated time still advances by one step per wait
+		if(m_idle)
+			next = std::max(next, snap.time + std::chrono::milliseconds(m_idle_timestep));
+
+		std::unique_lock<std::mutex> _lock{m_mtxWake};
+		const bool woken = m_condWake.wait_until(_lock, next, [this]() -> bool { return m_wake; });
+		m_wake = false;
+		if(woken)
+			next = t_clock::now();
+	}
+}
+
+
+/**
+ * leave the idle state, e.g. when the user interacts with the scene
+ */
+void SimThread::Wake()
+{
+	// the steps run at the full rate anyway
+	if(m_running && !m_idle)
+		return;
+
+	{
+		std::lock_guard<std::mutex> _lock{m_mtxWake};
+		m_wake = true;
+	}
+	m_condWake.notify_one();
+}
+
+
+/**
+ * has a snapshot with moved objects been published that has not yet been read?
+ * (the previous snapshot's changes are needed to finish their interpolation)
+ */
+bool SimThread::HasNewSnapshot() const
+{
+	std::lock_guard<std::mutex> _lock{m_mtxSnap};
+	return !m_latest_read && (m_snaps[m_latest].changed || m_snaps[m_prev].changed);
+}
+
+
+/**
+ * get the transformations of the objects that have moved, interpolated
+ * between the previous and the latest snapshot (rendering lags by one step)
+ * @return false if no object needs to be updated
+ */
+bool SimThread::GetTrafos(t_trafos& trafos)
+{
+	trafos.clear();
+
+	std::lock_guard<std::mutex> _lock{m_mtxSnap};
+	const SimSnapshot& cur = m_snaps[m_latest];
+	const SimSnapshot& prev = m_snaps[m_prev];
+
+	if(cur.step == 0)
+		return false;
+
+	const bool new_step = (cur.step != m_read_step);
+	const bool interpolate = m_interpolate && prev.step != 0 && cur.time > prev.time;
+	if(!new_step && !interpolate)
+		return false;
+
+	// interpolation parameter
+	t_real alpha = 1;
+	if(interpolate)
+	{
+		const std::chrono::duration<t_real> dur_step = cur.time - prev.time;
+		const std::chrono::duration<t_real> dur_cur = t_clock::now() - cur.time;
+		alpha = std::clamp<t_real>(dur_cur.count() / dur_step.count(), 0, 1);
+	}
+
+	const bool same_objs = (prev.objs.size() == cur.objs.size());
+	for(std::size_t idx=0; idx<cur.objs.size(); ++idx)
+	{
+		const SimSnapshotObj& obj = cur.objs[idx];
+		const SimSnapshotObj* prevobj = nullptr;
+		if(same_objs && prev.objs[idx].handle == obj.handle)
+			prevobj = &prev.objs[idx];
+
+		if(obj.changed)
+		{
+			if(interpolate && prevobj && alpha < t_real(1))
+				trafos.emplace_back(obj.handle, interpolate_trafo(prevobj->trafo, obj.trafo, alpha));
+			else
+				trafos.emplace_back(obj.handle, obj.trafo);
+		}
+		else if(new_step && prevobj && prevobj->changed)
+		{
+			// finish the interpolation from the previous step
+			trafos.emplace_back(obj.handle, obj.trafo);
+		}
+	}
+
+	m_read_step = cur.step;
+	m_latest_read = true;
+
+	return trafos.size() != 0;
+}
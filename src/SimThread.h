@@ -0,0 +1,132 @@
+/**
+ * simulation thread
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * References:
+ *   - https://gafferongames.com/post/fix_your_timestep/
+ */
+
+#ifndef __GLSCENE_SIMTHREAD_H__
+#define __GLSCENE_SIMTHREAD_H__
+
+#include <array>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "types.h"
+#include "Scene.h"
+
+
+/**
+ * transformation of a scene object at a given simulation step
+ */
+struct SimSnapshotObj
+{
+	// stable across copies of the object, e.g. when it is detached from a snapshot
+	Scene::t_handle handle{0};
+
+	t_mat44 trafo = m::unit<t_mat44>(4);
+
+	// has the object moved since the previous snapshot?
+	bool changed{false};
+};
+
+
+/**
+ * transformations of all scene objects at a given simulation step
+ */
+struct SimSnapshot
+{
+	std::uint64_t step{0};
+	std::chrono::steady_clock::time_point time{};
+
+	// has any object moved since the previous snapshot?
+	bool changed{false};
+
+	std::vector<SimSnapshotObj> objs{};
+};
+
+
+/**
+ * runs the simulation at a fixed time step in its own thread
+ * and publishes the object transformations in a triple buffer
+ */
+class SimThread
+{
+public:
+	using t_clock = std::chrono::steady_clock;
+
+	// transformations of the objects that have to be updated
+	using t_trafos = std::vector<std::pair<Scene::t_handle, t_mat44>>;
+
+
+public:
+	SimThread(Scene& scene);
+	~SimThread();
+
+	SimThread(const SimThread&) = delete;
+	const SimThread& operator=(const SimThread&) = delete;
+
+	void Start();
+	void Stop();
+	bool IsRunning() const { return m_running; }
+
+	void SetTimeStep(const std::chrono::milliseconds& dt) { m_timestep = dt.count(); }
+	void SetTimeScale(t_real scale) { m_timescale = scale; }
+	void SetInterpolation(bool b) { m_interpolate = b; }
+
+	// wall-clock time between the steps while the scene is at rest
+	void SetIdleTimeStep(const std::chrono::milliseconds& dt) { m_idle_timestep = dt.count(); }
+	bool IsIdle() const { return m_idle; }
+	void Wake();
+
+	bool HasNewSnapshot() const;
+	bool GetTrafos(t_trafos& trafos);
+
+
+protected:
+	void Run();
+	void TakeSnapshot(SimSnapshot& snap) const;
+
+
+private:
+	Scene& m_scene;
+
+	std::thread m_thread{};
+	std::atomic<bool> m_running{false};
+
+	// fixed simulation time step in ms
+	std::atomic<std::int64_t> m_timestep{10};
+	std::atomic<t_real> m_timescale{1};
+	std::atomic<bool> m_interpolate{true};
+
+	// the scene is at rest, the steps are slowed down until it is woken up
+	std::atomic<std::int64_t> m_idle_timestep{250};
+	std::atomic<bool> m_idle{false};
+	std::mutex m_mtxWake{};
+	std::condition_variable m_condWake{};
+	bool m_wake{false};
+
+	// triple buffer: the simulation writes into the back buffer,
+	// the renderer reads the latest and the previous one
+	mutable std::mutex m_mtxSnap{};
+	std::array<SimSnapshot, 3> m_snaps{};
+	std::size_t m_back{0}, m_latest{1}, m_prev{2};
+
+	// has the latest snapshot already been read?
+	bool m_latest_read{true};
+
+	// last step seen by the reader
+	std::uint64_t m_read_step{0};
+};
+
+
+#endif
@@ -0,0 +1,726 @@
+/**
+ * recording and replay of simulation runs
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ */
+
+#include "Trajectory.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/copy.hpp>
+
+namespace ios = boost::iostreams;
+
+
+static constexpr std::uint64_t traj_align(std::uint64_t offs)
+{
+	return (offs + 7) & ~std::uint64_t(7);
+}
+
+
+/**
+ * pad the file to the next 8-byte aligned offset
+ */
+static void traj_pad(std::ofstream& ofstr)
+{
+	static const char zeros[8]{};
+	const std::uint64_t offs = std::uint64_t(ofstr.tellp());
+	ofstr.write(zeros, std::streamsize(traj_align(offs) - offs));
+}
+
+
+/**
+ * append an integer in zigzag and variable-length encoding
+ */
+static void traj_put_int(std::string& data, std::int64_t val)
+{
+	std::uint64_t uval = (std::uint64_t(val) << 1) ^ std::uint64_t(val >> 63);
+	while(uval >= 0x80)
+	{
+		data.push_back(char((uval & 0x7f) | 0x80));
+		uval >>= 7;
+	}
+	data.push_back(char(uval));
+}
+
+
+/**
+ * read an integer in zigzag and variable-length encoding
+ */
+static bool traj_get_int(const std::string& data, std::size_t& pos, std::int64_t& val)
+{
+	std::uint64_t uval = 0;
+	for(unsigned int shift = 0; shift < 64; shift += 7)
+	{
+		if(pos >= data.size())
+			return false;
+
+		const std::uint64_t byte = std::uint8_t(data[pos++]);
+		uval |= (byte & 0x7f) << shift;
+		if(!(byte & 0x80))
+		{
+			val = std::int64_t(uval >> 1) ^ -std::int64_t(uval & 1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+static std::string traj_compress(const std::string& raw)
+{
+	std::string data;
+	{
+		ios::filtering_ostream ostr;
+		ostr.push(ios::zlib_compressor{});
+		ostr.push(ios::back_inserter(data));
+		ostr.write(raw.data(), std::streamsize(raw.size()));
+	}  // flushed on destruction
+	return data;
+}
+
+
+static std::string traj_decompress(const std::string& data)
+{
+	std::string raw;
+	ios::filtering_istream istr;
+	istr.push(ios::zlib_decompressor{});
+	istr.push(ios::array_source{data.data(), data.size()});
+	ios::copy(istr, ios::back_inserter(raw));
+	return raw;
+}
+
+
+
+// ----------------------------------------------------------------------------
+// poses
+// ----------------------------------------------------------------------------
+/**
+ * rigid-body transformation matrix from position and quaternion
+ */
+t_mat44 TrajPose::GetTrafo() const
+{
+	const auto [x, y, z, w] = quat;
+
+	t_mat44 mat = m::unit<t_mat44>(4);
+	mat(0, 0) = 1 - 2*(y*y + z*z);
+	mat(0, 1) = 2*(x*y - z*w);
+	mat(0, 2) = 2*(x*z + y*w);
+	mat(1, 0) = 2*(x*y + z*w);
+	mat(1, 1) = 1 - 2*(x*x + z*z);
+	mat(1, 2) = 2*(y*z - x*w);
+	mat(2, 0) = 2*(x*z - y*w);
+	mat(2, 1) = 2*(y*z + x*w);
+	mat(2, 2) = 1 - 2*(x*x + y*y);
+
+	for(std::size_t i=0; i<3; ++i)
+		mat(i, 3) = pos[i];
+
+	return mat;
+}
+
+
+/**
+ * position and quaternion of a transformation matrix, scaling is removed
+ * @see https://www.euclideanspace.com/maths/geometry/rotations/conversions/matrixToQuaternion/
+ */
+TrajPose TrajPose::FromTrafo(const t_mat44& mat)
+{
+	TrajPose pose;
+	for(std::size_t i=0; i<3; ++i)
+		pose.pos[i] = mat(i, 3);
+
+	// rotation part without the scaling of the axes
+	t_real rot[3][3]{};
+	for(std::size_t j=0; j<3; ++j)
+	{
+		t_real len = 0;
+		for(std::size_t i=0; i<3; ++i)
+			len += mat(i, j) * mat(i, j);
+		len = std::sqrt(len);
+
+		for(std::size_t i=0; i<3; ++i)
+			rot[i][j] = len > 0 ? mat(i, j) / len : t_real(i == j);
+	}
+
+	// choose the largest diagonal element for numerical stability
+	auto& [x, y, z, w] = pose.quat;
+	if(const t_real trace = rot[0][0] + rot[1][1] + rot[2][2]; trace > 0)
+	{
+		const t_real s = std::sqrt(trace + 1) * 2;
+		w = s / 4;
+		x = (rot[2][1] - rot[1][2]) / s;
+		y = (rot[0][2] - rot[2][0]) / s;
+		z = (rot[1][0] - rot[0][1]) / s;
+	}
+	else if(rot[0][0] > rot[1][1] && rot[0][0] > rot[2][2])
+	{
+		const t_real s = std::sqrt(1 + rot[0][0] - rot[1][1] - rot[2][2]) * 2;
+		w = (rot[2][1] - rot[1][2]) / s;
+		x = s / 4;
+		y = (rot[0][1] + rot[1][0]) / s;
+		z = (rot[0][2] + rot[2][0]) / s;
+	}
+	else if(rot[1][1] > rot[2][2])
+	{
+		const t_real s = std::sqrt(1 + rot[1][1] - rot[0][0] - rot[2][2]) * 2;
+		w = (rot[0][2] - rot[2][0]) / s;
+		x = (rot[0][1] + rot[1][0]) / s;
+		y = s / 4;
+		z = (rot[1][2] + rot[2][1]) / s;
+	}
+	else
+	{
+		const t_real s = std::sqrt(1 + rot[2][2] - rot[0][0] - rot[1][1]) * 2;
+		w = (rot[1][0] - rot[0][1]) / s;
+		x = (rot[0][2] + rot[2][0]) / s;
+		y = (rot[1][2] + rot[2][1]) / s;
+		z = s / 4;
+	}
+
+	const t_real len = std::sqrt(x*x + y*y + z*z + w*w);
+	if(len > 0)
+	{
+		for(t_real& comp : pose.quat)
+			comp /= len;
+	}
+
+	return pose;
+}
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// recorder
+// ----------------------------------------------------------------------------
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+	Close();
+}
+
+
+/**
+ * create the trajectory file and write the object ids
+ */
+bool TrajectoryRecorder::Open(const std::string& filename, const std::vector<std::string>& ids,
+	std::uint32_t chunk_frames, t_real pos_res, t_real time_res)
+{
+	Close();
+
+	m_ofstr.open(filename, std::ios_base::binary | std::ios_base::trunc);
+	if(!m_ofstr)
+	{
+		std::cerr << "Error: Cannot create trajectory file \"" << filename << "\"." << std::endl;
+		return false;
+	}
+
+	m_header = TrajHeader{};
+	std::memcpy(m_header.magic, TRAJ_MAGIC, sizeof(m_header.magic));
+	m_header.num_objs = std::uint32_t(ids.size());
+	m_header.chunk_frames = std::max<std::uint32_t>(chunk_frames, 1);
+	m_header.pos_res = pos_res;
+	m_header.time_res = time_res;
+
+	// the header is written again when the file is closed
+	m_ofstr.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+
+	m_header.ids.offs = std::uint64_t(m_ofstr.tellp());
+	for(const std::string& id : ids)
+	{
+		const std::uint32_t len = std::uint32_t(id.size());
+		m_ofstr.write(reinterpret_cast<const char*>(&len), sizeof(len));
+		m_ofstr.write(id.data(), std::streamsize(len));
+	}
+	m_header.ids.size = std::uint64_t(m_ofstr.tellp()) - m_header.ids.offs;
+	traj_pad(m_ofstr);
+
+	m_ok = bool(m_ofstr);
+	m_raw.clear();
+	m_chunk = TrajChunkHeader{};
+	m_prev_vals.assign(ids.size() * 7, 0);
+	m_num_frames = 0;
+	m_index.clear();
+
+	return m_ok;
+}
+
+
+/**
+ * write the remaining frames, the chunk index, and the final header
+ */
+bool TrajectoryRecorder::Close()
+{
+	if(!IsOpen())
+		return true;
+
+	FlushChunk();
+	if(m_writing.valid())
+		m_ok = m_writing.get() && m_ok;
+
+	m_header.num_frames = m_num_frames;
+	m_header.index.offs = std::uint64_t(m_ofstr.tellp());
+	m_header.index.size = m_index.size() * sizeof(TrajChunkIndex);
+	m_ofstr.write(reinterpret_cast<const char*>(m_index.data()),
+		std::streamsize(m_header.index.size));
+
+	m_ofstr.seekp(0);
+	m_ofstr.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+
+	m_ok = bool(m_ofstr) && m_ok;
+	m_ofstr.close();
+
+	if(!m_ok)
+		std::cerr << "Error: Trajectory file could not be written completely." << std::endl;
+	return m_ok;
+}
+
+
+/**
+ * add the poses of all objects at the given simulation time
+ */
+void TrajectoryRecorder::AddFrame(t_real time, const std::vector<t_mat44>& trafos)
+{
+	if(!IsOpen())
+		return;
+
+	if(trafos.size() != m_header.num_objs)
+	{
+		std::cerr << "Error: Expected " << m_header.num_objs << " objects in trajectory frame, got "
+			<< trafos.size() << "." << std::endl;
+		return;
+	}
+
+	// the first frame of a chunk is stored relative to zero
+	const bool keyframe = (m_chunk.num_frames == 0);
+	if(keyframe)
+	{
+		m_chunk.first_frame = m_num_frames;
+		m_chunk.first_time = time;
+		m_prev_time = 0;
+		std::fill(m_prev_vals.begin(), m_prev_vals.end(), 0);
+	}
+
+	const std::int64_t qtime = std::llround((time - m_chunk.first_time) / m_header.time_res);
+	traj_put_int(m_raw, qtime - m_prev_time);
+	m_prev_time = qtime;
+
+	for(std::size_t objidx = 0; objidx < trafos.size(); ++objidx)
+	{
+		TrajPose pose = TrajPose::FromTrafo(trafos[objidx]);
+		std::int64_t* prev = m_prev_vals.data() + objidx*7;
+
+		// q and -q are the same rotation, take the one closest to the previous frame
+		t_real dot = 0;
+		for(std::size_t i=0; i<4; ++i)
+			dot += t_real(prev[3 + i]) * pose.quat[i];
+		if((keyframe && pose.quat[3] < 0) || (!keyframe && dot < 0))
+		{
+			for(t_real& comp : pose.quat)
+				comp = -comp;
+		}
+
+		std::int64_t vals[7]{};
+		for(std::size_t i=0; i<3; ++i)
+			vals[i] = std::llround(pose.pos[i] / m_header.pos_res);
+		for(std::size_t i=0; i<4; ++i)
+			vals[3 + i] = std::llround(pose.quat[i] * TRAJ_QUAT_SCALE);
+
+		for(std::size_t i=0; i<7; ++i)
+		{
+			traj_put_int(m_raw, vals[i] - prev[i]);
+			prev[i] = vals[i];
+		}
+	}
+
+	++m_chunk.num_frames;
+	++m_num_frames;
+
+	if(m_chunk.num_frames >= m_header.chunk_frames)
+		FlushChunk();
+}
+
+
+/**
+ * hand the frames of the current chunk over to the background writer
+ */
+void TrajectoryRecorder::FlushChunk()
+{
+	if(m_chunk.num_frames == 0)
+		return;
+
+	// wait for the previous chunk
+	if(m_writing.valid())
+		m_ok = m_writing.get() && m_ok;
+
+	m_chunk.raw_size = m_raw.size();
+	m_writing = std::async(std::launch::async,
+		[&ofstr = m_ofstr, &index = m_index, chunk = m_chunk, raw = std::move(m_raw)]() -> bool
+	{
+		return WriteChunk(ofstr, index, chunk, raw);
+	});
+
+	m_raw = std::string{};
+	m_chunk = TrajChunkHeader{};
+}
+
+
+/**
+ * compress the frames and append them to the file
+ */
+bool TrajectoryRecorder::WriteChunk(std::ofstream& ofstr, std::vector<TrajChunkIndex>& index,
+	TrajChunkHeader chunk, const std::string& raw)
+{
+	try
+	{
+		const std::string data = traj_compress(raw);
+		chunk.size = data.size();
+
+		const std::uint64_t offs = std::uint64_t(ofstr.tellp());
+		ofstr.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+		ofstr.write(data.data(), std::streamsize(data.size()));
+		traj_pad(ofstr);
+
+		index.emplace_back(TrajChunkIndex{
+			.offs = offs,
+			.first_frame = chunk.first_frame,
+			.first_time = chunk.first_time,
+			.num_frames = chunk.num_frames });
+
+		return bool(ofstr);
+	}
+	catch(const std::exception& ex)
+	{
+		std::cerr << "Error: Cannot write trajectory chunk: " << ex.what() << "." << std::endl;
+	}
+
+	return false;
+}
+// ----------------------------------------------------------------------------
+
+
+
+// ----------------------------------------------------------------------------
+// player
+// ----------------------------------------------------------------------------
+/**
+ * read the header, the object ids, and the chunk index of a trajectory file
+ */
+bool TrajectoryPlayer::Open(const std::string& filename)
+{
+	Close();
+
+	m_ifstr.open(filename, std::ios_base::binary);
+	if(!m_ifstr)
+	{
+		std::cerr << "Error: Cannot open trajectory file \"" << filename << "\"." << std::endl;
+		return false;
+	}
+
+	auto fail = [this, &filename](const char* msg) -> bool
+	{
+		std::cerr << "Error: Trajectory file \"" << filename << "\": " << msg << "." << std::endl;
+		Close();
+		return false;
+	};
+
+	if(!m_ifstr.read(reinterpret_cast<char*>(&m_header), sizeof(m_header))
+		|| std::memcmp(m_header.magic, TRAJ_MAGIC, sizeof(m_header.magic)) != 0)
+		return fail("Unknown file format");
+	if(m_header.version != TRAJ_VERSION || m_header.byteorder != BINSCENE_BYTEORDER)
+		return fail("Unsupported version or byte order");
+	if(m_header.pos_res <= 0 || m_header.time_res <= 0)
+		return fail("Invalid resolution");
+
+	// object ids
+	m_ifstr.seekg(std::streamoff(m_header.ids.offs));
+	m_ids.reserve(m_header.num_objs);
+	for(std::uint32_t objidx = 0; objidx < m_header.num_objs; ++objidx)
+	{
+		std::uint32_t len = 0;
+		if(!m_ifstr.read(reinterpret_cast<char*>(&len), sizeof(len)) || len > m_header.ids.size)
+			return fail("Invalid object ids");
+
+		std::string id(len, '\0');
+		if(!m_ifstr.read(id.data(), std::streamsize(len)))
+			return fail("Invalid object ids");
+		m_ids.emplace_back(std::move(id));
+	}
+
+	// chunk index, it is missing if the recording has been interrupted
+	bool has_index = false;
+	if(m_header.index.size && m_header.index.size % sizeof(TrajChunkIndex) == 0)
+	{
+		m_index.resize(m_header.index.size / sizeof(TrajChunkIndex));
+		m_ifstr.seekg(std::streamoff(m_header.index.offs));
+		has_index = bool(m_ifstr.read(reinterpret_cast<char*>(m_index.data()),
+			std::streamsize(m_header.index.size)));
+	}
+	if(!has_index)
+		ScanChunks(traj_align(m_header.ids.offs + m_header.ids.size));
+
+	// chunks without frames have no time range
+	std::erase_if(m_index, [](const TrajChunkIndex& chunk) -> bool
+	{
+		return chunk.num_frames == 0;
+	});
+
+	if(m_index.size() == 0)
+		return fail("No recorded frames");
+
+	for(const TrajChunkIndex& chunk : m_index)
+		m_num_frames += chunk.num_frames;
+
+	// the time range ends with the last frame of the last chunk
+	m_start_time = m_index.front().first_time;
+	std::shared_ptr<const TrajDecodedChunk> last = GetChunk(m_index.size() - 1);
+	if(!last || last->times.empty())
+		return fail("Invalid frame data");
+	m_end_time = last->times.back();
+
+	return true;
+}
+
+
+void TrajectoryPlayer::Close()
+{
+	if(m_ifstr.is_open())
+		m_ifstr.close();
+
+	m_header = TrajHeader{};
+	m_ids.clear();
+	m_index.clear();
+	m_cache.clear();
+	m_num_frames = 0;
+	m_start_time = m_end_time = 0;
+}
+
+
+/**
+ * rebuild the chunk index from the complete chunks following the given offset
+ */
+bool TrajectoryPlayer::ScanChunks(std::uint64_t offs)
+{
+	m_ifstr.clear();
+	m_ifstr.seekg(0, std::ios_base::end);
+	const std::uint64_t file_size = std::uint64_t(m_ifstr.tellg());
+
+	m_index.clear();
+	while(offs + sizeof(TrajChunkHeader) <= file_size)
+	{
+		TrajChunkHeader chunk;
+		m_ifstr.seekg(std::streamoff(offs));
+		if(!m_ifstr.read(reinterpret_cast<char*>(&chunk), sizeof(chunk)))
+			break;
+		if(chunk.magic != TRAJ_CHUNK_MAGIC || chunk.num_frames == 0
+			|| chunk.size > file_size - offs - sizeof(chunk))
+			break;
+
+		m_index.emplace_back(TrajChunkIndex{
+			.offs = offs,
+			.first_frame = chunk.first_frame,
+			.first_time = chunk.first_time,
+			.num_frames = chunk.num_frames });
+
+		offs = traj_align(offs + sizeof(chunk) + chunk.size);
+	}
+
+	m_ifstr.clear();
+	return m_index.size() != 0;
+}
+
+
+/**
+ * decode the frames of a chunk, the most recent ones are cached
+ */
+std::shared_ptr<const TrajDecodedChunk> TrajectoryPlayer::GetChunk(std::size_t idx)
+{
+	if(idx >= m_index.size())
+		return nullptr;
+
+	for(const auto& cached : m_cache)
+	{
+		if(cached->idx == idx)
+			return cached;
+	}
+
+	const TrajChunkIndex& entry = m_index[idx];
+	TrajChunkHeader chunk;
+	m_ifstr.clear();
+	m_ifstr.seekg(std::streamoff(entry.offs));
+	if(!m_ifstr.read(reinterpret_cast<char*>(&chunk), sizeof(chunk))
+		|| chunk.magic != TRAJ_CHUNK_MAGIC || chunk.num_frames == 0
+		|| chunk.num_frames != entry.num_frames)
+	{
+		std::cerr << "Error: Invalid trajectory chunk " << idx << "." << std::endl;
+		return nullptr;
+	}
+
+	std::string raw;
+	try
+	{
+		std::string data(chunk.size, '\0');
+		if(!m_ifstr.read(data.data(), std::streamsize(chunk.size)))
+			throw std::runtime_error("Truncated data");
+
+		raw = traj_decompress(data);
+		if(raw.size() != chunk.raw_size)
+			throw std::runtime_error("Size mismatch");
+	}
+	catch(const std::exception& ex)
+	{
+		std::cerr << "Error: Invalid trajectory chunk " << idx << ": " << ex.what() << "." << std::endl;
+		return nullptr;
+	}
+
+	auto decoded = std::make_shared<TrajDecodedChunk>();
+	decoded->idx = idx;
+	decoded->times.reserve(chunk.num_frames);
+	decoded->poses.resize(std::size_t(chunk.num_frames) * m_header.num_objs);
+
+	std::vector<std::int64_t> vals(std::size_t(m_header.num_objs) * 7, 0);
+	std::int64_t qtime = 0;
+	std::size_t pos = 0;
+	for(std::uint32_t frame = 0; frame < chunk.num_frames; ++frame)
+	{
+		std::int64_t delta = 0;
+		bool ok = traj_get_int(raw, pos, delta);
+		qtime += delta;
+		decoded->times.push_back(chunk.first_time + t_real(qtime) * m_header.time_res);
+
+		for(std::uint32_t objidx = 0; objidx < m_header.num_objs; ++objidx)
+		{
+			std::int64_t* val = vals.data() + objidx*7;
+			for(std::size_t i=0; i<7; ++i)
+			{
+				ok = ok && traj_get_int(raw, pos, delta);
+				val[i] += delta;
+			}
+
+			TrajPose& pose = decoded->poses[std::size_t(frame)*m_header.num_objs + objidx];
+			for(std::size_t i=0; i<3; ++i)
+				pose.pos[i] = t_real(val[i]) * m_header.pos_res;
+
+			t_real len = 0;
+			for(std::size_t i=0; i<4; ++i)
+			{
+				pose.quat[i] = t_real(val[3 + i]) / TRAJ_QUAT_SCALE;
+				len += pose.quat[i] * pose.quat[i];
+			}
+			len = std::sqrt(len);
+			if(len > 0)
+			{
+				for(t_real& comp : pose.quat)
+					comp /= len;
+			}
+		}
+
+		if(!ok)
+		{
+			std::cerr << "Error: Truncated frame data in trajectory chunk " << idx << "." << std::endl;
+			return nullptr;
+		}
+	}
+
+	// keep the current chunk and its successor
+	if(m_cache.size() >= 2)
+		m_cache.erase(m_cache.begin());
+	m_cache.push_back(decoded);
+
+	return decoded;
+}
+
+
+/**
+ * get the poses of all objects at the given simulation time,
+ * linearly interpolating the positions and normalising the interpolated quaternions
+ */
+bool TrajectoryPlayer::GetPoses(t_real time, std::vector<TrajPose>& poses)
+{
+	if(!IsOpen() || m_index.size() == 0)
+		return false;
+
+	time = std::clamp(time, m_start_time, m_end_time);
+
+	// chunk and frame at or before the requested time
+	auto iter = std::upper_bound(m_index.begin(), m_index.end(), time,
+		[](t_real t, const TrajChunkIndex& chunk) -> bool { return t < chunk.first_time; });
+	const std::size_t chunkidx = (iter == m_index.begin()) ? 0 : std::size_t(iter - m_index.begin() - 1);
+
+	std::shared_ptr<const TrajDecodedChunk> chunk = GetChunk(chunkidx);
+	if(!chunk || chunk->times.empty())
+		return false;
+
+	auto frameiter = std::upper_bound(chunk->times.begin(), chunk->times.end(), time);
+	const std::size_t frame = (frameiter == chunk->times.begin()) ? 0
+		: std::size_t(frameiter - chunk->times.begin() - 1);
+
+	// the following frame might be the first one of the next chunk
+	std::shared_ptr<const TrajDecodedChunk> nextchunk = chunk;
+	std::size_t nextframe = frame + 1;
+	if(nextframe >= chunk->times.size())
+	{
+		nextchunk = GetChunk(chunkidx + 1);
+		nextframe = 0;
+		if(nextchunk && nextchunk->times.empty())
+			nextchunk.reset();
+	}
+
+	const std::size_t num_objs = m_header.num_objs;
+	poses.resize(num_objs);
+
+	t_real alpha = 0;
+	if(nextchunk && nextchunk->times[nextframe] > chunk->times[frame])
+	{
+		alpha = (time - chunk->times[frame]) / (nextchunk->times[nextframe] - chunk->times[frame]);
+		alpha = std::clamp<t_real>(alpha, 0, 1);
+	}
+
+	for(std::size_t objidx = 0; objidx < num_objs; ++objidx)
+	{
+		const TrajPose& pose1 = chunk->poses[frame*num_objs + objidx];
+		if(alpha <= 0)
+		{
+			poses[objidx] = pose1;
+			continue;
+		}
+
+		const TrajPose& pose2 = nextchunk->poses[nextframe*num_objs + objidx];
+		TrajPose& pose = poses[objidx];
+
+		for(std::size_t i=0; i<3; ++i)
+			pose.pos[i] = (t_real(1) - alpha)*pose1.pos[i] + alpha*pose2.pos[i];
+
+		// interpolate along the shorter arc
+		t_real dot = 0;
+		for(std::size_t i=0; i<4; ++i)
+			dot += pose1.quat[i] * pose2.quat[i];
+		const t_real sign = dot < 0 ? -1 : 1;
+
+		t_real len = 0;
+		for(std::size_t i=0; i<4; ++i)
+		{
+			pose.quat[i] = (t_real(1) - alpha)*pose1.quat[i] + alpha*sign*pose2.quat[i];
+			len += pose.quat[i] * pose.quat[i];
+		}
+		len = std::sqrt(len);
+		if(len > 0)
+		{
+			for(t_real& comp : pose.quat)
+				comp /= len;
+		}
+	}
+
+	return true;
+}
+// ----------------------------------------------------------------------------
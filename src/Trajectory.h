@@ -0,0 +1,201 @@
+/**
+ * recording and replay of simulation runs
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * File layout, all parts start at 8-byte aligned offsets from the beginning of the file:
+ *   header | object ids | chunk | chunk | ... | chunk index
+ * Each chunk holds a zlib-compressed run of frames whose first frame is stored
+ * in full, so it can be decoded without its predecessors. The index and the
+ * frame count in the header are only written when the recording is closed,
+ * files of interrupted recordings are read by scanning their chunks.
+ *
+ * Frame encoding within a chunk, all integers are zigzag-encoded variable-length deltas
+ * to the previous frame (or to zero for the chunk's first frame):
+ *   time in units of time_res | per object: position in units of pos_res, quaternion x, y, z, w
+ */
+
+#ifndef __GLSCENE_TRAJECTORY_H__
+#define __GLSCENE_TRAJECTORY_H__
+
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "types.h"
+#include "SceneBinary.h"
+
+
+#define TRAJ_MAGIC        "GLSCNTRJ"
+#define TRAJ_VERSION      1
+#define TRAJ_CHUNK_MAGIC  0x4b4e4843u    // "CHNK"
+
+// quaternion components are quantised to this range
+#define TRAJ_QUAT_SCALE   32767
+
+
+struct TrajHeader
+{
+	char magic[8]{};
+	std::uint32_t version{TRAJ_VERSION};
+	std::uint32_t byteorder{BINSCENE_BYTEORDER};
+
+	std::uint32_t num_objs{0};
+	std::uint32_t chunk_frames{0};   // maximum number of frames per chunk
+
+	double pos_res{0};               // position quantisation step
+	double time_res{0};              // time quantisation step in seconds
+
+	std::uint64_t num_frames{0};     // 0 while recording
+	BinSceneSection ids{};           // per object: 32-bit length and characters of its id
+	BinSceneSection index{};         // TrajChunkIndex entries, empty while recording
+};
+
+
+struct TrajChunkHeader
+{
+	std::uint32_t magic{TRAJ_CHUNK_MAGIC};
+	std::uint32_t num_frames{0};
+
+	std::uint64_t first_frame{0};
+	double first_time{0};            // simulation time of the first frame in seconds
+
+	std::uint64_t raw_size{0};       // uncompressed size of the frame data
+	std::uint64_t size{0};           // compressed size, the data follows the header
+};
+
+
+struct TrajChunkIndex
+{
+	std::uint64_t offs{0};           // of the chunk header, in bytes from the start of the file
+	std::uint64_t first_frame{0};
+	double first_time{0};
+	std::uint32_t num_frames{0};
+	std::uint32_t reserved{0};
+};
+
+
+static_assert(std::is_trivially_copyable_v<TrajHeader>);
+static_assert(sizeof(TrajHeader) % 8 == 0);
+static_assert(sizeof(TrajChunkHeader) % 8 == 0);
+static_assert(sizeof(TrajChunkIndex) % 8 == 0);
+
+
+/**
+ * decoded position and orientation of an object
+ */
+struct TrajPose
+{
+	std::array<t_real, 3> pos{};
+	std::array<t_real, 4> quat{ 0, 0, 0, 1 };  // x, y, z, w
+
+	t_mat44 GetTrafo() const;
+	static TrajPose FromTrafo(const t_mat44& trafo);
+};
+
+
+/**
+ * decoded frames of a chunk
+ */
+struct TrajDecodedChunk
+{
+	std::size_t idx{0};              // into the chunk index
+	std::vector<t_real> times{};
+	std::vector<TrajPose> poses{};   // num_objs poses per frame
+};
+
+
+/**
+ * streams the poses of a fixed set of objects into a trajectory file,
+ * full chunks are compressed and written in the background
+ */
+class TrajectoryRecorder
+{
+public:
+	TrajectoryRecorder() = default;
+	~TrajectoryRecorder();
+
+	TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+	const TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+	bool Open(const std::string& filename, const std::vector<std::string>& ids,
+		std::uint32_t chunk_frames = 256, t_real pos_res = 1e-4, t_real time_res = 1e-6);
+	bool Close();
+	bool IsOpen() const { return m_ofstr.is_open(); }
+
+	// the trafos are in the order of the ids passed to Open()
+	void AddFrame(t_real time, const std::vector<t_mat44>& trafos);
+
+	std::uint64_t GetNumFrames() const { return m_num_frames; }
+
+
+protected:
+	void FlushChunk();
+	static bool WriteChunk(std::ofstream& ofstr, std::vector<TrajChunkIndex>& index,
+		TrajChunkHeader chunk, const std::string& raw);
+
+
+private:
+	std::ofstream m_ofstr{};
+	TrajHeader m_header{};
+	bool m_ok{true};
+
+	// frames of the current chunk
+	std::string m_raw{};
+	TrajChunkHeader m_chunk{};
+	std::int64_t m_prev_time{0};
+	std::vector<std::int64_t> m_prev_vals{};  // 7 quantised values per object
+	std::uint64_t m_num_frames{0};
+
+	// the chunk being written, only one at a time
+	std::future<bool> m_writing{};
+	std::vector<TrajChunkIndex> m_index{};
+};
+
+
+/**
+ * random access to the frames of a trajectory file,
+ * the chunks around the requested time are decoded on demand
+ */
+class TrajectoryPlayer
+{
+public:
+	bool Open(const std::string& filename);
+	void Close();
+	bool IsOpen() const { return m_ifstr.is_open(); }
+
+	const std::vector<std::string>& GetIds() const { return m_ids; }
+	std::uint64_t GetNumFrames() const { return m_num_frames; }
+	t_real GetStartTime() const { return m_start_time; }
+	t_real GetEndTime() const { return m_end_time; }
+
+	// poses at the given simulation time, interpolated between the neighbouring frames
+	bool GetPoses(t_real time, std::vector<TrajPose>& poses);
+
+
+protected:
+	bool ScanChunks(std::uint64_t offs);
+	std::shared_ptr<const TrajDecodedChunk> GetChunk(std::size_t idx);
+
+
+private:
+	std::ifstream m_ifstr{};
+	TrajHeader m_header{};
+	std::vector<std::string> m_ids{};
+	std::vector<TrajChunkIndex> m_index{};
+	std::uint64_t m_num_frames{0};
+	t_real m_start_time{0}, m_end_time{0};
+
+	// recently decoded chunks, the current one and its successor
+	std::vector<std::shared_ptr<const TrajDecodedChunk>> m_cache{};
+};
+
+
+#endif
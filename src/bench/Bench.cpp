@@ -0,0 +1,400 @@
+/**
+ * benchmarks of the scene and renderer hot paths on synthetic scenes
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * Usage:
+ *   gl_bench [--boxes N] [--spheres N] [--portals N] [--lights N] [--dynamic ratio]
+ *            [--seed N] [--iterations N] [--size <width>x<height>]
+ *            [--save <scene file>] [--out <json file>]
+ * The results are written as json to the standard output or to the given file.
+ */
+
+#include "SceneGenerator.h"
+#include "src/Scene.h"
+#include "src/settings_variables.h"
+#include "src/renderer/GlRenderer.h"
+
+#include <QtCore/QtGlobal>
+#include <QtWidgets/QApplication>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <locale>
+#include <cmath>
+
+#if __has_include(<filesystem>)
+	#include <filesystem>
+	namespace fs = std::filesystem;
+#else
+	#include <boost/filesystem.hpp>
+	namespace fs = boost::filesystem;
+#endif
+
+#include <boost/algorithm/string.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+namespace pt = boost::property_tree;
+
+
+/**
+ * command-line options of the benchmarks
+ */
+struct BenchOptions
+{
+	SceneGenOptions scene{};
+
+	std::size_t iterations{100};
+	int width{1920};
+	int height{1080};
+
+	std::string save_file{};
+	std::string out_file{};
+};
+
+
+/**
+ * timings of one benchmark in milliseconds
+ */
+struct BenchResult
+{
+	std::string name{};
+	std::vector<t_real> times{};
+};
+
+
+/**
+ * gives access to the renderer's picker
+ */
+class BenchRenderer : public GlSceneRenderer
+{
+public:
+	void Pick(t_real_gl x, t_real_gl y)
+	{
+		m_posMouse = QPointF(x, y);
+		UpdatePicker();
+	}
+};
+
+
+/**
+ * run a function repeatedly and measure each call, after a few warm-up calls
+ */
+static BenchResult measure(const std::string& name, std::size_t iterations,
+	const std::function<void(std::size_t)>& func, std::size_t warmup = 2)
+{
+	using t_clock = std::chrono::steady_clock;
+
+	for(std::size_t iter = 0; iter < warmup; ++iter)
+		func(iter);
+
+	BenchResult result{ .name = name };
+	result.times.reserve(iterations);
+
+	for(std::size_t iter = 0; iter < iterations; ++iter)
+	{
+		const auto start = t_clock::now();
+		func(warmup + iter);
+		result.times.push_back(std::chrono::duration<t_real, std::milli>(t_clock::now() - start).count());
+	}
+
+	std::cerr << "Finished benchmark \"" << name << "\"." << std::endl;
+	return result;
+}
+
+
+/**
+ * get a percentile of sorted values by linear interpolation
+ */
+static t_real percentile(const std::vector<t_real>& sorted, t_real perc)
+{
+	if(sorted.empty())
+		return 0;
+
+	const t_real pos = perc / t_real(100) * t_real(sorted.size() - 1);
+	const std::size_t idx = std::size_t(pos);
+	if(idx + 1 >= sorted.size())
+		return sorted.back();
+
+	return sorted[idx] + (pos - t_real(idx)) * (sorted[idx + 1] - sorted[idx]);
+}
+
+
+/**
+ * write the options and the statistics of all benchmarks
+ */
+static void write_json(std::ostream& ostr, const BenchOptions& opts,
+	const std::vector<BenchResult>& results)
+{
+	ostr.precision(6);
+	ostr << "{\n";
+
+	ostr << "\t\"scene\": {\n"
+		<< "\t\t\"boxes\": " << opts.scene.num_boxes << ",\n"
+		<< "\t\t\"spheres\": " << opts.scene.num_spheres << ",\n"
+		<< "\t\t\"portals\": " << opts.scene.num_portals << ",\n"
+		<< "\t\t\"lights\": " << opts.scene.num_lights << ",\n"
+		<< "\t\t\"dynamic_ratio\": " << opts.scene.dynamic_ratio << ",\n"
+		<< "\t\t\"seed\": " << opts.scene.seed << "\n"
+		<< "\t},\n";
+
+	ostr << "\t\"width\": " << opts.width << ",\n"
+		<< "\t\"height\": " << opts.height << ",\n"
+#ifdef USE_BULLET
+		<< "\t\"bullet\": true,\n"
+#else
+		<< "\t\"bullet\": false,\n"
+#endif
+		<< "\t\"unit\": \"ms\",\n";
+
+	ostr << "\t\"benchmarks\": [\n";
+	for(std::size_t idx = 0; idx < results.size(); ++idx)
+	{
+		const BenchResult& result = results[idx];
+
+		std::vector<t_real> sorted = result.times;
+		std::sort(sorted.begin(), sorted.end());
+		const t_real mean = sorted.size()
+			? std::accumulate(sorted.begin(), sorted.end(), t_real(0)) / t_real(sorted.size())
+			: t_real(0);
+
+		ostr << "\t\t{ "
+			<< "\"name\": \"" << result.name << "\", "
+			<< "\"samples\": " << sorted.size() << ", "
+			<< "\"mean\": " << mean << ", "
+			<< "\"min\": " << (sorted.size() ? sorted.front() : t_real(0)) << ", "
+			<< "\"p50\": " << percentile(sorted, 50) << ", "
+			<< "\"p90\": " << percentile(sorted, 90) << ", "
+			<< "\"p99\": " << percentile(sorted, 99) << ", "
+			<< "\"max\": " << (sorted.size() ? sorted.back() : t_real(0))
+			<< " }" << (idx + 1 < results.size() ? "," : "") << "\n";
+	}
+	ostr << "\t]\n";
+
+	ostr << "}" << std::endl;
+}
+
+
+/**
+ * parse the command-line options
+ */
+static bool get_options(int argc, char** argv, BenchOptions& opts)
+{
+	for(int arg = 1; arg < argc; ++arg)
+	{
+		const std::string str = argv[arg];
+		if(arg + 1 >= argc)
+		{
+			std::cerr << "Error: Missing value for option \"" << str << "\"." << std::endl;
+			return false;
+		}
+
+		const std::string val = argv[++arg];
+
+		if(str == "--boxes")
+			opts.scene.num_boxes = std::stoul(val);
+		else if(str == "--spheres")
+			opts.scene.num_spheres = std::stoul(val);
+		else if(str == "--portals")
+			opts.scene.num_portals = std::stoul(val);
+		else if(str == "--lights")
+			opts.scene.num_lights = std::stoul(val);
+		else if(str == "--dynamic")
+			opts.scene.dynamic_ratio = std::clamp<t_real>(std::stod(val), 0, 1);
+		else if(str == "--seed")
+			opts.scene.seed = unsigned(std::stoul(val));
+		else if(str == "--iterations")
+			opts.iterations = std::max<std::size_t>(std::stoul(val), 1);
+		else if(str == "--save")
+			opts.save_file = val;
+		else if(str == "--out")
+			opts.out_file = val;
+		else if(str == "--size")
+		{
+			std::vector<std::string> dims;
+			boost::split(dims, val, boost::is_any_of("x"));
+			if(dims.size() == 2)
+			{
+				opts.width = std::max(std::stoi(dims[0]), 1);
+				opts.height = std::max(std::stoi(dims[1]), 1);
+			}
+		}
+		else
+		{
+			std::cerr << "Error: Unknown option \"" << str << "\"." << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/**
+ * run all benchmarks
+ */
+static int run_benchmarks(const BenchOptions& opts)
+{
+	std::vector<BenchResult> results;
+
+	pt::ptree prop = generate_scene(opts.scene);
+	if(opts.save_file != "")
+	{
+		pt::write_xml(opts.save_file, prop, std::locale(),
+			pt::xml_writer_make_settings('\t', 1, std::string{"utf-8"}));
+	}
+
+	// scene loading, this includes the creation of the rigid bodies
+	results.emplace_back(measure("scene_load", opts.iterations, [&prop](std::size_t)
+	{
+		Scene scene;
+		if(auto [ok, msg] = Scene::load(prop, scene); !ok)
+			std::cerr << "Error: " << msg << std::endl;
+	}));
+
+	Scene scene;
+	if(auto [ok, msg] = Scene::load(prop, scene); !ok)
+	{
+		std::cerr << "Error: " << msg << std::endl;
+		return -1;
+	}
+
+	// tessellation of all objects
+	results.emplace_back(measure("geometry_triangles", opts.iterations, [&scene](std::size_t)
+	{
+		std::size_t num_verts = 0;
+		for(const auto& obj : scene.GetObjects())
+			num_verts += std::get<0>(obj->GetTriangles()).size();
+
+		// keep the result alive
+		if(num_verts == std::numeric_limits<std::size_t>::max())
+			std::cerr << num_verts << std::endl;
+	}));
+
+	// the offscreen renderer using the generated scene
+	BenchRenderer renderer;
+	if(!renderer.InitOffscreen(opts.width, opts.height))
+	{
+		std::cerr << "Error: Could not initialise offscreen renderer." << std::endl;
+		return -1;
+	}
+
+	renderer.EnableShadowRendering(g_enable_shadow_rendering);
+	renderer.EnableShadowMapCache(g_shadow_map_cache);
+	renderer.SetShadowMapSize(int(std::clamp(g_shadow_map_size, 16u, 16384u)));
+	renderer.EnablePortalRendering(g_enable_portal_rendering);
+	renderer.SetPortalDepth(g_portal_depth);
+	renderer.EnableInstancing(g_enable_instancing);
+	renderer.EnableOcclusionCulling(g_enable_occlusion_culling);
+	renderer.SetLodPixels(g_lod_pixels);
+	renderer.SetLightRange(g_light_range);
+	renderer.LoadScene(scene);
+	renderer.FinishLoading();
+
+	GlSceneRenderer::t_cam& cam = renderer.GetCamera();
+	cam.SetFOV(prop.get<t_real_gl>(FILE_BASENAME "configuration.camera.viewing_angle", 90)
+		/ t_real_gl{180} * m::pi<t_real_gl>);
+
+	// orbit around the scene centre by one degree per frame
+	cam.SetPosition(m::create<t_vec3_gl>({ 0, 0, 0 }));
+	cam.SetDist(t_real_gl(opts.scene.extent) * t_real_gl(0.75));
+	cam.SetZoom(1);
+	auto set_cam = [&cam](std::size_t frame)
+	{
+		cam.SetRotation(t_real_gl(frame % 360) / t_real_gl{180} * m::pi<t_real_gl>,
+			t_real_gl(-60) / t_real_gl{180} * m::pi<t_real_gl>);
+	};
+
+	// picking at pseudo-random screen positions
+	set_cam(0);
+	renderer.UpdateCam(false);
+	std::mt19937 rng{opts.scene.seed};
+	results.emplace_back(measure("update_picker", opts.iterations,
+		[&renderer, &rng, &opts](std::size_t)
+	{
+		renderer.Pick(t_real_gl(rng() % unsigned(opts.width)), t_real_gl(rng() % unsigned(opts.height)));
+	}));
+
+	// full frames, the read-back of a frame overlaps with the rendering of the next ones
+	auto drop_frame = [](std::size_t, QImage&&) {};
+	results.emplace_back(measure("frame", opts.iterations,
+		[&renderer, &set_cam, &drop_frame](std::size_t frame)
+	{
+		set_cam(frame);
+		renderer.RenderOffscreen(frame, drop_frame);
+	}, 8));
+	renderer.FinishOffscreen(drop_frame);
+
+	// physics steps of the rigid bodies and the animations
+	results.emplace_back(measure("scene_tick", opts.iterations, [&scene](std::size_t)
+	{
+		scene.tick(std::chrono::milliseconds{10});
+	}));
+
+	if(opts.out_file != "")
+	{
+		std::ofstream ofstr{opts.out_file};
+		if(!ofstr)
+		{
+			std::cerr << "Error: Could not write \"" << opts.out_file << "\"." << std::endl;
+			return -1;
+		}
+		write_json(ofstr, opts, results);
+	}
+	else
+	{
+		write_json(std::cout, opts, results);
+	}
+
+	return 0;
+}
+
+
+/**
+ * main entry point
+ */
+int main(int argc, char** argv)
+{
+	try
+	{
+		BenchOptions opts;
+		if(!get_options(argc, argv, opts))
+			return -1;
+
+		// render with the offscreen platform plugin unless another one is given
+		if(!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+			qputenv("QT_QPA_PLATFORM", "offscreen");
+
+		set_gl_format(true, _GL_MAJ_VER, _GL_MIN_VER, int(g_msaa_samples));
+
+		::setlocale(LC_ALL, "C");
+		std::locale::global(std::locale("C"));
+
+		QApplication app{argc, argv};
+
+		// shaders
+		fs::path apppath = QApplication::applicationDirPath().toStdString();
+		g_apppath = apppath.string();
+		g_res.AddPath((apppath / "res").string());
+		g_res.AddPath((apppath / ".." / "res").string());
+		g_res.AddPath(g_apppath);
+		g_res.AddPath(fs::current_path().string());
+
+		return run_benchmarks(opts);
+	}
+	catch(const std::exception& ex)
+	{
+		std::cerr << "Error: " << ex.what() << std::endl;
+		return -1;
+	}
+}
@@ -0,0 +1,193 @@
+/**
+ * synthetic scenes for the benchmarks
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ */
+
+#include "SceneGenerator.h"
+#include "src/Geometry.h"
+
+#include <random>
+#include <string>
+#include <cmath>
+
+namespace pt = boost::property_tree;
+
+
+static const std::string g_unit_matrix = "1; 0; 0; 0| 0; 1; 0; 0| 0; 0; 1; 0| 0; 0; 0; 1";
+
+
+/**
+ * random numbers which are the same on all platforms,
+ * the standard distributions are implementation-defined
+ */
+class SceneGenRandom
+{
+public:
+	explicit SceneGenRandom(unsigned int seed) : m_rng{seed}
+	{}
+
+
+	// uniform in [min, max]
+	t_real operator()(t_real min, t_real max)
+	{
+		const t_real val = t_real(m_rng() - m_rng.min()) / t_real(m_rng.max() - m_rng.min());
+		return min + val*(max - min);
+	}
+
+
+private:
+	std::mt19937 m_rng;
+};
+
+
+/**
+ * properties common to all objects
+ */
+static pt::ptree make_object(const t_vec& pos, const t_vec& col,
+	bool fixed, const std::string& rot = g_unit_matrix)
+{
+	pt::ptree geo;
+	geo.put("position", geo_vec_to_str(pos));
+	geo.put("rotation", rot);
+	geo.put("fixed", fixed ? 1 : 0);
+	geo.put("colour", geo_vec_to_str(col));
+	geo.put("lighting", 1);
+	geo.put("light_id", -1);
+	geo.put("texture", "");
+	geo.put("portal_id", -1);
+	geo.put("portal_trafo", g_unit_matrix);
+	geo.put("mass", 1);
+	return geo;
+}
+
+
+/**
+ * generate a floor with randomly placed boxes and spheres, lights above them and pairs of portals
+ */
+pt::ptree generate_scene(const SceneGenOptions& opts)
+{
+	SceneGenRandom rnd{opts.seed};
+	const t_real half = opts.extent / t_real(2);
+
+	pt::ptree objs;
+	std::size_t objidx = 0;
+
+	auto add_object = [&objs, &objidx](const std::string& type, const std::string& name, pt::ptree&& geo)
+	{
+		geo.put("<xmlattr>.id", name);
+
+		pt::ptree obj;
+		obj.put("<xmlattr>.id", "object " + std::to_string(++objidx));
+		obj.put_child("geometry." + type, geo);
+		objs.push_back(std::make_pair("object", obj));
+	};
+
+	auto rnd_pos = [&rnd, half](t_real z) -> t_vec
+	{
+		return m::create<t_vec>({ rnd(-half, half), rnd(-half, half), z });
+	};
+
+	auto rnd_col = [&rnd]() -> t_vec
+	{
+		return m::create<t_vec>({ rnd(0.2, 1.), rnd(0.2, 1.), rnd(0.2, 1.) });
+	};
+
+	// floor
+	{
+		pt::ptree geo = make_object(m::create<t_vec>({ 0, 0, 0 }),
+			m::create<t_vec>({ 0.5, 0.5, 0.5 }), true);
+		geo.put("normal", "0; 0; 1");
+		geo.put("width", opts.extent);
+		geo.put("height", opts.extent);
+		add_object("plane", "floor", std::move(geo));
+	}
+
+	// boxes, the dynamic ones are dropped onto the floor
+	for(std::size_t idx = 0; idx < opts.num_boxes; ++idx)
+	{
+		// the random numbers are drawn in a fixed order, unlike the evaluation of function arguments
+		const bool fixed = rnd(0, 1) >= opts.dynamic_ratio;
+		const t_real height = rnd(0.5, 4.);
+		const t_real drop = fixed ? 0. : rnd(1., 10.);
+		const t_vec pos = rnd_pos(height/2. + drop);
+		const t_vec col = rnd_col();
+		const t_real length = rnd(0.5, 4.);
+		const t_real depth = rnd(0.5, 4.);
+
+		pt::ptree geo = make_object(pos, col, fixed);
+		geo.put("length", length);
+		geo.put("depth", depth);
+		geo.put("height", height);
+		add_object("box", "box " + std::to_string(idx + 1), std::move(geo));
+	}
+
+	// spheres
+	for(std::size_t idx = 0; idx < opts.num_spheres; ++idx)
+	{
+		const bool fixed = rnd(0, 1) >= opts.dynamic_ratio;
+		const t_real radius = rnd(0.25, 2.);
+		const t_real drop = fixed ? 0. : rnd(1., 10.);
+		const t_vec pos = rnd_pos(radius + drop);
+		const t_vec col = rnd_col();
+
+		pt::ptree geo = make_object(pos, col, fixed);
+		geo.put("radius", radius);
+		add_object("sphere", "sphere " + std::to_string(idx + 1), std::move(geo));
+	}
+
+	// lights on a regular grid above the objects
+	const std::size_t lights_side = std::size_t(std::ceil(std::sqrt(t_real(opts.num_lights))));
+	for(std::size_t idx = 0; idx < opts.num_lights; ++idx)
+	{
+		const t_real x = (t_real(idx % lights_side) + 0.5) / t_real(lights_side) * opts.extent - half;
+		const t_real y = (t_real(idx / lights_side) + 0.5) / t_real(lights_side) * opts.extent - half;
+
+		pt::ptree geo = make_object(m::create<t_vec>({ x, y, 10 }),
+			m::create<t_vec>({ 1, 0.8, 0 }), true);
+		geo.put("lighting", 0);
+		geo.put("light_id", idx);
+		geo.put("mass", 0);
+		geo.put("radius", 0.25);
+		add_object("sphere", "light " + std::to_string(idx + 1), std::move(geo));
+	}
+
+	// upright portal planes, each one's transformation leads to its partner
+	const std::string portal_rot = "1; 0; 0; 0| 0; 0; -1; 0| 0; 1; 0; 0| 0; 0; 0; 1";
+	for(std::size_t idx = 0; idx < opts.num_portals; ++idx)
+	{
+		const t_vec pos[2] = { rnd_pos(3), rnd_pos(3) };
+
+		for(int side = 0; side < 2; ++side)
+		{
+			const t_vec diff = pos[side] - pos[1 - side];
+
+			pt::ptree geo = make_object(pos[side], m::create<t_vec>({ 1, 1, 0 }), true, portal_rot);
+			geo.put("portal_id", 2*idx + side + 1);
+			geo.put("portal_trafo",
+				"1; 0; 0; " + geo_vec_to_str(m::create<t_vec>({ diff[0] })) +
+				"| 0; 1; 0; " + geo_vec_to_str(m::create<t_vec>({ diff[1] })) +
+				"| 0; 0; 1; 0| 0; 0; 0; 1");
+			geo.put("normal", "0; 0; 1");
+			geo.put("width", 6);
+			geo.put("height", 6);
+			add_object("plane", "portal " + std::to_string(2*idx + side + 1), std::move(geo));
+		}
+	}
+
+	pt::ptree prop;
+	prop.put_child(FILE_BASENAME "objects", objs);
+
+	// camera looking at the scene from above one of its corners
+	prop.put(FILE_BASENAME "configuration.camera.x", 0);
+	prop.put(FILE_BASENAME "configuration.camera.y", 0);
+	prop.put(FILE_BASENAME "configuration.camera.z", 0);
+	prop.put(FILE_BASENAME "configuration.camera.phi", 315);
+	prop.put(FILE_BASENAME "configuration.camera.theta", -60);
+	prop.put(FILE_BASENAME "configuration.camera.viewing_angle", 90);
+	prop.put(FILE_BASENAME "configuration.camera.perspective_proj", 1);
+	prop.put(FILE_BASENAME "ident", APPL_IDENT);
+
+	return prop;
+}
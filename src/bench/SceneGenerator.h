@@ -0,0 +1,38 @@
+/**
+ * synthetic scenes for the benchmarks
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ */
+
+#ifndef __GLSCENE_BENCH_SCENEGEN_H__
+#define __GLSCENE_BENCH_SCENEGEN_H__
+
+#include <cstddef>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "src/types.h"
+
+
+/**
+ * number and kind of the generated objects
+ */
+struct SceneGenOptions
+{
+	std::size_t num_boxes{512};
+	std::size_t num_spheres{128};
+	std::size_t num_portals{1};     // pairs of connected portals
+	std::size_t num_lights{16};
+
+	t_real dynamic_ratio{0.25};     // fraction of boxes and spheres simulated as rigid bodies
+	t_real extent{100.};            // side length of the square floor
+	unsigned int seed{1};
+};
+
+
+// generate a scene in the format of the xml scene files, the same options give the same scene
+extern boost::property_tree::ptree generate_scene(const SceneGenOptions& opts);
+
+
+#endif
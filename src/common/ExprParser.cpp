@@ -19,19 +19,52 @@
 #include <limits>
 #include <regex>
 #include <cmath>
+#include <charconv>
+#include <cctype>
+#include <algorithm>
+#include <functional>
 
 
 static std::mt19937 g_rng{std::random_device{}()};
 
 
+/**
+ * modulo for real and integer values
+ */
+template<class t_val>
+static t_val expr_mod(t_val x, t_val y)
+{
+	if constexpr(std::is_floating_point_v<t_val>)
+		return (t_val)std::fmod(x, y);
+	else if constexpr(std::is_integral_v<t_val>)
+		return (t_val)(x % y);
+	else
+		throw std::invalid_argument("Invalid number type.");
+}
+
+
+/**
+ * symbol table with the predefined constants
+ */
 template<class T>
-ExprParser<T>::ExprParser() :
-	m_mapSymbols  // symbol table
+const typename ExprParser<T>::t_symbols& ExprParser<T>::GetDefaultSymbols()
+{
+	static const t_symbols symbols
 	{
 		{ "pi", t_val(M_PI) },
-	},
+	};
 
-	m_mapFuncs0   // zero-args function table
+	return symbols;
+}
+
+
+/**
+ * zero-args function table, shared by all parser instances
+ */
+template<class T>
+const typename ExprParser<T>::t_funcs0& ExprParser<T>::GetFuncs0()
+{
+	static const t_funcs0 funcs
 	{
 		{ "rand", []() -> t_val
 			{
@@ -45,9 +78,19 @@ ExprParser<T>::ExprParser() :
 				else
 					throw std::invalid_argument("Invalid number type.");
 			} },
-	},
+	};
+
+	return funcs;
+}
+
 
-	m_mapFuncs1   // one-arg function table
+/**
+ * one-arg function table, shared by all parser instances
+ */
+template<class T>
+const typename ExprParser<T>::t_funcs1& ExprParser<T>::GetFuncs1()
+{
+	static const t_funcs1 funcs
 	{
 		{ "sin", [](t_val x) -> t_val { return (t_val)std::sin(x); } },
 		{ "cos", [](t_val x) -> t_val { return (t_val)std::cos(x); } },
@@ -78,9 +121,19 @@ ExprParser<T>::ExprParser() :
 
 		{ "erf", [](t_val x) -> t_val { return (t_val)std::erf(x); } },
 		{ "erfc", [](t_val x) -> t_val { return (t_val)std::erfc(x); } },
-	},
+	};
+
+	return funcs;
+}
 
-	m_mapFuncs2   // two-args function table
+
+/**
+ * two-args function table, shared by all parser instances
+ */
+template<class T>
+const typename ExprParser<T>::t_funcs2& ExprParser<T>::GetFuncs2()
+{
+	static const t_funcs2 funcs
 	{
 		{ "pow", [](t_val x, t_val y) -> t_val { return (t_val)std::pow(x, y); } },
 		{ "atan2", [](t_val y, t_val x) -> t_val { return (t_val)std::atan2(y, x); } },
@@ -97,16 +150,15 @@ ExprParser<T>::ExprParser() :
 					throw std::invalid_argument("Invalid number type.");
 			} },
 
-		{ "mod", [](t_val x, t_val y) -> t_val
-			{
-				if constexpr(std::is_floating_point_v<t_val>)
-					return (t_val)std::fmod(x, y);
-				else if constexpr(std::is_integral_v<t_val>)
-					return (t_val)(x % y);
-				else
-					throw std::invalid_argument("Invalid number type.");
-			} },
-	}
+		{ "mod", [](t_val x, t_val y) -> t_val { return expr_mod(x, y); } },
+	};
+
+	return funcs;
+}
+
+
+template<class T>
+ExprParser<T>::ExprParser() : m_mapSymbols{GetDefaultSymbols()}
 { }
 
 
@@ -133,9 +185,7 @@ ExprParser<T>& ExprParser<T>::operator=(const ExprParser<T>& parser)
 	this->m_dist_to_jump = parser.m_dist_to_jump;
 
 	this->m_mapSymbols = parser.m_mapSymbols;
-	this->m_mapFuncs0 = parser.m_mapFuncs0;
-	this->m_mapFuncs1 = parser.m_mapFuncs1;
-	this->m_mapFuncs2 = parser.m_mapFuncs2;
+	this->m_symbolsModified = parser.m_symbolsModified;
 
 	return *this;
 }
@@ -150,9 +200,10 @@ ExprParser<T>::get_matching_tokens(const std::string& str)
 {
 	std::vector<Token> matches;
 
+	// the regexes are only compiled once
 	if constexpr(std::is_floating_point_v<t_val>)
 	{       // real
-		std::regex regex{"[0-9]+(\\.[0-9]*)?([Ee][+-]?[0-9]*)?"};
+		static const std::regex regex{"[0-9]+(\\.[0-9]*)?([Ee][+-]?[0-9]*)?"};
 		std::smatch smatch;
 		if(std::regex_match(str, smatch, regex))
 		{
@@ -164,7 +215,7 @@ ExprParser<T>::get_matching_tokens(const std::string& str)
 	}
 	else if constexpr(std::is_integral_v<t_val>)
 	{       // int
-		std::regex regex{"[0-9]+"};
+		static const std::regex regex{"[0-9]+"};
 		std::smatch smatch;
 		if(std::regex_match(str, smatch, regex))
 		{
@@ -180,7 +231,7 @@ ExprParser<T>::get_matching_tokens(const std::string& str)
 	}
 
 	// ident
-	std::regex regex{"[A-Za-z]+[A-Za-z0-9]*"};
+	static const std::regex regex{"[A-Za-z]+[A-Za-z0-9]*"};
 	std::smatch smatch;
 	if(std::regex_match(str, smatch, regex))
 	{
@@ -362,6 +413,20 @@ typename ExprParser<T>::t_sym ExprParser<T>::AssignVar(
 	const std::string& id,
 	const typename ExprParser<T>::t_sym& arg)
 {
+	if(m_program)
+	{
+		// the assignment creates a local variable, which also shadows an input from here on
+		using t_op = typename ExprProgram<T>::OpCode;
+		auto iter = m_slots.find(id);
+		if(iter == m_slots.end() || iter->second.first != t_op::LOCAL)
+			iter = m_slots.insert_or_assign(id, std::make_pair(t_op::LOCAL, m_program->AddLocal())).first;
+
+		m_program->EmitVar(t_op::STORE, iter->second.second);
+		return t_val{};
+	}
+
+	m_symbolsModified = true;
+
 	// does the variable already exist?
 	if(auto iter = m_mapSymbols.find(id); iter != m_mapSymbols.end())
 	{
@@ -384,8 +449,17 @@ typename ExprParser<T>::t_sym ExprParser<T>::AssignVar(
 template<class T>
 typename ExprParser<T>::t_sym ExprParser<T>::CallFunc(const std::string& id) const
 {
-	if(auto iter = m_mapFuncs0.find(id); iter != m_mapFuncs0.end())
+	const t_funcs0& funcs = GetFuncs0();
+	if(auto iter = funcs.find(id); iter != funcs.end())
+	{
+		if(m_program)
+		{
+			m_program->EmitCall(iter->second);
+			return t_val{};
+		}
+
 		return (*iter->second)();
+	}
 
 	throw std::runtime_error("Unknown function \"" + id + "\".");
 }
@@ -399,8 +473,17 @@ typename ExprParser<T>::t_sym ExprParser<T>::CallFunc(
 	const std::string& id,
 	const typename ExprParser<T>::t_sym& arg) const
 {
-	if(auto iter = m_mapFuncs1.find(id); iter != m_mapFuncs1.end())
+	const t_funcs1& funcs = GetFuncs1();
+	if(auto iter = funcs.find(id); iter != funcs.end())
+	{
+		if(m_program)
+		{
+			m_program->EmitCall(iter->second);
+			return t_val{};
+		}
+
 		return (*iter->second)(GetValue(arg));
+	}
 
 	throw std::runtime_error("Unknown function \"" + id + "\".");
 }
@@ -415,8 +498,15 @@ typename ExprParser<T>::t_sym ExprParser<T>::CallFunc(
 	const typename ExprParser<T>::t_sym& arg1,
 	const typename ExprParser<T>::t_sym& arg2) const
 {
-	if(auto iter = m_mapFuncs2.find(id); iter != m_mapFuncs2.end())
+	const t_funcs2& funcs = GetFuncs2();
+	if(auto iter = funcs.find(id); iter != funcs.end())
 	{
+		if(m_program)
+		{
+			m_program->EmitCall(iter->second);
+			return t_val{};
+		}
+
 		t_val retval = (*iter->second)(GetValue(arg1), GetValue(arg2));
 		return t_sym{retval};
 	}
@@ -425,8 +515,182 @@ typename ExprParser<T>::t_sym ExprParser<T>::CallFunc(
 }
 
 
+/**
+ * reduce a scalar or a variable to a value
+ */
+template<class T>
+typename ExprParser<T>::t_sym ExprParser<T>::Terminal(const t_sym& sym)
+{
+	if(!m_program)
+		return GetValue(sym);
+
+	if(std::holds_alternative<t_val>(sym))
+	{
+		m_program->EmitConst(std::get<t_val>(sym));
+	}
+	else
+	{
+		const std::string& id = std::get<std::string>(sym);
+		if(auto iter = m_slots.find(id); iter != m_slots.end())
+			m_program->EmitVar(iter->second.first, iter->second.second);
+		else  // constants, e.g. pi, are inserted directly
+			m_program->EmitConst(GetIdentValue(id));
+	}
+
+	return t_val{};
+}
+
+
+/**
+ * binary arithmetic operation
+ */
+template<class T>
+typename ExprParser<T>::t_sym ExprParser<T>::Arith(int op, const t_sym& arg0, const t_sym& arg1)
+{
+	using t_op = typename ExprProgram<T>::OpCode;
+	t_op opcode = t_op::ADD;
+	switch(op)
+	{
+		case '+': opcode = t_op::ADD; break;
+		case '-': opcode = t_op::SUB; break;
+		case '*': opcode = t_op::MUL; break;
+		case '/': opcode = t_op::DIV; break;
+		case '%': opcode = t_op::MOD; break;
+		case '^': opcode = t_op::POW; break;
+	}
+
+	if(m_program)
+	{
+		m_program->EmitOp(opcode);
+		return t_val{};
+	}
+
+	return ExprProgram<T>::Binary(opcode, GetValue(arg0), GetValue(arg1));
+}
+
+
+template<class T>
+typename ExprParser<T>::t_sym ExprParser<T>::Negate(const t_sym& arg)
+{
+	if(m_program)
+	{
+		m_program->EmitOp(ExprProgram<T>::OpCode::NEG);
+		return t_val{};
+	}
+
+	return -GetValue(arg);
+}
+
+
+/**
+ * directly convert a plain number, e.g. "-1.5e3", without running the parser
+ * @return false if the string is not just a number literal
+ */
+template<class T>
+bool ExprParser<T>::ParseLiteral(std::string_view str, t_val& val)
+{
+	// trim white spaces
+	const std::size_t first = str.find_first_not_of(" \t\n");
+	if(first == std::string_view::npos)
+		return false;
+	str = str.substr(first, str.find_last_not_of(" \t\n") - first + 1);
+
+	const char *begin = str.data(), *end = str.data() + str.size();
+	bool negative = false;
+	if(*begin == '+' || *begin == '-')
+	{
+		negative = (*begin == '-');
+		++begin;
+	}
+
+	// only accept numbers starting with a digit like the lexer's, not "inf", "nan", or ".5"
+	if(begin == end || !std::isdigit((unsigned char)*begin))
+		return false;
+
+	auto [ptr, err] = std::from_chars(begin, end, val);
+	if(err != std::errc{} || ptr != end)
+		return false;
+
+	if(negative)
+		val = -val;
+	return true;
+}
+
+
+/**
+ * restore the predefined symbols if variables have been assigned
+ */
+template<class T>
+void ExprParser<T>::ResetSymbols()
+{
+	if(!m_symbolsModified)
+		return;
+
+	m_mapSymbols = GetDefaultSymbols();
+	m_symbolsModified = false;
+}
+
+
 template<class T>
 typename ExprParser<T>::t_val ExprParser<T>::Parse(const std::string& expr)
+{
+	// plain numbers don't need the lexer and parser
+	if(t_val val{}; ParseLiteral(expr, val))
+		return val;
+
+	if(RunParser(expr))
+		return GetValue(m_symbols.top());
+
+	return t_val{};  // error
+}
+
+
+/**
+ * compile the expression, the variables are accessed by their index in vars
+ */
+template<class T>
+ExprProgram<T> ExprParser<T>::Compile(const std::string& expr, const std::vector<std::string>& vars)
+{
+	using t_op = typename ExprProgram<T>::OpCode;
+
+	ExprProgram<T> program;
+	program.Clear(vars.size());
+
+	if(t_val val{}; ParseLiteral(expr, val))
+	{
+		program.EmitConst(val);
+		return program;
+	}
+
+	m_slots.clear();
+	for(std::size_t idx = 0; idx < vars.size(); ++idx)
+		m_slots.emplace(vars[idx], std::make_pair(t_op::INPUT, idx));
+
+	m_program = &program;
+	bool ok = false;
+	try
+	{
+		ok = RunParser(expr);
+	}
+	catch(...)
+	{
+		m_program = nullptr;
+		throw;
+	}
+	m_program = nullptr;
+
+	if(!ok)
+		program.Clear(vars.size());  // error
+	return program;
+}
+
+
+/**
+ * run the LR closures on the expression
+ * @return true if the expression has been accepted
+ */
+template<class T>
+bool ExprParser<T>::RunParser(const std::string& expr)
 {
 	m_toparse = expr;
 	m_istr = std::make_shared<std::istringstream>(expr);
@@ -439,10 +703,7 @@ typename ExprParser<T>::t_val ExprParser<T>::Parse(const std::string& expr)
 	GetNextLookahead();
 	start();
 
-	if(m_symbols.size() && m_accepted)
-		return GetValue(m_symbols.top());
-
-	return t_val{};  // error
+	return m_symbols.size() && m_accepted;
 }
 
 
@@ -623,11 +884,11 @@ void ExprParser<T>::after_add(int op)
 			{
 				case '+':
 					// semantic rule: expr -> expr + expr.
-					m_symbols.emplace(GetValue(arg0) + GetValue(arg1));
+					m_symbols.emplace(Arith('+', arg0, arg1));
 					break;
 				case '-':
 					// semantic rule: expr -> expr - expr.
-					m_symbols.emplace(GetValue(arg0) - GetValue(arg1));
+					m_symbols.emplace(Arith('-', arg0, arg1));
 					break;
 			}
 			break;
@@ -721,21 +982,16 @@ void ExprParser<T>::after_mul(int op)
 			{
 				case '*':
 					// semantic rule: expr -> expr * expr.
-					m_symbols.emplace(GetValue(arg0) * GetValue(arg1));
+					m_symbols.emplace(Arith('*', arg0, arg1));
 					break;
 				case '/':
 					// semantic rule: expr -> expr / expr.
-					m_symbols.emplace(GetValue(arg0) / GetValue(arg1));
+					m_symbols.emplace(Arith('/', arg0, arg1));
 					break;
 				case '%':
 					// semantic rule: expr -> expr % expr.
-					if constexpr(std::is_floating_point_v<t_val>)
-						m_symbols.emplace((t_val)std::fmod(GetValue(arg0), GetValue(arg1)));
-					else if constexpr(std::is_integral_v<t_val>)
-						m_symbols.emplace((t_val)(GetValue(arg0) % GetValue(arg1)));
-					else
-						throw std::invalid_argument("Invalid number type.");
-				break;
+					m_symbols.emplace(Arith('%', arg0, arg1));
+					break;
 			}
 			break;
 		}
@@ -826,7 +1082,7 @@ void ExprParser<T>::after_pow()
 			m_symbols.pop();
 
 			// semantic rule: expr -> expr ^ expr.
-			m_symbols.emplace((t_val)std::pow(GetValue(arg0), GetValue(arg1)));
+			m_symbols.emplace(Arith('^', arg0, arg1));
 			break;
 		}
 		default:
@@ -965,7 +1221,7 @@ void ExprParser<T>::after_ident()
 			m_symbols.pop();
 
 			// semantic rule: expr -> ident.
-			m_symbols.emplace(GetValue(arg));
+			m_symbols.emplace(Terminal(arg));
 			break;
 		}
 		default:
@@ -1407,7 +1663,7 @@ void ExprParser<T>::after_scalar()
 			m_symbols.pop();
 
 			// semantic rule: expr -> scalar.
-			m_symbols.emplace(GetValue(arg));
+			m_symbols.emplace(Terminal(arg));
 			break;
 		}
 		default:
@@ -1546,7 +1802,7 @@ void ExprParser<T>::after_uadd(int op)
 					break;
 				case '-':
 					// semantic rule: expr -> - expr.
-					m_symbols.emplace(-GetValue(arg));
+					m_symbols.emplace(Negate(arg));
 					break;
 			}
 			break;
@@ -1563,8 +1819,231 @@ void ExprParser<T>::after_uadd(int op)
 }
 
 
+// --------------------------------------------------------------------------------
+// compiled expressions
+// --------------------------------------------------------------------------------
+template<class T>
+void ExprProgram<T>::Clear(std::size_t num_inputs)
+{
+	m_instrs.clear();
+	m_consts.clear();
+	m_funcs0.clear();
+	m_funcs1.clear();
+	m_funcs2.clear();
+
+	m_num_inputs = num_inputs;
+	m_num_locals = 0;
+	m_depth = m_max_depth = 0;
+}
+
+
+/**
+ * track the stack depth needed for the evaluation
+ */
+template<class T>
+void ExprProgram<T>::Push(int delta)
+{
+	m_depth += delta;
+	m_max_depth = std::max(m_max_depth, m_depth);
+
+	if(m_max_depth > MAX_STACK)
+		throw std::runtime_error("Expression is too deeply nested.");
+}
+
+
+template<class T>
+void ExprProgram<T>::EmitConst(t_val val)
+{
+	m_instrs.emplace_back(Instr{OpCode::CONST, (std::uint32_t)m_consts.size()});
+	m_consts.push_back(val);
+	Push(1);
+}
+
+
+template<class T>
+void ExprProgram<T>::EmitVar(OpCode op, std::size_t idx)
+{
+	m_instrs.emplace_back(Instr{op, (std::uint32_t)idx});
+	Push(op == OpCode::STORE ? 0 : 1);
+}
+
+
+template<class T>
+void ExprProgram<T>::EmitOp(OpCode op)
+{
+	m_instrs.emplace_back(Instr{op, 0});
+	Push(op == OpCode::NEG ? 0 : -1);
+	FoldConstants();
+}
+
+
+template<class T>
+void ExprProgram<T>::EmitCall(t_func0 func)
+{
+	// not folded, as the only 0-args function is rand()
+	m_instrs.emplace_back(Instr{OpCode::CALL0, (std::uint32_t)m_funcs0.size()});
+	m_funcs0.push_back(func);
+	Push(1);
+}
+
+
+template<class T>
+void ExprProgram<T>::EmitCall(t_func1 func)
+{
+	m_instrs.emplace_back(Instr{OpCode::CALL1, (std::uint32_t)m_funcs1.size()});
+	m_funcs1.push_back(func);
+	Push(0);
+	FoldConstants();
+}
+
+
+template<class T>
+void ExprProgram<T>::EmitCall(t_func2 func)
+{
+	// not folded, as rand(min, max) also has two arguments
+	m_instrs.emplace_back(Instr{OpCode::CALL2, (std::uint32_t)m_funcs2.size()});
+	m_funcs2.push_back(func);
+	Push(-1);
+}
+
+
+template<class T>
+std::size_t ExprProgram<T>::AddLocal()
+{
+	if(m_num_locals >= MAX_LOCALS)
+		throw std::runtime_error("Too many variables in expression.");
+
+	return m_num_locals++;
+}
+
+
+/**
+ * replace the last operation by its result if all its arguments are constants
+ */
+template<class T>
+bool ExprProgram<T>::FoldConstants()
+{
+	const std::size_t num_instrs = m_instrs.size();
+	const Instr instr = m_instrs[num_instrs - 1];
+	const bool unary = (instr.op == OpCode::NEG || instr.op == OpCode::CALL1);
+	const std::size_t num_args = unary ? 1 : 2;
+
+	if(num_instrs < num_args + 1)
+		return false;
+	for(std::size_t idx = num_instrs - 1 - num_args; idx < num_instrs - 1; ++idx)
+	{
+		if(m_instrs[idx].op != OpCode::CONST)
+			return false;
+	}
+
+	// the arguments are the most recently added constants
+	const t_val x = m_consts[m_instrs[num_instrs - 1 - num_args].idx];
+	const t_val y = unary ? t_val{} : m_consts[m_instrs[num_instrs - 2].idx];
+
+	t_val result{};
+	if(instr.op == OpCode::NEG)
+	{
+		result = -x;
+	}
+	else if(instr.op == OpCode::CALL1)
+	{
+		result = (*m_funcs1[instr.idx])(x);
+		m_funcs1.pop_back();
+	}
+	else
+	{
+		// leave integer divisions by zero to the evaluation
+		if constexpr(std::is_integral_v<t_val>)
+		{
+			if((instr.op == OpCode::DIV || instr.op == OpCode::MOD) && y == t_val{})
+				return false;
+		}
+
+		result = Binary(instr.op, x, y);
+	}
+
+	m_instrs.resize(num_instrs - 1 - num_args);
+	m_consts.resize(m_consts.size() - num_args);
+
+	m_instrs.emplace_back(Instr{OpCode::CONST, (std::uint32_t)m_consts.size()});
+	m_consts.push_back(result);
+	return true;
+}
+
+
+template<class T>
+typename ExprProgram<T>::t_val ExprProgram<T>::Binary(OpCode op, t_val x, t_val y)
+{
+	switch(op)
+	{
+		case OpCode::ADD: return x + y;
+		case OpCode::SUB: return x - y;
+		case OpCode::MUL: return x * y;
+		case OpCode::DIV: return x / y;
+		case OpCode::MOD: return expr_mod(x, y);
+		case OpCode::POW: return (t_val)std::pow(x, y);
+		default: break;
+	}
+
+	throw std::invalid_argument("Invalid binary operation.");
+}
+
+
+/**
+ * run the program on a single set of inputs without allocating memory
+ */
+template<class T>
+typename ExprProgram<T>::t_val ExprProgram<T>::Evaluate(const t_val* vars) const
+{
+	t_val stack[MAX_STACK];
+	t_val locals[MAX_LOCALS]{};
+	std::size_t sp = 0;
+
+	for(const Instr& instr : m_instrs)
+	{
+		switch(instr.op)
+		{
+			case OpCode::CONST: stack[sp++] = m_consts[instr.idx]; break;
+			case OpCode::INPUT: stack[sp++] = vars[instr.idx]; break;
+			case OpCode::LOCAL: stack[sp++] = locals[instr.idx]; break;
+			case OpCode::STORE: locals[instr.idx] = stack[sp - 1]; break;
+
+			case OpCode::NEG: stack[sp - 1] = -stack[sp - 1]; break;
+			case OpCode::CALL0: stack[sp++] = (*m_funcs0[instr.idx])(); break;
+			case OpCode::CALL1: stack[sp - 1] = (*m_funcs1[instr.idx])(stack[sp - 1]); break;
+			case OpCode::CALL2:
+				--sp;
+				stack[sp - 1] = (*m_funcs2[instr.idx])(stack[sp - 1], stack[sp]);
+				break;
+
+			default:
+				--sp;
+				stack[sp - 1] = Binary(instr.op, stack[sp - 1], stack[sp]);
+				break;
+		}
+	}
+
+	return sp ? stack[sp - 1] : t_val{};
+}
+
+
+/**
+ * run several programs on the same inputs in one pass, e.g. all components of the animations
+ */
+template<class T>
+void ExprProgram<T>::EvaluateBatch(const ExprProgram<T>* progs, std::size_t num_progs,
+	const t_val* vars, t_val* out)
+{
+	for(std::size_t idx = 0; idx < num_progs; ++idx)
+		out[idx] = progs[idx].Evaluate(vars);
+}
+// --------------------------------------------------------------------------------
+
+
 // --------------------------------------------------------------------------------
 // explicit instantiations
+template class ExprProgram<double>;
+template class ExprProgram<int>;
 template class ExprParser<double>;
 template class ExprParser<int>;
 // --------------------------------------------------------------------------------
@@ -19,6 +19,92 @@
 #include <variant>
 #include <unordered_map>
 #include <string>
+#include <string_view>
+#include <cstdint>
+
+
+/**
+ * expression compiled to postfix bytecode with the variables resolved to slots
+ */
+template<class T = double>
+class ExprProgram
+{
+public:
+	using t_val = T;
+	using t_func0 = t_val(*)();
+	using t_func1 = t_val(*)(t_val);
+	using t_func2 = t_val(*)(t_val, t_val);
+
+	// limits of the fixed-size evaluation stack and the local variables
+	static constexpr std::size_t MAX_STACK = 32;
+	static constexpr std::size_t MAX_LOCALS = 16;
+
+	enum class OpCode : std::uint8_t
+	{
+		CONST,      // push constant
+		INPUT,      // push input variable
+		LOCAL,      // push local variable
+		STORE,      // assign the top of the stack to a local variable
+
+		NEG, ADD, SUB, MUL, DIV, MOD, POW,
+		CALL0, CALL1, CALL2,
+	};
+
+	struct Instr
+	{
+		OpCode op{OpCode::CONST};
+		std::uint32_t idx{0};   // index of the constant, variable or function
+	};
+
+
+public:
+	// evaluate with the input variables in the order given to the compiler
+	t_val Evaluate(const t_val* vars = nullptr) const;
+
+	// evaluate num_progs programs on the same inputs, out[i] being the result of program i
+	static void EvaluateBatch(const ExprProgram<T>* progs, std::size_t num_progs,
+		const t_val* vars, t_val* out);
+
+	bool IsValid() const { return !m_instrs.empty(); }
+	bool IsConstant() const { return m_instrs.size() == 1 && m_instrs[0].op == OpCode::CONST; }
+
+	std::size_t GetNumInputs() const { return m_num_inputs; }
+	const std::vector<Instr>& GetInstructions() const { return m_instrs; }
+
+	// --------------------------------------------------------------------
+	// used by the compiler
+	// --------------------------------------------------------------------
+	void Clear(std::size_t num_inputs);
+	void EmitConst(t_val val);
+	void EmitVar(OpCode op, std::size_t idx);
+	void EmitOp(OpCode op);
+	void EmitCall(t_func0 func);
+	void EmitCall(t_func1 func);
+	void EmitCall(t_func2 func);
+	std::size_t AddLocal();
+
+	static t_val Binary(OpCode op, t_val x, t_val y);
+	// --------------------------------------------------------------------
+
+
+protected:
+	void Push(int delta);
+	bool FoldConstants();
+
+
+private:
+	std::vector<Instr> m_instrs{};
+	std::vector<t_val> m_consts{};
+	std::vector<t_func0> m_funcs0{};
+	std::vector<t_func1> m_funcs1{};
+	std::vector<t_func2> m_funcs2{};
+
+	std::size_t m_num_inputs{0};
+	std::size_t m_num_locals{0};
+
+	std::size_t m_depth{0}, m_max_depth{0};
+};
+
 
 
 template<class T = double>
@@ -28,6 +114,11 @@ public:
 	using t_val = T;
 	using t_sym = std::variant<t_val, std::string>;
 
+	using t_symbols = std::unordered_map<std::string, t_val>;
+	using t_funcs0 = std::unordered_map<std::string, t_val(*)()>;
+	using t_funcs1 = std::unordered_map<std::string, t_val(*)(t_val)>;
+	using t_funcs2 = std::unordered_map<std::string, t_val(*)(t_val, t_val)>;
+
 	struct Token
 	{
 		enum : int
@@ -52,6 +143,13 @@ public:
 	ExprParser& operator=(const ExprParser<T>&);
 
 	t_val Parse(const std::string& expr);
+	static bool ParseLiteral(std::string_view str, t_val& val);
+
+	// translate the expression once for repeated evaluation with the given input variables
+	ExprProgram<T> Compile(const std::string& expr, const std::vector<std::string>& vars = {});
+
+	// forget assigned variables, e.g. when re-using the parser
+	void ResetSymbols();
 
 
 protected:
@@ -71,6 +169,9 @@ protected:
 	t_val GetValue(const t_sym& sym) const;
 	t_val GetIdentValue(const std::string& ident) const;
 	t_sym AssignVar(const std::string& ident, const t_sym& arg);
+	t_sym Terminal(const t_sym& sym);
+	t_sym Arith(int op, const t_sym& arg0, const t_sym& arg1);
+	t_sym Negate(const t_sym& arg);
 	t_sym CallFunc(const std::string& ident) const;
 	t_sym CallFunc(const std::string& ident, const t_sym& arg) const;
 	t_sym CallFunc(const std::string& ident, const t_sym& arg1, const t_sym& arg2) const;
@@ -114,6 +215,13 @@ protected:
 	// --------------------------------------------------------------------
 
 	void TransitionError(const char* func, int token);
+	bool RunParser(const std::string& expr);
+
+	// tables shared by all instances
+	static const t_symbols& GetDefaultSymbols();
+	static const t_funcs0& GetFuncs0();
+	static const t_funcs1& GetFuncs1();
+	static const t_funcs2& GetFuncs2();
 
 
 private:
@@ -129,17 +237,16 @@ private:
 	// --------------------------------------------------------------------
 	// Tables
 	// --------------------------------------------------------------------
-	// symbol table
-	std::unordered_map<std::string, t_val> m_mapSymbols{};
-
-	// zero-args function table
-	std::unordered_map<std::string, t_val(*)()> m_mapFuncs0{};
-
-	// one-arg function table
-	std::unordered_map<std::string, t_val(*)(t_val)> m_mapFuncs1{};
+	// symbol table, the function tables are static
+	t_symbols m_mapSymbols{};
+	bool m_symbolsModified{false};
+	// ----------------------------------------------------------------------------
 
-	// two-args function table
-	std::unordered_map<std::string, t_val(*)(t_val, t_val)> m_mapFuncs2{};
+	// ----------------------------------------------------------------------------
+	// compiler state, the semantic rules emit code instead of evaluating if set
+	// ----------------------------------------------------------------------------
+	ExprProgram<T>* m_program{nullptr};
+	std::unordered_map<std::string, std::pair<typename ExprProgram<T>::OpCode, std::size_t>> m_slots{};
 	// ----------------------------------------------------------------------------
 };
 
@@ -0,0 +1,94 @@
+/**
+ * memory pools for the scene objects
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * References:
+ *   - https://en.cppreference.com/w/cpp/memory/synchronized_pool_resource
+ *   - https://en.cppreference.com/w/cpp/memory/shared_ptr/allocate_shared
+ */
+
+#ifndef __GLSCENE_POOL_H__
+#define __GLSCENE_POOL_H__
+
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <cstddef>
+
+
+// pooled objects can be released from any thread, e.g. from the renderer or with a snapshot
+using t_pool = std::pmr::synchronized_pool_resource;
+
+
+/**
+ * allocator sharing the ownership of its pool,
+ * so that the pooled objects can outlive the pool's owner
+ */
+template<class T>
+class PoolAllocator
+{
+public:
+	using value_type = T;
+
+
+public:
+	PoolAllocator(const std::shared_ptr<t_pool>& pool) noexcept : m_pool{pool}
+	{}
+
+	template<class U>
+	PoolAllocator(const PoolAllocator<U>& alloc) noexcept : m_pool{alloc.GetPool()}
+	{}
+
+
+	T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(m_pool->allocate(n * sizeof(T), alignof(T)));
+	}
+
+
+	void deallocate(T* ptr, std::size_t n) noexcept
+	{
+		m_pool->deallocate(ptr, n * sizeof(T), alignof(T));
+	}
+
+
+	const std::shared_ptr<t_pool>& GetPool() const noexcept { return m_pool; }
+
+	template<class U>
+	bool operator==(const PoolAllocator<U>& alloc) const noexcept { return m_pool == alloc.GetPool(); }
+
+	template<class U>
+	bool operator!=(const PoolAllocator<U>& alloc) const noexcept { return m_pool != alloc.GetPool(); }
+
+
+private:
+	std::shared_ptr<t_pool> m_pool{};
+};
+
+
+/**
+ * create a new pool, its memory is released in bulk when its last object is gone
+ */
+static inline std::shared_ptr<t_pool> create_pool()
+{
+	return std::make_shared<t_pool>();
+}
+
+
+/**
+ * create an object and its reference count in one allocation from the pool,
+ * or on the heap without a pool
+ */
+template<class T, class... t_args>
+std::shared_ptr<T> make_pooled(const std::shared_ptr<t_pool>& pool, t_args&&... args)
+{
+	if(!pool)
+		return std::make_shared<T>(std::forward<t_args>(args)...);
+
+	return std::allocate_shared<T>(PoolAllocator<T>{pool}, std::forward<t_args>(args)...);
+}
+
+
+#endif
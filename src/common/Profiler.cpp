@@ -0,0 +1,243 @@
+/**
+ * frame profiler
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ */
+
+#include "Profiler.h"
+
+#include <fstream>
+#include <algorithm>
+#include <iterator>
+#include <cctype>
+
+
+Profiler& Profiler::GetInstance()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+
+/**
+ * set the number of frames kept in the rolling window
+ */
+void Profiler::SetNumFrames(std::size_t num)
+{
+	std::lock_guard<std::mutex> _lock{m_mtx};
+
+	m_num_frames = std::max<std::size_t>(num, 1);
+	while(m_frames.size() > m_num_frames)
+		m_frames.pop_front();
+}
+
+
+void Profiler::AddTime(const std::string& section, double ms)
+{
+	AddSample(section, ms, true);
+}
+
+
+void Profiler::AddCount(const std::string& section, double count)
+{
+	AddSample(section, count, false);
+}
+
+
+/**
+ * add a value to the section's sum for the current frame
+ */
+void Profiler::AddSample(const std::string& section, double val, bool is_time)
+{
+	if(!m_enabled)
+		return;
+
+	std::lock_guard<std::mutex> _lock{m_mtx};
+
+	std::size_t idx = 0;
+	if(auto iter = m_indices.find(section); iter != m_indices.end())
+	{
+		idx = iter->second;
+	}
+	else
+	{
+		// new section
+		idx = m_names.size();
+		m_names.push_back(section);
+		m_is_time.push_back(is_time);
+		m_indices.emplace(section, idx);
+	}
+
+	if(m_cur.size() <= idx)
+		m_cur.resize(idx + 1, 0.);
+	m_cur[idx] += val;
+}
+
+
+/**
+ * move the values of the current frame into the rolling window
+ */
+void Profiler::EndFrame()
+{
+	if(!m_enabled)
+		return;
+
+	std::lock_guard<std::mutex> _lock{m_mtx};
+
+	// re-use the oldest frame's memory
+	Frame frame;
+	if(m_frames.size() >= m_num_frames)
+	{
+		frame = std::move(m_frames.front());
+		m_frames.pop_front();
+	}
+
+	std::chrono::duration<double, std::milli> time = t_clock::now() - m_start;
+	frame.frame = m_frame++;
+	frame.time = time.count();
+	frame.vals.assign(m_cur.begin(), m_cur.end());
+	frame.vals.resize(m_names.size(), 0.);
+	m_frames.emplace_back(std::move(frame));
+
+	std::fill(m_cur.begin(), m_cur.end(), 0.);
+}
+
+
+/**
+ * get the last, mean, and maximum values of the sections
+ */
+std::vector<ProfilerStats> Profiler::GetStats() const
+{
+	std::lock_guard<std::mutex> _lock{m_mtx};
+
+	std::vector<ProfilerStats> stats;
+	stats.reserve(m_names.size());
+
+	for(std::size_t idx=0; idx<m_names.size(); ++idx)
+	{
+		ProfilerStats stat
+		{
+			.name = m_names[idx],
+			.is_time = m_is_time[idx],
+		};
+
+		std::size_t num = 0;
+		for(const Frame& frame : m_frames)
+		{
+			if(idx >= frame.vals.size())
+				continue;
+
+			const double val = frame.vals[idx];
+			stat.avg += val;
+			stat.max = std::max(stat.max, val);
+			++num;
+		}
+
+		if(num)
+			stat.avg /= double(num);
+		if(m_frames.size() && idx < m_frames.back().vals.size())
+			stat.last = m_frames.back().vals[idx];
+
+		stats.emplace_back(std::move(stat));
+	}
+
+	return stats;
+}
+
+
+/**
+ * write the recorded frames as comma-separated values
+ */
+bool Profiler::SaveCSV(const std::string& filename) const
+{
+	std::ofstream ofstr{filename};
+	if(!ofstr)
+		return false;
+
+	std::lock_guard<std::mutex> _lock{m_mtx};
+
+	ofstr << "frame,time_ms";
+	for(std::size_t idx=0; idx<m_names.size(); ++idx)
+		ofstr << ",\"" << m_names[idx] << (m_is_time[idx] ? " [ms]" : "") << "\"";
+	ofstr << "\n";
+
+	for(const Frame& frame : m_frames)
+	{
+		ofstr << frame.frame << "," << frame.time;
+		for(std::size_t idx=0; idx<m_names.size(); ++idx)
+		{
+			ofstr << ",";
+			if(idx < frame.vals.size())
+				ofstr << frame.vals[idx];
+		}
+		ofstr << "\n";
+	}
+
+	ofstr.flush();
+	return !!ofstr;
+}
+
+
+/**
+ * write the recorded frames as a json array
+ */
+bool Profiler::SaveJSON(const std::string& filename) const
+{
+	std::ofstream ofstr{filename};
+	if(!ofstr)
+		return false;
+
+	std::lock_guard<std::mutex> _lock{m_mtx};
+
+	ofstr << "{\n\t\"sections\": [";
+	for(std::size_t idx=0; idx<m_names.size(); ++idx)
+	{
+		if(idx > 0)
+			ofstr << ", ";
+		ofstr << "{ \"name\": \"" << m_names[idx] << "\", \"unit\": \""
+			<< (m_is_time[idx] ? "ms" : "count") << "\" }";
+	}
+	ofstr << "],\n";
+
+	ofstr << "\t\"frames\": [\n";
+	for(auto iter = m_frames.begin(); iter != m_frames.end(); ++iter)
+	{
+		const Frame& frame = *iter;
+
+		ofstr << "\t\t{ \"frame\": " << frame.frame
+			<< ", \"time\": " << frame.time << ", \"values\": [";
+		for(std::size_t idx=0; idx<frame.vals.size(); ++idx)
+		{
+			if(idx > 0)
+				ofstr << ", ";
+			ofstr << frame.vals[idx];
+		}
+		ofstr << "] }";
+
+		if(std::next(iter) != m_frames.end())
+			ofstr << ",";
+		ofstr << "\n";
+	}
+	ofstr << "\t]\n}\n";
+
+	ofstr.flush();
+	return !!ofstr;
+}
+
+
+/**
+ * write the recorded frames, the format is chosen by the file extension
+ */
+bool Profiler::Save(const std::string& filename) const
+{
+	std::string ext;
+	if(std::size_t pos = filename.rfind('.'); pos != std::string::npos)
+		ext = filename.substr(pos + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(),
+		[](unsigned char c) -> char { return std::tolower(c); });
+
+	if(ext == "json")
+		return SaveJSON(filename);
+	return SaveCSV(filename);
+}
@@ -0,0 +1,137 @@
+/**
+ * frame profiler
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ */
+
+#ifndef __GLSCENE_PROFILER_H__
+#define __GLSCENE_PROFILER_H__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+/**
+ * statistics of a profiler section over the recorded frames
+ */
+struct ProfilerStats
+{
+	std::string name{};
+	bool is_time{true};     // time in ms or a counter
+
+	double last{0};
+	double avg{0};
+	double max{0};
+};
+
+
+/**
+ * collects cpu and gpu timings and counters per frame
+ * samples can be added from any thread, they are summed up until the end of the frame
+ */
+class Profiler
+{
+public:
+	using t_clock = std::chrono::steady_clock;
+
+
+public:
+	static Profiler& GetInstance();
+
+	Profiler(const Profiler&) = delete;
+	const Profiler& operator=(const Profiler&) = delete;
+
+	void SetEnabled(bool b) { m_enabled = b; }
+	bool IsEnabled() const { return m_enabled; }
+
+	void SetNumFrames(std::size_t num);
+
+	void AddTime(const std::string& section, double ms);
+	void AddCount(const std::string& section, double count);
+	void EndFrame();
+
+	std::vector<ProfilerStats> GetStats() const;
+
+	bool SaveCSV(const std::string& filename) const;
+	bool SaveJSON(const std::string& filename) const;
+	bool Save(const std::string& filename) const;
+
+
+protected:
+	Profiler() = default;
+
+	void AddSample(const std::string& section, double val, bool is_time);
+
+
+private:
+	/**
+	 * recorded section values of a frame
+	 */
+	struct Frame
+	{
+		std::uint64_t frame{0};
+		double time{0};         // time since the first frame in ms
+		std::vector<double> vals{};
+	};
+
+	std::atomic<bool> m_enabled{false};
+
+	mutable std::mutex m_mtx{};
+
+	// section names, indices, and types
+	std::vector<std::string> m_names{};
+	std::vector<bool> m_is_time{};
+	std::unordered_map<std::string, std::size_t> m_indices{};
+
+	// values of the current frame
+	std::vector<double> m_cur{};
+
+	// rolling window of recorded frames
+	std::deque<Frame> m_frames{};
+	std::size_t m_num_frames{240};
+	std::uint64_t m_frame{0};
+	t_clock::time_point m_start{t_clock::now()};
+};
+
+
+/**
+ * measures the cpu time spent in a scope
+ */
+class ProfilerScope
+{
+public:
+	ProfilerScope(const char* section)
+		: m_section{Profiler::GetInstance().IsEnabled() ? section : nullptr}
+	{
+		if(m_section)
+			m_start = Profiler::t_clock::now();
+	}
+
+	~ProfilerScope()
+	{
+		if(!m_section)
+			return;
+
+		std::chrono::duration<double, std::milli> dur = Profiler::t_clock::now() - m_start;
+		Profiler::GetInstance().AddTime(m_section, dur.count());
+	}
+
+	ProfilerScope(const ProfilerScope&) = delete;
+	const ProfilerScope& operator=(const ProfilerScope&) = delete;
+
+
+private:
+	// not measured if disabled
+	const char *m_section{nullptr};
+	Profiler::t_clock::time_point m_start{};
+};
+
+
+#endif
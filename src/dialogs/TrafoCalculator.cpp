@@ -255,6 +255,7 @@ void TrafoCalculator::CalculatePortal()
 	std::string start_name = m_comboPortal1->currentText().toStdString();
 	std::string target_name = m_comboPortal2->currentText().toStdString();
 
+	auto _lock = m_scene->Lock();
 	auto start = m_scene->FindObject(start_name);
 	auto target = m_scene->FindObject(target_name);
 	if(!start || !target)
@@ -267,16 +268,16 @@ void TrafoCalculator::CalculatePortal()
 	{
 		t_mat matStart = m::unit<t_mat>(4);
 		t_mat matTarget = m::unit<t_mat>(4);
-		m::set_col<t_mat, t_vec>(matStart, start->GetPosition(), 3);
-		m::set_col<t_mat, t_vec>(matTarget, -target->GetPosition(), 3);
+		m::set_col<t_mat, t_vec>(matStart, m::convert<t_vec>(start->GetPosition()), 3);
+		m::set_col<t_mat, t_vec>(matTarget, -m::convert<t_vec>(target->GetPosition()), 3);
 
 		t_mat mat = matTarget * matStart;
 		set_result(m_textPortal, mat);
 	}
 	else
 	{
-		const auto& matStart = start->GetTrafo();
-		const auto& matTarget = target->GetTrafo();
+		const t_mat matStart = m::convert<t_mat>(start->GetTrafo());
+		const t_mat matTarget = m::convert<t_mat>(target->GetTrafo());
 
 		auto [mat, mat_ok] = m::inv<t_mat, t_vec>(matTarget);
 		if(!mat_ok)
@@ -38,6 +38,12 @@ SimPropertiesWidget::SimPropertiesWidget(QWidget *parent)
 	m_spinMaxTimeStep->setSuffix(" ms");
 	m_spinMaxTimeStep->setToolTip("Maximum simulation time per step.");
 
+	m_spinThreads = new QSpinBox(this);
+	m_spinThreads->setMinimum(1);
+	m_spinThreads->setMaximum(1);
+	m_spinThreads->setValue(1);
+	m_spinThreads->setToolTip("Number of threads for the physics simulation.");
+
 	auto *grid = new QGridLayout(this);
 	grid->setHorizontalSpacing(2);
 	grid->setVerticalSpacing(2);
@@ -48,6 +54,8 @@ SimPropertiesWidget::SimPropertiesWidget(QWidget *parent)
 	grid->addWidget(m_spinTimeScale, y++, 1, 1, 1);
 	grid->addWidget(new QLabel("Max. Time Step:", this), y, 0, 1, 1);
 	grid->addWidget(m_spinMaxTimeStep, y++, 1, 1, 1);
+	grid->addWidget(new QLabel("Threads:", this), y, 0, 1, 1);
+	grid->addWidget(m_spinThreads, y++, 1, 1, 1);
 	grid->addItem(new QSpacerItem(1, 1,
 		QSizePolicy::Minimum, QSizePolicy::Expanding), y++, 0, 1, 2);
 
@@ -58,6 +66,9 @@ SimPropertiesWidget::SimPropertiesWidget(QWidget *parent)
 	connect(m_spinMaxTimeStep,
 		static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
 		this, &SimPropertiesWidget::MaxTimeStepChanged);
+	connect(m_spinThreads,
+		static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+		this, &SimPropertiesWidget::NumThreadsChanged);
 }
 
 
@@ -82,6 +93,25 @@ void SimPropertiesWidget::SetMaxTimeStep(int dt)
 }
 
 
+void SimPropertiesWidget::SetNumThreads(t_int num)
+{
+	this->blockSignals(true);
+	m_spinThreads->setValue(num);
+	this->blockSignals(false);
+}
+
+
+/**
+ * set the number of threads supported by the simulation
+ */
+void SimPropertiesWidget::SetMaxNumThreads(t_int num)
+{
+	this->blockSignals(true);
+	m_spinThreads->setMaximum(num);
+	this->blockSignals(false);
+}
+
+
 /**
  * save the dock widget's settings
  */
@@ -91,6 +121,7 @@ boost::property_tree::ptree SimPropertiesWidget::Save() const
 
 	prop.put<t_real>("time_scale", m_spinTimeScale->value());
 	prop.put<t_int>("time_step", m_spinMaxTimeStep->value());
+	prop.put<t_int>("threads", m_spinThreads->value());
 
 	return prop;
 }
@@ -104,20 +135,25 @@ bool SimPropertiesWidget::Load(const boost::property_tree::ptree& prop)
 	// old values
 	t_real t = m_spinTimeScale->value();
 	t_int dt = m_spinMaxTimeStep->value();
+	t_int threads = m_spinThreads->value();
 
 	// new values
 	if(auto opt = prop.get_optional<t_real>("time_scale"); opt)
 		t = *opt;
 	if(auto opt = prop.get_optional<t_int>("time_step"); opt)
 		dt = *opt;
+	if(auto opt = prop.get_optional<t_int>("threads"); opt)
+		threads = *opt;
 
 	// set new values
 	SetTimeScale(t);
 	SetMaxTimeStep(dt);
+	SetNumThreads(threads);
 
 	// emit changes
 	emit TimeScaleChanged(t);
 	emit MaxTimeStepChanged(t);
+	emit NumThreadsChanged(m_spinThreads->value());
 
 	return true;
 }
@@ -38,16 +38,20 @@ public:
 public slots:
 	void SetTimeScale(t_real t);
 	void SetMaxTimeStep(t_int dt);
+	void SetNumThreads(t_int num);
+	void SetMaxNumThreads(t_int num);
 
 
 signals:
 	void TimeScaleChanged(t_real t);
 	void MaxTimeStepChanged(t_int dt);
+	void NumThreadsChanged(t_int num);
 
 
 private:
 	QDoubleSpinBox *m_spinTimeScale{nullptr};
 	QSpinBox *m_spinMaxTimeStep{nullptr};
+	QSpinBox *m_spinThreads{nullptr};
 };
 
 
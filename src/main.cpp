@@ -13,7 +13,11 @@
 #include <QtWidgets/QApplication>
 
 #include <optional>
+#include <charconv>
 #include <locale>
+#include <string>
+#include <vector>
+#include <algorithm>
 
 #include <boost/predef.h>
 #include <boost/algorithm/string.hpp>
@@ -32,6 +36,7 @@
 #endif
 
 #include "MainWnd.h"
+#include "Headless.h"
 #include "settings_variables.h"
 
 
@@ -206,6 +211,60 @@ private:
 };
 
 
+/**
+ * get the options of the headless mode:
+ *   glscene --headless --job <job file> [--size <width>x<height>] <scene file>
+ * @return nullopt if the gui is to be started
+ */
+static std::optional<HeadlessOptions> get_headless_options(int argc, char** argv)
+{
+	bool headless = false;
+	HeadlessOptions opts;
+
+	for(int arg = 1; arg < argc; ++arg)
+	{
+		std::string str = argv[arg];
+
+		if(str == "--headless")
+		{
+			headless = true;
+		}
+		else if(str == "--job" && arg+1 < argc)
+		{
+			opts.job_file = argv[++arg];
+		}
+		else if(str == "--size" && arg+1 < argc)
+		{
+			std::string size = argv[++arg];
+			std::vector<std::string> dims;
+			boost::split(dims, size, boost::is_any_of("x"));
+
+			// invalid sizes are reported as usage errors
+			auto parse_dim = [](const std::string& dim) -> int
+			{
+				int val = 0;
+				const char *end = dim.data() + dim.size();
+				if(auto [ptr, err] = std::from_chars(dim.data(), end, val);
+					err != std::errc{} || ptr != end)
+					return 0;
+				return val;
+			};
+
+			opts.width = dims.size() == 2 ? parse_dim(dims[0]) : 0;
+			opts.height = dims.size() == 2 ? parse_dim(dims[1]) : 0;
+		}
+		else
+		{
+			opts.scene_file = str;
+		}
+	}
+
+	if(!headless)
+		return std::nullopt;
+	return opts;
+}
+
+
 /**
  * main entry point
  */
@@ -248,8 +307,25 @@ int main(int argc, char** argv)
 			std::cerr << ": " << log.toStdString() << std::endl;
 		});
 
-		// default gl surface format
-		set_gl_format(true, _GL_MAJ_VER, _GL_MIN_VER, 8);
+		// without a display, render with the offscreen platform plugin unless another one is given
+		std::optional<HeadlessOptions> headless = get_headless_options(argc, argv);
+		if(headless)
+		{
+			if(headless->scene_file == "" || headless->job_file == ""
+				|| headless->width <= 0 || headless->height <= 0)
+			{
+				std::cerr << "Usage: " << argv[0]
+					<< " --headless --job <job file> [--size <width>x<height>] <scene file>"
+					<< std::endl;
+				return -1;
+			}
+
+			if(!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+				qputenv("QT_QPA_PLATFORM", "offscreen");
+		}
+
+		// default gl surface format, the main window's is set after reading the settings
+		set_gl_format(true, _GL_MAJ_VER, _GL_MIN_VER, int(g_msaa_samples));
 		set_locales();
 
 		// create application
@@ -277,6 +353,9 @@ int main(int argc, char** argv)
 		qRegisterMetaType<std::string>("std::string");
 		qRegisterMetaType<std::size_t>("std::size_t");
 
+		if(headless)
+			return run_headless(*headless);
+
 		// create main window
 		auto mainwnd = std::make_shared<MainWnd>(nullptr);
 
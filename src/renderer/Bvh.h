@@ -0,0 +1,446 @@
+/**
+ * bounding volume hierarchy for ray picking
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * References:
+ *   - https://en.wikipedia.org/wiki/Bounding_volume_hierarchy
+ *   - https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
+ */
+
+#ifndef __GL_RENDERER_BVH_H__
+#define __GL_RENDERER_BVH_H__
+
+
+#include <array>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+
+/**
+ * axis-aligned bounding box
+ */
+template<class t_real>
+struct BvhBox
+{
+	using t_arr = std::array<t_real, 3>;
+
+	t_arr min
+	{
+		std::numeric_limits<t_real>::max(),
+		std::numeric_limits<t_real>::max(),
+		std::numeric_limits<t_real>::max()
+	};
+
+	t_arr max
+	{
+		std::numeric_limits<t_real>::lowest(),
+		std::numeric_limits<t_real>::lowest(),
+		std::numeric_limits<t_real>::lowest()
+	};
+
+
+	/**
+	 * enlarge the box to contain a point
+	 */
+	template<class t_vec>
+	void Add(const t_vec& pt)
+	{
+		for(int i=0; i<3; ++i)
+		{
+			min[i] = std::min<t_real>(min[i], pt[i]);
+			max[i] = std::max<t_real>(max[i], pt[i]);
+		}
+	}
+
+
+	/**
+	 * enlarge the box to contain another box
+	 */
+	void Add(const BvhBox<t_real>& box)
+	{
+		for(int i=0; i<3; ++i)
+		{
+			min[i] = std::min(min[i], box.min[i]);
+			max[i] = std::max(max[i], box.max[i]);
+		}
+	}
+
+
+	t_real Centre(int axis) const
+	{
+		return t_real(0.5) * (min[axis] + max[axis]);
+	}
+
+
+	/**
+	 * do the boxes touch or intersect?
+	 */
+	bool Overlaps(const BvhBox<t_real>& box) const
+	{
+		for(int i=0; i<3; ++i)
+		{
+			if(box.max[i] < min[i] || box.min[i] > max[i])
+				return false;
+		}
+
+		return true;
+	}
+
+
+	/**
+	 * ray-box slab test within the parameter range [0, lam_max]
+	 * inv_dir holds the component-wise inverse ray direction,
+	 * lam_entry receives the ray parameter where the box is entered, 0 if the origin is inside
+	 */
+	bool Intersects(const t_arr& org, const t_arr& inv_dir, t_real lam_max,
+		t_real *lam_entry = nullptr) const
+	{
+		t_real lam_min = 0;
+
+		for(int i=0; i<3; ++i)
+		{
+			t_real lam0 = (min[i] - org[i]) * inv_dir[i];
+			t_real lam1 = (max[i] - org[i]) * inv_dir[i];
+			if(lam0 > lam1)
+				std::swap(lam0, lam1);
+
+			lam_min = std::max(lam_min, lam0);
+			lam_max = std::min(lam_max, lam1);
+
+			if(lam_min > lam_max)
+				return false;
+		}
+
+		if(lam_entry)
+			*lam_entry = lam_min;
+		return true;
+	}
+};
+
+
+/**
+ * intersection of a ray with a triangle
+ * @return ray parameter of the intersection or a negative value
+ */
+template<class t_vec, class t_real>
+t_real bvh_intersect_ray_triangle(
+	const std::array<t_real, 3>& org, const std::array<t_real, 3>& dir,
+	const t_vec& v0, const t_vec& v1, const t_vec& v2,
+	t_real eps = std::numeric_limits<t_real>::epsilon())
+{
+	const std::array<t_real, 3> e1{ v1[0]-v0[0], v1[1]-v0[1], v1[2]-v0[2] };
+	const std::array<t_real, 3> e2{ v2[0]-v0[0], v2[1]-v0[1], v2[2]-v0[2] };
+
+	auto cross = [](const std::array<t_real, 3>& a, const std::array<t_real, 3>& b)
+		-> std::array<t_real, 3>
+	{
+		return { a[1]*b[2] - a[2]*b[1], a[2]*b[0] - a[0]*b[2], a[0]*b[1] - a[1]*b[0] };
+	};
+
+	auto dot = [](const std::array<t_real, 3>& a, const std::array<t_real, 3>& b) -> t_real
+	{
+		return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+	};
+
+	const std::array<t_real, 3> p = cross(dir, e2);
+	const t_real det = dot(e1, p);
+	if(std::abs(det) < eps)
+		return -1;
+
+	const t_real inv_det = t_real(1) / det;
+	const std::array<t_real, 3> t{ org[0]-v0[0], org[1]-v0[1], org[2]-v0[2] };
+
+	const t_real u = dot(t, p) * inv_det;
+	if(u < 0 || u > 1)
+		return -1;
+
+	const std::array<t_real, 3> q = cross(t, e1);
+	const t_real v = dot(dir, q) * inv_det;
+	if(v < 0 || u + v > 1)
+		return -1;
+
+	return dot(e2, q) * inv_det;
+}
+
+
+/**
+ * bounding volume hierarchy over a set of items given by their bounding boxes
+ */
+template<class t_real>
+class Bvh
+{
+public:
+	using t_box = BvhBox<t_real>;
+	using t_arr = typename t_box::t_arr;
+	using t_idx = std::uint32_t;
+
+	static constexpr t_idx MAX_LEAF_ITEMS = 4;
+	static constexpr std::size_t MAX_DEPTH = 64;
+
+
+	struct Node
+	{
+		t_box box{};
+
+		// inner node: index of the first child (the second one follows it)
+		// leaf node: index of the first item
+		t_idx first = 0;
+
+		// number of items, 0 for inner nodes
+		t_idx count = 0;
+	};
+
+
+public:
+	Bvh() = default;
+	~Bvh() = default;
+
+	Bvh(const Bvh<t_real>&) = default;
+	Bvh<t_real>& operator=(const Bvh<t_real>&) = default;
+
+
+	void Clear()
+	{
+		m_nodes.clear();
+		m_items.clear();
+	}
+
+
+	bool IsEmpty() const
+	{
+		return m_nodes.size() == 0;
+	}
+
+
+	std::size_t GetNumItems() const
+	{
+		return m_items.size();
+	}
+
+
+	/**
+	 * build the hierarchy using a median split along the longest axis
+	 * get_box(idx) returns the bounding box of item idx
+	 */
+	template<class t_func>
+	void Build(std::size_t num_items, t_func&& get_box)
+	{
+		Clear();
+		if(num_items == 0)
+			return;
+
+		std::vector<t_box> boxes;
+		boxes.reserve(num_items);
+		m_items.reserve(num_items);
+
+		for(std::size_t idx=0; idx<num_items; ++idx)
+		{
+			boxes.emplace_back(get_box(idx));
+			m_items.push_back(t_idx(idx));
+		}
+
+		m_nodes.reserve(2*num_items);
+		m_nodes.emplace_back(Node{});
+		BuildNode(0, 0, t_idx(num_items), boxes, 0);
+	}
+
+
+	/**
+	 * update the node bounds for moved items, keeping the tree topology
+	 */
+	template<class t_func>
+	void Refit(t_func&& get_box)
+	{
+		// children are always stored after their parents
+		for(std::size_t nodeidx = m_nodes.size(); nodeidx > 0; --nodeidx)
+		{
+			Node& node = m_nodes[nodeidx - 1];
+			node.box = t_box{};
+
+			if(node.count)
+			{
+				for(t_idx i=0; i<node.count; ++i)
+					node.box.Add(get_box(m_items[node.first + i]));
+			}
+			else
+			{
+				node.box.Add(m_nodes[node.first].box);
+				node.box.Add(m_nodes[node.first + 1].box);
+			}
+		}
+	}
+
+
+	/**
+	 * traverse the hierarchy along a ray, without allocations
+	 * test_item(idx, lam_max) checks an item and returns its ray parameter or a negative value
+	 * @return true if an item has been hit, its index is written to closest
+	 */
+	template<class t_func>
+	bool Intersect(const t_arr& org, const t_arr& dir,
+		t_real& lam_max, t_idx& closest, t_func&& test_item) const
+	{
+		if(IsEmpty())
+			return false;
+
+		t_arr inv_dir{};
+		for(int i=0; i<3; ++i)
+		{
+			inv_dir[i] = (dir[i] != t_real(0))
+				? t_real(1) / dir[i]
+				: std::numeric_limits<t_real>::max();
+		}
+
+		std::array<t_idx, MAX_DEPTH> stack{};
+		std::size_t stack_size = 0;
+		stack[stack_size++] = 0;
+
+		bool hit = false;
+		while(stack_size)
+		{
+			const Node& node = m_nodes[stack[--stack_size]];
+			if(!node.box.Intersects(org, inv_dir, lam_max))
+				continue;
+
+			if(node.count)
+			{
+				// leaf
+				for(t_idx i=0; i<node.count; ++i)
+				{
+					t_idx item = m_items[node.first + i];
+					if(t_real lam = test_item(item, lam_max); lam >= 0 && lam < lam_max)
+					{
+						lam_max = lam;
+						closest = item;
+						hit = true;
+					}
+				}
+			}
+			else if(stack_size + 2 <= stack.size())
+			{
+				// visit the child nearer to the ray origin first
+				t_idx near = node.first, far = node.first + 1;
+				if(Distance(m_nodes[far].box, org) < Distance(m_nodes[near].box, org))
+					std::swap(near, far);
+
+				stack[stack_size++] = far;
+				stack[stack_size++] = near;
+			}
+		}
+
+		return hit;
+	}
+
+
+	/**
+	 * find all items whose nodes overlap a box, without allocations
+	 * found(idx) is called for each item in an overlapping leaf and checks its own box
+	 */
+	template<class t_func>
+	void Query(const t_box& box, t_func&& found) const
+	{
+		if(IsEmpty())
+			return;
+
+		std::array<t_idx, MAX_DEPTH> stack{};
+		std::size_t stack_size = 0;
+		stack[stack_size++] = 0;
+
+		while(stack_size)
+		{
+			const Node& node = m_nodes[stack[--stack_size]];
+			if(!node.box.Overlaps(box))
+				continue;
+
+			if(node.count)
+			{
+				for(t_idx i=0; i<node.count; ++i)
+					found(m_items[node.first + i]);
+			}
+			else if(stack_size + 2 <= stack.size())
+			{
+				stack[stack_size++] = node.first + 1;
+				stack[stack_size++] = node.first;
+			}
+		}
+	}
+
+
+protected:
+	/**
+	 * recursively split the item range [begin, end)
+	 */
+	void BuildNode(std::size_t nodeidx, t_idx begin, t_idx end,
+		const std::vector<t_box>& boxes, std::size_t depth)
+	{
+		t_box box{}, centres{};
+		for(t_idx i=begin; i<end; ++i)
+		{
+			const t_box& itembox = boxes[m_items[i]];
+			box.Add(itembox);
+			centres.Add(t_arr{ itembox.Centre(0), itembox.Centre(1), itembox.Centre(2) });
+		}
+		m_nodes[nodeidx].box = box;
+
+		// leaf node
+		if(end - begin <= MAX_LEAF_ITEMS || depth + 1 >= MAX_DEPTH/2)
+		{
+			m_nodes[nodeidx].first = begin;
+			m_nodes[nodeidx].count = end - begin;
+			return;
+		}
+
+		// split along the longest axis of the item centres
+		int axis = 0;
+		for(int i=1; i<3; ++i)
+		{
+			if(centres.max[i] - centres.min[i] > centres.max[axis] - centres.min[axis])
+				axis = i;
+		}
+
+		t_idx mid = begin + (end - begin) / 2;
+		std::nth_element(m_items.begin() + begin, m_items.begin() + mid, m_items.begin() + end,
+			[&boxes, axis](t_idx idx1, t_idx idx2) -> bool
+		{
+			return boxes[idx1].Centre(axis) < boxes[idx2].Centre(axis);
+		});
+
+		// inner node
+		t_idx child = t_idx(m_nodes.size());
+		m_nodes[nodeidx].first = child;
+		m_nodes[nodeidx].count = 0;
+		m_nodes.emplace_back(Node{});
+		m_nodes.emplace_back(Node{});
+
+		BuildNode(child, begin, mid, boxes, depth + 1);
+		BuildNode(child + 1, mid, end, boxes, depth + 1);
+	}
+
+
+	/**
+	 * squared distance of a point to a box
+	 */
+	static t_real Distance(const t_box& box, const t_arr& pt)
+	{
+		t_real dist = 0;
+		for(int i=0; i<3; ++i)
+		{
+			t_real d = std::max({ box.min[i] - pt[i], t_real(0), pt[i] - box.max[i] });
+			dist += d*d;
+		}
+		return dist;
+	}
+
+
+private:
+	std::vector<Node> m_nodes{};
+	std::vector<t_idx> m_items{};
+};
+
+
+#endif
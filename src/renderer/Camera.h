@@ -23,6 +23,8 @@
 #include <array>
 #include <unordered_set>
 #include <algorithm>
+#include <limits>
+#include <cmath>
 
 #include "mathlibs/libs/matrix_algos.h"
 
@@ -31,6 +33,12 @@ template<class t_mat, class t_vec, class t_vec3, class t_real>
 requires m::is_mat<t_mat> && m::is_vec<t_vec> && m::is_vec<t_vec3>
 class Camera
 {
+public:
+	// screen-space rectangle in normalised device coordinates: x_min, x_max, y_min, y_max
+	using t_rect = std::array<t_real, 4>;
+	static constexpr t_rect s_ndc_rect{ -1, 1, -1, 1 };
+
+
 public:
 	Camera() = default;
 
@@ -377,6 +385,30 @@ public:
 	}
 
 
+	/**
+	 * get the radius in pixels of a sphere projected onto the screen
+	 */
+	t_real GetProjectedRadius(const t_vec& pos, t_real rad) const
+	{
+		t_real scale = std::abs(m_matPerspective(1, 1)) * t_real(m_screenDims[1]) * t_real(0.5);
+
+		if(m_persp_proj)
+		{
+			// distance along the viewing direction
+			const t_vec pos_cam = m_mat * pos;
+			const t_real depth = -pos_cam[2];
+
+			// at least partially behind the camera
+			if(depth <= rad)
+				return std::numeric_limits<t_real>::max();
+
+			scale /= depth;
+		}
+
+		return rad * scale;
+	}
+
+
 	/**
 	 * is the transformation matrix outdated?
 	 */
@@ -472,44 +504,86 @@ public:
 
 
 	/**
-	 * test if bounding box is outside frustum
+	 * get the frustum sides (as in GetFrustumSides) of a vector
+	 * that has already been projected, encoded as bits,
+	 * the sides are optionally narrowed to a screen-space rectangle
+	 */
+	static unsigned int GetFrustumSideBits(t_vec vec_trafo, const t_rect& rect = s_ndc_rect)
+	{
+		vec_trafo /= vec_trafo[3];
+
+		unsigned int sides = 0;
+		for(int i=0; i<3; ++i)
+		{
+			const t_real lower = i < 2 ? rect[2*i] : t_real(-1.);
+			const t_real upper = i < 2 ? rect[2*i + 1] : t_real(1.);
+
+			if(vec_trafo[i] < lower)
+				sides |= (1u << (2*i));
+			else if(vec_trafo[i] > upper)
+				sides |= (1u << (2*i + 1));
+		}
+
+		return sides;
+	}
+
+
+	/**
+	 * test if bounding box is outside frustum,
+	 * or outside the part of it that is given by a screen-space rectangle
 	 */
 	bool IsBoundingBoxOutsideFrustum(const t_mat& matObj,
-		const std::vector<t_vec>& bbox) const
+		const std::vector<t_vec>& bbox, const t_rect& rect = s_ndc_rect) const
 	{
-		bool first_vec = true;
-		std::unordered_set<int> set_inters;
+		if(bbox.size() == 0)
+			return false;
 
-		for(const t_vec& _vec : bbox)
+		// combined object, camera and projection transformation
+		const t_mat mat = m_matPerspective * m_mat * matObj;
+
+		// sides that all vertices are outside of
+		unsigned int common_sides = ~0u;
+
+		for(const t_vec& vec : bbox)
 		{
-			t_vec vec = matObj * _vec;
-			std::unordered_set<int> sides = GetFrustumSides(vec);
+			unsigned int sides = GetFrustumSideBits(mat * vec, rect);
 
 			// inside the frustum?
-			if(sides.size() == 0)
+			if(sides == 0)
 				return false;
 
-			if(first_vec)
-			{
-				set_inters = sides;
-				first_vec = false;
-			}
-			else
-			{
-				std::unordered_set<int> new_inters;
-				std::set_intersection(
-					sides.begin(), sides.end(),
-					set_inters.begin(), set_inters.end(),
-					std::inserter(new_inters, new_inters.begin()));
-				set_inters = std::move(new_inters);
-
-				if(set_inters.size() == 0)
-					return false;
-			}
+			common_sides &= sides;
+			if(common_sides == 0)
+				return false;
 		}
 
 		// all outside the same frustum plane?
-		return set_inters.size() != 0;
+		return common_sides != 0;
+	}
+
+
+	/**
+	 * get the frustum planes in the coordinate system that matObj transforms from,
+	 * optionally narrowed to a screen-space rectangle,
+	 * points x with n*x + d >= 0 are on the inner side of a plane
+	 */
+	std::array<std::array<t_real, 4>, 6> GetFrustumPlanes(const t_mat& matObj,
+		const t_rect& rect = s_ndc_rect) const
+	{
+		const t_mat mat = m_matPerspective * m_mat * matObj;
+
+		std::array<std::array<t_real, 4>, 6> planes{};
+		for(int col=0; col<4; ++col)
+		{
+			planes[0][col] = mat(0, col) - rect[0]*mat(3, col);  // left
+			planes[1][col] = rect[1]*mat(3, col) - mat(0, col);  // right
+			planes[2][col] = mat(1, col) - rect[2]*mat(3, col);  // bottom
+			planes[3][col] = rect[3]*mat(3, col) - mat(1, col);  // top
+			planes[4][col] = mat(2, col) + mat(3, col);          // near
+			planes[5][col] = mat(3, col) - mat(2, col);          // far
+		}
+
+		return planes;
 	}
 
 
@@ -543,6 +617,42 @@ public:
 	}
 
 
+	/**
+	 * get the screen-space rectangle covered by an object's bounding box,
+	 * the full screen is returned if the box reaches behind the camera
+	 */
+	t_rect GetProjectedRect(const t_mat& matObj, const std::vector<t_vec>& bbox) const
+	{
+		const t_mat mat = m_matPerspective * m_mat * matObj;
+
+		t_rect rect{
+			std::numeric_limits<t_real>::max(), std::numeric_limits<t_real>::lowest(),
+			std::numeric_limits<t_real>::max(), std::numeric_limits<t_real>::lowest() };
+
+		for(const t_vec& _vec : bbox)
+		{
+			const t_vec vec = mat * _vec;
+			if(vec[3] <= std::numeric_limits<t_real>::epsilon())
+				return s_ndc_rect;
+
+			for(int i=0; i<2; ++i)
+			{
+				rect[2*i] = std::min(rect[2*i], vec[i] / vec[3]);
+				rect[2*i + 1] = std::max(rect[2*i + 1], vec[i] / vec[3]);
+			}
+		}
+
+		// clip to the screen
+		for(int i=0; i<2; ++i)
+		{
+			rect[2*i] = std::max(rect[2*i], t_real(-1.));
+			rect[2*i + 1] = std::min(rect[2*i + 1], t_real(1.));
+		}
+
+		return rect;
+	}
+
+
 	/**
 	 * get a ray from screen coordinates
 	 */
@@ -19,6 +19,7 @@
 
 #include <QtCore/QtGlobal>
 #include <QtCore/QThread>
+#include <QtCore/QFileInfo>
 #include <QtGui/QPainter>
 #include <QtGui/QGuiApplication>
 #include <QtGui/QOpenGLContext>
@@ -30,6 +31,14 @@
 #endif
 
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <array>
+#include <map>
+#include <limits>
+#include <tuple>
+#include <chrono>
 
 #include <boost/scope_exit.hpp>
 #include <boost/preprocessor/stringize.hpp>
@@ -40,14 +49,12 @@
 namespace algo = boost::algorithm;
 
 #include "src/common/Resources.h"
+#include "src/common/Profiler.h"
 #include "src/settings_variables.h"
 
 #include "mathlibs/libs/poly_algos.h"
 
 
-#define MAX_LIGHTS 4  // max. number allowed in shader
-
-
 // ----------------------------------------------------------------------------
 // functions
 // ----------------------------------------------------------------------------
@@ -96,14 +103,14 @@ qgl_funcs* GlSceneRenderer::GetGlFunctions()
 
 	if constexpr(std::is_same_v<qgl_funcs, QOpenGLFunctions>)
 	{
-		pGl = (qgl_funcs*)context()->functions();
+		pGl = (qgl_funcs*)GetContext()->functions();
 	}
 	else
 	{
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-		pGl = QOpenGLVersionFunctionsFactory::get<qgl_funcs>(context());
+		pGl = QOpenGLVersionFunctionsFactory::get<qgl_funcs>(GetContext());
 #else
-		pGl = (qgl_funcs*)context()->versionFunctions<qgl_funcs>();
+		pGl = (qgl_funcs*)GetContext()->versionFunctions<qgl_funcs>();
 #endif
 	}
 
@@ -115,159 +122,202 @@ qgl_funcs* GlSceneRenderer::GetGlFunctions()
 
 
 /**
- * creates a triangle-based 3d object
+ * flattens the vertex data of a triangle-based 3d object,
+ * identical vertices are welded and referenced by an index buffer
+ * this only works on the cpu side and can run in any thread
  */
-bool GlSceneRenderer::CreateTriangleObject(GlRenderObj& obj,
+void GlSceneRenderer::PrepareTriangleData(GlTriangleData& data,
 	const std::vector<t_vec3_gl>& verts, const std::vector<t_vec3_gl>& triagverts,
 	const std::vector<t_vec3_gl>& norms, const std::vector<t_vec3_gl>& uvs,
-	const t_vec_gl& colour, bool bUseVertsAsNorm,
-	GLint attrVertex, GLint attrVertexNormal,
-	GLint attrVertexcolour, GLint attrTextureCoords)
+	bool bUseVertsAsNorm)
 {
-	// TODO: move context to calling thread
-	BOOST_SCOPE_EXIT(this_)
-	{
-		this_->doneCurrent();
-	} BOOST_SCOPE_EXIT_END
-	makeCurrent();
-
-	qgl_funcs* pGl = GetGlFunctions();
-	if(!pGl) return false;
+	// interleaved vertex: position, normal, uv coordinates
+	using t_vert = std::array<t_real_gl, GlTriangleData::VERT_ELEMS>;
+	std::map<t_vert, GLuint> mapVerts;
 
-	obj.m_type = GlRenderObjType::TRIANGLES;
-	obj.m_colour = colour;
+	data.m_interleaved.clear();
+	data.m_indices.clear();
+	data.m_interleaved.reserve(triagverts.size() * GlTriangleData::VERT_ELEMS);
+	data.m_indices.reserve(triagverts.size());
 
-	// flatten vertex array into raw float array
-	auto to_float_array = [](const std::vector<t_vec3_gl>& verts,
-		int iRepeat=1, int iElems=3, bool bNorm=false, t_real_gl lastElem=1.)
-		-> std::vector<t_real_gl>
+	for(std::size_t vertidx=0; vertidx<triagverts.size(); ++vertidx)
 	{
-		std::vector<t_real_gl> vecRet;
-		vecRet.reserve(iRepeat*verts.size()*iElems);
+		const t_vec3_gl& pos = triagverts[vertidx];
 
-		for(const t_vec3_gl& vert : verts)
-		{
-			t_real_gl norm = bNorm ? m::norm<t_vec3_gl>(vert) : 1;
+		t_vert vert{};
+		for(int i=0; i<3; ++i)
+			vert[i] = pos[i];
 
-			for(int i=0; i<iRepeat; ++i)
-			{
-				for(int iElem=0; iElem<iElems; ++iElem)
-				{
-					if(iElem < vert.size())
-						vecRet.push_back(vert[iElem] / norm);
-					else
-						vecRet.push_back(lastElem);
-				}
-			}
+		// the given normals are defined per triangle
+		if(bUseVertsAsNorm)
+		{
+			t_real_gl len = m::norm<t_vec3_gl>(pos);
+			for(int i=0; i<3; ++i)
+				vert[3 + i] = pos[i] / len;
+		}
+		else if(vertidx/3 < norms.size())
+		{
+			const t_vec3_gl& norm = norms[vertidx/3];
+			for(int i=0; i<3; ++i)
+				vert[3 + i] = norm[i];
 		}
 
-		return vecRet;
-	};
+		if(vertidx < uvs.size())
+		{
+			const t_vec3_gl& uv = uvs[vertidx];
+			for(int i=0; i<2; ++i)
+				vert[6 + i] = uv[i];
+		}
 
-	// main vertex array object
-	obj.m_vertex_array = std::make_shared<QOpenGLVertexArrayObject>();
-	obj.m_vertex_array->create();
-	obj.m_vertex_array->bind();
+		// weld the vertex if it has already been seen
+		auto [iter, inserted] = mapVerts.emplace(
+			std::make_pair(vert, GLuint(mapVerts.size())));
+		if(inserted)
+			data.m_interleaved.insert(data.m_interleaved.end(), vert.begin(), vert.end());
+		data.m_indices.push_back(iter->second);
+	}
 
-	// vertices
-	if(attrVertex >= 0)
+	// triangle hierarchy for picking
+	data.m_bvh.Build(triagverts.size() / 3,
+		[&triagverts](std::size_t triagidx) -> t_bvh::t_box
 	{
-		obj.m_vertex_buffer = std::make_shared<QOpenGLBuffer>(
-			QOpenGLBuffer::VertexBuffer);
+		t_bvh::t_box box;
+		for(std::size_t vertidx=0; vertidx<3; ++vertidx)
+			box.Add(triagverts[triagidx*3 + vertidx]);
+		return box;
+	});
+
+	data.m_vertices = verts;
+	data.m_triangles = triagverts;
+	data.m_uvs = uvs;
+}
 
-		BOOST_SCOPE_EXIT(&obj)
-		{
-			obj.m_vertex_buffer->release();
-		} BOOST_SCOPE_EXIT_END
 
-		if(!obj.m_vertex_buffer->create())
-			std::cerr << "Cannot create vertex buffer." << std::endl;
-		if(!obj.m_vertex_buffer->bind())
-			std::cerr << "Cannot bind vertex buffer." << std::endl;
+/**
+ * creates a triangle-based 3d object
+ */
+bool GlSceneRenderer::CreateTriangleObject(GlRenderObj& obj,
+	const std::vector<t_vec3_gl>& verts, const std::vector<t_vec3_gl>& triagverts,
+	const std::vector<t_vec3_gl>& norms, const std::vector<t_vec3_gl>& uvs,
+	const t_vec_gl& colour, bool bUseVertsAsNorm,
+	GLint attrVertex, GLint attrVertexNormal, GLint attrTextureCoords)
+{
+	GlTriangleData data;
+	PrepareTriangleData(data, verts, triagverts, norms, uvs, bUseVertsAsNorm);
 
-		auto vecVerts = to_float_array(triagverts, 1, 4, false, 1.);
-		obj.m_vertex_buffer->allocate(
-			vecVerts.data(), 
-			vecVerts.size()*sizeof(typename decltype(vecVerts)::value_type));
-		pGl->glVertexAttribPointer(attrVertex, 4, GL_FLOAT, 0, 0, nullptr);
-	}
+	return CreateTriangleObject(obj, std::move(data), colour,
+		attrVertex, attrVertexNormal, attrTextureCoords);
+}
 
-	// normals
-	if(attrVertexNormal >= 0)
-	{
-		obj.m_normals_buffer = std::make_shared<QOpenGLBuffer>(
-			QOpenGLBuffer::VertexBuffer);
 
-		BOOST_SCOPE_EXIT(&obj)
-		{
-			obj.m_normals_buffer->release();
-		} BOOST_SCOPE_EXIT_END
+/**
+ * uploads the prepared vertex data of a triangle-based 3d object
+ */
+bool GlSceneRenderer::CreateTriangleObject(GlRenderObj& obj,
+	GlTriangleData&& data, const t_vec_gl& colour,
+	GLint attrVertex, GLint attrVertexNormal, GLint attrTextureCoords)
+{
+	// the context is already bound while uploading a batch of objects
+	const bool bind_context = !m_uploadingBatch;
+	BOOST_SCOPE_EXIT(this_, bind_context)
+	{
+		if(bind_context)
+			this_->DoneCurrent();
+	} BOOST_SCOPE_EXIT_END
+	if(bind_context)
+		MakeCurrent();
 
-		obj.m_normals_buffer->create();
-		obj.m_normals_buffer->bind();
+	qgl_funcs* pGl = GetGlFunctions();
+	if(!pGl) return false;
 
-		auto vecNorms = bUseVertsAsNorm
-			? to_float_array(triagverts, 1, 4, true, 0.)
-			: to_float_array(norms, 3, 4, false, 0.);
-		obj.m_normals_buffer->allocate(
-			vecNorms.data(),
-			vecNorms.size()*sizeof(typename decltype(vecNorms)::value_type));
-		pGl->glVertexAttribPointer(attrVertexNormal, 4, GL_FLOAT, 0, 0, nullptr);
-	}
+	obj.m_type = GlRenderObjType::TRIANGLES;
+	obj.m_colour = colour;
 
-	// colours
-	if(attrVertexcolour >= 0)
-	{
-		obj.m_colour_buffer = std::make_shared<QOpenGLBuffer>(
-			QOpenGLBuffer::VertexBuffer);
+	const std::size_t vertex_size = data.m_interleaved.size()*sizeof(t_real_gl);
+	const std::size_t index_size = data.m_indices.size()*sizeof(GLuint);
 
-		BOOST_SCOPE_EXIT(&obj)
-		{
-			obj.m_colour_buffer->release();
-		} BOOST_SCOPE_EXIT_END
+	// an existing object keeps its buffer ranges and vertex array if the new data fits
+	const bool in_place = obj.m_vertex_array &&
+		obj.m_vertex_range.page && obj.m_vertex_range.size >= vertex_size &&
+		obj.m_index_range.page && obj.m_index_range.size >= index_size;
 
-		obj.m_colour_buffer->create();
-		obj.m_colour_buffer->bind();
+	if(!in_place)
+	{
+		FreeBufferRange(obj.m_vertex_range);
+		FreeBufferRange(obj.m_index_range);
 
-		std::vector<t_real_gl> vecCols;
-		vecCols.reserve(4*triagverts.size());
-		for(std::size_t iVert=0; iVert<triagverts.size(); ++iVert)
+		if(!AllocateBufferRange(pGl, QOpenGLBuffer::VertexBuffer, vertex_size, obj.m_vertex_range) ||
+			!AllocateBufferRange(pGl, QOpenGLBuffer::IndexBuffer, index_size, obj.m_index_range))
 		{
-			for(int icol=0; icol<obj.m_colour.size(); ++icol)
-				vecCols.push_back(obj.m_colour[icol]);
+			std::cerr << "Cannot allocate vertex buffer." << std::endl;
+			return false;
 		}
 
-		obj.m_colour_buffer->allocate(
-			vecCols.data(),
-			vecCols.size()*sizeof(typename decltype(vecCols)::value_type));
-		pGl->glVertexAttribPointer(attrVertexcolour, 4, GL_FLOAT, 0, 0, nullptr);
+		obj.m_vertex_buffer = obj.m_vertex_range.page->buffer;
+		obj.m_index_buffer = obj.m_index_range.page->buffer;
 	}
 
-	// texture uv coordinates
-	if(attrTextureCoords >= 0)
+	WriteBufferRange(pGl, obj.m_vertex_range, data.m_interleaved.data(), vertex_size);
+	WriteBufferRange(pGl, obj.m_index_range, data.m_indices.data(), index_size);
+	obj.m_num_indices = GLsizei(data.m_indices.size());
+
+	// main vertex array object, pointing to the ranges of the buffer pages
+	if(!in_place)
 	{
-		obj.m_uv_buffer = std::make_shared<QOpenGLBuffer>(
-			QOpenGLBuffer::VertexBuffer);
+		if(!obj.m_vertex_array)
+		{
+			obj.m_vertex_array = std::make_shared<QOpenGLVertexArrayObject>();
+			obj.m_vertex_array->create();
+		}
+		obj.m_vertex_array->bind();
 
 		BOOST_SCOPE_EXIT(&obj)
 		{
-			obj.m_uv_buffer->release();
+			obj.m_vertex_array->release();
 		} BOOST_SCOPE_EXIT_END
 
-		obj.m_uv_buffer->create();
-		obj.m_uv_buffer->bind();
+		// interleaved vertex attributes
+		{
+			BOOST_SCOPE_EXIT(&obj)
+			{
+				obj.m_vertex_buffer->release();
+			} BOOST_SCOPE_EXIT_END
+
+			if(!obj.m_vertex_buffer->bind())
+				std::cerr << "Cannot bind vertex buffer." << std::endl;
 
-		auto vecUVs = to_float_array(uvs, 1, 2);
-		obj.m_uv_buffer->allocate(
-			vecUVs.data(),
-			vecUVs.size()*sizeof(typename decltype(vecUVs)::value_type));
-		pGl->glVertexAttribPointer(attrTextureCoords, 2, GL_FLOAT, 0, 0, nullptr);
-	}
+			// the enabled attribute arrays are part of the vertex array object's state
+			constexpr GLsizei stride = GlTriangleData::VERT_ELEMS * sizeof(t_real_gl);
+			const std::size_t offs = obj.m_vertex_range.offset;
+			if(attrVertex >= 0)
+			{
+				pGl->glVertexAttribPointer(attrVertex, 3, GL_FLOAT, 0, stride,
+					reinterpret_cast<const void*>(offs));
+				pGl->glEnableVertexAttribArray(attrVertex);
+			}
+			if(attrVertexNormal >= 0)
+			{
+				pGl->glVertexAttribPointer(attrVertexNormal, 3, GL_FLOAT, 0, stride,
+					reinterpret_cast<const void*>(offs + 3 * sizeof(t_real_gl)));
+				pGl->glEnableVertexAttribArray(attrVertexNormal);
+			}
+			if(attrTextureCoords >= 0)
+			{
+				pGl->glVertexAttribPointer(attrTextureCoords, 2, GL_FLOAT, 0, stride,
+					reinterpret_cast<const void*>(offs + 6 * sizeof(t_real_gl)));
+				pGl->glEnableVertexAttribArray(attrTextureCoords);
+			}
+		}
 
+		// vertex indices, the binding is part of the vertex array object's state
+		if(!obj.m_index_buffer->bind())
+			std::cerr << "Cannot bind index buffer." << std::endl;
+	}
 
-	obj.m_vertices = std::move(verts);
-	obj.m_triangles = std::move(triagverts);
-	obj.m_uvs = std::move(uvs);
+	obj.m_bvh = std::move(data.m_bvh);
+	obj.m_vertices = std::move(data.m_vertices);
+	obj.m_triangles = std::move(data.m_triangles);
+	obj.m_uvs = std::move(data.m_uvs);
 	LOGGLERR(pGl)
 
 	return true;
@@ -279,20 +329,19 @@ bool GlSceneRenderer::CreateTriangleObject(GlRenderObj& obj,
  */
 bool GlSceneRenderer::CreateLineObject(GlRenderObj& obj,
 	const std::vector<t_vec3_gl>& verts, const t_vec_gl& colour,
-	GLint attrVertex, GLint attrVertexcolour)
+	GLint attrVertex)
 {
 	// TODO: move context to calling thread
 	BOOST_SCOPE_EXIT(this_)
 	{
-		this_->doneCurrent();
+		this_->DoneCurrent();
 	} BOOST_SCOPE_EXIT_END
-	makeCurrent();
+	MakeCurrent();
 
 	qgl_funcs* pGl = GetGlFunctions();
 	if(!pGl) return false;
 
 	//GLint attrVertex = m_attrVertex;
-	//GLint attrVertexcolour = m_attrVertexCol;
 
 	obj.m_type = GlRenderObjType::LINES;
 	obj.m_colour = colour;
@@ -318,6 +367,11 @@ bool GlSceneRenderer::CreateLineObject(GlRenderObj& obj,
 	obj.m_vertex_array->create();
 	obj.m_vertex_array->bind();
 
+	BOOST_SCOPE_EXIT(&obj)
+	{
+		obj.m_vertex_array->release();
+	} BOOST_SCOPE_EXIT_END
+
 	{	// vertices
 		obj.m_vertex_buffer = std::make_shared<QOpenGLBuffer>(
 				QOpenGLBuffer::VertexBuffer);
@@ -335,58 +389,127 @@ bool GlSceneRenderer::CreateLineObject(GlRenderObj& obj,
 			vecVerts.data(),
 			vecVerts.size()*sizeof(typename decltype(vecVerts)::value_type));
 		pGl->glVertexAttribPointer(attrVertex, 3, GL_FLOAT, 0, 0, nullptr);
+		pGl->glEnableVertexAttribArray(attrVertex);
 	}
 
-	{	// colours
-		obj.m_colour_buffer = std::make_shared<QOpenGLBuffer>(
-			QOpenGLBuffer::VertexBuffer);
 
-		BOOST_SCOPE_EXIT(&obj)
-		{
-			obj.m_colour_buffer->release();
-		} BOOST_SCOPE_EXIT_END
+	obj.m_vertices = std::move(verts);
+	LOGGLERR(pGl)
 
-		obj.m_colour_buffer->create();
-		obj.m_colour_buffer->bind();
+		return true;
+}
+
+
+/**
+ * get a range of a buffer page, a new page is created if none has enough room
+ */
+bool GlSceneRenderer::AllocateBufferRange(qgl_funcs *pGl, QOpenGLBuffer::Type type,
+	std::size_t size, GlBufferRange& range)
+{
+	constexpr std::size_t page_size = 4 * 1024 * 1024;
+	constexpr std::size_t align = 16;
+
+	auto& pages = (type == QOpenGLBuffer::IndexBuffer ? m_index_pages : m_vertex_pages);
+	range.size = size;
 
-		std::vector<t_real_gl> vecCols;
-		vecCols.reserve(4*verts.size());
-		for(std::size_t iVert=0; iVert<verts.size(); ++iVert)
+	for(auto& page : pages)
+	{
+		if(std::optional<std::size_t> offs = page->ranges.Allocate(size, align); offs)
 		{
-			for(int icol=0; icol<obj.m_colour.size(); ++icol)
-				vecCols.push_back(obj.m_colour[icol]);
+			range.page = page.get();
+			range.offset = *offs;
+			return true;
 		}
+	}
+
+	// new page, larger objects get their own one
+	auto page = std::make_unique<GlBufferPage>();
+	page->buffer = std::make_shared<QOpenGLBuffer>(type);
+	if(!page->buffer->create())
+		return false;
+	page->ranges.Reset(std::max(size, page_size));
+
+	// the copy target doesn't change the state of a bound vertex array object
+	pGl->glBindBuffer(GL_COPY_WRITE_BUFFER, page->buffer->bufferId());
+	pGl->glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(page->ranges.GetCapacity()),
+		nullptr, GL_DYNAMIC_DRAW);
+	pGl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	LOGGLERR(pGl);
+
+	range.page = page.get();
+	range.offset = *page->ranges.Allocate(size, align);
+	pages.emplace_back(std::move(page));
 
-		obj.m_colour_buffer->allocate(
-			vecCols.data(),
-			vecCols.size()*sizeof(typename decltype(vecCols)::value_type));
-		pGl->glVertexAttribPointer(attrVertexcolour, 4, GL_FLOAT, 0, 0, nullptr);
+	return true;
+}
+
+
+/**
+ * return a range to its buffer page, empty pages are deleted
+ */
+void GlSceneRenderer::FreeBufferRange(GlBufferRange& range)
+{
+	if(!range.page)
+		return;
+
+	range.page->ranges.Free(range.offset, range.size);
+
+	if(range.page->ranges.IsEmpty())
+	{
+		for(auto* pages : { &m_vertex_pages, &m_index_pages })
+		{
+			std::erase_if(*pages, [&range](const std::unique_ptr<GlBufferPage>& page) -> bool
+			{
+				if(page.get() != range.page)
+					return false;
+
+				page->buffer->destroy();
+				return true;
+			});
+		}
 	}
 
+	range = GlBufferRange{};
+}
+
 
-	obj.m_vertices = std::move(verts);
-	LOGGLERR(pGl)
+/**
+ * overwrite the data in a range of a buffer page
+ */
+void GlSceneRenderer::WriteBufferRange(qgl_funcs *pGl, const GlBufferRange& range,
+	const void* data, std::size_t size)
+{
+	if(!range.page || size == 0)
+		return;
 
-		return true;
+	pGl->glBindBuffer(GL_COPY_WRITE_BUFFER, range.page->buffer->bufferId());
+	pGl->glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(range.offset), GLsizeiptr(size), data);
+	pGl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
 }
 
 
 void GlSceneRenderer::DeleteRenderObject(GlRenderObj& obj)
 {
+	// the buffers of triangle objects are shared pages
+	if(obj.m_vertex_range.page || obj.m_index_range.page)
+	{
+		FreeBufferRange(obj.m_vertex_range);
+		FreeBufferRange(obj.m_index_range);
+		obj.m_vertex_buffer.reset();
+		obj.m_index_buffer.reset();
+	}
+
 	if(obj.m_vertex_buffer)
 	{
 		obj.m_vertex_buffer->destroy();
 		obj.m_vertex_buffer.reset();
 	}
 
-	if(obj.m_normals_buffer)
-		obj.m_normals_buffer.reset();
-
-	if(obj.m_colour_buffer)
-		obj.m_colour_buffer.reset();
-
-	if(obj.m_uv_buffer)
-		obj.m_uv_buffer.reset();
+	if(obj.m_index_buffer)
+	{
+		obj.m_index_buffer->destroy();
+		obj.m_index_buffer.reset();
+	}
 
 	if(obj.m_vertex_array)
 	{
@@ -394,6 +517,173 @@ void GlSceneRenderer::DeleteRenderObject(GlRenderObj& obj)
 		obj.m_vertex_array.reset();
 	}
 }
+
+
+/**
+ * calculate the bounding box and sphere
+ */
+template<class t_vec, template<class...> class t_cont = std::vector, class t_obj = GlSceneObj>
+	requires m::is_vec<t_vec>
+static void create_bounding_objects(t_obj& obj, const t_cont<t_vec>& triag_verts)
+{
+	// bounding sphere
+	obj.m_boundingSpherePos = m::avg<t_vec3_gl>(triag_verts);
+	std::tie(std::ignore, obj.m_boundingSphereRad) =
+		m::minmax_dist(triag_verts, obj.m_boundingSpherePos);
+
+	// bounding box
+	auto [bbMin, bbMax] =
+		m::minmax_comp<t_vec3_gl>(triag_verts);
+
+	// object bounding box
+	obj.m_boundingBox.reserve(8);
+	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMin[0], bbMin[1], bbMin[2], 1.}));
+	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMin[0], bbMin[1], bbMax[2], 1.}));
+	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMin[0], bbMax[1], bbMin[2], 1.}));
+	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMin[0], bbMax[1], bbMax[2], 1.}));
+
+	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMax[0], bbMin[1], bbMin[2], 1.}));
+	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMax[0], bbMin[1], bbMax[2], 1.}));
+	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMax[0], bbMax[1], bbMin[2], 1.}));
+	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMax[0], bbMax[1], bbMax[2], 1.}));
+}
+
+
+/**
+ * tessellates a geometry and prepares its vertex data, this can run in any thread
+ */
+void GlSceneRenderer::PrepareTriangleData(GlTriangleData& data,
+	const Geometry& geo, std::size_t lod)
+{
+	std::shared_ptr<const Geometry::t_triangles> triags = geo.GetCachedTriangles(lod);
+	auto triag_verts = m::convert<t_vec3_gl>(std::get<0>(*triags));
+	auto triag_norms = m::convert<t_vec3_gl>(std::get<1>(*triags));
+	auto triag_uvs = m::convert<t_vec3_gl>(std::get<2>(*triags));
+
+	if(triag_verts.size())
+		create_bounding_objects<t_vec3_gl, std::vector, GlTriangleData>(data, triag_verts);
+	PrepareTriangleData(data, triag_verts, triag_verts, triag_norms, triag_uvs, false);
+}
+
+
+/**
+ * get the shared geometry of an object's level of detail, creating it if needed
+ */
+GlSceneMesh* GlSceneRenderer::AcquireMesh(const Geometry& geo, std::size_t lod,
+	GlTriangleData *prepared)
+{
+	std::string key = geo.GetMeshKey();
+	if(key == "")
+		return nullptr;
+	if(lod > 0)
+		key += "#lod" + std::to_string(lod);
+
+	QMutexLocker _locker{&m_mutexObj};
+
+	auto iter = m_meshes.find(key);
+	if(iter == m_meshes.end())
+	{
+		// only tessellate the geometry if it is neither known nor prepared yet
+		GlTriangleData data;
+		if(prepared && prepared->m_triangles.size())
+			data = std::move(*prepared);
+		else
+			PrepareTriangleData(data, geo, lod);
+		if(data.m_triangles.size() == 0)
+			return nullptr;
+
+		// the colours are given per instance
+		auto col = m::create<t_vec_gl>({ 1, 1, 1, 1 });
+
+		GlSceneMesh mesh;
+		mesh.m_boundingBox = data.m_boundingBox;
+		mesh.m_boundingSpherePos = data.m_boundingSpherePos;
+		mesh.m_boundingSphereRad = data.m_boundingSphereRad;
+		if(!CreateTriangleObject(mesh, std::move(data), col,
+			m_attrVertex, m_attrVertexNorm, m_attrTexCoords))
+			return nullptr;
+
+		iter = m_meshes.emplace(std::make_pair(key, std::move(mesh))).first;
+	}
+
+	++iter->second.m_refs;
+	return &iter->second;
+}
+
+
+/**
+ * get the shared geometries of all levels of detail of an object that is drawn instanced
+ * @return number of levels of detail, 0 if the object is not instanced
+ */
+std::size_t GlSceneRenderer::AcquireMeshes(const Geometry& geo,
+	std::array<GlSceneMesh*, Geometry::MAX_LODS>& lod_meshes,
+	[[maybe_unused]] GlLoadItem *prepared)
+{
+	lod_meshes.fill(nullptr);
+	std::size_t num_lods = 0;
+
+#ifdef _GL_INSTANCING
+	if(m_instancingEnabled && geo.GetPortalId() < 0)
+	{
+		for(; num_lods < geo.GetNumLods(); ++num_lods)
+		{
+			GlTriangleData *data = nullptr;
+			if(prepared && prepared->instanced && num_lods < prepared->num_jobs)
+				data = &prepared->jobs[num_lods]->data;
+
+			lod_meshes[num_lods] = AcquireMesh(geo, num_lods, data);
+			if(!lod_meshes[num_lods])
+				break;
+		}
+	}
+#endif
+
+	return num_lods;
+}
+
+
+/**
+ * an object doesn't use the shared geometry anymore
+ */
+void GlSceneRenderer::ReleaseMesh(GlSceneMesh *mesh)
+{
+	if(!mesh)
+		return;
+
+	// the reference count is shared with AcquireMesh
+	QMutexLocker _locker{&m_mutexObj};
+	if(--mesh->m_refs > 0)
+		return;
+
+	for(auto iter = m_meshes.begin(); iter != m_meshes.end(); ++iter)
+	{
+		if(&iter->second != mesh)
+			continue;
+
+		DeleteRenderObject(iter->second);
+		if(iter->second.m_instance_buffer)
+			iter->second.m_instance_buffer->destroy();
+		m_meshes.erase(iter);
+		break;
+	}
+}
+
+
+/**
+ * remove all shared geometries
+ */
+void GlSceneRenderer::DeleteMeshes()
+{
+	QMutexLocker _locker{&m_mutexObj};
+
+	for(auto &[mesh_key, mesh] : m_meshes)
+	{
+		DeleteRenderObject(mesh);
+		if(mesh.m_instance_buffer)
+			mesh.m_instance_buffer->destroy();
+	}
+	m_meshes.clear();
+}
 // ----------------------------------------------------------------------------
 
 
@@ -409,6 +699,12 @@ GlSceneRenderer::GlSceneRenderer(QWidget *pParent) : QOpenGLWidget(pParent)
 
 	setMouseTracking(true);
 	setFocusPolicy(Qt::StrongFocus);
+
+	// upload the objects prepared by the loader threads
+	connect(&m_load_timer, &QTimer::timeout, this, &GlSceneRenderer::UploadLoadedObjects);
+
+	// upload the textures decoded by the worker threads
+	connect(&m_texture_timer, &QTimer::timeout, this, &GlSceneRenderer::UploadLoadedTextures);
 }
 
 
@@ -418,12 +714,26 @@ GlSceneRenderer::GlSceneRenderer(QWidget *pParent) : QOpenGLWidget(pParent)
 GlSceneRenderer::~GlSceneRenderer()
 {
 	setMouseTracking(false);
+	StopLoading();
 	Clear();
 
-	// remove selection plane
+	// remove selection plane and timers
 	DeleteRenderObject(m_selectionPlane);
+	DeleteTimerQueries();
+
+	MakeCurrent();
+	DeleteShadowFramebuffer();
+	DeletePickFramebuffer();
+	DeleteScaledFramebuffer();
+	DeleteFrameTimers();
+	DeleteUniformBuffers();
+	if(m_vertex_array_upscale)
+		m_vertex_array_upscale->destroy();
+	DeleteOffscreen();
+	DoneCurrent();
 
 	// delete gl objects within current gl context
+	m_shaders_upscale.reset();
 	m_shaders.reset();
 }
 
@@ -447,29 +757,39 @@ GlSceneRenderer::GetGlDescription() const
  */
 void GlSceneRenderer::Clear()
 {
+	StopLoading();
+
 	BOOST_SCOPE_EXIT(this_)
 	{
-		this_->doneCurrent();
+		this_->DoneCurrent();
 	} BOOST_SCOPE_EXIT_END
-	makeCurrent();
+	MakeCurrent();
 
 	m_lights.clear();
 
 	// clear objects
 	QMutexLocker _locker{&m_mutexObj};
 	for(auto &[obj_name, obj] : m_objs)
+	{
+		DeleteOcclusionQuery(obj);
 		DeleteRenderObject(obj);
+	}
 	m_objs.clear();
-
-	// clear textures
+	m_handle_objs.clear();
+	m_visible_objs.clear();
+	m_visible_objs_shadow.clear();
+	DeleteMeshes();
+
+	m_scene_bvh.Clear();
+	m_scene_bvh_objs.clear();
+	m_obj_bounds.Resize(0);
+	m_sceneBvhNeedsRebuild = true;
+	m_shadowMapNeedsUpdate = true;
+
+	// clear textures, images still being decoded are discarded when they are ready
+	auto *pGl = GetGlFunctions();
 	for(auto& txt : m_textures)
-	{
-		if(txt.second.texture)
-		{
-			txt.second.texture->destroy();
-			txt.second.texture = nullptr;
-		}
-	}
+		DeleteTexture(pGl, txt.second);
 	m_textures.clear();
 }
 
@@ -495,9 +815,9 @@ bool GlSceneRenderer::ChangeTextureProperty(
 
 	BOOST_SCOPE_EXIT(this_)
 	{
-		this_->doneCurrent();
+		this_->DoneCurrent();
 	} BOOST_SCOPE_EXIT_END
-	makeCurrent();
+	MakeCurrent();
 
 	QMutexLocker _locker{&m_mutexObj};
 
@@ -508,38 +828,27 @@ bool GlSceneRenderer::ChangeTextureProperty(
 	{
 		if(iter != m_textures.end())
 		{
-			if(iter->second.texture)
-				iter->second.texture->destroy();
+			DeleteTexture(GetGlFunctions(), iter->second);
 			m_textures.erase(iter);
 
 			return true;
 		}
 	}
 
-	// add or replace texture
-	else if(QImage image(filename); !image.isNull())
+	// add or replace texture, the image is decoded asynchronously
+	else if(QFileInfo(filename).isReadable())
 	{
 		// insert new texture
 		if(iter == m_textures.end())
-		{
-			GlSceneTexture txt
-			{
-				.filename = filename.toStdString(),
-				.texture = std::make_shared<QOpenGLTexture>(image),
-			};
-
-			m_textures.emplace(std::make_pair(ident.toStdString(), txt));
-		}
+			iter = m_textures.emplace(std::make_pair(ident.toStdString(), GlSceneTexture{})).first;
 
 		// replace old texture
 		else
-		{
-			if(iter->second.texture)
-				iter->second.texture->destroy();
+			DeleteTexture(GetGlFunctions(), iter->second);
 
-			iter->second.filename = filename.toStdString();
-			iter->second.texture = std::make_shared<QOpenGLTexture>(image);
-		}
+		iter->second.filename = filename.toStdString();
+		iter->second.file.clear();
+		LoadTexture(iter->first, iter->second);
 
 		return true;
 	}
@@ -550,6 +859,7 @@ bool GlSceneRenderer::ChangeTextureProperty(
 
 /**
  * create a 3d representation of the scene's objects
+ * the objects are tessellated by worker threads and uploaded in batches
  */
 bool GlSceneRenderer::LoadScene(const Scene& scene)
 {
@@ -558,118 +868,431 @@ bool GlSceneRenderer::LoadScene(const Scene& scene)
 
 	Clear();
 
-	// objects
+	auto add_job = [this](const std::shared_ptr<const Geometry>& geo, std::size_t lod)
+		-> GlLoadJob*
+	{
+		auto job = std::make_unique<GlLoadJob>();
+		job->geo = geo;
+		job->lod = lod;
+		return m_load_jobs.emplace_back(std::move(job)).get();
+	};
+
+	QMutexLocker _locker{&m_mutexLoad};
+
+	// collect the objects and the tessellations they need,
+	// shared meshes are only prepared once
+	std::unordered_map<std::string, GlLoadJob*> mesh_jobs;
 	for(const auto& obj : scene.GetObjects())
 	{
 		if(!obj)
 			continue;
-		AddObject(*obj);
-	}
 
-	update();
-	return true;
-}
+		GlLoadItem item{ .geo = obj };
+		const std::string mesh_key = obj->GetMeshKey();
+#ifdef _GL_INSTANCING
+		item.instanced = m_instancingEnabled && obj->GetPortalId() < 0 && mesh_key != "";
+#endif
+
+		if(item.instanced)
+		{
+			for(; item.num_jobs < obj->GetNumLods(); ++item.num_jobs)
+			{
+				auto [iter, inserted] = mesh_jobs.emplace(std::make_pair(
+					mesh_key + "#lod" + std::to_string(item.num_jobs), nullptr));
+				if(inserted)
+					iter->second = add_job(obj, item.num_jobs);
+				item.jobs[item.num_jobs] = iter->second;
+			}
+		}
+		else
+		{
+			item.jobs[item.num_jobs++] = add_job(obj, 0);
+		}
+
+		m_load_items.emplace_back(std::move(item));
+	}
+
+	// start the loader threads
+	const std::size_t num_threads = std::min<std::size_t>(m_load_jobs.size(),
+		std::max(std::thread::hardware_concurrency(), 2u) - 1);
+	m_load_cancel = false;
+	m_load_next_job = 0;
+	m_load_next_item = 0;
+	for(std::size_t thread=0; thread<num_threads; ++thread)
+		m_load_threads.emplace_back(&GlSceneRenderer::RunLoadJobs, this);
+
+	if(m_load_items.size())
+		m_load_timer.start(5);
+
+	update();
+	return true;
+}
 
 
 /**
- * calculate the bounding box and sphere
+ * loader thread: prepare the vertex data of the queued jobs
  */
-template<class t_vec, template<class...> class t_cont = std::vector>
-	requires m::is_vec<t_vec>
-static void create_bounding_objects(GlSceneObj& obj, const t_cont<t_vec>& triag_verts)
+void GlSceneRenderer::RunLoadJobs()
 {
-	// bounding sphere
-	obj.m_boundingSpherePos = m::avg<t_vec3_gl>(triag_verts);
-	std::tie(std::ignore, obj.m_boundingSphereRad) =
-		m::minmax_dist(triag_verts, obj.m_boundingSpherePos);
+	while(!m_load_cancel)
+	{
+		const std::size_t idx = m_load_next_job++;
+		if(idx >= m_load_jobs.size())
+			break;
 
-	// bounding box
-	auto [bbMin, bbMax] =
-		m::minmax_comp<t_vec3_gl>(triag_verts);
+		GlLoadJob& job = *m_load_jobs[idx];
+		PrepareTriangleData(job.data, *job.geo, job.lod);
+		job.ready.store(true, std::memory_order_release);
+	}
+}
 
-	// object bounding box
-	obj.m_boundingBox.reserve(8);
-	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMin[0], bbMin[1], bbMin[2], 1.}));
-	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMin[0], bbMin[1], bbMax[2], 1.}));
-	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMin[0], bbMax[1], bbMin[2], 1.}));
-	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMin[0], bbMax[1], bbMax[2], 1.}));
 
-	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMax[0], bbMin[1], bbMin[2], 1.}));
-	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMax[0], bbMin[1], bbMax[2], 1.}));
-	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMax[0], bbMax[1], bbMin[2], 1.}));
-	obj.m_boundingBox.push_back(m::create<t_vec_gl>({bbMax[0], bbMax[1], bbMax[2], 1.}));
+/**
+ * upload the objects that have been prepared by the loader threads,
+ * all objects of a batch are uploaded with the context bound once
+ */
+void GlSceneRenderer::UploadLoadedObjects()
+{
+	QMutexLocker _locker{&m_mutexLoad};
+	if(!m_initialised || m_load_items.size() == 0)
+	{
+		m_load_timer.stop();
+		return;
+	}
+
+	auto is_ready = [](const GlLoadItem& item) -> bool
+	{
+		for(std::size_t job=0; job<item.num_jobs; ++job)
+		{
+			if(!item.jobs[job]->ready.load(std::memory_order_acquire))
+				return false;
+		}
+		return true;
+	};
+
+	// wait for the next object in order
+	if(m_load_next_item < m_load_items.size() && !is_ready(m_load_items[m_load_next_item]))
+		return;
+
+	ProfilerScope _prof{"cpu: scene upload"};
+
+	{
+		BOOST_SCOPE_EXIT(this_)
+		{
+			this_->m_uploadingBatch = false;
+			this_->DoneCurrent();
+		} BOOST_SCOPE_EXIT_END
+		MakeCurrent();
+		m_uploadingBatch = true;
+
+		// limit the time spent per batch to keep the gui responsive
+		constexpr std::chrono::milliseconds max_batch_time{10};
+		const auto start_time = std::chrono::steady_clock::now();
+
+		while(m_load_next_item < m_load_items.size())
+		{
+			GlLoadItem& item = m_load_items[m_load_next_item];
+			if(!is_ready(item))
+				break;
+
+			if(!item.deleted)
+				AddObject(*item.geo, &item);
+			++m_load_next_item;
+
+			if(std::chrono::steady_clock::now() - start_time > max_batch_time)
+				break;
+		}
+	}
+
+	emit SceneLoadProgress(m_load_next_item, m_load_items.size());
+
+	// all objects uploaded
+	if(m_load_next_item >= m_load_items.size())
+		StopLoading();
+}
+
+
+/**
+ * stop the loader threads and discard the objects that have not yet been uploaded
+ */
+void GlSceneRenderer::StopLoading()
+{
+	QMutexLocker _locker{&m_mutexLoad};
+	m_load_timer.stop();
+
+	m_load_cancel = true;
+	for(std::thread& thread : m_load_threads)
+	{
+		if(thread.joinable())
+			thread.join();
+	}
+
+	m_load_threads.clear();
+	m_load_items.clear();
+	m_load_jobs.clear();
+	m_load_next_item = 0;
+	m_load_next_job = 0;
 }
 
 
 /**
  * insert an object into the scene
+ * its vertex data is taken from the loader if it has already been prepared
  */
-void GlSceneRenderer::AddObject(const Geometry& obj)
+void GlSceneRenderer::AddObject(const Geometry& obj, GlLoadItem *prepared)
 {
 	if(!m_initialised)
 		return;
 
 	QMutexLocker _locker{&m_mutexObj};
-	auto [_verts, _norms, _uvs] = obj.GetTriangles();
-
-	auto verts = m::convert<t_vec3_gl>(_verts);
-	auto norms = m::convert<t_vec3_gl>(_norms);
-	auto uvs = m::convert<t_vec3_gl>(_uvs);
 	auto cols = m::convert<t_vec3_gl>(obj.GetColour());
 
-	auto obj_iter = AddTriangleObject(
-		obj.GetId(), verts, norms, uvs,
-		cols[0], cols[1], cols[2], 1);
+	// share the geometry with other objects having the same shape
+	std::array<GlSceneMesh*, Geometry::MAX_LODS> lod_meshes{};
+	const std::size_t num_lods = AcquireMeshes(obj, lod_meshes, prepared);
+
+	t_objs::iterator obj_iter = m_objs.end();
+	if(GlSceneMesh *mesh = lod_meshes[0]; mesh)
+	{
+		GlSceneObj sceneobj;
+		sceneobj.m_boundingBox = mesh->m_boundingBox;
+		sceneobj.m_boundingSpherePos = mesh->m_boundingSpherePos;
+		sceneobj.m_boundingSphereRad = mesh->m_boundingSphereRad;
+		sceneobj.m_colour = m::create<t_vec_gl>({ cols[0], cols[1], cols[2], 1 });
+		sceneobj.m_mesh = mesh;
+		sceneobj.m_lod_meshes = lod_meshes;
+		sceneobj.m_num_lods = num_lods;
+
+		bool inserted = false;
+		std::tie(obj_iter, inserted) = m_objs.emplace(
+			std::make_pair(obj.GetId(), std::move(sceneobj)));
+		if(!inserted)
+		{
+			for(std::size_t lod=0; lod<num_lods; ++lod)
+				ReleaseMesh(lod_meshes[lod]);
+		}
+	}
+	else
+	{
+		GlTriangleData data;
+		if(prepared && !prepared->instanced && prepared->num_jobs)
+			data = std::move(prepared->jobs[0]->data);
+		else
+			PrepareTriangleData(data, obj);
+
+		obj_iter = AddTriangleObject(obj.GetId(), std::move(data),
+			m::create<t_vec_gl>({ cols[0], cols[1], cols[2], 1 }));
+	}
+
+	// the simulation identifies the objects by their handles
+	if(obj.GetHandle())
+	{
+		obj_iter->second.m_handle = obj.GetHandle();
+		m_handle_objs[obj.GetHandle()] = &obj_iter->second;
+	}
+
+	SetObjectProperties(obj_iter->second, obj);
+	update();
+}
 
-	obj_iter->second.m_mat = m::convert<t_mat_gl>(obj.GetTrafo());
-	obj_iter->second.m_texture = obj.GetTexture();
-	obj_iter->second.m_lighting = obj.IsLightingEnabled();
-	obj_iter->second.m_portal_id = obj.GetPortalId();
-	obj_iter->second.m_portal_mat = m::convert<t_mat_gl>(obj.GetPortalTrafo());
-	obj_iter->second.m_portal_mirror = (obj.GetPortalDeterminant() < 0.);
+
+/**
+ * take over the transformation and the rendering properties of a scene object
+ */
+void GlSceneRenderer::SetObjectProperties(GlSceneObj& sceneobj, const Geometry& obj)
+{
+	sceneobj.m_mat = m::convert<t_mat_gl>(obj.GetTrafo());
+	sceneobj.m_texture = obj.GetTexture();
+	sceneobj.m_lighting = obj.IsLightingEnabled();
+	sceneobj.m_portal_id = obj.GetPortalId();
+	sceneobj.m_portal_mat = m::convert<t_mat_gl>(obj.GetPortalTrafo());
+	sceneobj.m_portal_mirror = (obj.GetPortalDeterminant() < 0.);
+	m_sceneBvhNeedsRebuild = true;
+	m_shadowMapNeedsUpdate = true;
 
 	if(obj.GetLightId() >= 0)
 	{
-		const t_vec& pos = obj.GetPosition();
+		const t_vec3 pos = obj.GetPosition();
 		SetLight(obj.GetLightId(), m::convert<t_vec3_gl>(pos));
 	}
+}
+
+
+/**
+ * the geometry or the properties of an object have been changed,
+ * instanced objects are moved to the shared geometry of their new shape,
+ * the vertex data of other objects is overwritten in place if it still fits into its buffer ranges
+ */
+void GlSceneRenderer::UpdateObject(const Geometry& obj)
+{
+	if(!m_initialised)
+		return;
+
+	QMutexLocker _loadlocker{&m_mutexLoad};
+	QMutexLocker _locker{&m_mutexObj};
+	auto iter = m_objs.find(obj.GetId());
+
+	if(iter == m_objs.end() || IsLoading())
+	{
+		DeleteObject(obj.GetId());
+		AddObject(obj);
+		return;
+	}
+
+	GlSceneObj& sceneobj = iter->second;
+
+	// the new shared geometries are acquired before the old ones are released,
+	// so that they are kept if the shape is unchanged
+	std::array<GlSceneMesh*, Geometry::MAX_LODS> lod_meshes{};
+	const std::size_t num_lods = AcquireMeshes(obj, lod_meshes);
+
+	if(sceneobj.m_mesh || lod_meshes[0])
+	{
+		BOOST_SCOPE_EXIT(this_)
+		{
+			this_->DoneCurrent();
+		} BOOST_SCOPE_EXIT_END
+		MakeCurrent();
+
+		for(std::size_t lod=0; lod<sceneobj.m_num_lods; ++lod)
+			ReleaseMesh(sceneobj.m_lod_meshes[lod]);
+
+		// the object's own geometry is replaced by the shared one
+		if(!sceneobj.m_mesh)
+			DeleteRenderObject(sceneobj);
+
+		sceneobj.m_mesh = lod_meshes[0];
+		sceneobj.m_lod_meshes = lod_meshes;
+		sceneobj.m_num_lods = num_lods;
+		sceneobj.m_lod = 0;
+	}
+
+	if(GlSceneMesh *mesh = sceneobj.m_mesh; mesh)
+	{
+		auto cols = m::convert<t_vec3_gl>(obj.GetColour());
+		sceneobj.m_boundingBox = mesh->m_boundingBox;
+		sceneobj.m_boundingSpherePos = mesh->m_boundingSpherePos;
+		sceneobj.m_boundingSphereRad = mesh->m_boundingSphereRad;
+		sceneobj.m_colour = m::create<t_vec_gl>({ cols[0], cols[1], cols[2], 1 });
+
+		SetObjectProperties(sceneobj, obj);
+		m_occlusionViewChanged = true;
+		update();
+		return;
+	}
+
+	GlTriangleData data;
+	PrepareTriangleData(data, obj);
+	if(data.m_triangles.size() == 0)
+		return;
+
+	sceneobj.m_boundingBox = data.m_boundingBox;
+	sceneobj.m_boundingSpherePos = data.m_boundingSpherePos;
+	sceneobj.m_boundingSphereRad = data.m_boundingSphereRad;
+
+	auto cols = m::convert<t_vec3_gl>(obj.GetColour());
+	CreateTriangleObject(sceneobj, std::move(data),
+		m::create<t_vec_gl>({ cols[0], cols[1], cols[2], 1 }),
+		m_attrVertex, m_attrVertexNorm, m_attrTexCoords);
 
+	SetObjectProperties(sceneobj, obj);
+	m_occlusionViewChanged = true;
 	update();
 }
 
 
 /**
  * scene has been changed (e.g. objects have been moved)
+ * only the changed objects need to be updated
  */
-void GlSceneRenderer::UpdateScene(const Scene& scene)
+void GlSceneRenderer::UpdateScene([[maybe_unused]] const Scene& scene,
+	const std::vector<std::shared_ptr<Geometry>>& changed_objs)
 {
-	if(!m_initialised)
+	if(!m_initialised || changed_objs.size() == 0)
 		return;
 
 	//QMutexLocker _locker{&m_mutexObj};
 
 	// update object matrices
-	for(const auto& obj : scene.GetObjects())
+	for(const auto& obj : changed_objs)
 	{
-		m_objs[obj->GetId()].m_mat = m::convert<t_mat_gl>(obj->GetTrafo());
+		if(auto iter = m_objs.find(obj->GetId()); iter != m_objs.end())
+			iter->second.m_mat = m::convert<t_mat_gl>(obj->GetTrafo());
 	}
+	m_shadowMapNeedsUpdate = true;
+	m_occlusionViewChanged = true;
+
+	// adapt the bounding boxes and the picking hierarchy to the moved objects
+	m_objBoundsNeedUpdate = true;
+	if(!m_sceneBvhNeedsRebuild)
+		UpdateSceneBvh(false);
 
 	update();
 }
 
 
+/**
+ * pick up the latest (interpolated) object transformations from the simulation thread
+ */
+void GlSceneRenderer::UpdateFromSimulation()
+{
+	m_sim_moving = false;
+	if(!m_sim || !m_sim->IsRunning())
+		return;
+
+	if(!m_sim->GetTrafos(m_sim_trafos))
+		return;
+
+	m_sim_moving = true;
+	m_occlusionViewChanged = true;
+
+	for(const auto& [handle, trafo] : m_sim_trafos)
+	{
+		if(auto iter = m_handle_objs.find(handle); iter != m_handle_objs.end())
+			iter->second->m_mat = m::convert<t_mat_gl>(trafo);
+	}
+	m_shadowMapNeedsUpdate = true;
+
+	// the bounding boxes and the picking hierarchy are adapted before culling
+	m_objBoundsNeedUpdate = true;
+}
+
+
 /**
  * delete an object by name
  */
 void GlSceneRenderer::DeleteObject(const std::string& obj_name)
 {
+	// the object might still be waiting to be uploaded
+	QMutexLocker _loadlocker{&m_mutexLoad};
+	for(std::size_t idx=m_load_next_item; idx<m_load_items.size(); ++idx)
+	{
+		if(m_load_items[idx].geo->GetId() == obj_name)
+			m_load_items[idx].deleted = true;
+	}
+
 	QMutexLocker _locker{&m_mutexObj};
 	auto iter = m_objs.find(obj_name);
 
 	if(iter != m_objs.end())
 	{
+		BOOST_SCOPE_EXIT(this_)
+		{
+			this_->DoneCurrent();
+		} BOOST_SCOPE_EXIT_END
+		MakeCurrent();
+
+		for(std::size_t lod=0; lod<iter->second.m_num_lods; ++lod)
+			ReleaseMesh(iter->second.m_lod_meshes[lod]);
+		DeleteOcclusionQuery(iter->second);
 		DeleteRenderObject(iter->second);
+
+		if(auto handle_iter = m_handle_objs.find(iter->second.m_handle);
+			handle_iter != m_handle_objs.end() && handle_iter->second == &iter->second)
+			m_handle_objs.erase(handle_iter);
 		m_objs.erase(iter);
+		m_sceneBvhNeedsRebuild = true;
+		m_shadowMapNeedsUpdate = true;
 
 		update();
 	}
@@ -690,6 +1313,7 @@ void GlSceneRenderer::RenameObject(const std::string& oldname, const std::string
 		decltype(m_objs)::node_type node = m_objs.extract(iter);
 		node.key() = newname;
 		m_objs.insert(std::move(node));
+		m_sceneBvhNeedsRebuild = true;
 
 		update();
 	}
@@ -707,19 +1331,31 @@ GlSceneRenderer::AddTriangleObject(
 	const std::vector<t_vec3_gl>& triag_uvs,
 	t_real_gl r, t_real_gl g, t_real_gl b, t_real_gl a)
 {
-	// colour
-	auto col = m::create<t_vec_gl>({ r, g, b, a });
+	GlTriangleData data;
+	create_bounding_objects<t_vec3_gl, std::vector, GlTriangleData>(data, triag_verts);
+	PrepareTriangleData(data, triag_verts, triag_verts, triag_norms, triag_uvs, false);
 
+	return AddTriangleObject(obj_name, std::move(data),
+		m::create<t_vec_gl>({ r, g, b, a }));
+}
+
+
+/**
+ * add a polygon-based object from prepared vertex data
+ */
+	GlSceneRenderer::t_objs::iterator
+GlSceneRenderer::AddTriangleObject(const std::string& obj_name,
+	GlTriangleData&& data, const t_vec_gl& col)
+{
 	GlSceneObj obj;
-	create_bounding_objects<t_vec3_gl>(obj, triag_verts);
+	obj.m_boundingBox = data.m_boundingBox;
+	obj.m_boundingSpherePos = data.m_boundingSpherePos;
+	obj.m_boundingSphereRad = data.m_boundingSphereRad;
 
 	QMutexLocker _locker{&m_mutexObj};
 
-	CreateTriangleObject(obj,
-		triag_verts, triag_verts, triag_norms,
-		triag_uvs, col,
-		false, m_attrVertex, m_attrVertexNorm,
-		m_attrVertexCol, m_attrTexCoords);
+	CreateTriangleObject(obj, std::move(data), col,
+		m_attrVertex, m_attrVertexNorm, m_attrTexCoords);
 
 	// object transformation matrix
 	obj.m_mat = m::hom_translation<t_mat_gl, t_real_gl>(0., 0., 0.);
@@ -765,7 +1401,7 @@ void GlSceneRenderer::CreateSelectionPlane()
 	CreateTriangleObject(m_selectionPlane,
 		verts, verts, norms, uvs, col,
 		false, m_attrVertex, m_attrVertexNorm,
-		m_attrVertexCol, m_attrTexCoords);
+		m_attrTexCoords);
 
 	m_selectionPlane.m_visible = false;
 	m_selectionPlane.m_cull = false;
@@ -845,7 +1481,10 @@ void GlSceneRenderer::SetLight(std::size_t idx, const t_vec3_gl& pos)
 
 	// light 0 is the principal light
 	if(idx == 0)
+	{
 		m_lightcam.SetLookAt(pos, target, up);
+		m_shadowMapNeedsUpdate = true;
+	}
 }
 
 
@@ -865,6 +1504,32 @@ void GlSceneRenderer::SetLightFollowsCursor(bool b)
 void GlSceneRenderer::EnableShadowRendering(bool b)
 {
 	m_shadowRenderingEnabled = b;
+	m_shadowMapNeedsUpdate = true;
+	update();
+}
+
+
+/**
+ * only render the shadow map again if the lights or the objects have changed
+ */
+void GlSceneRenderer::EnableShadowMapCache(bool b)
+{
+	m_shadowMapCacheEnabled = b;
+	m_shadowMapNeedsUpdate = true;
+	update();
+}
+
+
+/**
+ * set the width and height of the shadow map
+ */
+void GlSceneRenderer::SetShadowMapSize(int size)
+{
+	if(size == m_shadowMapSize)
+		return;
+
+	m_shadowMapSize = size;
+	m_shadowFramebufferNeedsUpdate = true;
 	update();
 }
 
@@ -879,6 +1544,57 @@ void GlSceneRenderer::EnablePortalRendering(bool b)
 }
 
 
+/**
+ * set the maximum number of nested portals, limited by the stencil buffer's bits
+ */
+void GlSceneRenderer::SetPortalDepth(std::size_t depth)
+{
+	m_portalDepth = std::clamp<std::size_t>(depth, 1, 255);
+	update();
+}
+
+
+/**
+ * share the geometry of identical objects and draw them instanced
+ * (only affects subsequently added objects)
+ */
+void GlSceneRenderer::EnableInstancing(bool b)
+{
+	m_instancingEnabled = b;
+}
+
+
+/**
+ * skip objects that have been hidden behind others in the previous frame
+ */
+void GlSceneRenderer::EnableOcclusionCulling(bool b)
+{
+	m_occlusionCullingEnabled = b;
+	update();
+}
+
+
+/**
+ * find the object under the cursor by rendering object ids instead of intersecting its triangles
+ */
+void GlSceneRenderer::EnableGpuPicking(bool b)
+{
+	m_gpuPickingEnabled = b;
+	m_pickerNeedsUpdate = true;
+	update();
+}
+
+
+/**
+ * show the profiler timings and counters on top of the scene
+ */
+void GlSceneRenderer::EnableProfilerOverlay(bool b)
+{
+	m_profilerOverlayEnabled = b;
+	update();
+}
+
+
 /**
  * update the light positions and the light camera for shadow rendering
  */
@@ -891,34 +1607,28 @@ void GlSceneRenderer::UpdateLights()
 	if(!pGl)
 		return;
 
-	int num_lights = std::min(MAX_LIGHTS, static_cast<int>(m_lights.size()));
-	auto pos = std::make_unique<t_real_gl[]>(num_lights * 3);
-
-	for(int i = 0; i < num_lights; ++i)
-	{
-		pos[i*3 + 0] = m_lights[i][0];
-		pos[i*3 + 1] = m_lights[i][1];
-		pos[i*3 + 2] = m_lights[i][2];
-	}
-
-	// bind shaders
-	BOOST_SCOPE_EXIT(m_shaders)
-	{
-		m_shaders->release();
-	} BOOST_SCOPE_EXIT_END
-	m_shaders->bind();
+	// light positions and ranges, the shader program doesn't need to be bound
+	std::vector<GLfloat> lights;
+	lights.reserve(std::max<std::size_t>(m_lights.size(), 1) * 4);
+	for(const t_vec3_gl& light : m_lights)
+		lights.insert(lights.end(), { light[0], light[1], light[2], m_lightRange });
+	if(lights.empty())
+		lights.resize(4, 0);  // the buffer texture mustn't be empty
+
+	pGl->glBindBuffer(GL_TEXTURE_BUFFER, m_bufLights);
+	pGl->glBufferData(GL_TEXTURE_BUFFER, GLsizeiptr(lights.size()*sizeof(GLfloat)),
+		lights.data(), GL_DYNAMIC_DRAW);
+	pGl->glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	const GLint num_active = static_cast<GLint>(m_lights.size());
+	pGl->glBindBuffer(GL_UNIFORM_BUFFER, m_uboLights);
+	pGl->glBufferSubData(GL_UNIFORM_BUFFER, offsetof(GlLightUniforms, num_active),
+		sizeof(num_active), &num_active);
+	pGl->glBindBuffer(GL_UNIFORM_BUFFER, 0);
 	LOGGLERR(pGl);
 
-	m_shaders->setUniformValueArray(m_uniLightPos, pos.get(), num_lights, 3);
-	m_shaders->setUniformValue(m_uniNumActiveLights, num_lights);
-
-	// update light perspective
+	// update light perspective, the shadow map is square
 	t_real ratio = 1;
-	if(m_fboshadow)
-	{
-		ratio = t_real_gl(m_fboshadow->height()) /
-			t_real_gl(m_fboshadow->width());
-	}
 
 	bool persp_proj = m_cam.GetPerspectiveProjection();
 	m_lightcam.SetPerspectiveProjection(persp_proj);
@@ -935,34 +1645,309 @@ void GlSceneRenderer::UpdateLights()
 
 	m_lightcam.UpdatePerspective();
 
-	// set matrices
-	m_shaders->setUniformValue(
-			m_uniMatrixLightProj, m_lightcam.GetPerspective());
-	LOGGLERR(pGl);
-
 	m_lightsNeedUpdate = false;
+	m_lightTilesNeedUpdate = true;
+	m_shadowMapNeedsUpdate = true;
 }
 
 
 /**
- * get the position of the mouse cursor on the selection plane
+ * sort the lights into screen tiles by the screen rectangles covered by their ranges,
+ * the fragment shader then only iterates the lights of its tile
  */
-std::tuple<t_vec3_gl, int> GlSceneRenderer::GetSelectionPlaneCursor() const
+void GlSceneRenderer::UpdateLightTiles(qgl_funcs *pGl)
 {
-	auto [org3, dir3] = m_cam.GetPickerRay(m_posMouse.x(), m_posMouse.y());
+	const std::array<int, 2> dims = GetRenderDimensions();
+	const int tiles_x = std::max((dims[0] + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE, 1);
+	const int tiles_y = std::max((dims[1] + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE, 1);
+	const std::size_t num_tiles = std::size_t(tiles_x) * std::size_t(tiles_y);
+
+	// range of tiles covered by each light
+	const t_real_gl range = m_lightRange;
+	const t_mat_gl unit = m::unit<t_mat_gl>();
+	std::vector<std::array<int, 4>> light_tiles;
+	light_tiles.reserve(m_lights.size());
+
+	for(const t_vec3_gl& light : m_lights)
+	{
+		if(range <= 0)
+		{
+			light_tiles.push_back({ 0, tiles_x - 1, 0, tiles_y - 1 });
+			continue;
+		}
 
-	auto[inters, inters_type, inters_lam] =
-		m::intersect_line_plane<t_vec3_gl>(
-			org3, dir3, m_selectionPlaneNorm, m_selectionPlaneDist);
+		std::vector<t_vec_gl> box;
+		box.reserve(8);
+		for(int corner = 0; corner < 8; ++corner)
+		{
+			box.emplace_back(m::create<t_vec_gl>({
+				light[0] + ((corner & 1) ? range : -range),
+				light[1] + ((corner & 2) ? range : -range),
+				light[2] + ((corner & 4) ? range : -range),
+				1 }));
+		}
 
-	return std::make_tuple(inters, inters_type);
-}
+		const t_cam::t_rect rect = m_cam.GetProjectedRect(unit, box);
+		if(rect[0] > rect[1] || rect[2] > rect[3])
+		{
+			// not on the screen
+			light_tiles.push_back({ 0, -1, 0, -1 });
+			continue;
+		}
 
+		// ndc -> tile indices
+		auto to_tile = [](t_real_gl ndc, int dim, int tiles) -> int
+		{
+			const int tile = int((ndc + 1) * t_real_gl(0.5) * t_real_gl(dim) / t_real_gl(LIGHT_TILE_SIZE));
+			return std::clamp(tile, 0, tiles - 1);
+		};
 
-/**
- * calculate the object the mouse cursor is currently on
- */
-void GlSceneRenderer::UpdatePicker()
+		light_tiles.push_back({
+			to_tile(rect[0], dims[0], tiles_x), to_tile(rect[1], dims[0], tiles_x),
+			to_tile(rect[2], dims[1], tiles_y), to_tile(rect[3], dims[1], tiles_y) });
+	}
+
+	// count the lights per tile, the offsets and counts precede the index lists
+	m_light_tiles.assign(2*num_tiles, 0);
+	for(const auto& tiles : light_tiles)
+		for(int y = tiles[2]; y <= tiles[3]; ++y)
+			for(int x = tiles[0]; x <= tiles[1]; ++x)
+				++m_light_tiles[2*(std::size_t(y)*tiles_x + x) + 1];
+
+	GLuint offs = GLuint(2*num_tiles);
+	for(std::size_t tile = 0; tile < num_tiles; ++tile)
+	{
+		m_light_tiles[2*tile] = offs;
+		offs += m_light_tiles[2*tile + 1];
+		m_light_tiles[2*tile + 1] = 0;
+	}
+
+	m_light_tiles.resize(offs);
+	for(std::size_t lightidx = 0; lightidx < light_tiles.size(); ++lightidx)
+	{
+		const auto& tiles = light_tiles[lightidx];
+		for(int y = tiles[2]; y <= tiles[3]; ++y)
+		{
+			for(int x = tiles[0]; x <= tiles[1]; ++x)
+			{
+				const std::size_t tile = std::size_t(y)*tiles_x + x;
+				m_light_tiles[m_light_tiles[2*tile] + m_light_tiles[2*tile + 1]++] = GLuint(lightidx);
+			}
+		}
+	}
+
+	pGl->glBindBuffer(GL_TEXTURE_BUFFER, m_bufLightTiles);
+	pGl->glBufferData(GL_TEXTURE_BUFFER, GLsizeiptr(m_light_tiles.size()*sizeof(GLuint)),
+		m_light_tiles.data(), GL_DYNAMIC_DRAW);
+	pGl->glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	const GLint tiles_count[2] = { tiles_x, tiles_y };
+	pGl->glBindBuffer(GL_UNIFORM_BUFFER, m_uboLights);
+	pGl->glBufferSubData(GL_UNIFORM_BUFFER, offsetof(GlLightUniforms, tiles_count),
+		sizeof(tiles_count), tiles_count);
+	pGl->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	LOGGLERR(pGl);
+
+	m_lightTilesNeedUpdate = false;
+}
+
+
+/**
+ * upload the camera and light matrices once per frame, they are shared by all passes
+ */
+void GlSceneRenderer::UpdateFrameUniforms(qgl_funcs *pGl)
+{
+	auto to_gl = [](GLfloat (&dst)[16], const t_mat_gl& mat)
+	{
+		const QMatrix4x4 qmat = mat;
+		std::memcpy(dst, qmat.constData(), sizeof(dst));
+	};
+
+	GlFrameUniforms frame;
+	to_gl(frame.proj, m_cam.GetPerspective());
+	to_gl(frame.cam, m_cam.GetTransformation());
+	to_gl(frame.cam_inv, m_cam.GetInverseTransformation());
+	to_gl(frame.light_proj, m_lightcam.GetPerspective());
+	to_gl(frame.light, m_lightcam.GetTransformation());
+	to_gl(frame.light_inv, m_lightcam.GetInverseTransformation());
+
+	pGl->glBindBuffer(GL_UNIFORM_BUFFER, m_uboFrame);
+	pGl->glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame), &frame);
+	pGl->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// the binding points could have been changed by the qt painter
+	pGl->glBindBufferBase(GL_UNIFORM_BUFFER, GLuint(GlUniformBlock::FRAME), m_uboFrame);
+	pGl->glBindBufferBase(GL_UNIFORM_BUFFER, GLuint(GlUniformBlock::LIGHTS), m_uboLights);
+
+	// light texture buffers
+	pGl->glActiveTexture(GL_TEXTURE2);
+	pGl->glBindTexture(GL_TEXTURE_BUFFER, m_texLights);
+	pGl->glActiveTexture(GL_TEXTURE3);
+	pGl->glBindTexture(GL_TEXTURE_BUFFER, m_texLightTiles);
+	pGl->glActiveTexture(GL_TEXTURE0);
+	LOGGLERR(pGl);
+}
+
+
+/**
+ * replace the projection matrix in the frame's uniform buffer, e.g. by a portal's oblique projection
+ */
+void GlSceneRenderer::SetFrameProjection(qgl_funcs *pGl, const t_mat_gl& proj)
+{
+	const QMatrix4x4 qmat = proj;
+
+	pGl->glBindBuffer(GL_UNIFORM_BUFFER, m_uboFrame);
+	pGl->glBufferSubData(GL_UNIFORM_BUFFER, offsetof(GlFrameUniforms, proj),
+		sizeof(GlFrameUniforms::proj), qmat.constData());
+	pGl->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+
+/**
+ * create the uniform buffers and connect them to the shaders' uniform blocks
+ */
+void GlSceneRenderer::CreateUniformBuffers(qgl_funcs *pGl)
+{
+	const GLuint program = m_shaders->programId();
+
+	for(auto [ubo, name, binding, size] : {
+		std::make_tuple(&m_uboFrame, "Frame", GlUniformBlock::FRAME, sizeof(GlFrameUniforms)),
+		std::make_tuple(&m_uboLights, "Lights", GlUniformBlock::LIGHTS, sizeof(GlLightUniforms)) })
+	{
+		if(GLuint idx = pGl->glGetUniformBlockIndex(program, name); idx != GL_INVALID_INDEX)
+			pGl->glUniformBlockBinding(program, idx, GLuint(binding));
+		else
+			std::cerr << "Shader uniform block \"" << name << "\" not found." << std::endl;
+
+		pGl->glGenBuffers(1, ubo);
+		pGl->glBindBuffer(GL_UNIFORM_BUFFER, *ubo);
+		pGl->glBufferData(GL_UNIFORM_BUFFER, GLsizeiptr(size), nullptr, GL_DYNAMIC_DRAW);
+		pGl->glBindBufferBase(GL_UNIFORM_BUFFER, GLuint(binding), *ubo);
+	}
+
+	// no lights until they are set
+	GlLightUniforms lights;
+	lights.tiles_count[0] = lights.tiles_count[1] = 1;
+	pGl->glBindBuffer(GL_UNIFORM_BUFFER, m_uboLights);
+	pGl->glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(lights), &lights);
+	pGl->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	// texture buffers for the lights and the tiles' light lists
+	for(auto [buf, tex, format] : {
+		std::make_tuple(&m_bufLights, &m_texLights, GLenum(GL_RGBA32F)),
+		std::make_tuple(&m_bufLightTiles, &m_texLightTiles, GLenum(GL_R32UI)) })
+	{
+		const GLuint empty[4]{};
+		pGl->glGenBuffers(1, buf);
+		pGl->glBindBuffer(GL_TEXTURE_BUFFER, *buf);
+		pGl->glBufferData(GL_TEXTURE_BUFFER, sizeof(empty), empty, GL_DYNAMIC_DRAW);
+		pGl->glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+		pGl->glGenTextures(1, tex);
+		pGl->glBindTexture(GL_TEXTURE_BUFFER, *tex);
+		pGl->glTexBuffer(GL_TEXTURE_BUFFER, format, *buf);
+		pGl->glBindTexture(GL_TEXTURE_BUFFER, 0);
+	}
+	LOGGLERR(pGl);
+}
+
+
+/**
+ * delete the uniform buffers, needs a current gl context
+ */
+void GlSceneRenderer::DeleteUniformBuffers()
+{
+	auto *pGl = GetGlFunctions();
+	if(!pGl)
+		return;
+
+	for(GLuint *ubo : { &m_uboFrame, &m_uboLights, &m_bufLights, &m_bufLightTiles })
+	{
+		if(*ubo)
+			pGl->glDeleteBuffers(1, ubo);
+		*ubo = 0;
+	}
+
+	for(GLuint *tex : { &m_texLights, &m_texLightTiles })
+	{
+		if(*tex)
+			pGl->glDeleteTextures(1, tex);
+		*tex = 0;
+	}
+}
+
+
+/**
+ * get the position of the mouse cursor on the selection plane
+ */
+std::tuple<t_vec3_gl, int> GlSceneRenderer::GetSelectionPlaneCursor() const
+{
+	auto [org3, dir3] = m_cam.GetPickerRay(m_posMouse.x(), m_posMouse.y());
+
+	auto[inters, inters_type, inters_lam] =
+		m::intersect_line_plane<t_vec3_gl>(
+			org3, dir3, m_selectionPlaneNorm, m_selectionPlaneDist);
+
+	return std::make_tuple(inters, inters_type);
+}
+
+
+/**
+ * update the world-space bounding boxes of all objects and
+ * rebuild their hierarchy or refit it to their current positions
+ */
+void GlSceneRenderer::UpdateSceneBvh(bool rebuild)
+{
+	QMutexLocker _locker{&m_mutexObj};
+	rebuild |= m_sceneBvhNeedsRebuild;
+
+	if(rebuild)
+	{
+		m_scene_bvh_objs.clear();
+		m_scene_bvh_objs.reserve(m_objs.size());
+		for(auto& obj : m_objs)
+			m_scene_bvh_objs.push_back(&obj);
+
+		m_obj_bounds.Resize(m_scene_bvh_objs.size());
+		for(std::size_t objidx=0; objidx<m_scene_bvh_objs.size(); ++objidx)
+		{
+			GlSceneObj& obj = m_scene_bvh_objs[objidx]->second;
+			obj.m_bounds_idx = objidx;
+
+			t_bvh::t_box box;
+			for(const t_vec_gl& vert : obj.m_boundingBox)
+				box.Add(vert);
+			m_obj_bounds.SetLocalBox(objidx, box);
+		}
+	}
+
+	// transform the boxes of all objects in one sweep
+	for(std::size_t objidx=0; objidx<m_scene_bvh_objs.size(); ++objidx)
+		m_obj_bounds.SetMatrix(objidx, m_scene_bvh_objs[objidx]->second.m_mat);
+	m_obj_bounds.UpdateWorldBoxes();
+	m_objBoundsNeedUpdate = false;
+
+	auto get_box = [this](std::size_t objidx) -> t_bvh::t_box
+	{
+		return m_obj_bounds.GetWorldBox(objidx);
+	};
+
+	if(rebuild)
+	{
+		m_scene_bvh.Build(m_scene_bvh_objs.size(), get_box);
+		m_sceneBvhNeedsRebuild = false;
+	}
+	else
+	{
+		m_scene_bvh.Refit(get_box);
+	}
+}
+
+
+/**
+ * calculate the object the mouse cursor is currently on
+ */
+void GlSceneRenderer::UpdatePicker()
 {
 	if(!m_initialised)
 		return;
@@ -982,100 +1967,84 @@ void GlSceneRenderer::UpdatePicker()
 	}
 
 
-	// intersection with geometry
-	bool hasInters = false;
-	m_curObj = "";
-	t_vec_gl closest_inters = m::create<t_vec_gl>({ 0, 0, 0, 0 });
-
-	QMutexLocker _locker{&m_mutexObj};
-
-	for(const auto& [obj_name, obj] : m_objs)
+	// the object ids are rendered in the next frame
+	if(m_gpuPickingEnabled)
 	{
-		if(obj.m_type != GlRenderObjType::TRIANGLES || !obj.m_visible)
-			continue;
-
-		const t_mat_gl& matObj = obj.m_mat;
-
-		// scaling factor, TODO: maximum factor for non-uniform scaling
-		auto scale = std::cbrt(std::abs(m::det<t_mat_gl, t_vec_gl>(matObj)));
-
-		// intersection with bounding sphere?
-		auto boundingInters =
-			m::intersect_line_sphere<t_vec3_gl, std::vector>(
-				org3, dir3,
-				matObj * obj.m_boundingSpherePos,
-				scale * obj.m_boundingSphereRad);
-		if(boundingInters.size() == 0)
-			continue;
-
-		// test actual polygons for intersection
-		for(std::size_t startidx=0; startidx+2<obj.m_triangles.size(); startidx+=3)
-		{
-			std::vector<t_vec3_gl> poly{ {
-				obj.m_triangles[startidx+0],
-				obj.m_triangles[startidx+1],
-				obj.m_triangles[startidx+2]
-			} };
+		m_gpuPickRequested = true;
+		m_pickerNeedsUpdate = false;
+		return;
+	}
 
-			std::vector<t_vec3_gl> polyuv{ {
-				obj.m_uvs[startidx+0],
-				obj.m_uvs[startidx+1],
-				obj.m_uvs[startidx+2]
-			} };
 
-			auto [inters, does_intersect, inters_lam] =
-				m::intersect_line_poly<t_vec3_gl, t_mat_gl>(
-					org3, dir3, poly, matObj);
+	// intersection with geometry
+	QMutexLocker _locker{&m_mutexObj};
 
-			if(!does_intersect)
-				continue;
+	if(m_sceneBvhNeedsRebuild || m_objBoundsNeedUpdate)
+		UpdateSceneBvh(m_sceneBvhNeedsRebuild);
 
-			t_vec_gl inters4 = m::create<t_vec_gl>({
-				inters[0], inters[1], inters[2], 1});
+	const t_bvh::t_arr org{ org3[0], org3[1], org3[2] };
+	const t_bvh::t_arr dir{ dir3[0], dir3[1], dir3[2] };
 
-			// intersection with other objects
-			bool updateUV = false;
+	t_real_gl closest_lam = std::numeric_limits<t_real_gl>::max();
+	t_bvh::t_idx closest_obj = 0;
 
-			if(!hasInters)
-			{	// first intersection
-				closest_inters = inters4;
-				m_curObj = obj_name;
-				hasInters = true;
-				updateUV = true;
-			}
-			else
-			{	// test if next intersection is closer...
-				t_vec_gl oldPosTrafo = m_cam.GetTransformation() * closest_inters;
-				t_vec_gl newPosTrafo = m_cam.GetTransformation() * inters4;
+	// find the closest object along the ray using the scene hierarchy
+	bool hasInters = m_scene_bvh.Intersect(org, dir, closest_lam, closest_obj,
+		[this, &org, &dir](t_bvh::t_idx objidx, t_real_gl lam_max) -> t_real_gl
+	{
+		const GlSceneObj& obj = m_scene_bvh_objs[objidx]->second;
+		if(obj.m_type != GlRenderObjType::TRIANGLES || !obj.m_visible)
+			return -1;
+
+		// transform the ray into object coordinates,
+		// this keeps the ray parameter of the intersection
+		auto [matInv, inv_ok] = m::inv<t_mat_gl, t_vec_gl>(obj.m_mat);
+		if(!inv_ok)
+			return -1;
+
+		t_vec_gl org_obj4 = matInv * m::create<t_vec_gl>({ org[0], org[1], org[2], 1 });
+		t_vec_gl dir_obj4 = matInv * m::create<t_vec_gl>({ dir[0], dir[1], dir[2], 0 });
+		const t_bvh::t_arr org_obj{ org_obj4[0], org_obj4[1], org_obj4[2] };
+		const t_bvh::t_arr dir_obj{ dir_obj4[0], dir_obj4[1], dir_obj4[2] };
+
+		// test the object's triangles using its own hierarchy
+		// (the geometry might be shared with other instances)
+		const GlRenderObj& geo = obj.m_mesh ? *obj.m_mesh : obj;
+
+		t_real_gl lam = lam_max;
+		t_bvh::t_idx triag = 0;
+		if(!geo.m_bvh.Intersect(org_obj, dir_obj, lam, triag,
+			[&geo, &org_obj, &dir_obj](t_bvh::t_idx triagidx, t_real_gl) -> t_real_gl
+			{
+				return bvh_intersect_ray_triangle<t_vec3_gl, t_real_gl>(
+					org_obj, dir_obj,
+					geo.m_triangles[triagidx*3 + 0],
+					geo.m_triangles[triagidx*3 + 1],
+					geo.m_triangles[triagidx*3 + 2]);
+			}))
+			return -1;
 
-				if(m::norm(newPosTrafo) < m::norm(oldPosTrafo))
-				{	// ...it is closer
-					closest_inters = inters4;
-					m_curObj = obj_name;
+		return lam;
+	});
 
-					updateUV = true;
-				}
-			}
+	m_curObj = "";
+	t_vec3_gl closest_inters3 = m::create<t_vec3_gl>({ 0, 0, 0 });
 
-			if(updateUV)
-			{
-				// TODO
-			}
-		}
+	if(hasInters)
+	{
+		m_curObj = m_scene_bvh_objs[closest_obj]->first;
+		closest_inters3 = org3 + dir3*closest_lam;
 	}
 
 	m_pickerNeedsUpdate = false;
-	t_vec3_gl closest_inters3 = m::create<t_vec3_gl>({
-		closest_inters[0], closest_inters[1], closest_inters[2]});
-
 	emit PickerIntersection(hasInters ? &closest_inters3 : nullptr, m_curObj);
 }
 
 
 /**
  * timer tick
- * this is currently only used for keyboard input
- * (new frames are rendered as needed, not on timer ticks)
+ * this is used for keyboard input and to poll the simulation thread
+ * (new frames are only rendered if something has changed)
  */
 void GlSceneRenderer::tick(const std::chrono::milliseconds& ms)
 {
@@ -1115,9 +2084,40 @@ void GlSceneRenderer::tick(const std::chrono::milliseconds& ms)
 	if(needs_update)
 		UpdateCam();
 
-#ifdef USE_BULLET
-	update();
-#endif
+	// the simulation thread has moved objects, or is still interpolating them
+	if(m_sim && m_sim->IsRunning() && (m_sim_moving || m_sim->HasNewSnapshot()))
+		update();
+
+	// read back the occlusion queries of the last frame
+	else if(m_occlusionResultsPending && m_occlusionCullingEnabled)
+		update();
+
+	// render the requested object ids or read them back
+	else if(m_gpuPickingEnabled && (m_gpuPickRequested || m_pick_readback.pending))
+		update();
+}
+
+
+/**
+ * is the view at rest?
+ */
+bool GlSceneRenderer::IsIdle() const
+{
+	for(bool key : m_arrowDown)
+		if(key) return false;
+	for(bool key : m_pageDown)
+		if(key) return false;
+	for(bool key : m_bracketDown)
+		if(key) return false;
+
+	if(m_sim_moving || (m_sim && m_sim->IsRunning() && m_sim->HasNewSnapshot()))
+		return false;
+	if(m_occlusionResultsPending && m_occlusionCullingEnabled)
+		return false;
+	if(m_gpuPickingEnabled && (m_gpuPickRequested || m_pick_readback.pending))
+		return false;
+
+	return true;
 }
 
 
@@ -1130,6 +2130,8 @@ void GlSceneRenderer::UpdateCam(bool update_frame)
 	{
 		m_cam.UpdateTransformation();
 		m_pickerNeedsUpdate = true;
+		m_occlusionViewChanged = true;
+		m_lightTilesNeedUpdate = true;
 
 		// emit changed camera position and rotation
 		t_vec3_gl pos = m_cam.GetPosition();
@@ -1143,14 +2145,16 @@ void GlSceneRenderer::UpdateCam(bool update_frame)
 	if(m_cam.PerspectiveNeedsUpdate())
 	{
 		m_cam.UpdatePerspective();
-		m_perspectiveNeedsUpdate = true;
 		m_pickerNeedsUpdate = true;
+		m_occlusionViewChanged = true;
+		m_lightTilesNeedUpdate = true;
 	}
 
 	if(m_cam.ViewportNeedsUpdate())
 	{
 		m_cam.UpdateViewport();
 		m_viewportNeedsUpdate = true;
+		m_lightTilesNeedUpdate = true;
 	}
 
 	// redraw frame
@@ -1201,7 +2205,7 @@ void GlSceneRenderer::initializeGL()
 	{
 		algo::replace_all(*strSrc, std::string("${GLSL_VERSION}"), strGlsl);
 		algo::replace_all(*strSrc, std::string("${PI}"), strPi);
-		algo::replace_all(*strSrc, std::string("${MAX_LIGHTS}"), std::to_string(MAX_LIGHTS));
+		algo::replace_all(*strSrc, std::string("${LIGHT_TILE_SIZE}"), std::to_string(LIGHT_TILE_SIZE));
 	}
 
 
@@ -1258,33 +2262,48 @@ void GlSceneRenderer::initializeGL()
 	// get attribute handles from shaders
 	m_attrVertex = m_shaders->attributeLocation("vertex");
 	m_attrVertexNorm = m_shaders->attributeLocation("normal");
-	m_attrVertexCol = m_shaders->attributeLocation("vertex_col");
 	m_attrTexCoords = m_shaders->attributeLocation("tex_coords");
+	m_attrInstanceTrafo = m_shaders->attributeLocation("instance_trafo");
+	m_attrInstanceCol = m_shaders->attributeLocation("instance_col");
 
 	// get uniform handles from shaders
-	m_uniMatrixCam = m_shaders->uniformLocation("trafos_cam");
-	m_uniMatrixCamInv = m_shaders->uniformLocation("trafos_cam_inv");
-	m_uniMatrixLight = m_shaders->uniformLocation("trafos_light");
-	m_uniMatrixLightInv = m_shaders->uniformLocation("trafos_light_inv");
-	m_uniMatrixProj = m_shaders->uniformLocation("trafos_proj");
-	m_uniMatrixLightProj = m_shaders->uniformLocation("trafos_light_proj");
 	m_uniMatrixObj = m_shaders->uniformLocation("trafos_obj");
+	m_uniObjCol = m_shaders->uniformLocation("obj_col");
+	m_uniInstancingEnabled = m_shaders->uniformLocation("instancing_enabled");
 
 	m_uniTextureActive = m_shaders->uniformLocation("texture_active");
 	m_uniTexture = m_shaders->uniformLocation("texture_image");
 
 	m_uniConstCol = m_shaders->uniformLocation("lights_const_col");
-	m_uniLightPos = m_shaders->uniformLocation("lights_pos");
-	m_uniNumActiveLights = m_shaders->uniformLocation("lights_numactive");
 	m_uniLightingEnabled = m_shaders->uniformLocation("lights_enabled");
 
 	m_uniShadowRenderingEnabled = m_shaders->uniformLocation("shadow_enabled");
 	m_uniShadowRenderPass = m_shaders->uniformLocation("shadow_renderpass");
 	m_uniShadowMap = m_shaders->uniformLocation("shadow_map");
 
+	m_uniLights = m_shaders->uniformLocation("lights");
+	m_uniLightTiles = m_shaders->uniformLocation("light_tiles");
+	m_uniLightTilesEnabled = m_shaders->uniformLocation("light_tiles_enabled");
+
+	m_uniPickRenderPass = m_shaders->uniformLocation("pick_renderpass");
+	m_uniPickId = m_shaders->uniformLocation("pick_id");
+
+	// the texture units are fixed
+	m_shaders->bind();
+	m_shaders->setUniformValue(m_uniShadowMap, 0);
+	m_shaders->setUniformValue(m_uniTexture, 1);
+	m_shaders->setUniformValue(m_uniLights, 2);
+	m_shaders->setUniformValue(m_uniLightTiles, 3);
+	m_shaders->release();
+
+	CreateUniformBuffers(pGl);
+	CreateUpscaleShaders(pGl, strGlsl);
 	LOGGLERR(pGl);
 
 	CreateSelectionPlane();
+#ifdef _GL_OCCLUSION_QUERIES
+	CreateOcclusionBox();
+#endif
 	SetLight(0, m::create<t_vec3_gl>({ 0, 0, 10 }));
 
 	m_initialised = true;
@@ -1300,7 +2319,6 @@ void GlSceneRenderer::resizeGL(int w, int h)
 	m_cam.SetScreenDimensions(w, h);
 
 	m_viewportNeedsUpdate = true;
-	m_shadowFramebufferNeedsUpdate = true;
 	m_lightsNeedUpdate = true;
 
 	UpdateCam();
@@ -1308,7 +2326,7 @@ void GlSceneRenderer::resizeGL(int w, int h)
 
 
 /**
- * framebuffer for shadow rendering
+ * depth-only framebuffer for shadow rendering
  * @see (Sellers 2014) pp. 534-540
  */
 void GlSceneRenderer::UpdateShadowFramebuffer()
@@ -1320,110 +2338,1011 @@ void GlSceneRenderer::UpdateShadowFramebuffer()
 	if(!pGl)
 		return;
 
-	t_real scale = devicePixelRatioF();
-	int w = m_cam.GetScreenDimensions()[0] * scale;
-	int h = m_cam.GetScreenDimensions()[1] * scale;
+	DeleteShadowFramebuffer();
+
+	const GLsizei size = std::max(m_shadowMapSize, 16);
+
+	// depth texture
+	pGl->glActiveTexture(GL_TEXTURE0);
+	pGl->glGenTextures(1, &m_texshadow);
+	pGl->glBindTexture(GL_TEXTURE_2D, m_texshadow);
+	pGl->glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0,
+		GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
 
-	QOpenGLFramebufferObjectFormat fbformat;
-	fbformat.setTextureTarget(GL_TEXTURE_2D);
-	fbformat.setInternalTextureFormat(GL_RGBA32F);
-	fbformat.setAttachment(QOpenGLFramebufferObject::Depth);
-	m_fboshadow = std::make_shared<QOpenGLFramebufferObject>(
-		w, h, fbformat);
+	// shadow texture parameters
+	// see: https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glTexParameter.xhtml
+	pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// everything outside the light's frustum is lit
+	const GLfloat border[] = { 1., 1., 1., 1. };
+	pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	pGl->glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+
+	pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	pGl->glBindTexture(GL_TEXTURE_2D, 0);
 	LOGGLERR(pGl);
 
-	BOOST_SCOPE_EXIT(pGl, m_fboshadow)
+	// framebuffer without colour attachments
+	pGl->glGenFramebuffers(1, &m_fboshadow);
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, m_fboshadow);
+
+	BOOST_SCOPE_EXIT(this_, pGl)
 	{
-		pGl->glActiveTexture(GL_TEXTURE0);
-		pGl->glBindTexture(GL_TEXTURE_2D, 0);
-		if(m_fboshadow)
-			m_fboshadow->release();
+		pGl->glBindFramebuffer(GL_FRAMEBUFFER, this_->GetDefaultFramebuffer());
 	} BOOST_SCOPE_EXIT_END
 
+	pGl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+		GL_TEXTURE_2D, m_texshadow, 0);
+	pGl->glDrawBuffer(GL_NONE);
+	pGl->glReadBuffer(GL_NONE);
+
+	if(pGl->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cerr << "Shadow framebuffer is incomplete." << std::endl;
+	LOGGLERR(pGl);
+
+	m_shadowFramebufferNeedsUpdate = false;
+	m_shadowMapNeedsUpdate = true;
+	m_lightsNeedUpdate = true;
+}
+
+
+/**
+ * delete the shadow framebuffer and texture, needs a current gl context
+ */
+void GlSceneRenderer::DeleteShadowFramebuffer()
+{
+	auto *pGl = GetGlFunctions();
+	if(!pGl)
+		return;
+
 	if(m_fboshadow)
-	{
-		pGl->glActiveTexture(GL_TEXTURE0);
+		pGl->glDeleteFramebuffers(1, &m_fboshadow);
+	if(m_texshadow)
+		pGl->glDeleteTextures(1, &m_texshadow);
 
-		m_fboshadow->bind();
-		LOGGLERR(pGl);
+	m_fboshadow = 0;
+	m_texshadow = 0;
+}
 
-		pGl->glBindTexture(GL_TEXTURE_2D, m_fboshadow->texture());
-		LOGGLERR(pGl);
 
-		// shadow texture parameters
-		// see: https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glTexParameter.xhtml
-		pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+/**
+ * does the shadow map have to be rendered again?
+ */
+bool GlSceneRenderer::IsShadowMapOutdated() const
+{
+	return !m_shadowMapCacheEnabled || m_shadowMapNeedsUpdate ||
+		m_shadowFramebufferNeedsUpdate || m_lightsNeedUpdate || !m_fboshadow;
+}
+
+
+/**
+ * framebuffer with the object id and the depth of a single pixel, and its read-back buffer
+ */
+void GlSceneRenderer::CreatePickFramebuffer(qgl_funcs *pGl)
+{
+	DeletePickFramebuffer();
+
+	pGl->glGenFramebuffers(1, &m_fbo_pick);
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, m_fbo_pick);
+
+	pGl->glGenRenderbuffers(1, &m_rbo_pick_id);
+	pGl->glBindRenderbuffer(GL_RENDERBUFFER, m_rbo_pick_id);
+	pGl->glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, 1, 1);
+	pGl->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_rbo_pick_id);
 
-		pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-		pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	pGl->glGenRenderbuffers(1, &m_rbo_pick_depth);
+	pGl->glBindRenderbuffer(GL_RENDERBUFFER, m_rbo_pick_depth);
+	pGl->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 1, 1);
+	pGl->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_rbo_pick_depth);
+	pGl->glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	// the shader's colour output is discarded, its id output goes into the attachment
+	const GLenum draw_buffers[] = { GL_NONE, GL_COLOR_ATTACHMENT0 };
+	pGl->glDrawBuffers(2, draw_buffers);
+	pGl->glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+	const bool complete = (pGl->glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, GetDefaultFramebuffer());
+
+	if(!complete)
+	{
+		std::cerr << "Picking framebuffer is incomplete." << std::endl;
+		DeletePickFramebuffer();
+		return;
 	}
 
-	m_shadowFramebufferNeedsUpdate = false;
+	// object id and depth
+	pGl->glGenBuffers(1, &m_pick_readback.pbo);
+	pGl->glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pick_readback.pbo);
+	pGl->glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint) + sizeof(GLfloat), nullptr, GL_STREAM_READ);
+	pGl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	LOGGLERR(pGl);
 }
 
 
 /**
- * find objects that are marked as portals
+ * delete the picking framebuffer, needs a current gl context
  */
-void GlSceneRenderer::CreateActivePortals()
+void GlSceneRenderer::DeletePickFramebuffer()
 {
-	m_active_portal = nullptr;
-	m_active_portals.clear();
+	auto *pGl = GetGlFunctions();
+	if(!pGl)
+		return;
 
-	for(const auto& [obj_name, obj] : m_objs)
-	{
-		if(bool obj_is_portal = (obj.m_portal_id >= 0); obj_is_portal)
-		{
-			// remember current portal for subsequent rendering passes
-			ActivePortal active_portal
-			{
-				.id = obj.m_portal_id,
-				.mat = obj.m_portal_mat,
-				.mirror = obj.m_portal_mirror
-			};
+#ifdef _GL_FENCE_SYNC
+	if(m_pick_readback.fence)
+		pGl->glDeleteSync(m_pick_readback.fence);
+	m_pick_readback.fence = nullptr;
+#endif
+	m_pick_readback.pending = false;
 
-			m_active_portals.emplace_back(std::move(active_portal));
-		}
+	if(m_pick_readback.pbo)
+		pGl->glDeleteBuffers(1, &m_pick_readback.pbo);
+	if(m_fbo_pick)
+		pGl->glDeleteFramebuffers(1, &m_fbo_pick);
+	for(GLuint *rbo : { &m_rbo_pick_id, &m_rbo_pick_depth })
+	{
+		if(*rbo)
+			pGl->glDeleteRenderbuffers(1, rbo);
+		*rbo = 0;
 	}
+
+	m_pick_readback.pbo = 0;
+	m_fbo_pick = 0;
 }
 
 
 /**
- * draw the scene
+ * render the object ids of the pixel under the cursor and start their read-back,
+ * the viewport is shifted so that this pixel is the framebuffer's only one
  */
-void GlSceneRenderer::paintGL()
+void GlSceneRenderer::RenderPickPass(qgl_funcs *pGl)
 {
-	if(!m_initialised || thread() != QThread::currentThread())
+	m_gpuPickRequested = false;
+
+	const auto& dims = m_cam.GetScreenDimensions();
+	if(dims[0] <= 0 || dims[1] <= 0)
 		return;
 
-	QMutexLocker _locker{&m_mutexObj};
+	if(!m_fbo_pick)
+		CreatePickFramebuffer(pGl);
+	if(!m_fbo_pick)
+		return;
 
-	if(auto *pContext = context(); !pContext) return;
-	auto *pGl = GetGlFunctions();
+	const GLint x = std::clamp(GLint(m_posMouse.x()), 0, dims[0] - 1);
+	const GLint y = std::clamp(dims[1] - 1 - GLint(m_posMouse.y()), 0, dims[1] - 1);
+	auto [z_near, z_far] = m_cam.GetDepthRange();
+
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, m_fbo_pick);
+	pGl->glViewport(-x, -y, dims[0], dims[1]);
+	pGl->glDepthRange(z_near, z_far);
+	m_viewportNeedsUpdate = false;
+
+	m_pick_objs.clear();
+	m_portalRenderPass = PortalRenderPass::IGNORE;
+	m_pickRenderPass = true;
+	DoPaintGL(pGl);
+	m_pickRenderPass = false;
+	m_viewportNeedsUpdate = true;  // restore the main viewport
+
+	// copy the id and the depth into the pixel buffer, this returns without waiting for the gpu
+	pGl->glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pick_readback.pbo);
+	pGl->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	pGl->glReadBuffer(GL_COLOR_ATTACHMENT0);
+	pGl->glReadPixels(0, 0, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	pGl->glReadPixels(0, 0, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT,
+		reinterpret_cast<const void*>(sizeof(GLuint)));
+	pGl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, GetDefaultFramebuffer());
+
+#ifdef _GL_FENCE_SYNC
+	m_pick_readback.fence = pGl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+	LOGGLERR(pGl);
+
+	// pixel centre in normalised device coordinates, and the matrix to unproject it
+	m_pick_ndc = m::create<t_vec_gl>({
+		(t_real_gl(x) + t_real_gl(0.5)) / t_real_gl(dims[0]) * t_real_gl(2) - t_real_gl(1),
+		(t_real_gl(y) + t_real_gl(0.5)) / t_real_gl(dims[1]) * t_real_gl(2) - t_real_gl(1),
+		0, 1 });
+	m_pick_inv_viewproj = m_cam.GetInverseTransformation() * m_cam.GetInversePerspective();
+	m_pick_readback.pending = true;
+}
+
+
+/**
+ * get the object id and the depth of the last pick pass if they have arrived
+ */
+void GlSceneRenderer::CollectPickResult(qgl_funcs *pGl)
+{
+	if(!m_pick_readback.pending)
+		return;
 
-	// shadow framebuffer render pass
-	if(m_shadowRenderingEnabled)
+#ifdef _GL_FENCE_SYNC
+	if(m_pick_readback.fence)
 	{
-		m_portalRenderPass = PortalRenderPass::IGNORE;
-		m_shadowRenderPass = true;
-		DoPaintGL(pGl);
-		m_shadowRenderPass = false;
+		// still being rendered, try again in the next frame
+		if(pGl->glClientWaitSync(m_pick_readback.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+			return;
+
+		pGl->glDeleteSync(m_pick_readback.fence);
+		m_pick_readback.fence = nullptr;
+	}
+#endif
+
+	GLuint pick_id = 0;
+	GLfloat depth = 1;
+
+	pGl->glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pick_readback.pbo);
+	if(const void *data = pGl->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+		sizeof(GLuint) + sizeof(GLfloat), GL_MAP_READ_BIT); data)
+	{
+		std::memcpy(&pick_id, data, sizeof(pick_id));
+		std::memcpy(&depth, reinterpret_cast<const char*>(data) + sizeof(GLuint), sizeof(depth));
+		pGl->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	pGl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	LOGGLERR(pGl);
+
+	m_pick_readback.pending = false;
+
+	m_curObj = "";
+	if(pick_id == 0 || pick_id > m_pick_objs.size())
+	{
+		emit PickerIntersection(nullptr, m_curObj);
+		return;
+	}
+
+	// unproject the pixel at its depth to get the intersection point
+	auto [z_near, z_far] = m_cam.GetDepthRange();
+	t_vec_gl ndc = m_pick_ndc;
+	ndc[2] = (t_real_gl(depth) - z_near) / (z_far - z_near) * t_real_gl(2) - t_real_gl(1);
+
+	t_vec_gl inters = m_pick_inv_viewproj * ndc;
+	inters /= inters[3];
+	t_vec3_gl inters3 = m::create<t_vec3_gl>({ inters[0], inters[1], inters[2] });
+
+	m_curObj = m_pick_objs[pick_id - 1];
+	emit PickerIntersection(&inters3, m_curObj);
+}
+
+
+/**
+ * get the plane of a flat portal surface from its bounding box,
+ * the normal points away from the camera
+ */
+static std::optional<t_vec_gl> get_portal_plane(const t_mat_gl& matObj,
+	const std::vector<t_vec_gl>& bbox, const t_vec_gl& campos)
+{
+	if(bbox.size() == 0)
+		return std::nullopt;
+
+	// extents of the box in object coordinates
+	t_real_gl min[3], max[3];
+	for(int i=0; i<3; ++i)
+	{
+		min[i] = std::numeric_limits<t_real_gl>::max();
+		max[i] = std::numeric_limits<t_real_gl>::lowest();
+	}
+
+	for(const t_vec_gl& vec : bbox)
+	{
+		for(int i=0; i<3; ++i)
+		{
+			min[i] = std::min(min[i], vec[i]);
+			max[i] = std::max(max[i], vec[i]);
+		}
+	}
+
+	// the thinnest side of the box is perpendicular to the surface
+	int axis = 0;
+	for(int i=1; i<3; ++i)
+	{
+		if(max[i] - min[i] < max[axis] - min[axis])
+			axis = i;
+	}
+
+	t_vec_gl tangent1 = m::create<t_vec_gl>({ 0, 0, 0, 0 });
+	t_vec_gl tangent2 = m::create<t_vec_gl>({ 0, 0, 0, 0 });
+	tangent1[(axis + 1) % 3] = 1;
+	tangent2[(axis + 2) % 3] = 1;
+	tangent1 = matObj * tangent1;
+	tangent2 = matObj * tangent2;
+
+	const t_vec_gl centre = matObj * m::create<t_vec_gl>({
+		(min[0] + max[0]) * t_real_gl(0.5),
+		(min[1] + max[1]) * t_real_gl(0.5),
+		(min[2] + max[2]) * t_real_gl(0.5), 1 });
+
+	t_vec_gl plane = m::create<t_vec_gl>({
+		tangent1[1]*tangent2[2] - tangent1[2]*tangent2[1],
+		tangent1[2]*tangent2[0] - tangent1[0]*tangent2[2],
+		tangent1[0]*tangent2[1] - tangent1[1]*tangent2[0], 0 });
+
+	const t_real_gl len = std::sqrt(plane[0]*plane[0] + plane[1]*plane[1] + plane[2]*plane[2]);
+	if(len <= std::numeric_limits<t_real_gl>::epsilon())
+		return std::nullopt;
+
+	for(int i=0; i<3; ++i)
+		plane[i] /= len;
+	plane[3] = -(plane[0]*centre[0] + plane[1]*centre[1] + plane[2]*centre[2]);
+
+	// put the camera on the negative side
+	if(plane[0]*campos[0] + plane[1]*campos[1] + plane[2]*campos[2] + plane[3] > 0)
+	{
+		for(int i=0; i<4; ++i)
+			plane[i] = -plane[i];
+	}
+
+	return plane;
+}
+
+
+/**
+ * replace the near plane of a projection by a camera-space clipping plane
+ * @see E. Lengyel, "Oblique View Frustum Depth Projection and Clipping", JGT 10(2) (2005)
+ */
+static t_mat_gl get_oblique_projection(const t_mat_gl& proj, const t_mat_gl& proj_inv,
+	const t_vec_gl& plane)
+{
+	auto sgn = [](t_real_gl val) -> t_real_gl
+	{
+		return val > 0 ? t_real_gl(1) : (val < 0 ? t_real_gl(-1) : t_real_gl(0));
+	};
+
+	// corner of the frustum opposite to the plane
+	const t_vec_gl corner = proj_inv * m::create<t_vec_gl>({
+		sgn(plane[0]), sgn(plane[1]), 1, 1 });
+
+	t_real_gl dot = 0;
+	for(int i=0; i<4; ++i)
+		dot += plane[i] * corner[i];
+	if(std::abs(dot) <= std::numeric_limits<t_real_gl>::epsilon())
+		return proj;
+
+	t_mat_gl oblique = proj;
+	for(int col=0; col<4; ++col)
+		oblique(2, col) = plane[col] * t_real_gl(2) / dot - proj(3, col);
+
+	return oblique;
+}
+
+
+/**
+ * build the tree of the portals in the view, starting with the directly visible ones
+ */
+void GlSceneRenderer::CreateActivePortals()
+{
+	m_active_portal = nullptr;
+	m_active_portals.clear();
+	m_portal_roots.clear();
+
+	AddActivePortals(std::nullopt);
+
+	Profiler::GetInstance().AddCount("visible portals", double(m_active_portals.size()));
+}
+
+
+/**
+ * add the portals that are visible directly or through a parent portal,
+ * portals outside the view or outside the parent portal's screen bounds are skipped
+ */
+void GlSceneRenderer::AddActivePortals(std::optional<std::size_t> parent)
+{
+	// nested portals multiply, this limits the number of render passes
+	constexpr std::size_t max_portals = 64;
+
+	const t_vec_gl campos = m_cam.GetInverseTransformation() * m::create<t_vec_gl>({ 0, 0, 0, 1 });
+
+	// the list of active portals grows in the recursion, so everything is accessed by index
+	auto get_objs = [this, &parent]() -> const std::vector<GlSceneObj*>&
+	{
+		return parent ? m_active_portals[*parent].visible_objs : m_visible_objs;
+	};
+
+	for(std::size_t objidx = 0; objidx < get_objs().size(); ++objidx)
+	{
+		GlSceneObj *obj = get_objs()[objidx];
+		if(obj->m_portal_id < 0 || !obj->m_visible)
+			continue;
+		if(m_active_portals.size() >= max_portals)
+			break;
+
+		ActivePortal portal{ .id = obj->m_portal_id, .obj = obj };
+		portal.proj_surface = m_cam.GetPerspective();
+
+		std::optional<t_vec_gl> parent_plane;
+		if(parent)
+		{
+			const ActivePortal& parent_portal = m_active_portals[*parent];
+
+			portal.mat_surface = parent_portal.mat;
+			portal.mirror_surface = parent_portal.mirror;
+			portal.proj_surface = parent_portal.proj;
+			portal.depth = parent_portal.depth + 1;
+			portal.rect = parent_portal.rect;
+			parent_plane = parent_portal.plane;
+		}
+
+		portal.mat = portal.mat_surface * obj->m_portal_mat;
+		portal.mirror = (portal.mirror_surface != obj->m_portal_mirror);
+
+		// screen-space bounds, clipped to the parent portal's
+		const t_mat_gl matObj = portal.mat_surface * obj->m_mat;
+		const t_cam::t_rect rect = m_cam.GetProjectedRect(matObj, obj->m_boundingBox);
+		for(int i=0; i<2; ++i)
+		{
+			portal.rect[2*i] = std::max(portal.rect[2*i], rect[2*i]);
+			portal.rect[2*i + 1] = std::min(portal.rect[2*i + 1], rect[2*i + 1]);
+		}
+		if(portal.rect[0] >= portal.rect[1] || portal.rect[2] >= portal.rect[3])
+			continue;
+
+		// clip the objects between the camera and the portal
+		portal.proj = m_cam.GetPerspective();
+		if(auto plane = get_portal_plane(matObj, obj->m_boundingBox, campos); plane)
+		{
+			// a mirror's image of itself lies in its own plane
+			if(parent_plane)
+			{
+				t_real_gl dist = 0;
+				for(int i=0; i<4; ++i)
+					dist += std::abs((*plane)[i] - (*parent_plane)[i]);
+				if(dist < t_real_gl(1e-4))
+					continue;
+			}
+
+			portal.plane = *plane;
+
+			// plane in camera coordinates
+			const t_mat_gl& cam_inv = m_cam.GetInverseTransformation();
+			t_vec_gl plane_cam = m::create<t_vec_gl>({ 0, 0, 0, 0 });
+			for(int col=0; col<4; ++col)
+				for(int row=0; row<4; ++row)
+					plane_cam[col] += cam_inv(row, col) * portal.plane[row];
+
+			// only if the camera is clearly in front of the portal
+			if(plane_cam[3] < -std::numeric_limits<t_real_gl>::epsilon())
+			{
+				portal.proj = get_oblique_projection(m_cam.GetPerspective(),
+					m_cam.GetInversePerspective(), plane_cam);
+			}
+		}
+
+		CullObjects(m_cam, &portal.mat, portal.visible_objs, portal.rect);
+
+		const std::size_t idx = m_active_portals.size();
+		const std::size_t depth = portal.depth;
+		m_active_portals.emplace_back(std::move(portal));
+		(parent ? m_active_portals[*parent].children : m_portal_roots).push_back(idx);
+
+		// portals seen through this one
+		if(depth < m_portalDepth)
+			AddActivePortals(idx);
+	}
+}
+
+
+/**
+ * render the view through a portal and, before, the views through the portals seen in it
+ */
+void GlSceneRenderer::RenderPortal(qgl_funcs *pGl, std::size_t idx)
+{
+	const ActivePortal& portal = m_active_portals[idx];
+
+	// pass 0: mark the visible part of the portal surface in the stencil buffer
+	m_active_portal = &portal;
+	m_portalRenderPass = PortalRenderPass::CREATE_STENCIL;
+	DoPaintGL(pGl);
+
+	// pass 1: reset the z buffer in the marked region
+	m_portalRenderPass = PortalRenderPass::CLEAR_Z;
+	DoPaintGL(pGl);
+
+	for(std::size_t child : portal.children)
+		RenderPortal(pGl, child);
+
+	// pass 2: draw the scene that is visible through the portal
+	m_active_portal = &portal;
+	m_portalRenderPass = PortalRenderPass::RENDER_PORTALS;
+	DoPaintGL(pGl);
+
+	// pass 3: write the portal surface to the z buffer and unmark its region
+	m_portalRenderPass = PortalRenderPass::RESTORE_Z;
+	DoPaintGL(pGl);
+}
+
+
+/**
+ * collect the objects whose world bounding boxes are inside a camera's frustum,
+ * or inside the part of it given by a screen-space rectangle
+ */
+void GlSceneRenderer::CullObjects(const t_cam& cam, const t_mat_gl* matPortal,
+	std::vector<GlSceneObj*>& visible_objs, const t_cam::t_rect& rect)
+{
+	visible_objs.clear();
+	visible_objs.reserve(m_scene_bvh_objs.size());
+
+	// the world boxes seen through a portal are tested against the transformed frustum
+	m_obj_bounds.Cull(cam.GetFrustumPlanes(
+		matPortal ? *matPortal : m::unit<t_mat_gl>(), rect), m_obj_inside);
+
+	for(std::size_t objidx=0; objidx<m_scene_bvh_objs.size(); ++objidx)
+	{
+		GlSceneObj& obj = m_scene_bvh_objs[objidx]->second;
+		if(obj.m_visible && m_obj_inside[objidx])
+			visible_objs.push_back(&obj);
+	}
+}
+
+
+/**
+ * determine the visible objects once per frame for the camera and the light
+ */
+void GlSceneRenderer::CullScene()
+{
+	// objects have been added, removed, or moved
+	if(m_sceneBvhNeedsRebuild || m_objBoundsNeedUpdate)
+		UpdateSceneBvh(m_sceneBvhNeedsRebuild);
+
+	if(m_shadowRenderingEnabled && IsShadowMapOutdated())
+		CullObjects(m_lightcam, nullptr, m_visible_objs_shadow);
+
+	CullObjects(m_cam, nullptr, m_visible_objs);
+
+	// objects hidden by the user are neither rendered nor culled
+	m_num_objs_shown = m_num_objs_culled = 0;
+	for(std::size_t objidx=0; objidx<m_scene_bvh_objs.size(); ++objidx)
+	{
+		if(!m_scene_bvh_objs[objidx]->second.m_visible)
+			continue;
+
+		++m_num_objs_shown;
+		if(!m_obj_inside[objidx])
+			++m_num_objs_culled;
+	}
+	m_num_objs_occluded = 0;
+
+	SelectLods();
+}
+
+
+/**
+ * choose the level of detail of the visible objects by their size on the screen
+ */
+void GlSceneRenderer::SelectLods()
+{
+	const t_real_gl lod_pixels = m_lodPixels;
+
+	for(GlSceneObj* obj : m_visible_objs)
+	{
+		obj->m_lod = 0;
+		if(obj->m_num_lods <= 1 || lod_pixels <= 0.)
+			continue;
+
+		// world-space bounding sphere
+		t_vec_gl centre = obj->m_mat * m::create<t_vec_gl>({
+			obj->m_boundingSpherePos[0],
+			obj->m_boundingSpherePos[1],
+			obj->m_boundingSpherePos[2], 1. });
+
+		t_real_gl scale = 0.;
+		for(int col=0; col<3; ++col)
+		{
+			t_real_gl len = 0.;
+			for(int row=0; row<3; ++row)
+				len += obj->m_mat(row, col) * obj->m_mat(row, col);
+			scale = std::max(scale, std::sqrt(len));
+		}
+
+		const t_real_gl rad_pixels = m_cam.GetProjectedRadius(
+			centre, obj->m_boundingSphereRad * scale);
+
+		// each coarser level is used for a quarter of the size
+		for(t_real_gl threshold = lod_pixels;
+			obj->m_lod + 1 < obj->m_num_lods && rad_pixels < threshold;
+			threshold *= 0.25)
+		{
+			++obj->m_lod;
+		}
+	}
+}
+
+
+/**
+ * set the projected radius in pixels below which coarser meshes are used
+ */
+void GlSceneRenderer::SetLodPixels(t_real_gl pixels)
+{
+	m_lodPixels = pixels;
+	update();
+}
+
+
+/**
+ * set the distance beyond which a light has no effect, 0: unbounded
+ */
+void GlSceneRenderer::SetLightRange(t_real_gl range)
+{
+	m_lightRange = std::max<t_real_gl>(range, 0);
+	m_lightsNeedUpdate = true;
+	update();
+}
+
+
+/**
+ * set the gpu memory budget for the textures, 0: unlimited
+ */
+void GlSceneRenderer::SetTextureMemory(std::size_t bytes)
+{
+	m_texture_vram_limit = bytes;
+	update();
+}
+
+
+#ifdef _GL_OCCLUSION_QUERIES
+/**
+ * create the box drawn in place of the objects for the occlusion queries
+ */
+void GlSceneRenderer::CreateOcclusionBox()
+{
+	auto solid = m::create_cube<t_vec3_gl>(0.5, 0.5, 0.5);
+	auto [verts, norms, uvs] = m::create_triangles<t_vec3_gl>(solid);
+	auto col = m::create<t_vec_gl>({ 1, 1, 1, 1 });
+
+	CreateTriangleObject(m_occlusionBox,
+		verts, verts, norms, uvs, col,
+		false, m_attrVertex, m_attrVertexNorm,
+		m_attrTexCoords);
+}
+
+
+/**
+ * get the results of the previous frame's occlusion queries without stalling
+ */
+void GlSceneRenderer::UpdateOcclusionResults(qgl_funcs *pGl)
+{
+	for(GlSceneObj* obj : m_visible_objs)
+	{
+		if(!obj->m_occlusion_query_issued)
+			continue;
+
+		// keep the previous result if the query has not yet finished
+		GLuint available = 0;
+		pGl->glGetQueryObjectuiv(obj->m_occlusion_query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if(!available)
+		{
+			m_occlusionViewChanged = true;  // poll again in the next frame
+			continue;
+		}
+
+		GLuint any_samples = 0;
+		pGl->glGetQueryObjectuiv(obj->m_occlusion_query, GL_QUERY_RESULT, &any_samples);
+
+		// the set of drawn objects changes, so the new frame has to be tested again
+		if(obj->m_occluded != (any_samples == 0))
+			m_occlusionViewChanged = true;
+		obj->m_occluded = (any_samples == 0);
+		obj->m_occlusion_query_issued = false;
+	}
+	LOGGLERR(pGl);
+}
+
+
+/**
+ * test the bounding boxes of the visible objects against the current depth buffer,
+ * the results are used to skip hidden objects in the next frame
+ */
+void GlSceneRenderer::IssueOcclusionQueries(qgl_funcs *pGl)
+{
+	if(!m_occlusionBox.m_vertex_array)
+		return;
+
+	// the results only have to be read back by an extra frame if the view has changed
+	m_occlusionResultsPending = m_occlusionViewChanged.exchange(false);
+
+	// only test against the depth buffer
+	pGl->glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	pGl->glDepthMask(GL_FALSE);
+	pGl->glDepthFunc(GL_LEQUAL);
+	m_glstates.SetCullFace(false);
+	m_glstates.SetUniform(m_uniInstancingEnabled, false);
+
+	m_occlusionBox.m_vertex_array->bind();
+
+	BOOST_SCOPE_EXIT(pGl, &m_occlusionBox)
+	{
+		m_occlusionBox.m_vertex_array->release();
+
+		pGl->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		pGl->glDepthMask(GL_TRUE);
+		pGl->glDepthFunc(GL_LESS);
+	} BOOST_SCOPE_EXIT_END
+
+	// camera position
+	const t_mat_gl& matCamInv = m_cam.GetInverseTransformation();
+	const t_real_gl campos[] = { matCamInv(0, 3), matCamInv(1, 3), matCamInv(2, 3) };
+
+	for(GlSceneObj* obj : m_visible_objs)
+	{
+		// the previous query is still running
+		if(obj->m_occlusion_query_issued || obj->m_boundingBox.size() < 8)
+			continue;
+
+		// the box would be clipped by the near plane if the camera is (nearly) inside it
+		const t_bvh::t_box box = m_obj_bounds.GetWorldBox(obj->m_bounds_idx);
+		bool cam_inside = true;
+		for(int i=0; i<3; ++i)
+		{
+			t_real_gl margin = t_real_gl(0.1) * (box.max[i] - box.min[i]) + t_real_gl(0.1);
+			if(campos[i] < box.min[i] - margin || campos[i] > box.max[i] + margin)
+			{
+				cam_inside = false;
+				break;
+			}
+		}
+
+		if(cam_inside)
+		{
+			obj->m_occluded = false;
+			continue;
+		}
+
+		if(!obj->m_occlusion_query)
+			pGl->glGenQueries(1, &obj->m_occlusion_query);
+
+		// map the unit box onto the object's bounding box
+		const t_vec_gl& bbMin = obj->m_boundingBox[0];
+		const t_vec_gl& bbMax = obj->m_boundingBox[7];
+		t_mat_gl matBox = m::unit<t_mat_gl>();
+		for(int i=0; i<3; ++i)
+		{
+			matBox(i, i) = bbMax[i] - bbMin[i];
+			matBox(i, 3) = t_real_gl(0.5) * (bbMin[i] + bbMax[i]);
+		}
+
+		m_shaders->setUniformValue(m_uniMatrixObj, obj->m_mat * matBox);
+
+		pGl->glBeginQuery(GL_ANY_SAMPLES_PASSED, obj->m_occlusion_query);
+		pGl->glDrawElements(GL_TRIANGLES, m_occlusionBox.m_num_indices, GL_UNSIGNED_INT,
+			reinterpret_cast<const void*>(m_occlusionBox.m_index_range.offset));
+		pGl->glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+		obj->m_occlusion_query_issued = true;
+	}
+	LOGGLERR(pGl);
+}
+#endif
+
+
+/**
+ * delete an object's occlusion query, needs a current gl context
+ */
+void GlSceneRenderer::DeleteOcclusionQuery([[maybe_unused]] GlSceneObj& obj)
+{
+#ifdef _GL_OCCLUSION_QUERIES
+	if(!obj.m_occlusion_query)
+		return;
+
+	if(qgl_funcs *pGl = GetGlFunctions(); pGl)
+		pGl->glDeleteQueries(1, &obj.m_occlusion_query);
+
+	obj.m_occlusion_query = 0;
+	obj.m_occlusion_query_issued = false;
+	obj.m_occluded = false;
+#endif
+}
+
+
+/**
+ * start measuring the gpu time of a render pass
+ */
+void GlSceneRenderer::BeginTimerQuery([[maybe_unused]] qgl_funcs *pGl,
+	[[maybe_unused]] const char* section)
+{
+#ifdef _GL_TIMER_QUERIES
+	// timer queries cannot be nested
+	if(!Profiler::GetInstance().IsEnabled() || m_cur_timer_query)
+		return;
+
+	// re-use a finished query
+	std::optional<std::size_t> idx;
+	for(std::size_t i=0; i<m_timer_queries.size(); ++i)
+	{
+		if(!m_timer_queries[i].pending)
+		{
+			idx = i;
+			break;
+		}
+	}
+
+	if(!idx)
+	{
+		// don't accumulate queries if the results never arrive
+		constexpr std::size_t max_queries = 64;
+		if(m_timer_queries.size() >= max_queries)
+			return;
+
+		GlTimerQuery query;
+		pGl->glGenQueries(1, &query.query);
+		m_timer_queries.push_back(query);
+		idx = m_timer_queries.size() - 1;
+	}
+
+	GlTimerQuery& query = m_timer_queries[*idx];
+	query.section = section;
+	query.pending = true;
+	m_cur_timer_query = idx;
+
+	pGl->glBeginQuery(GL_TIME_ELAPSED, query.query);
+#endif
+}
+
+
+/**
+ * stop measuring the gpu time of the current render pass
+ */
+void GlSceneRenderer::EndTimerQuery([[maybe_unused]] qgl_funcs *pGl)
+{
+#ifdef _GL_TIMER_QUERIES
+	if(!m_cur_timer_query)
+		return;
+
+	pGl->glEndQuery(GL_TIME_ELAPSED);
+	m_cur_timer_query.reset();
+#endif
+}
+
+
+/**
+ * add the finished gpu timings of previous frames to the profiler without stalling
+ */
+void GlSceneRenderer::CollectTimerQueries([[maybe_unused]] qgl_funcs *pGl)
+{
+#ifdef _GL_TIMER_QUERIES
+	Profiler& profiler = Profiler::GetInstance();
+
+	for(GlTimerQuery& query : m_timer_queries)
+	{
+		if(!query.pending)
+			continue;
+
+		GLuint available = 0;
+		pGl->glGetQueryObjectuiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if(!available)
+			continue;
+
+		GLuint64 ns = 0;
+		pGl->glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &ns);
+		profiler.AddTime(query.section, double(ns) * 1e-6);
+
+		query.pending = false;
+	}
+	LOGGLERR(pGl);
+#endif
+}
+
+
+/**
+ * delete the gpu timers
+ */
+void GlSceneRenderer::DeleteTimerQueries()
+{
+#ifdef _GL_TIMER_QUERIES
+	if(!m_timer_queries.size())
+		return;
+
+	BOOST_SCOPE_EXIT(this_)
+	{
+		this_->DoneCurrent();
+	} BOOST_SCOPE_EXIT_END
+	MakeCurrent();
+
+	if(qgl_funcs *pGl = GetGlFunctions(); pGl)
+	{
+		for(GlTimerQuery& query : m_timer_queries)
+			pGl->glDeleteQueries(1, &query.query);
+	}
+
+	m_timer_queries.clear();
+	m_cur_timer_query.reset();
+#endif
+}
+
+
+/**
+ * draw the scene
+ */
+void GlSceneRenderer::paintGL()
+{
+	if(!m_initialised || thread() != QThread::currentThread())
+		return;
+
+	QMutexLocker _locker{&m_mutexObj};
+
+	if(auto *pContext = GetContext(); !pContext) return;
+	auto *pGl = GetGlFunctions();
+
+	Profiler& profiler = Profiler::GetInstance();
+	BOOST_SCOPE_EXIT(&profiler)
+	{
+		profiler.EndFrame();
+	} BOOST_SCOPE_EXIT_END
+
+	ProfilerScope _prof{"cpu: paintGL"};
+
+	CollectTimerQueries(pGl);
+	UpdateRenderScale(pGl);
+	BeginFrameTimer(pGl);
+	m_num_draw_calls = m_num_triangles = 0;
+	++m_texture_frame;
+
+	UpdateFromSimulation();
+
+	// determine the visible objects for all passes
+	CullScene();
+
+	// per-frame states shared by all passes
+	if(m_lightsNeedUpdate)
+		UpdateLights();
+	if(m_lightTilesNeedUpdate)
+		UpdateLightTiles(pGl);
+	UpdateFrameUniforms(pGl);
+
+	// shadow framebuffer render pass, the cached map is re-used if nothing has changed
+	if(m_shadowRenderingEnabled && IsShadowMapOutdated())
+	{
+		m_portalRenderPass = PortalRenderPass::IGNORE;
+		m_shadowRenderPass = true;
+		DoPaintGL(pGl);
+		m_shadowRenderPass = false;
+
+		m_shadowMapNeedsUpdate = false;
+		m_viewportNeedsUpdate = true;  // restore the main viewport
+		profiler.AddCount("shadow map updates", 1);
+	}
+
+	// object ids under the cursor, the previous result is fetched first
+	if(m_gpuPickingEnabled)
+	{
+		CollectPickResult(pGl);
+		if(m_pickerNeedsUpdate)
+			UpdatePicker();
+		if(m_gpuPickRequested && !m_pick_readback.pending)
+			RenderPickPass(pGl);
+	}
+
+	// there is no widget to paint on when rendering offscreen
+	std::optional<QPainter> painter;
+	if(!IsOffscreen())
+	{
+		painter.emplace(this);
+		painter->setRenderHint(QPainter::Antialiasing);
 	}
 
-	QPainter painter(this);
-	painter.setRenderHint(QPainter::Antialiasing);
-
 	// gl main render pass
 	{
-		if(m_pickerNeedsUpdate)
+		if(m_pickerNeedsUpdate && !m_gpuPickingEnabled)
+		{
+			ProfilerScope _prof_picker{"cpu: picker"};
 			UpdatePicker();
+		}
 
 		BOOST_SCOPE_EXIT(&painter)
 		{
-			painter.endNativePainting();
+			if(painter)
+				painter->endNativePainting();
 		} BOOST_SCOPE_EXIT_END
-		painter.beginNativePainting();
+		if(painter)
+			painter->beginNativePainting();
+		else
+			pGl->glBindFramebuffer(GL_FRAMEBUFFER, GetDefaultFramebuffer());
+
+		// a render scale other than 1 draws into a separate framebuffer, which is then upscaled
+		const bool scaled = BindScaledFramebuffer(pGl);
 
 		pGl->glClearColor(1., 1., 1., 1.);
 		pGl->glClearStencil(0);
@@ -1432,27 +3351,17 @@ void GlSceneRenderer::paintGL()
 		{
 			CreateActivePortals();
 
-			m_firstpass = true;
-			for(const ActivePortal& active_portal : m_active_portals)
-			{
-				m_active_portal = &active_portal;
-
-				// pass 0: draw portal masks into stencil buffer
-				m_portalRenderPass = PortalRenderPass::CREATE_STENCIL;
-				DoPaintGL(pGl);
+			// the buffers are only cleared once, the portal regions are reset by their surfaces
+			pGl->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			pGl->glDepthMask(GL_TRUE);
+			pGl->glStencilMask(~0);
+			pGl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-				// pass 1: draw scene that is only visible through portals
-				m_portalRenderPass = PortalRenderPass::RENDER_PORTALS;
-				DoPaintGL(pGl);
+			// draw the views through the visible portals, nested ones first
+			for(std::size_t idx : m_portal_roots)
+				RenderPortal(pGl, idx);
 
-				// pass 2: render only the z-values of the portals
-				m_portalRenderPass = PortalRenderPass::CREATE_Z;
-				DoPaintGL(pGl);
-
-				m_firstpass = false;
-			}
-
-			// pass 3: draw the rest of the scene without portals
+			// draw the rest of the scene without portals
 			m_portalRenderPass = PortalRenderPass::RENDER_NONPORTALS;
 			m_active_portal = nullptr;
 			DoPaintGL(pGl);
@@ -1460,14 +3369,38 @@ void GlSceneRenderer::paintGL()
 		else
 		{
 			m_portalRenderPass = PortalRenderPass::IGNORE;
-			m_firstpass = true;
 			DoPaintGL(pGl);
 		}
+
+		if(scaled)
+			UpscaleFramebuffer(pGl);
+		EndFrameTimer(pGl);
 	}
 
 	// qt painting pass
+	if(painter)
+	{
+		ProfilerScope _prof_qt{"cpu: qt painting"};
+		DoPaintQt(*painter);
+	}
+
+	profiler.AddCount("draw calls", m_num_draw_calls);
+	profiler.AddCount("triangles", m_num_triangles);
+
+	// textures not drawn in this frame can be released
+	EvictTextures(pGl);
+
+	// report changed culling statistics
+	if(m_num_objs_shown != m_last_num_objs ||
+		m_num_objs_culled != m_last_num_objs_culled ||
+		m_num_objs_occluded != m_last_num_objs_occluded)
 	{
-		DoPaintQt(painter);
+		m_last_num_objs = m_num_objs_shown;
+		m_last_num_objs_culled = m_num_objs_culled;
+		m_last_num_objs_occluded = m_num_objs_occluded;
+
+		emit CullingStatsChanged(m_last_num_objs,
+			m_last_num_objs_culled, m_last_num_objs_occluded);
 	}
 }
 
@@ -1477,13 +3410,39 @@ void GlSceneRenderer::paintGL()
  */
 void GlSceneRenderer::DoPaintGL(qgl_funcs *pGl)
 {
-	// remove shadow texture
-	BOOST_SCOPE_EXIT(m_fboshadow, pGl)
+	// measure the gpu time of the pass
+	const char* timer_section = "gpu: main pass";
+	if(m_shadowRenderPass)
+		timer_section = "gpu: shadow pass";
+	else if(m_pickRenderPass)
+		timer_section = "gpu: picking";
+	else if(m_portalRenderPass == PortalRenderPass::CREATE_STENCIL)
+		timer_section = "gpu: portal stencil";
+	else if(m_portalRenderPass == PortalRenderPass::RENDER_PORTALS)
+		timer_section = "gpu: through portals";
+	else if(m_portalRenderPass == PortalRenderPass::CLEAR_Z ||
+		m_portalRenderPass == PortalRenderPass::RESTORE_Z)
+		timer_section = "gpu: portal depth";
+	else if(m_portalRenderPass == PortalRenderPass::RENDER_NONPORTALS)
+		timer_section = "gpu: non-portals";
+
+	BeginTimerQuery(pGl, timer_section);
+	BOOST_SCOPE_EXIT(this_, pGl)
+	{
+		this_->EndTimerQuery(pGl);
+	} BOOST_SCOPE_EXIT_END
+
+	// remove shadow texture and framebuffer
+	BOOST_SCOPE_EXIT(this_, pGl)
 	{
 		pGl->glActiveTexture(GL_TEXTURE0);
 		pGl->glBindTexture(GL_TEXTURE_2D, 0);
-		if(m_fboshadow)
-			m_fboshadow->release();
+
+		if(this_->m_shadowRenderPass)
+		{
+			pGl->glDisable(GL_POLYGON_OFFSET_FILL);
+			pGl->glBindFramebuffer(GL_FRAMEBUFFER, this_->GetDefaultFramebuffer());
+		}
 	} BOOST_SCOPE_EXIT_END
 
 	bool portal_shadows =
@@ -1496,24 +3455,27 @@ void GlSceneRenderer::DoPaintGL(qgl_funcs *pGl)
 		if(m_shadowRenderPass)
 		{
 			// render into the shadow framebuffer
-			if(m_shadowFramebufferNeedsUpdate)
+			if(m_shadowFramebufferNeedsUpdate || !m_fboshadow)
 				UpdateShadowFramebuffer();
 
 			if(m_fboshadow)
-				m_fboshadow->bind();
+			{
+				pGl->glBindFramebuffer(GL_FRAMEBUFFER, m_fboshadow);
+				pGl->glViewport(0, 0, m_shadowMapSize, m_shadowMapSize);
+
+				// reduce self-shadowing artifacts
+				pGl->glEnable(GL_POLYGON_OFFSET_FILL);
+				pGl->glPolygonOffset(2., 4.);
+			}
 		}
 		else
 		{
 			// bind shadow texture
-			if(m_fboshadow)
+			if(m_texshadow)
 			{
 				pGl->glActiveTexture(GL_TEXTURE0);
-				pGl->glBindTexture(GL_TEXTURE_2D, m_fboshadow->texture());
+				pGl->glBindTexture(GL_TEXTURE_2D, m_texshadow);
 				LOGGLERR(pGl);
-
-				// see: https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glTexParameter.xhtml
-				pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-				pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 			}
 		}
 	}
@@ -1531,10 +3493,19 @@ void GlSceneRenderer::DoPaintGL(qgl_funcs *pGl)
 		pGl->glDisable(GL_MULTISAMPLE);
 	else
 		pGl->glEnable(GL_MULTISAMPLE);
-	pGl->glEnable(GL_LINE_SMOOTH);
-	pGl->glEnable(GL_POLYGON_SMOOTH);
-	pGl->glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
-	pGl->glHint(GL_POLYGON_SMOOTH_HINT, GL_NICEST);
+
+	if(m_smoothingEnabled && !m_shadowRenderPass && !m_pickRenderPass)
+	{
+		pGl->glEnable(GL_LINE_SMOOTH);
+		pGl->glEnable(GL_POLYGON_SMOOTH);
+		pGl->glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+		pGl->glHint(GL_POLYGON_SMOOTH_HINT, GL_NICEST);
+	}
+	else
+	{
+		pGl->glDisable(GL_LINE_SMOOTH);
+		pGl->glDisable(GL_POLYGON_SMOOTH);
+	}
 
 	// clear
 	pGl->glDisable(GL_DEPTH_TEST);
@@ -1543,43 +3514,57 @@ void GlSceneRenderer::DoPaintGL(qgl_funcs *pGl)
 	pGl->glDepthMask(GL_TRUE);
 	pGl->glDepthFunc(GL_LESS);
 
+	// the stencil value of the portal's region is its recursion depth
+	const GLint stencil_ref = m_active_portal ? GLint(m_active_portal->depth) : 0;
+	bool stencil_write = false;
+
 	if(m_portalRenderPass == PortalRenderPass::CREATE_STENCIL)
 	{
 		// don't write colours when creating portal stencil maps
 		pGl->glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-		pGl->glStencilMask(~0);
-
-		pGl->glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+		pGl->glDepthMask(GL_FALSE);
 
+		// the portal can only be seen within the enclosing portal's region,
+		// overlapping portals in front are respected by the depth test
+		pGl->glStencilFunc(GL_EQUAL, stencil_ref - 1, ~0);
 		pGl->glStencilOp(
 			GL_KEEP,     // stencil test failed
 			GL_KEEP,     // stencil test passed, depth test failed
-			GL_REPLACE); // both tests passed
+			GL_INCR);    // both tests passed
+		pGl->glEnable(GL_STENCIL_TEST);
+		stencil_write = true;
+	}
+	else if(m_portalRenderPass == PortalRenderPass::CLEAR_Z)
+	{
+		// set the region to the far plane instead of clearing the whole z buffer
+		pGl->glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		pGl->glDepthFunc(GL_ALWAYS);
+
+		pGl->glStencilFunc(GL_EQUAL, stencil_ref, ~0);
+		pGl->glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
 		pGl->glEnable(GL_STENCIL_TEST);
 	}
 	else if(m_portalRenderPass == PortalRenderPass::RENDER_PORTALS)
 	{
 		pGl->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
-		// TODO: recover depth mask for multiple portals...
-		// TODO: prevent (via z-buffer) the rendering of objects
-		//       through a portal that are in front of the portal
-		GLuint clear_bits = GL_DEPTH_BUFFER_BIT;
-		if(m_firstpass)
-			clear_bits |= GL_COLOR_BUFFER_BIT;
-		pGl->glClear(clear_bits);
-
+		// objects in front of the portal are removed by the oblique near plane
+		pGl->glStencilFunc(GL_EQUAL, stencil_ref, ~0);
 		pGl->glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
 		pGl->glEnable(GL_STENCIL_TEST);
 	}
-	else if(m_portalRenderPass == PortalRenderPass::CREATE_Z)
+	else if(m_portalRenderPass == PortalRenderPass::RESTORE_Z)
 	{
 		// don't write colours when creating portal z maps
 		pGl->glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 
-		// prevent rendering scene in portals in front of portals
-		// TODO: z-buffer for overlapping portals
+		// objects behind the portal are hidden by its surface,
+		// its region gets the stencil value of the enclosing portal again
 		pGl->glDepthFunc(GL_ALWAYS);
+		pGl->glStencilFunc(GL_EQUAL, stencil_ref, ~0);
+		pGl->glStencilOp(GL_KEEP, GL_KEEP, GL_DECR);
+		pGl->glEnable(GL_STENCIL_TEST);
+		stencil_write = true;
 	}
 	else if(m_portalRenderPass == PortalRenderPass::RENDER_NONPORTALS)
 	{
@@ -1589,15 +3574,27 @@ void GlSceneRenderer::DoPaintGL(qgl_funcs *pGl)
 	{
 		pGl->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
-		pGl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		// integer colour buffers can't be cleared with glClear
+		if(m_pickRenderPass)
+		{
+			const GLuint no_obj[4] = { 0, 0, 0, 0 };
+			const GLfloat far_depth = 1;
+			pGl->glClearBufferuiv(GL_COLOR, 1, no_obj);
+			pGl->glClearBufferfv(GL_DEPTH, 0, &far_depth);
+		}
+		else
+		{
+			pGl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
 	}
 
 	pGl->glEnable(GL_DEPTH_TEST);
-	pGl->glStencilMask(0);
+	pGl->glStencilMask(stencil_write ? ~0 : 0);
 
-	if(m_viewportNeedsUpdate)
+	// the shadow pass uses the shadow map's viewport
+	if(m_viewportNeedsUpdate && !m_shadowRenderPass)
 	{
-		const auto& dims = m_cam.GetScreenDimensions();
+		const std::array<int, 2> dims = GetRenderDimensions();
 		auto [z_near, z_far] = m_cam.GetDepthRange();
 
 		pGl->glViewport(0, 0, dims[0], dims[1]);
@@ -1607,8 +3604,44 @@ void GlSceneRenderer::DoPaintGL(qgl_funcs *pGl)
 		m_viewportNeedsUpdate = false;
 	}
 
-	if(m_lightsNeedUpdate)
-		UpdateLights();
+	if(m_active_portal)
+	{
+		const std::array<int, 2> dims = GetRenderDimensions();
+
+		// set the portal's region to the far plane
+		if(m_portalRenderPass == PortalRenderPass::CLEAR_Z)
+		{
+			auto [z_near, z_far] = m_cam.GetDepthRange();
+			pGl->glDepthRange(z_far, z_far);
+		}
+
+		// only draw within the portal's screen-space bounds
+		if(m_portalRenderPass == PortalRenderPass::CLEAR_Z ||
+			m_portalRenderPass == PortalRenderPass::RENDER_PORTALS)
+		{
+			const auto& rect = m_active_portal->rect;
+			const GLint x0 = GLint(std::floor((rect[0] + 1.) * 0.5 * dims[0]));
+			const GLint x1 = GLint(std::ceil((rect[1] + 1.) * 0.5 * dims[0]));
+			const GLint y0 = GLint(std::floor((rect[2] + 1.) * 0.5 * dims[1]));
+			const GLint y1 = GLint(std::ceil((rect[3] + 1.) * 0.5 * dims[1]));
+
+			pGl->glScissor(x0, y0, x1 - x0, y1 - y0);
+			pGl->glEnable(GL_SCISSOR_TEST);
+		}
+	}
+
+	// restore the states changed for the portal passes
+	BOOST_SCOPE_EXIT(this_, pGl)
+	{
+		if(this_->m_active_portal)
+		{
+			auto [z_near, z_far] = this_->m_cam.GetDepthRange();
+			pGl->glDepthRange(z_near, z_far);
+			pGl->glDisable(GL_SCISSOR_TEST);
+
+			this_->SetFrameProjection(pGl, this_->m_cam.GetPerspective());
+		}
+	} BOOST_SCOPE_EXIT_END
 
 	// bind shaders
 	BOOST_SCOPE_EXIT(m_shaders)
@@ -1622,209 +3655,407 @@ void GlSceneRenderer::DoPaintGL(qgl_funcs *pGl)
 	if(m_shadowRenderPass)
 		m_shaders->setUniformValue(m_uniLightingEnabled, false);
 
-	m_shaders->setUniformValue(m_uniShadowRenderingEnabled, m_shadowRenderingEnabled);
+	// the shadow map is only bound for the passes outside the portals
+	m_shaders->setUniformValue(m_uniShadowRenderingEnabled,
+		m_shadowRenderingEnabled && portal_shadows);
 	m_shaders->setUniformValue(m_uniShadowRenderPass, m_shadowRenderPass);
+	m_shaders->setUniformValue(m_uniPickRenderPass, m_pickRenderPass);
+	m_shaders->setUniformValue(m_uniPickId, GLuint(0));
 
-	// set camera transformation matrix
-	m_shaders->setUniformValue(
-		m_uniMatrixCam, m_cam.GetTransformation());
-	m_shaders->setUniformValue(
-		m_uniMatrixCamInv, m_cam.GetInverseTransformation());
+	// the light tiles are only valid for the main camera's view,
+	// the transformed objects seen through portals iterate all lights
+	m_shaders->setUniformValue(m_uniLightTilesEnabled,
+		!m_shadowRenderPass && m_portalRenderPass != PortalRenderPass::RENDER_PORTALS);
 
-	// set perspective matrix
-	if(m_perspectiveNeedsUpdate)
+	// the camera and light matrices are in the frame's uniform buffer,
+	// the views through portals and their nested portal surfaces are clipped by another near plane
+	if(m_active_portal)
 	{
-		m_shaders->setUniformValue(m_uniMatrixProj, m_cam.GetPerspective());
-		m_perspectiveNeedsUpdate = false;
+		SetFrameProjection(pGl, m_portalRenderPass == PortalRenderPass::RENDER_PORTALS
+			? m_active_portal->proj : m_active_portal->proj_surface);
 	}
 
-	// set light matrix
-	m_shaders->setUniformValue(
-		m_uniMatrixLight, m_lightcam.GetTransformation());
-	m_shaders->setUniformValue(
-		m_uniMatrixLightInv, m_lightcam.GetInverseTransformation());
+	// uniforms and states that are the same for all objects of the pass
+	m_glstates.Reset(pGl, m_shaders.get());
 
-	m_shaders->setUniformValue(m_uniShadowMap, 0);
+	BOOST_SCOPE_EXIT(this_)
+	{
+		// remove object texture
+		this_->m_glstates.BindTexture(GL_TEXTURE1, 0);
+	} BOOST_SCOPE_EXIT_END
 
-	//m_shaders->setUniformValue(m_uniTextureActive, m_textures_active);
-	m_shaders->setUniformValue(m_uniTexture, 1);
+	// set override color to white
+	m_shaders->setUniformValue(m_uniConstCol, m::create<t_vec_gl>({ 1, 1, 1, 1 }));
+	m_glstates.SetUniform(m_uniInstancingEnabled, false);
+	m_glstates.SetCullFace(true);
+	m_glstates.SetFrontFace(GL_CCW);
 
-	auto colOverride = m::create<t_vec_gl>({ 1, 1, 1, 1 });
+	// mirrored views and portal surfaces seen in mirrors
+	if(m_active_portal)
+	{
+		const bool mirror = (m_portalRenderPass == PortalRenderPass::RENDER_PORTALS)
+			? m_active_portal->mirror : m_active_portal->mirror_surface;
+		m_glstates.SetFrontFace(mirror ? GL_CW : GL_CCW);
+	}
 
-	// render object
-	auto render_triangle_geometry = 
-		[this, pGl, &colOverride, &boost_scope_exit_aux_args](
-			const GlSceneObj& obj)
+	// only the portal surface is drawn in the passes that mark or reset its region
+	const bool portal_surface_pass = m_active_portal && (
+		m_portalRenderPass == PortalRenderPass::CREATE_STENCIL ||
+		m_portalRenderPass == PortalRenderPass::CLEAR_Z ||
+		m_portalRenderPass == PortalRenderPass::RESTORE_Z);
+
+	// get an object's texture id
+	auto find_texture = [this](const std::string& ident) -> GLuint
+	{
+		if(!m_textures_active || m_shadowRenderPass || ident == "")
+			return 0;
+
+		auto iter = m_textures.find(ident);
+		if(iter == m_textures.end())
+			return 0;
+
+		// evicted textures are streamed in again
+		GlSceneTexture& txt = iter->second;
+		txt.last_used = m_texture_frame;
+		if(!txt.IsResident() && !txt.loading && !txt.failed)
+			LoadTexture(iter->first, txt);
+
+		return txt.GetId();
+	};
+
+	// is the object drawn in the current pass?
+	auto is_in_pass = [this, portal_surface_pass](const GlSceneObj& obj) -> bool
 	{
 		if(!obj.m_visible)
-			return;
+			return false;
+
+		if(portal_surface_pass)
+			return &obj == m_active_portal->obj;
 
 		const bool obj_is_portal = (obj.m_portal_id >= 0 &&
 			m_portalRenderPass != PortalRenderPass::IGNORE);
+
+		// ignore the portals themselves (only render view through portals),
+		// the ones beyond the recursion depth are drawn as opaque surfaces
+		if(obj_is_portal && !m_shadowRenderPass)
+			return (m_active_portal ? m_active_portal->depth : 0) >= m_portalDepth;
+
+		return true;
+	};
+
+	// render object
+	auto render_triangle_geometry = [this, pGl](const GlRenderQueueEntry& entry)
+	{
+		const GlSceneObj& obj = *entry.obj;
 		t_mat_gl matObj = obj.m_mat;
 
-		// draw portal surfaces into stencil buffer
-		if(m_portalRenderPass == PortalRenderPass::CREATE_STENCIL)
+		// objects seen through a portal, or the portal surface seen through the enclosing one
+		if(m_active_portal)
 		{
-			if(m_active_portal && obj_is_portal && obj.m_portal_id == m_active_portal->id)
-			{
-				pGl->glStencilMask(~0);
-				pGl->glStencilFunc(GL_ALWAYS, 1, ~0);
-			}
+			if(m_portalRenderPass == PortalRenderPass::RENDER_PORTALS)
+				matObj = m_active_portal->mat * matObj;
 			else
+				matObj = m_active_portal->mat_surface * matObj;
+		}
+
+		// lighting not needed for creation of shadow map
+		if(!m_shadowRenderPass)
+			m_glstates.SetUniform(m_uniLightingEnabled, obj.m_lighting);
+
+		// textures
+		m_glstates.SetUniform(m_uniTextureActive, entry.texture != 0);
+		if(entry.texture)
+			m_glstates.BindTexture(GL_TEXTURE1, entry.texture);
+
+		m_glstates.SetCullFace(obj.m_cull);
+
+		m_shaders->setUniformValue(m_uniMatrixObj, matObj);
+		m_shaders->setUniformValue(m_uniObjCol, obj.m_colour);
+
+		// only triangle objects can be picked, as with the ray casting
+		if(m_pickRenderPass)
+		{
+			GLuint pick_id = 0;
+			if(obj.m_type == GlRenderObjType::TRIANGLES && &obj != &m_selectionPlane)
 			{
-				// don't write non-portals to stencil buffer
-				pGl->glStencilMask(0);
+				m_pick_objs.push_back(m_scene_bvh_objs[obj.m_bounds_idx]->first);
+				pick_id = GLuint(m_pick_objs.size());
 			}
+			m_shaders->setUniformValue(m_uniPickId, pick_id);
 		}
-		else if(m_portalRenderPass == PortalRenderPass::CREATE_Z)
+
+		// main vertex array object, it also holds the enabled attribute arrays
+		obj.m_vertex_array->bind();
+
+		// render the object
+		if(obj.m_type == GlRenderObjType::TRIANGLES)
 		{
-			// ignore non-portals
-			if(!obj_is_portal)
-				return;
+			pGl->glDrawElements(GL_TRIANGLES, obj.m_num_indices, GL_UNSIGNED_INT,
+				reinterpret_cast<const void*>(obj.m_index_range.offset));
+			m_num_triangles += obj.m_num_indices / 3;
 		}
-		else if(m_portalRenderPass == PortalRenderPass::RENDER_NONPORTALS)
+		else if(obj.m_type == GlRenderObjType::LINES)
 		{
-			// ignore portals
-			if(obj_is_portal)
-				return;
+			pGl->glDrawArrays(GL_LINES, 0, obj.m_vertices.size());
 		}
-		else if(m_portalRenderPass == PortalRenderPass::RENDER_PORTALS)
+		else
 		{
-			// ignore portals themselves (only render view through portals)
-			if(obj_is_portal)
-				return;
-
-			if(m_active_portal)
-			{
-				matObj = m_active_portal->mat * matObj;
-				if(m_active_portal->mirror)
-					pGl->glFrontFace(GL_CW);
-				else
-					pGl->glFrontFace(GL_CCW);
-			}
+			std::cerr << "Unknown plot object type." << std::endl;
 		}
+		++m_num_draw_calls;
+		LOGGLERR(pGl);
+	};
 
-		// check if object is in camera frustum
-		if(m_shadowRenderPass)
-		{
-			if(obj_is_portal)
-				return;
+	// visible objects of the current pass
+	const std::vector<GlSceneObj*>* visible_objs = &m_visible_objs;
+	const std::vector<GlSceneObj*> portal_surface = { portal_surface_pass ? m_active_portal->obj : nullptr };
+	if(m_shadowRenderPass)
+		visible_objs = &m_visible_objs_shadow;
+	else if(portal_surface_pass)
+		visible_objs = &portal_surface;
+	else if(m_portalRenderPass == PortalRenderPass::RENDER_PORTALS && m_active_portal)
+		visible_objs = &m_active_portal->visible_objs;
+
+#ifdef _GL_OCCLUSION_QUERIES
+	const bool occlusion_pass = m_occlusionCullingEnabled && !m_shadowRenderPass &&
+		!m_pickRenderPass && m_portalRenderPass == PortalRenderPass::IGNORE;
+	if(occlusion_pass)
+		UpdateOcclusionResults(pGl);
+#else
+	const bool occlusion_pass = false;
+#endif
 
-			if(m_lightcam.IsBoundingBoxOutsideFrustum(
-				matObj, obj.m_boundingBox))
-				return;
-		}
-		else
-		{
-			m_shaders->setUniformValue(m_uniLightingEnabled, obj.m_lighting);
+	// collect the objects to draw
+	m_render_queue.clear();
+	m_render_queue.reserve(visible_objs->size());
+
+	for(const GlSceneObj* obj : *visible_objs)
+	{
+		if(!is_in_pass(*obj))
+			continue;
 
-			if(m_cam.IsBoundingBoxOutsideFrustum(
-				matObj, obj.m_boundingBox))
-				return;
+		// hidden in the previous frame
+		if(occlusion_pass && obj->m_occluded)
+		{
+			++m_num_objs_occluded;
+			continue;
 		}
 
-		// textures
-		std::shared_ptr<QOpenGLTexture> texture;
-		if(m_textures_active && !m_shadowRenderPass)
+		// instanced objects are collected and later drawn per mesh
+		if(obj->m_mesh)
 		{
-			if(auto iter = m_textures.find(obj.m_texture);
-				iter!=m_textures.end())
-			{
-				texture = iter->second.texture;
-				/*if(texture)
-				{
-					texture->setMinMagFilters(
-						QOpenGLTexture::Linear, QOpenGLTexture::Linear);
-				}*/
-			}
+			obj->m_lod_meshes[obj->m_lod]->m_draw_instances.push_back(obj);
+			continue;
 		}
 
-		BOOST_SCOPE_EXIT(texture, pGl)
+		m_render_queue.emplace_back(GlRenderQueueEntry
 		{
-			if(texture)
-			{
-				pGl->glActiveTexture(GL_TEXTURE1);
-				pGl->glBindTexture(GL_TEXTURE_2D, 0);
-				texture->release();
-			}
+			.obj = obj,
+			.texture = find_texture(obj->m_texture),
+		});
+	}
+
+	// sort the objects by their render states to minimise state changes
+	auto state_of = [](const GlRenderQueueEntry& entry)
+	{
+		return std::make_tuple(entry.obj->m_priority, entry.texture,
+			entry.obj->m_cull, entry.obj->m_lighting);
+	};
+
+	std::stable_sort(m_render_queue.begin(), m_render_queue.end(),
+		[&state_of](const GlRenderQueueEntry& entry1, const GlRenderQueueEntry& entry2) -> bool
+	{
+		return state_of(entry1) < state_of(entry2);
+	});
+
+	{
+		BOOST_SCOPE_EXIT(pGl)
+		{
+			pGl->glBindVertexArray(0);
 		} BOOST_SCOPE_EXIT_END
 
-		m_shaders->setUniformValue(m_uniTextureActive, !!texture);
+		for(const GlRenderQueueEntry& entry : m_render_queue)
+			render_triangle_geometry(entry);
+	}
+
+#ifdef _GL_INSTANCING
+	// render the instances collected for a shared mesh
+	auto render_instanced_geometry =
+		[this, pGl, &find_texture, &boost_scope_exit_aux_args](
+			GlSceneMesh& mesh)
+	{
+		std::vector<const GlSceneObj*>& instances = mesh.m_draw_instances;
+		if(instances.size() == 0)
+			return;
 
-		if(texture)
+		BOOST_SCOPE_EXIT(&instances)
 		{
-			pGl->glActiveTexture(GL_TEXTURE1);
-			texture->bind();
-			LOGGLERR(pGl);
+			instances.clear();
+		} BOOST_SCOPE_EXIT_END
 
-			// see: https://www.khronos.org/registry/OpenGL-Refpages/gl4/html/glTexParameter.xhtml
-			pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		}
+		// group instances having the same render states
+		auto state_of = [](const GlSceneObj* obj)
+		{
+			return std::tie(obj->m_texture, obj->m_lighting, obj->m_cull);
+		};
 
+		std::stable_sort(instances.begin(), instances.end(),
+			[&state_of](const GlSceneObj* obj1, const GlSceneObj* obj2) -> bool
+		{
+			return state_of(obj1) < state_of(obj2);
+		});
 
-		// set override color to white
-		m_shaders->setUniformValue(m_uniConstCol, colOverride);
+		// per-instance data: column-major object matrix and colour
+		constexpr std::size_t inst_elems = 4*4 + 4;
+		constexpr GLsizei inst_stride = inst_elems * sizeof(t_real_gl);
 
-		if(obj.m_cull)
-			pGl->glEnable(GL_CULL_FACE);
-		else
-			pGl->glDisable(GL_CULL_FACE);
+		mesh.m_draw_data.clear();
+		mesh.m_draw_data.reserve(instances.size() * inst_elems);
 
-		// draw scene that is only visible through portals
-		if(m_portalRenderPass == PortalRenderPass::RENDER_PORTALS && m_active_portal)
+		for(const GlSceneObj* obj : instances)
 		{
-			pGl->glStencilFunc(GL_EQUAL, 1, ~0);
-		}
+			for(int col=0; col<4; ++col)
+				for(int row=0; row<4; ++row)
+					mesh.m_draw_data.push_back(obj->m_mat(row, col));
 
-		m_shaders->setUniformValue(m_uniMatrixObj, matObj);
+			for(int icol=0; icol<4; ++icol)
+				mesh.m_draw_data.push_back(obj->m_colour[icol]);
+		}
 
 		// main vertex array object
-		obj.m_vertex_array->bind();
+		mesh.m_vertex_array->bind();
+
+		BOOST_SCOPE_EXIT(&mesh)
+		{
+			mesh.m_vertex_array->release();
+		} BOOST_SCOPE_EXIT_END
 
-		// bind vertex attribute arrays
-		BOOST_SCOPE_EXIT(pGl, &obj, &m_attrVertex, &m_attrVertexNorm, &m_attrVertexCol, &m_attrTexCoords)
+		// instance buffer
+		if(!mesh.m_instance_buffer)
 		{
-			pGl->glDisableVertexAttribArray(m_attrVertexCol);
-			if(obj.m_type == GlRenderObjType::TRIANGLES)
+			mesh.m_instance_buffer = std::make_shared<QOpenGLBuffer>(
+				QOpenGLBuffer::VertexBuffer);
+			mesh.m_instance_buffer->setUsagePattern(QOpenGLBuffer::StreamDraw);
+
+			if(!mesh.m_instance_buffer->create())
+				std::cerr << "Cannot create instance buffer." << std::endl;
+
+			// the instance attribute arrays stay enabled in the vertex array object
+			for(int col=0; col<4; ++col)
 			{
-				pGl->glDisableVertexAttribArray(m_attrTexCoords);
-				pGl->glDisableVertexAttribArray(m_attrVertexNorm);
+				pGl->glEnableVertexAttribArray(m_attrInstanceTrafo + col);
+				pGl->glVertexAttribDivisor(m_attrInstanceTrafo + col, 1);
 			}
-			pGl->glDisableVertexAttribArray(m_attrVertex);
+			pGl->glEnableVertexAttribArray(m_attrInstanceCol);
+			pGl->glVertexAttribDivisor(m_attrInstanceCol, 1);
 		}
-		BOOST_SCOPE_EXIT_END
 
-		pGl->glEnableVertexAttribArray(m_attrVertex);
-		if(obj.m_type == GlRenderObjType::TRIANGLES)
+		BOOST_SCOPE_EXIT(&mesh)
 		{
-			pGl->glEnableVertexAttribArray(m_attrVertexNorm);
-			pGl->glEnableVertexAttribArray(m_attrTexCoords);
+			mesh.m_instance_buffer->release();
+		} BOOST_SCOPE_EXIT_END
+
+		if(!mesh.m_instance_buffer->bind())
+			std::cerr << "Cannot bind instance buffer." << std::endl;
+
+		if(instances.size() > mesh.m_instance_buffer_size)
+		{
+			// grow the buffer geometrically to avoid frequent reallocations
+			mesh.m_instance_buffer_size = std::max(
+				instances.size(), 2*mesh.m_instance_buffer_size);
+			mesh.m_instance_buffer->allocate(
+				mesh.m_instance_buffer_size * inst_stride);
 		}
-		pGl->glEnableVertexAttribArray(m_attrVertexCol);
-		LOGGLERR(pGl);
 
+		mesh.m_instance_buffer->write(0, mesh.m_draw_data.data(),
+			mesh.m_draw_data.size() * sizeof(t_real_gl));
 
-		// render the object
-		if(obj.m_type == GlRenderObjType::TRIANGLES)
-			pGl->glDrawArrays(GL_TRIANGLES, 0, obj.m_triangles.size());
-		else if(obj.m_type == GlRenderObjType::LINES)
-			pGl->glDrawArrays(GL_LINES, 0, obj.m_vertices.size());
-		else
-			std::cerr << "Unknown plot object type." << std::endl;
+		// shared pass states
+		t_mat_gl matPass = m::unit<t_mat_gl>();
+		if(m_portalRenderPass == PortalRenderPass::RENDER_PORTALS && m_active_portal)
+			matPass = m_active_portal->mat;
+
+		m_shaders->setUniformValue(m_uniMatrixObj, matPass);
+		m_glstates.SetUniform(m_uniInstancingEnabled, true);
 		LOGGLERR(pGl);
+
+		// draw runs of instances with identical render states
+		for(std::size_t run_start = 0; run_start < instances.size();)
+		{
+			const GlSceneObj* first = instances[run_start];
+
+			std::size_t run_end = run_start + 1;
+			while(run_end < instances.size() &&
+				state_of(instances[run_end]) == state_of(first))
+				++run_end;
+
+			// point the instance attributes to the start of the run
+			const std::size_t offs = run_start * inst_stride;
+			for(int col=0; col<4; ++col)
+			{
+				pGl->glVertexAttribPointer(m_attrInstanceTrafo + col,
+					4, GL_FLOAT, 0, inst_stride,
+					reinterpret_cast<const void*>(offs + col*4*sizeof(t_real_gl)));
+			}
+			pGl->glVertexAttribPointer(m_attrInstanceCol,
+				4, GL_FLOAT, 0, inst_stride,
+				reinterpret_cast<const void*>(offs + 4*4*sizeof(t_real_gl)));
+
+			// textures
+			const GLuint texture = find_texture(first->m_texture);
+			m_glstates.SetUniform(m_uniTextureActive, texture != 0);
+			if(texture)
+				m_glstates.BindTexture(GL_TEXTURE1, texture);
+
+			if(!m_shadowRenderPass)
+				m_glstates.SetUniform(m_uniLightingEnabled, first->m_lighting);
+
+			m_glstates.SetCullFace(first->m_cull);
+
+			// consecutive ids for the instances of the run
+			if(m_pickRenderPass)
+			{
+				m_shaders->setUniformValue(m_uniPickId, GLuint(m_pick_objs.size() + 1));
+				for(std::size_t inst = run_start; inst < run_end; ++inst)
+					m_pick_objs.push_back(m_scene_bvh_objs[instances[inst]->m_bounds_idx]->first);
+			}
+
+			pGl->glDrawElementsInstanced(GL_TRIANGLES, mesh.m_num_indices, GL_UNSIGNED_INT,
+				reinterpret_cast<const void*>(mesh.m_index_range.offset), run_end - run_start);
+			++m_num_draw_calls;
+			m_num_triangles += (mesh.m_num_indices / 3) * (run_end - run_start);
+			LOGGLERR(pGl);
+
+			run_start = run_end;
+		}
 	};
 
-	for(const auto& [obj_name, obj] : m_objs)
-		render_triangle_geometry(obj);
+	for(auto& [mesh_key, mesh] : m_meshes)
+		render_instanced_geometry(mesh);
+
+	m_glstates.SetUniform(m_uniInstancingEnabled, false);
+#endif
+
+#ifdef _GL_OCCLUSION_QUERIES
+	if(occlusion_pass)
+		IssueOcclusionQueries(pGl);
+#endif
 
 	// render the selection plane
-	if(!m_shadowRenderPass)
+	if(!m_shadowRenderPass && !m_pickRenderPass)
 	{
 		m_shaders->setUniformValue(m_uniShadowRenderingEnabled, false);
 		pGl->glEnable(GL_BLEND);
-		render_triangle_geometry(m_selectionPlane);
+
+		if(is_in_pass(m_selectionPlane))
+		{
+			render_triangle_geometry(GlRenderQueueEntry
+			{
+				.obj = &m_selectionPlane,
+				.texture = find_texture(m_selectionPlane.m_texture),
+			});
+			pGl->glBindVertexArray(0);
+		}
 	}
 
 	pGl->glDisable(GL_BLEND);
@@ -1911,15 +4142,111 @@ void GlSceneRenderer::DoPaintQt(QPainter &painter)
 	painter.setFont(fontOrig);
 	painter.setPen(penOrig);
 	painter.setBrush(brushOrig);
+
+	if(m_profilerOverlayEnabled && Profiler::GetInstance().IsEnabled())
+		DrawProfilerOverlay(painter);
+}
+
+
+/**
+ * draw the profiler statistics in the top left corner
+ */
+void GlSceneRenderer::DrawProfilerOverlay(QPainter &painter)
+{
+	std::vector<ProfilerStats> stats = Profiler::GetInstance().GetStats();
+	if(!stats.size())
+		return;
+
+	std::sort(stats.begin(), stats.end(),
+		[](const ProfilerStats& stat1, const ProfilerStats& stat2) -> bool
+	{
+		return stat1.name < stat2.name;
+	});
+
+	QFont fontOrig = painter.font();
+	QPen penOrig = painter.pen();
+	QBrush brushOrig = painter.brush();
+
+	BOOST_SCOPE_EXIT(&painter, &fontOrig, &penOrig, &brushOrig)
+	{
+		painter.setFont(fontOrig);
+		painter.setPen(penOrig);
+		painter.setBrush(brushOrig);
+	} BOOST_SCOPE_EXIT_END
+
+	QFont fontStats = fontOrig;
+	fontStats.setFamily("Monospace");
+	fontStats.setStyleHint(QFont::TypeWriter);
+	painter.setFont(fontStats);
+
+	// one line per section: last, mean, and maximum value
+	QStringList lines;
+	lines << QString("%1 %2 %3 %4")
+		.arg("section", -24).arg("last", 10).arg("mean", 10).arg("max", 10);
+	for(const ProfilerStats& stat : stats)
+	{
+		const int prec = stat.is_time ? 3 : 0;
+		lines << QString("%1 %2 %3 %4")
+			.arg(stat.name.c_str(), -24)
+			.arg(stat.last, 10, 'f', prec)
+			.arg(stat.avg, 10, 'f', prec)
+			.arg(stat.max, 10, 'f', prec);
+	}
+
+	const QFontMetrics& metrics = painter.fontMetrics();
+	const int line_height = metrics.height();
+	int width = 0;
+	for(const QString& line : lines)
+		width = std::max(width, metrics.horizontalAdvance(line));
+
+	QRect rect(8, 8, width + 16, line_height * lines.size() + 16);
+	painter.setPen(QColor(0, 0, 0, 0xff));
+	painter.setBrush(QBrush(QColor(0xff, 0xff, 0xff, 0xc0), Qt::SolidPattern));
+	painter.drawRoundedRect(rect, 8., 8.);
+
+	for(int i=0; i<lines.size(); ++i)
+	{
+		painter.drawText(rect.left() + 8, rect.top() + 8 + metrics.ascent() + i*line_height,
+			lines[i]);
+	}
 }
 
 
 /**
  * save the shadow frame buffer to a file
  */
-void GlSceneRenderer::SaveShadowFramebuffer(const std::string& filename) const
+void GlSceneRenderer::SaveShadowFramebuffer(const std::string& filename)
 {
-	auto img = m_fboshadow->toImage(true, 0);
+	if(!m_fboshadow)
+		return;
+
+	BOOST_SCOPE_EXIT(this_)
+	{
+		this_->DoneCurrent();
+	} BOOST_SCOPE_EXIT_END
+	MakeCurrent();
+
+	auto *pGl = GetGlFunctions();
+	if(!pGl)
+		return;
+
+	// read the depth values
+	const int size = m_shadowMapSize;
+	std::vector<GLfloat> depths(size * size);
+
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, m_fboshadow);
+	pGl->glReadPixels(0, 0, size, size, GL_DEPTH_COMPONENT, GL_FLOAT, depths.data());
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, GetDefaultFramebuffer());
+	LOGGLERR(pGl);
+
+	QImage img(size, size, QImage::Format_Grayscale8);
+	for(int y=0; y<size; ++y)
+	{
+		uchar *line = img.scanLine(size - y - 1);
+		for(int x=0; x<size; ++x)
+			line[x] = uchar(std::clamp<GLfloat>(depths[y*size + x], 0., 1.) * 255.);
+	}
+
 	img.save(filename.c_str());
 }
 
@@ -26,6 +26,9 @@
 #include <QtGui/QVector4D>
 #include <QtGui/QVector3D>
 #include <QtGui/QVector2D>
+#include <QtCore/QTimer>
+#include <QtGui/QImage>
+#include <QtGui/QOffscreenSurface>
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 	#include <QtOpenGL/QOpenGLShaderProgram>
@@ -58,13 +61,26 @@
 #include <memory>
 #include <unordered_map>
 #include <optional>
+#include <vector>
+#include <array>
+#include <utility>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <future>
+
+#include <boost/asio/thread_pool.hpp>
 
 #include "mathlibs/libs/matrix_algos.h"
 #include "mathlibs/libs/matrix_conts.h"
 
 #include "src/types.h"
 #include "src/Scene.h"
+#include "src/SimThread.h"
 #include "src/renderer/Camera.h"
+#include "src/renderer/Bvh.h"
+#include "src/renderer/ObjectBounds.h"
+#include "src/renderer/RangeAllocator.h"
 
 
 
@@ -107,6 +123,23 @@
 	#endif
 #endif
 
+// instanced rendering needs attribute divisors,
+// occlusion queries need GL_ANY_SAMPLES_PASSED,
+// gpu timers need GL_TIME_ELAPSED
+#if _GL_MAJ_VER > 3 || (_GL_MAJ_VER == 3 && _GL_MIN_VER >= 3)
+	#define _GL_INSTANCING
+	#define _GL_OCCLUSION_QUERIES
+	#define _GL_TIMER_QUERIES
+#endif
+
+// asynchronous read-back of offscreen frames needs fence syncs
+#if _GL_MAJ_VER > 3 || (_GL_MAJ_VER == 3 && _GL_MIN_VER >= 2)
+	#define _GL_FENCE_SYNC
+#endif
+
+// size of the screen tiles into which the lights are sorted, in pixels
+#define LIGHT_TILE_SIZE 32
+
 // GL functions include
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 	#define _GL_INC_IMPL(MAJ, MIN, SUFF) <QtOpenGL/QOpenGLFunctions_ ## MAJ ## _ ## MIN ## SUFF>
@@ -143,6 +176,8 @@ using t_vec3_gl = m::qvecN_adapter<int, 3, t_real_gl, QVector3D>;
 using t_vec_gl = m::qvecN_adapter<int, 4, t_real_gl, QVector4D>;
 using t_mat33_gl = m::qmatNN_adapter<int, 3, 3, t_real_gl, QMatrix3x3>;
 using t_mat_gl = m::qmatNN_adapter<int, 4, 4, t_real_gl, QMatrix4x4>;
+
+using t_bvh = Bvh<t_real_gl>;
 // ----------------------------------------------------------------------------
 
 
@@ -156,19 +191,45 @@ enum class GlRenderObjType
 };
 
 
+/**
+ * large buffer whose ranges hold the vertex or index data of several objects
+ */
+struct GlBufferPage
+{
+	std::shared_ptr<QOpenGLBuffer> buffer{};
+	RangeAllocator ranges{};
+};
+
+
+/**
+ * range of a buffer page in bytes
+ */
+struct GlBufferRange
+{
+	GlBufferPage *page = nullptr;
+	std::size_t offset = 0;
+	std::size_t size = 0;
+};
+
+
 struct GlRenderObj
 {
 	GlRenderObjType m_type = GlRenderObjType::TRIANGLES;
 
 	std::shared_ptr<QOpenGLVertexArrayObject> m_vertex_array{};
-	std::shared_ptr<QOpenGLBuffer> m_vertex_buffer{};
-	std::shared_ptr<QOpenGLBuffer> m_normals_buffer{};
-	std::shared_ptr<QOpenGLBuffer> m_uv_buffer{};
-	std::shared_ptr<QOpenGLBuffer> m_colour_buffer{};
+	std::shared_ptr<QOpenGLBuffer> m_vertex_buffer{};  // interleaved vertex data
+	std::shared_ptr<QOpenGLBuffer> m_index_buffer{};
+	GLsizei m_num_indices = 0;
+
+	// ranges of the shared buffer pages used by triangle objects
+	GlBufferRange m_vertex_range{}, m_index_range{};
 
 	std::vector<t_vec3_gl> m_vertices{}, m_triangles{}, m_uvs{};
 
-	t_vec_gl m_colour = m::create<t_vec_gl>({ 0., 0., 1., 1. });	// rgba
+	// object-space hierarchy of the triangles for picking
+	t_bvh m_bvh{};
+
+	t_vec_gl m_colour = m::create<t_vec_gl>({ 0., 0., 1., 1. });	// rgba, set as uniform
 
 	// does not define a geometry itself, but just links to another object
 	std::optional<std::size_t> linkedObj{};
@@ -209,6 +270,80 @@ extern QSurfaceFormat gl_format(bool bCore = true,
 
 
 
+struct GlSceneObj;
+
+
+/**
+ * vertex data of a triangle object, prepared on the cpu and ready to be uploaded
+ */
+struct GlTriangleData
+{
+	// interleaved vertex: position, normal, uv coordinates
+	static constexpr std::size_t VERT_ELEMS = 3 + 3 + 2;
+
+	std::vector<t_real_gl> m_interleaved{};
+	std::vector<GLuint> m_indices{};
+
+	std::vector<t_vec3_gl> m_vertices{}, m_triangles{}, m_uvs{};
+	t_bvh m_bvh{};
+
+	// object-space bounds
+	std::vector<t_vec_gl> m_boundingBox = {};
+	t_vec3_gl m_boundingSpherePos = m::create<t_vec3_gl>({ 0., 0., 0. });
+	t_real_gl m_boundingSphereRad = 0.;
+};
+
+
+/**
+ * tessellation of a geometry, prepared by a loader thread
+ */
+struct GlLoadJob
+{
+	std::shared_ptr<const Geometry> geo{};
+	std::size_t lod = 0;
+
+	GlTriangleData data{};
+	std::atomic<bool> ready = false;
+};
+
+
+/**
+ * object of a scene that is being loaded, waiting to be uploaded
+ */
+struct GlLoadItem
+{
+	std::shared_ptr<const Geometry> geo{};
+	bool instanced = false;
+	bool deleted = false;
+
+	// jobs preparing the object's vertex data or its shared levels of detail
+	std::array<GlLoadJob*, Geometry::MAX_LODS> jobs{};
+	std::size_t num_jobs = 0;
+};
+
+
+/**
+ * geometry shared by several instanced objects
+ */
+struct GlSceneMesh : public GlRenderObj
+{
+	// per-instance object matrices and colours
+	std::shared_ptr<QOpenGLBuffer> m_instance_buffer{};
+	std::size_t m_instance_buffer_size = 0;  // number of allocated instances
+
+	std::size_t m_refs = 0;  // number of objects using this mesh
+
+	// object-space bounds of the mesh
+	std::vector<t_vec_gl> m_boundingBox = {};
+	t_vec3_gl m_boundingSpherePos = m::create<t_vec3_gl>({ 0., 0., 0. });
+	t_real_gl m_boundingSphereRad = 0.;
+
+	// instances to be drawn in the current pass and their data
+	std::vector<const GlSceneObj*> m_draw_instances{};
+	std::vector<t_real_gl> m_draw_data{};
+};
+
+
 /**
  * rendering object structure
  */
@@ -230,6 +365,47 @@ struct GlSceneObj : public GlRenderObj
 	std::vector<t_vec_gl> m_boundingBox = {};
 
 	std::string m_texture = ""; // texture identifier
+
+	GlSceneMesh *m_mesh = nullptr; // shared instanced geometry, if any
+
+	// coarser shared geometries, the first one is m_mesh
+	std::array<GlSceneMesh*, Geometry::MAX_LODS> m_lod_meshes{};
+	std::size_t m_num_lods = 0;
+	std::size_t m_lod = 0;         // level of detail used in the current frame
+
+	// hardware occlusion query, its result is used in the following frame
+	GLuint m_occlusion_query = 0;
+	bool m_occlusion_query_issued = false;
+	bool m_occluded = false;
+
+	std::size_t m_bounds_idx = 0;  // index into the renderer's world bounding boxes
+	std::size_t m_handle = 0;      // handle of the scene object, 0 if there is none
+};
+
+
+/**
+ * texture image decoded by a worker thread,
+ * either an uncompressed image or the pre-compressed mip levels of a dds or ktx file
+ */
+struct GlTextureImage
+{
+	QImage image{};
+
+	GLenum compressed_format = 0;
+	int width = 0, height = 0;
+	std::vector<QByteArray> levels{};
+
+	QByteArray file{};  // contents of the image file
+};
+
+
+/**
+ * texture image being decoded
+ */
+struct GlTextureLoad
+{
+	std::string ident{}, filename{};
+	std::future<GlTextureImage> image{};
 };
 
 
@@ -239,15 +415,200 @@ struct GlSceneObj : public GlRenderObj
 struct GlSceneTexture
 {
 	std::string filename{};
-	std::shared_ptr<QOpenGLTexture> texture{};
+	std::shared_ptr<QOpenGLTexture> texture{};  // uncompressed texture with generated mipmaps
+	GLuint compressed = 0;                      // texture with pre-compressed mipmaps
+
+	std::size_t vram = 0;       // estimated gpu memory in bytes
+	std::size_t last_used = 0;  // frame in which the texture was last drawn
+	bool loading = false;       // the image is being decoded
+	bool failed = false;        // the image could not be loaded
+
+	QByteArray file{};          // contents of the image file, decoded again after an eviction
+
+	bool IsResident() const { return texture || compressed; }
+	GLuint GetId() const { return texture ? texture->textureId() : compressed; }
+};
+
+
+/**
+ * per-frame camera and light matrices,
+ * std140 layout of the shaders' "Frame" uniform block, column-major
+ */
+struct GlFrameUniforms
+{
+	GLfloat proj[16]{}, cam[16]{}, cam_inv[16]{};
+	GLfloat light_proj[16]{}, light[16]{}, light_inv[16]{};
+};
+
+
+/**
+ * light counts, std140 layout of the shaders' "Lights" uniform block,
+ * the light positions and the per-tile light lists are in texture buffers
+ */
+struct GlLightUniforms
+{
+	GLint num_active = 0;
+	GLint pad{};
+	GLint tiles_count[2]{};  // ivec2 is aligned to 8 bytes in std140
+};
+
+
+// binding points of the uniform blocks
+enum class GlUniformBlock : GLuint
+{
+	FRAME = 0,
+	LIGHTS = 1,
+};
+
+
+/**
+ * gpu timer measuring a render pass, read back in a later frame
+ */
+struct GlTimerQuery
+{
+	GLuint query = 0;
+	const char *section = nullptr;
+	bool pending = false;
+};
+
+
+/**
+ * gpu timestamps at the start and the end of a frame, read back in a later frame,
+ * unlike GL_TIME_ELAPSED they can overlap with the profiler's timers
+ */
+struct GlFrameTimer
+{
+	GLuint queries[2] = { 0, 0 };
+	GLfloat scale = 1;      // render scale of the measured frame
+	bool pending = false;
+};
+
+
+/**
+ * entry in the sorted list of objects to be drawn in a render pass
+ */
+struct GlRenderQueueEntry
+{
+	const GlSceneObj *obj = nullptr;
+	GLuint texture = 0;         // resolved texture id, 0 if untextured
+};
+
+
+/**
+ * keeps track of the gl states set during a render pass
+ * and skips calls that would not change them
+ */
+class GlStateCache
+{
+public:
+	/**
+	 * forget all states, needs to be called when they could have been changed elsewhere
+	 */
+	void Reset(qgl_funcs *pGl, QOpenGLShaderProgram *shaders)
+	{
+		m_pGl = pGl;
+		m_shaders = shaders;
+		m_cull.reset();
+		m_frontface.reset();
+		m_texture.reset();
+		m_uniforms.clear();
+	}
+
+
+	void SetCullFace(bool b)
+	{
+		if(m_cull && *m_cull == b)
+			return;
+
+		if(b)
+			m_pGl->glEnable(GL_CULL_FACE);
+		else
+			m_pGl->glDisable(GL_CULL_FACE);
+		m_cull = b;
+	}
+
+
+	void SetFrontFace(GLenum mode)
+	{
+		if(m_frontface && *m_frontface == mode)
+			return;
+
+		m_pGl->glFrontFace(mode);
+		m_frontface = mode;
+	}
+
+
+	/**
+	 * bind a 2d texture to the given texture unit, 0 unbinds it
+	 */
+	void BindTexture(GLenum unit, GLuint texture)
+	{
+		if(m_texture && m_texture->first == unit && m_texture->second == texture)
+			return;
+
+		m_pGl->glActiveTexture(unit);
+		m_pGl->glBindTexture(GL_TEXTURE_2D, texture);
+		m_texture = std::make_pair(unit, texture);
+	}
+
+
+	/**
+	 * set a boolean shader uniform
+	 */
+	void SetUniform(GLint loc, bool b)
+	{
+		for(auto& [uni_loc, uni_val] : m_uniforms)
+		{
+			if(uni_loc != loc)
+				continue;
+
+			if(uni_val != b)
+			{
+				m_shaders->setUniformValue(loc, b);
+				uni_val = b;
+			}
+			return;
+		}
+
+		m_shaders->setUniformValue(loc, b);
+		m_uniforms.emplace_back(loc, b);
+	}
+
+
+private:
+	qgl_funcs *m_pGl = nullptr;
+	QOpenGLShaderProgram *m_shaders = nullptr;
+
+	// unknown states are unset
+	std::optional<bool> m_cull{};
+	std::optional<GLenum> m_frontface{};
+	std::optional<std::pair<GLenum, GLuint>> m_texture{};  // unit and texture id
+
+	// only a few uniforms are cached, so a linear search suffices
+	std::vector<std::pair<GLint, bool>> m_uniforms{};
+};
+
+
+/**
+ * pixel buffer for the asynchronous read-back of an offscreen frame
+ */
+struct GlReadbackBuffer
+{
+	GLuint pbo = 0;
+#ifdef _GL_FENCE_SYNC
+	GLsync fence = nullptr;
+#endif
+	std::size_t frame = 0;
+	bool pending = false;  // read-back started, but the pixels have not yet been fetched
 };
 
 
 enum class PortalRenderPass
 {
-	CREATE_STENCIL,     // write portals to stencil buffer
+	CREATE_STENCIL,     // mark the portal's region in the stencil buffer
+	CLEAR_Z,            // reset the z buffer in the portal's region
 	RENDER_PORTALS,     // render scene through portals
-	CREATE_Z,           // write portal surface to z buffer
+	RESTORE_Z,          // write portal surface to z buffer and unmark its region
 	RENDER_NONPORTALS,  // render non-portal geometry
 
 	IGNORE,             // portals disabled
@@ -255,13 +616,37 @@ enum class PortalRenderPass
 
 
 /**
- * active portal infos
+ * node in the tree of portals that are visible in the current frame
  */
 struct ActivePortal
 {
 	GLint id = -1;
+	GlSceneObj *obj = nullptr;   // portal surface
+
+	// transformations of the scene seen through the portal and of the portal surface
 	t_mat_gl mat = m::unit<t_mat_gl>();
-	bool mirror = false;
+	t_mat_gl mat_surface = m::unit<t_mat_gl>();
+	bool mirror = false, mirror_surface = false;
+
+	// plane of the portal surface (normal and distance), facing away from the camera
+	t_vec_gl plane = m::create<t_vec_gl>({ 0, 0, 0, 0 });
+
+	// projections of the view through the portal, with the near plane in the portal's plane,
+	// and of the portal surface, with the near plane of the enclosing portal
+	t_mat_gl proj = m::unit<t_mat_gl>();
+	t_mat_gl proj_surface = m::unit<t_mat_gl>();
+
+	// recursion level, also the value of the portal's region in the stencil buffer
+	std::size_t depth = 1;
+
+	// screen-space bounds of the portal, clipped to the ones of the enclosing portal
+	std::array<t_real_gl, 4> rect{ -1, 1, -1, 1 };
+
+	// objects visible through the portal
+	std::vector<GlSceneObj*> visible_objs{};
+
+	// portals seen through this one, indices into the list of active portals
+	std::vector<std::size_t> children{};
 };
 
 
@@ -277,6 +662,10 @@ public:
 	// 3d object and texture types
 	using t_objs = std::unordered_map<std::string, GlSceneObj>;
 	using t_textures = std::unordered_map<std::string, GlSceneTexture>;
+	using t_meshes = std::unordered_map<std::string, GlSceneMesh>;
+
+	// receives the finished frames of the offscreen renderer
+	using t_frame_callback = std::function<void(std::size_t frame, QImage&& img)>;
 
 
 public:
@@ -288,16 +677,22 @@ public:
 
 	void Clear();
 	bool LoadScene(const Scene& scene);
-	void AddObject(const Geometry& geo);
+	bool IsLoading() const { return m_load_items.size() != 0; }
+	void AddObject(const Geometry& geo, GlLoadItem *prepared = nullptr);
 
 	// receivers for scene update signals
-	void UpdateScene(const Scene& instr);
+	void UpdateScene(const Scene& scene,
+		const std::vector<std::shared_ptr<Geometry>>& changed_objs);
+
+	// object transformations are picked up from the simulation thread while it is running
+	void SetSimThread(const std::shared_ptr<SimThread>& sim) { m_sim = sim; }
 
 	std::tuple<std::string, std::string, std::string, std::string, std::string, std::string>
 		GetGlDescription() const;
 	bool IsInitialised() const { return m_initialised; }
 
 	void DeleteObject(const std::string& obj_name);
+	void UpdateObject(const Geometry& geo);
 	void RenameObject(const std::string& oldname, const std::string& newname);
 
 	t_objs::iterator AddTriangleObject(const std::string& obj_name,
@@ -305,11 +700,29 @@ public:
 		const std::vector<t_vec3_gl>& triag_norms,
 		const std::vector<t_vec3_gl>& triag_uvs,
 		t_real_gl r = 0, t_real_gl g = 0, t_real_gl b = 0, t_real_gl a = 1);
+	t_objs::iterator AddTriangleObject(const std::string& obj_name,
+		GlTriangleData&& data, const t_vec_gl& col);
 
 	void SetLight(std::size_t idx, const t_vec3_gl& pos);
 	void SetLightFollowsCursor(bool b);
 	void EnableShadowRendering(bool b);
+	void EnableShadowMapCache(bool b);
+	void SetShadowMapSize(int size);
 	void EnablePortalRendering(bool b);
+	void SetPortalDepth(std::size_t depth);
+	void EnableInstancing(bool b);
+	void EnableOcclusionCulling(bool b);
+	void EnableGpuPicking(bool b);
+	void EnableProfilerOverlay(bool b);
+	void SetLodPixels(t_real_gl pixels);
+	void SetLightRange(t_real_gl range);
+	void SetTextureMemory(std::size_t bytes);
+
+	// render quality, see GlRenderer_resolution.cpp
+	void EnableSmoothing(bool b);
+	void SetRenderScale(t_real_gl scale);
+	void EnableDynamicResolution(bool b, t_real_gl target_fps = 60);
+	t_real_gl GetRenderScale() const { return m_curRenderScale; }
 
 	const t_cam& GetCamera() const { return m_cam; }
 	t_cam& GetCamera() { return m_cam; }
@@ -330,33 +743,82 @@ public:
 	std::tuple<t_vec3_gl, int> GetSelectionPlaneCursor() const;
 	QPoint GetMousePosition(bool global_pos = false) const;
 
-	void SaveShadowFramebuffer(const std::string& filename) const;
+	void SaveShadowFramebuffer(const std::string& filename);
 
 	bool AreTexturesEnabled() const { return m_textures_active; }
+	bool IsLoadingTextures() const { return m_texture_loads.size() != 0; }
 	const t_textures& GetTextures() const { return m_textures; }
 
 	void UpdateCam(bool update_frame = true);
 
 	void tick(const std::chrono::milliseconds& ms);
 
+	// nothing to redraw until the next input or scene change
+	bool IsIdle() const;
+
+	// --------------------------------------------------------------------
+	// headless rendering into an offscreen framebuffer, see GlRenderer_offscreen.cpp
+	// --------------------------------------------------------------------
+	bool InitOffscreen(int width, int height);
+	bool IsOffscreen() const { return m_offscreen_context != nullptr; }
+	void FinishLoading();
+
+	// render a frame and start its read-back, earlier frames are passed to the callback when ready
+	bool RenderOffscreen(std::size_t frame, const t_frame_callback& callback);
+	void FinishOffscreen(const t_frame_callback& callback);
+
+	// the renderer's gl code uses these instead of the widget's functions,
+	// they select the offscreen surface in headless mode
+	void MakeCurrent();
+	void DoneCurrent();
+	QOpenGLContext* GetContext() const;
+	GLuint GetDefaultFramebuffer() const;
+	// --------------------------------------------------------------------
+
 
 protected:
 	// get gl functions
 	qgl_funcs* GetGlFunctions();
 
 	// create a triangle-based object
+	static void PrepareTriangleData(GlTriangleData& data,
+		const std::vector<t_vec3_gl>& verts, const std::vector<t_vec3_gl>& triagverts,
+		const std::vector<t_vec3_gl>& norms, const std::vector<t_vec3_gl>& uvs,
+		bool bUseVertsAsNorm);
+	static void PrepareTriangleData(GlTriangleData& data,
+		const Geometry& geo, std::size_t lod = 0);
 	bool CreateTriangleObject(GlRenderObj& obj,
 		const std::vector<t_vec3_gl>& verts, const std::vector<t_vec3_gl>& triagverts,
 		const std::vector<t_vec3_gl>& norms, const std::vector<t_vec3_gl>& uvs,
 		const t_vec_gl& colour, bool bUseVertsAsNorm, GLint attrVertex,
-		GLint attrVertexNormal, GLint attrVertexcolour, GLint attrTextureCoords=-1);
+		GLint attrVertexNormal, GLint attrTextureCoords=-1);
+	bool CreateTriangleObject(GlRenderObj& obj,
+		GlTriangleData&& data, const t_vec_gl& colour, GLint attrVertex,
+		GLint attrVertexNormal, GLint attrTextureCoords=-1);
 
 	// create a line-based object
 	bool CreateLineObject(GlRenderObj& obj,
 		const std::vector<t_vec3_gl>& verts, const t_vec_gl& colour,
-		GLint attrVertex, GLint attrVertexcolour);
+		GLint attrVertex);
 
 	void DeleteRenderObject(GlRenderObj& obj);
+	void SetObjectProperties(GlSceneObj& sceneobj, const Geometry& geo);
+
+	// sub-allocation of the vertex and index data from shared buffer pages
+	bool AllocateBufferRange(qgl_funcs *pGl, QOpenGLBuffer::Type type,
+		std::size_t size, GlBufferRange& range);
+	void FreeBufferRange(GlBufferRange& range);
+	static void WriteBufferRange(qgl_funcs *pGl, const GlBufferRange& range,
+		const void* data, std::size_t size);
+
+	// shared geometry for instanced rendering
+	GlSceneMesh* AcquireMesh(const Geometry& geo, std::size_t lod = 0,
+		GlTriangleData *prepared = nullptr);
+	std::size_t AcquireMeshes(const Geometry& geo,
+		std::array<GlSceneMesh*, Geometry::MAX_LODS>& lod_meshes,
+		GlLoadItem *prepared = nullptr);
+	void ReleaseMesh(GlSceneMesh *mesh);
+	void DeleteMeshes();
 
 
 protected:
@@ -376,20 +838,86 @@ protected:
 	void CalcSelectionPlaneMatrix();
 
 	void CreateActivePortals();
+	void AddActivePortals(std::optional<std::size_t> parent);
+	void RenderPortal(qgl_funcs *pGl, std::size_t idx);
 
 	void UpdatePicker();
+	void UpdateSceneBvh(bool rebuild);
+	void UpdateFromSimulation();
+
+	// scene loading pipeline
+	void RunLoadJobs();
+	void UploadLoadedObjects();
+	void StopLoading();
+
+	// culling stage
+	void CullObjects(const t_cam& cam, const t_mat_gl* matPortal,
+		std::vector<GlSceneObj*>& visible_objs,
+		const t_cam::t_rect& rect = t_cam::s_ndc_rect);
+	void CullScene();
+	void SelectLods();
+	void UpdateOcclusionResults(qgl_funcs *pGl);
+	void IssueOcclusionQueries(qgl_funcs *pGl);
+	void DeleteOcclusionQuery(GlSceneObj& obj);
+	void CreateOcclusionBox();
+
+	// texture streaming, see GlRenderer_textures.cpp
+	static GlTextureImage DecodeTexture(const std::string& filename, QByteArray file);
+	void LoadTexture(const std::string& ident, GlSceneTexture& txt);
+	void UploadLoadedTextures();
+	bool UploadTexture(qgl_funcs *pGl, GlSceneTexture& txt, GlTextureImage&& img);
+	void DeleteTexture(qgl_funcs *pGl, GlSceneTexture& txt);
+	void EvictTextures(qgl_funcs *pGl);
+
+	// profiling
+	void BeginTimerQuery(qgl_funcs *pGl, const char* section);
+	void EndTimerQuery(qgl_funcs *pGl);
+	void CollectTimerQueries(qgl_funcs *pGl);
+	void DeleteTimerQueries();
+	void DrawProfilerOverlay(QPainter &painter);
 	void UpdateLights();
+	void UpdateLightTiles(qgl_funcs *pGl);
+	void UpdateFrameUniforms(qgl_funcs *pGl);
+	void SetFrameProjection(qgl_funcs *pGl, const t_mat_gl& proj);
+	void CreateUniformBuffers(qgl_funcs *pGl);
+	void DeleteUniformBuffers();
 	void UpdateShadowFramebuffer();
+	void DeleteShadowFramebuffer();
+	bool IsShadowMapOutdated() const;
+
+	// gpu picking, the object ids under the cursor are read back in the next frame
+	void CreatePickFramebuffer(qgl_funcs *pGl);
+	void DeletePickFramebuffer();
+	void RenderPickPass(qgl_funcs *pGl);
+	void CollectPickResult(qgl_funcs *pGl);
+
+	// rendering at a different resolution than the screen's, see GlRenderer_resolution.cpp
+	std::array<int, 2> GetRenderDimensions() const;
+	void UpdateRenderScale(qgl_funcs *pGl);
+	bool BindScaledFramebuffer(qgl_funcs *pGl);
+	void UpscaleFramebuffer(qgl_funcs *pGl);
+	void CreateScaledFramebuffer(qgl_funcs *pGl, const std::array<int, 2>& size);
+	void DeleteScaledFramebuffer();
+	void CreateUpscaleShaders(qgl_funcs *pGl, const std::string& glsl_version);
+	void BeginFrameTimer(qgl_funcs *pGl);
+	void EndFrameTimer(qgl_funcs *pGl);
+	void CollectFrameTimers(qgl_funcs *pGl);
+	void DeleteFrameTimers();
 
 	void DoPaintGL(qgl_funcs *pGL);
 	void DoPaintQt(QPainter &painter);
 
+	void FetchReadback(qgl_funcs *pGl, GlReadbackBuffer& buf, const t_frame_callback& callback);
+	void DeleteOffscreen();
+
 
 private:
 #if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
 	t_qt_mutex m_mutexObj{};
+	t_qt_mutex m_mutexLoad{};
 #else
 	t_qt_mutex m_mutexObj{QMutex::Recursive};
+	t_qt_mutex m_mutexLoad{QMutex::Recursive};
 #endif
 
 	bool m_mouseMovedBetweenDownAndUp = false;
@@ -404,13 +932,18 @@ protected:
 	// shader interface
 	// ------------------------------------------------------------------------
 	std::shared_ptr<QOpenGLShaderProgram> m_shaders{};
-	std::shared_ptr<QOpenGLFramebufferObject> m_fboshadow{};
+
+	// depth-only framebuffer and texture for the shadow map
+	GLuint m_fboshadow = 0;
+	GLuint m_texshadow = 0;
+	int m_shadowMapSize = 2048;
 
 	// vertex attributes
 	GLint m_attrVertex = -1;
 	GLint m_attrVertexNorm = -1;
-	GLint m_attrVertexCol = -1;
 	GLint m_attrTexCoords = -1;
+	GLint m_attrInstanceTrafo = -1;
+	GLint m_attrInstanceCol = -1;
 
 	// texture
 	GLint m_uniTextureActive = -1;
@@ -418,21 +951,33 @@ protected:
 
 	// lighting
 	GLint m_uniConstCol = -1;
-	GLint m_uniLightPos = -1;
-	GLint m_uniNumActiveLights = -1;
 	GLint m_uniLightingEnabled = -1;
 	GLint m_uniShadowMap = -1;
 	GLint m_uniShadowRenderingEnabled = -1;
 	GLint m_uniShadowRenderPass = -1;
 
 	// matrices
-	GLint m_uniMatrixProj = -1;
-	GLint m_uniMatrixLightProj = -1;
-	GLint m_uniMatrixCam = -1;
-	GLint m_uniMatrixCamInv = -1;
-	GLint m_uniMatrixLight = -1;
-	GLint m_uniMatrixLightInv = -1;
 	GLint m_uniMatrixObj = -1;
+	GLint m_uniObjCol = -1;
+
+	// instancing
+	GLint m_uniInstancingEnabled = -1;
+
+	// uniform buffers with the per-frame and the light states
+	GLuint m_uboFrame = 0;
+	GLuint m_uboLights = 0;
+
+	// texture buffers with the light positions and ranges and with the lights of each screen tile
+	GLint m_uniLights = -1;
+	GLint m_uniLightTiles = -1;
+	GLint m_uniLightTilesEnabled = -1;
+
+	// object ids for gpu picking
+	GLint m_uniPickRenderPass = -1;
+	GLint m_uniPickId = -1;
+	GLuint m_bufLights = 0, m_texLights = 0;
+	GLuint m_bufLightTiles = 0, m_texLightTiles = 0;
+	std::vector<GLuint> m_light_tiles{};
 	// ------------------------------------------------------------------------
 
 	// version identifiers
@@ -454,26 +999,112 @@ protected:
 
 	std::atomic<bool> m_initialised = false;
 	std::atomic<bool> m_pickerNeedsUpdate = false;
+	std::atomic<bool> m_sceneBvhNeedsRebuild = true;
 	std::atomic<bool> m_lightsNeedUpdate = true;
-	std::atomic<bool> m_perspectiveNeedsUpdate = true;
+	std::atomic<bool> m_lightTilesNeedUpdate = true;
 	std::atomic<bool> m_viewportNeedsUpdate = true;
 	std::atomic<bool> m_shadowFramebufferNeedsUpdate = false;
 	std::atomic<bool> m_shadowRenderingEnabled = true;
+	std::atomic<bool> m_shadowMapCacheEnabled = true;
+	std::atomic<bool> m_shadowMapNeedsUpdate = true;
 	std::atomic<bool> m_shadowRenderPass = false;
 	std::atomic<bool> m_portalRenderingEnabled = true;
-	std::atomic<bool> m_firstpass = true;
+	std::atomic<bool> m_instancingEnabled = false;
+	std::atomic<bool> m_occlusionCullingEnabled = false;
+	std::atomic<bool> m_occlusionViewChanged = true;   // the objects or the camera have moved
+	std::atomic<bool> m_occlusionResultsPending = false;  // another frame is needed to read the queries
+	std::atomic<bool> m_gpuPickingEnabled = false;
+	std::atomic<bool> m_gpuPickRequested = false;
+	std::atomic<bool> m_pickRenderPass = false;
+	std::atomic<bool> m_profilerOverlayEnabled = false;
+	std::atomic<bool> m_smoothingEnabled = true;
+	std::atomic<bool> m_dynamicResolutionEnabled = false;
+	std::atomic<t_real_gl> m_renderScale = 1.;      // fixed scale, or the maximum of the dynamic one
+	std::atomic<t_real_gl> m_curRenderScale = 1.;   // scale of the current frame
+	std::atomic<t_real_gl> m_targetFrameTime = 1000./60.;  // ms
+	std::atomic<t_real_gl> m_lodPixels = 48.;
+	std::atomic<t_real_gl> m_lightRange = 64.;  // 0: unbounded
+	std::atomic<std::size_t> m_portalDepth = 2;
 	std::atomic<PortalRenderPass> m_portalRenderPass = PortalRenderPass::IGNORE;
 
 	// 3d objects
 	t_objs m_objs{};
 
+	// shared geometry of instanced objects
+	t_meshes m_meshes{};
+
+	// buffer pages holding the vertex and index data of the triangle objects
+	std::vector<std::unique_ptr<GlBufferPage>> m_vertex_pages{}, m_index_pages{};
+
+	// objects in the camera and light frusta, determined once per frame
+	std::vector<GlSceneObj*> m_visible_objs{};
+	std::vector<GlSceneObj*> m_visible_objs_shadow{};
+
+	// proxy geometry for the occlusion queries
+	GlRenderObj m_occlusionBox{};
+
+	// sorted objects of the current render pass and their gl states
+	std::vector<GlRenderQueueEntry> m_render_queue{};
+	GlStateCache m_glstates{};
+
+	// culling statistics of the main view
+	std::size_t m_num_objs_shown = 0, m_num_objs_culled = 0, m_num_objs_occluded = 0;
+	std::size_t m_last_num_objs_culled = 0, m_last_num_objs_occluded = 0;
+	std::size_t m_last_num_objs = 0;
+
+	// profiler timers and counters of the current frame
+	std::vector<GlTimerQuery> m_timer_queries{};
+	std::optional<std::size_t> m_cur_timer_query{};
+	std::size_t m_num_draw_calls = 0, m_num_triangles = 0;
+
+	// scene loading: vertex data is prepared by the worker threads
+	// and uploaded in batches by the gui thread,
+	// the load items are guarded by m_mutexLoad, which is locked before m_mutexObj
+	std::vector<std::unique_ptr<GlLoadJob>> m_load_jobs{};
+	std::vector<GlLoadItem> m_load_items{};
+	std::vector<std::thread> m_load_threads{};
+	std::atomic<std::size_t> m_load_next_job = 0;
+	std::atomic<bool> m_load_cancel = false;
+	std::size_t m_load_next_item = 0;
+	QTimer m_load_timer{};
+	bool m_uploadingBatch = false;  // the gl context is bound for a batch upload
+
+	// simulation thread and the transformations received from it
+	std::shared_ptr<SimThread> m_sim{};
+	SimThread::t_trafos m_sim_trafos{};
+
+	// objects by their scene handles, the map's nodes stay in place when they are renamed
+	std::unordered_map<Scene::t_handle, GlSceneObj*> m_handle_objs{};
+	bool m_sim_moving = false;  // objects have moved in the last frame
+
+	// world-space bounding boxes of the objects, used for culling and picking
+	ObjectBounds<t_real_gl> m_obj_bounds{};
+	std::vector<std::uint8_t> m_obj_inside{};
+	std::atomic<bool> m_objBoundsNeedUpdate = true;
+
+	// world-space hierarchy of the objects' bounding boxes for picking,
+	// the items are also the indices into m_obj_bounds
+	t_bvh m_scene_bvh{};
+	std::vector<t_objs::value_type*> m_scene_bvh_objs{};
+
 	// lights
 	std::vector<t_vec3_gl> m_lights{};
 
 	// texture map
 	t_textures m_textures{};
 
+	// texture streaming: the images are decoded by worker threads and uploaded by the gui thread,
+	// the least recently drawn textures are evicted when exceeding the memory budget
+	std::vector<GlTextureLoad> m_texture_loads{};
+	boost::asio::thread_pool m_texture_pool{2};  // decoding threads
+	QTimer m_texture_timer{};
+	std::size_t m_texture_frame = 0;
+	std::size_t m_texture_vram = 0;        // estimated gpu memory of the resident textures
+	std::size_t m_texture_vram_limit = 0;  // 0: unlimited
+
+	// tree of the visible portals, in depth-first order
 	std::vector<ActivePortal> m_active_portals{};
+	std::vector<std::size_t> m_portal_roots{};  // portals seen directly
 	const ActivePortal* m_active_portal = nullptr;
 
 	// cursor
@@ -486,6 +1117,45 @@ protected:
 
 	GlSceneObj m_selectionPlane{};
 
+	// offscreen surface and framebuffers for headless rendering,
+	// the frame is rendered into the multisampled framebuffer and resolved for the read-back
+	std::shared_ptr<QOffscreenSurface> m_offscreen_surface{};
+	std::shared_ptr<QOpenGLContext> m_offscreen_context{};
+	GLuint m_fbo_offscreen = 0, m_fbo_resolve = 0;
+	GLuint m_rbo_colour = 0, m_rbo_depth = 0, m_rbo_resolve = 0;
+	std::array<int, 2> m_offscreen_size{ 0, 0 };
+
+	// ring of read-back buffers, so that downloading a frame overlaps with rendering the next ones
+	std::array<GlReadbackBuffer, 3> m_readback{};
+	std::size_t m_readback_next = 0;
+
+	// 1x1 framebuffer with the object id and the depth under the cursor,
+	// the names of the objects drawn in the pick pass are indexed by id - 1
+	GLuint m_fbo_pick = 0, m_rbo_pick_id = 0, m_rbo_pick_depth = 0;
+	GlReadbackBuffer m_pick_readback{};
+	std::vector<std::string> m_pick_objs{};
+	t_mat_gl m_pick_inv_viewproj = m::unit<t_mat_gl>();
+	t_vec_gl m_pick_ndc = m::create<t_vec_gl>({ 0, 0, 0, 1 });
+
+	// framebuffer for a render scale other than 1, sized for the maximum scale,
+	// smaller scales only use its lower left part; multisampled frames are resolved into the texture
+	GLuint m_fbo_scaled = 0, m_rbo_scaled_colour = 0, m_rbo_scaled_depth = 0;
+	GLuint m_fbo_scaled_resolve = 0, m_tex_scaled = 0;
+	std::array<int, 2> m_scaled_size{ 0, 0 };
+	GLsizei m_scaled_samples = 0;
+
+	// draws the scaled frame onto the screen
+	std::shared_ptr<QOpenGLShaderProgram> m_shaders_upscale{};
+	std::shared_ptr<QOpenGLVertexArrayObject> m_vertex_array_upscale{};
+	GLint m_uniUpscaleFrame = -1, m_uniUpscaleTexScale = -1;
+	GLint m_uniUpscaleTexMin = -1, m_uniUpscaleTexMax = -1;
+
+	// gpu frame times for the dynamic resolution
+	std::array<GlFrameTimer, 4> m_frame_timers{};
+	std::optional<std::size_t> m_cur_frame_timer{};
+	t_real_gl m_gpu_frame_time = 0;            // smoothed, in ms, 0: not yet measured
+	std::size_t m_frames_since_rescale = 0;
+
 
 public slots:
 	void EnableTextures(bool b);
@@ -504,6 +1174,13 @@ signals:
 	void CamPositionChanged(t_real_gl x, t_real_gl y, t_real_gl z);
 	void CamRotationChanged(t_real_gl phi, t_real_gl theta);
 	void CamZoomChanged(t_real_gl zoom);
+
+	void CullingStatsChanged(std::size_t num_objs,
+		std::size_t num_culled, std::size_t num_occluded);
+	void SceneLoadProgress(std::size_t num_loaded, std::size_t num_objs);
+
+	// keyboard or mouse input that needs timer ticks at the full rate
+	void InputReceived();
 };
 
 
@@ -24,6 +24,8 @@
  */
 void GlSceneRenderer::keyPressEvent(QKeyEvent *pEvt)
 {
+	emit InputReceived();
+
 	switch(pEvt->key())
 	{
 		case Qt::Key_Left:
@@ -143,6 +145,7 @@ void GlSceneRenderer::mouseMoveEvent(QMouseEvent *pEvt)
 	// an object is being dragged
 	if(m_draggedObj != "")
 	{
+		emit InputReceived();
 		emit ObjectDragged(false, m_draggedObj);
 	}
 
@@ -171,6 +174,7 @@ QPoint GlSceneRenderer::GetMousePosition(bool global_pos) const
 void GlSceneRenderer::mousePressEvent(QMouseEvent *pEvt)
 {
 	m_mouseMovedBetweenDownAndUp = false;
+	emit InputReceived();
 
 	if(pEvt->buttons() & Qt::LeftButton) m_mouseDown[0] = 1;
 	if(pEvt->buttons() & Qt::MiddleButton) m_mouseDown[1] = 1;
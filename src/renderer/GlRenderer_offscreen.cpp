@@ -0,0 +1,347 @@
+/**
+ * gl scene renderer -- headless rendering into offscreen framebuffers
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * References:
+ *   - https://doc.qt.io/qt-5/qoffscreensurface.html
+ *   - https://www.khronos.org/opengl/wiki/Pixel_Buffer_Object
+ *   - https://www.khronos.org/opengl/wiki/Sync_Object
+ */
+
+#include "GlRenderer.h"
+
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QSurfaceFormat>
+
+#include <iostream>
+#include <cstring>
+#include <chrono>
+#include <thread>
+
+
+/**
+ * make the widget's or the offscreen context current
+ */
+void GlSceneRenderer::MakeCurrent()
+{
+	if(m_offscreen_context)
+		m_offscreen_context->makeCurrent(m_offscreen_surface.get());
+	else
+		QOpenGLWidget::makeCurrent();
+}
+
+
+/**
+ * release the widget's context,
+ * the offscreen context stays current, as it is the only one used in headless mode
+ */
+void GlSceneRenderer::DoneCurrent()
+{
+	if(!m_offscreen_context)
+		QOpenGLWidget::doneCurrent();
+}
+
+
+/**
+ * the widget's or the offscreen context
+ */
+QOpenGLContext* GlSceneRenderer::GetContext() const
+{
+	if(m_offscreen_context)
+		return m_offscreen_context.get();
+	return QOpenGLWidget::context();
+}
+
+
+/**
+ * the framebuffer that the main render pass draws into
+ */
+GLuint GlSceneRenderer::GetDefaultFramebuffer() const
+{
+	if(m_offscreen_context)
+		return m_fbo_offscreen;
+	return QOpenGLWidget::defaultFramebufferObject();
+}
+
+
+/**
+ * create the offscreen surface, context, and framebuffers and initialise the renderer
+ */
+bool GlSceneRenderer::InitOffscreen(int width, int height)
+{
+	const QSurfaceFormat format = QSurfaceFormat::defaultFormat();
+
+	m_offscreen_surface = std::make_shared<QOffscreenSurface>();
+	m_offscreen_surface->setFormat(format);
+	m_offscreen_surface->create();
+	if(!m_offscreen_surface->isValid())
+	{
+		std::cerr << "Cannot create offscreen surface." << std::endl;
+		m_offscreen_surface.reset();
+		return false;
+	}
+
+	m_offscreen_context = std::make_shared<QOpenGLContext>();
+	m_offscreen_context->setFormat(format);
+	if(!m_offscreen_context->create() ||
+		!m_offscreen_context->makeCurrent(m_offscreen_surface.get()))
+	{
+		std::cerr << "Cannot create offscreen gl context." << std::endl;
+		m_offscreen_context.reset();
+		m_offscreen_surface.reset();
+		return false;
+	}
+
+	auto *pGl = GetGlFunctions();
+	if(!pGl)
+		return false;
+
+	m_offscreen_size = { width, height };
+	const GLsizei samples = std::max(format.samples(), 0);
+
+	// render target
+	pGl->glGenRenderbuffers(1, &m_rbo_colour);
+	pGl->glBindRenderbuffer(GL_RENDERBUFFER, m_rbo_colour);
+	pGl->glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+
+	// the stencil buffer is needed for the portals
+	pGl->glGenRenderbuffers(1, &m_rbo_depth);
+	pGl->glBindRenderbuffer(GL_RENDERBUFFER, m_rbo_depth);
+	pGl->glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, width, height);
+
+	pGl->glGenFramebuffers(1, &m_fbo_offscreen);
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, m_fbo_offscreen);
+	pGl->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_rbo_colour);
+	pGl->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_rbo_depth);
+	if(pGl->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cerr << "Offscreen framebuffer is incomplete." << std::endl;
+
+	// single-sampled framebuffer for the read-back
+	if(samples > 0)
+	{
+		pGl->glGenRenderbuffers(1, &m_rbo_resolve);
+		pGl->glBindRenderbuffer(GL_RENDERBUFFER, m_rbo_resolve);
+		pGl->glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+		pGl->glGenFramebuffers(1, &m_fbo_resolve);
+		pGl->glBindFramebuffer(GL_FRAMEBUFFER, m_fbo_resolve);
+		pGl->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_rbo_resolve);
+		if(pGl->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cerr << "Offscreen resolve framebuffer is incomplete." << std::endl;
+	}
+
+	pGl->glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, m_fbo_offscreen);
+
+	// pixel buffers for the read-back
+	const GLsizeiptr frame_size = GLsizeiptr(width) * GLsizeiptr(height) * 4;
+	for(GlReadbackBuffer& buf : m_readback)
+	{
+		pGl->glGenBuffers(1, &buf.pbo);
+		pGl->glBindBuffer(GL_PIXEL_PACK_BUFFER, buf.pbo);
+		pGl->glBufferData(GL_PIXEL_PACK_BUFFER, frame_size, nullptr, GL_STREAM_READ);
+	}
+	pGl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_readback_next = 0;
+	LOGGLERR(pGl);
+
+	initializeGL();
+	resizeGL(width, height);
+
+	return m_initialised;
+}
+
+
+/**
+ * upload all objects and textures of the scene that is being loaded
+ */
+void GlSceneRenderer::FinishLoading()
+{
+	while(IsLoading() || IsLoadingTextures())
+	{
+		UploadLoadedObjects();
+		UploadLoadedTextures();
+
+		if(IsLoading() || IsLoadingTextures())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+
+/**
+ * render a frame into the offscreen framebuffer and copy it asynchronously into the next pixel buffer
+ */
+bool GlSceneRenderer::RenderOffscreen(std::size_t frame, const t_frame_callback& callback)
+{
+	if(!IsOffscreen() || !m_initialised)
+		return false;
+
+	MakeCurrent();
+	auto *pGl = GetGlFunctions();
+	if(!pGl)
+		return false;
+
+	// the oldest buffer in the ring is re-used, so its frame has to be fetched first
+	GlReadbackBuffer& buf = m_readback[m_readback_next];
+	if(buf.pending)
+		FetchReadback(pGl, buf, callback);
+
+	UpdateCam(false);
+	paintGL();
+
+	// evicted textures have been requested again, they are needed for a complete frame
+	if(IsLoadingTextures())
+	{
+		FinishLoading();
+		MakeCurrent();
+		paintGL();
+	}
+
+	const auto [width, height] = m_offscreen_size;
+
+	// resolve the multisampled frame
+	if(m_fbo_resolve)
+	{
+		pGl->glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo_offscreen);
+		pGl->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo_resolve);
+		pGl->glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
+			GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+
+	// start the transfer into the pixel buffer, this returns without waiting for the gpu
+	pGl->glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo_resolve ? m_fbo_resolve : m_fbo_offscreen);
+	pGl->glReadBuffer(GL_COLOR_ATTACHMENT0);
+	pGl->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	pGl->glBindBuffer(GL_PIXEL_PACK_BUFFER, buf.pbo);
+	pGl->glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	pGl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, m_fbo_offscreen);
+
+#ifdef _GL_FENCE_SYNC
+	buf.fence = pGl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+	pGl->glFlush();
+	LOGGLERR(pGl);
+
+	buf.frame = frame;
+	buf.pending = true;
+	m_readback_next = (m_readback_next + 1) % m_readback.size();
+
+	return true;
+}
+
+
+/**
+ * fetch all remaining frames
+ */
+void GlSceneRenderer::FinishOffscreen(const t_frame_callback& callback)
+{
+	if(!IsOffscreen())
+		return;
+
+	MakeCurrent();
+	auto *pGl = GetGlFunctions();
+	if(!pGl)
+		return;
+
+	// the oldest frames come first
+	for(std::size_t idx = 0; idx < m_readback.size(); ++idx)
+	{
+		GlReadbackBuffer& buf = m_readback[(m_readback_next + idx) % m_readback.size()];
+		if(buf.pending)
+			FetchReadback(pGl, buf, callback);
+	}
+}
+
+
+/**
+ * wait for the transfer of a frame to finish and pass its image to the callback
+ */
+void GlSceneRenderer::FetchReadback(qgl_funcs *pGl, GlReadbackBuffer& buf, const t_frame_callback& callback)
+{
+#ifdef _GL_FENCE_SYNC
+	if(buf.fence)
+	{
+		// usually already signalled, as the following frames have been rendered in the meantime
+		constexpr GLuint64 timeout = 1'000'000'000;  // ns
+		while(pGl->glClientWaitSync(buf.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout) == GL_TIMEOUT_EXPIRED)
+			;
+		pGl->glDeleteSync(buf.fence);
+		buf.fence = nullptr;
+	}
+#endif
+
+	const auto [width, height] = m_offscreen_size;
+	const std::size_t line_size = std::size_t(width) * 4;
+
+	pGl->glBindBuffer(GL_PIXEL_PACK_BUFFER, buf.pbo);
+	const uchar *data = reinterpret_cast<const uchar*>(pGl->glMapBufferRange(
+		GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(line_size * height), GL_MAP_READ_BIT));
+
+	QImage img;
+	if(data)
+	{
+		// gl's origin is at the bottom
+		img = QImage(width, height, QImage::Format_RGBA8888);
+		for(int y = 0; y < height; ++y)
+			std::memcpy(img.scanLine(height - y - 1), data + y*line_size, line_size);
+
+		pGl->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	else
+	{
+		std::cerr << "Cannot map read-back buffer of frame " << buf.frame << "." << std::endl;
+	}
+
+	pGl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	LOGGLERR(pGl);
+
+	buf.pending = false;
+	if(callback)
+		callback(buf.frame, std::move(img));
+}
+
+
+/**
+ * delete the offscreen framebuffers and pixel buffers, needs a current gl context
+ */
+void GlSceneRenderer::DeleteOffscreen()
+{
+	if(!IsOffscreen())
+		return;
+
+	auto *pGl = GetGlFunctions();
+	if(!pGl)
+		return;
+
+	for(GlReadbackBuffer& buf : m_readback)
+	{
+#ifdef _GL_FENCE_SYNC
+		if(buf.fence)
+			pGl->glDeleteSync(buf.fence);
+		buf.fence = nullptr;
+#endif
+		if(buf.pbo)
+			pGl->glDeleteBuffers(1, &buf.pbo);
+		buf.pbo = 0;
+		buf.pending = false;
+	}
+
+	for(GLuint *fbo : { &m_fbo_offscreen, &m_fbo_resolve })
+	{
+		if(*fbo)
+			pGl->glDeleteFramebuffers(1, fbo);
+		*fbo = 0;
+	}
+
+	for(GLuint *rbo : { &m_rbo_colour, &m_rbo_depth, &m_rbo_resolve })
+	{
+		if(*rbo)
+			pGl->glDeleteRenderbuffers(1, rbo);
+		*rbo = 0;
+	}
+
+	LOGGLERR(pGl);
+}
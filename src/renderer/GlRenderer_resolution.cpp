@@ -0,0 +1,493 @@
+/**
+ * gl scene renderer -- render quality, scaled rendering and dynamic resolution
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * References:
+ *   - https://www.khronos.org/opengl/wiki/Framebuffer_Object
+ *   - https://www.khronos.org/opengl/wiki/Query_Object#Timer_queries
+ */
+
+#include "GlRenderer.h"
+
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QSurfaceFormat>
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/algorithm/string.hpp>
+namespace algo = boost::algorithm;
+
+#include "src/settings_variables.h"
+
+
+// range of the render scale factor
+static constexpr t_real_gl g_min_render_scale = 0.25;
+static constexpr t_real_gl g_max_render_scale = 2.;
+
+// the dynamic resolution doesn't go below this scale, unless the fixed one does
+static constexpr t_real_gl g_min_dynamic_scale = 0.5;
+
+// measured frames before the dynamic scale is changed again, and its maximum change
+static constexpr std::size_t g_rescale_frames = 8;
+static constexpr t_real_gl g_max_rescale_step = 0.125;
+
+
+/**
+ * screen dimensions multiplied by the render scale
+ */
+static std::array<int, 2> scale_dims(const std::array<int, 2>& dims, t_real_gl scale)
+{
+	return
+	{
+		std::max(int(std::ceil(t_real_gl(dims[0]) * scale)), 1),
+		std::max(int(std::ceil(t_real_gl(dims[1]) * scale)), 1),
+	};
+}
+
+
+/**
+ * polygon and line smoothing, this is expensive and mostly redundant with multisampling
+ */
+void GlSceneRenderer::EnableSmoothing(bool b)
+{
+	m_smoothingEnabled = b;
+	update();
+}
+
+
+/**
+ * render at a multiple of the screen resolution, the frame is then scaled to the screen size
+ * with dynamic resolution, this is the maximum scale
+ */
+void GlSceneRenderer::SetRenderScale(t_real_gl scale)
+{
+	m_renderScale = std::clamp(scale, g_min_render_scale, g_max_render_scale);
+	update();
+}
+
+
+/**
+ * adapt the render scale to the measured gpu frame times in order to reach the target frame rate
+ */
+void GlSceneRenderer::EnableDynamicResolution(bool b, t_real_gl target_fps)
+{
+	m_dynamicResolutionEnabled = b;
+	m_targetFrameTime = t_real_gl(1000.) / std::max<t_real_gl>(target_fps, 1);
+	m_gpu_frame_time = 0;
+	m_frames_since_rescale = 0;
+	update();
+}
+
+
+/**
+ * size of the frame that the main render passes draw
+ */
+std::array<int, 2> GlSceneRenderer::GetRenderDimensions() const
+{
+	const auto& dims = m_cam.GetScreenDimensions();
+	const t_real_gl scale = m_curRenderScale;
+	if(scale == 1)
+		return dims;
+
+	return scale_dims(dims, scale);
+}
+
+
+/**
+ * determine the render scale of the current frame and provide its framebuffer
+ */
+void GlSceneRenderer::UpdateRenderScale(qgl_funcs *pGl)
+{
+	const t_real_gl max_scale = m_renderScale;
+	const t_real_gl old_scale = m_curRenderScale;
+	t_real_gl scale = max_scale;
+
+	if(m_dynamicResolutionEnabled)
+	{
+		CollectFrameTimers(pGl);
+
+		const t_real_gl min_scale = std::min(g_min_dynamic_scale, max_scale);
+		const t_real_gl target = m_targetFrameTime;
+		scale = std::clamp(old_scale, min_scale, max_scale);
+
+		// the gpu time is roughly proportional to the number of pixels,
+		// aim a bit below the target and only scale up again if there is enough headroom
+		if(m_gpu_frame_time > 0 && m_frames_since_rescale >= g_rescale_frames &&
+			(m_gpu_frame_time > target || m_gpu_frame_time < target * t_real_gl(0.75)))
+		{
+			t_real_gl new_scale = scale * std::sqrt(target * t_real_gl(0.9) / m_gpu_frame_time);
+			new_scale = std::clamp(new_scale, scale - g_max_rescale_step, scale + g_max_rescale_step);
+			new_scale = std::round(new_scale * t_real_gl(32)) / t_real_gl(32);
+			scale = std::clamp(new_scale, min_scale, max_scale);
+		}
+	}
+
+	if(scale != 1 && m_shaders_upscale)
+	{
+		// the framebuffer is sized for the maximum scale
+		const std::array<int, 2> size = scale_dims(m_cam.GetScreenDimensions(),
+			std::max(max_scale, scale));
+		const GLsizei samples = std::max(GetContext()->format().samples(), 0);
+
+		if(!m_fbo_scaled || size != m_scaled_size || samples != m_scaled_samples)
+			CreateScaledFramebuffer(pGl, size);
+	}
+	else if(m_fbo_scaled && !m_dynamicResolutionEnabled)
+	{
+		// the framebuffer is kept while the dynamic resolution may need it again
+		DeleteScaledFramebuffer();
+	}
+
+	// without the framebuffer or the upscaling shaders, the screen resolution is used
+	if(!m_fbo_scaled || !m_shaders_upscale)
+		scale = 1;
+
+	if(scale != old_scale)
+	{
+		m_curRenderScale = scale;
+		m_gpu_frame_time = 0;
+		m_frames_since_rescale = 0;
+
+		m_viewportNeedsUpdate = true;
+		m_lightTilesNeedUpdate = true;
+	}
+}
+
+
+/**
+ * bind the framebuffer for a render scale other than 1
+ * @return false if the main passes draw directly into the default framebuffer
+ */
+bool GlSceneRenderer::BindScaledFramebuffer(qgl_funcs *pGl)
+{
+	if(m_curRenderScale == 1 || !m_fbo_scaled)
+		return false;
+
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, m_fbo_scaled);
+	return true;
+}
+
+
+/**
+ * draw the scaled frame onto the default framebuffer
+ */
+void GlSceneRenderer::UpscaleFramebuffer(qgl_funcs *pGl)
+{
+	const auto& dims = m_cam.GetScreenDimensions();
+	const std::array<int, 2> render_dims = GetRenderDimensions();
+
+	// resolve the samples of the rendered part
+	if(m_fbo_scaled_resolve)
+	{
+		pGl->glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo_scaled);
+		pGl->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo_scaled_resolve);
+		pGl->glBlitFramebuffer(0, 0, render_dims[0], render_dims[1],
+			0, 0, render_dims[0], render_dims[1], GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, GetDefaultFramebuffer());
+	pGl->glViewport(0, 0, dims[0], dims[1]);
+	m_viewportNeedsUpdate = true;  // restore the scaled viewport
+
+	// the frame is drawn over the whole screen
+	pGl->glDisable(GL_DEPTH_TEST);
+	pGl->glDisable(GL_STENCIL_TEST);
+	pGl->glDisable(GL_SCISSOR_TEST);
+	pGl->glDisable(GL_BLEND);
+	pGl->glDisable(GL_CULL_FACE);
+	pGl->glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+	pGl->glActiveTexture(GL_TEXTURE0);
+	pGl->glBindTexture(GL_TEXTURE_2D, m_tex_scaled);
+
+	const GLfloat tex_w = GLfloat(m_scaled_size[0]);
+	const GLfloat tex_h = GLfloat(m_scaled_size[1]);
+
+	m_shaders_upscale->bind();
+	m_shaders_upscale->setUniformValue(m_uniUpscaleTexScale,
+		GLfloat(render_dims[0]) / tex_w, GLfloat(render_dims[1]) / tex_h);
+	m_shaders_upscale->setUniformValue(m_uniUpscaleTexMin,
+		GLfloat(0.5) / tex_w, GLfloat(0.5) / tex_h);
+	m_shaders_upscale->setUniformValue(m_uniUpscaleTexMax,
+		(GLfloat(render_dims[0]) - GLfloat(0.5)) / tex_w,
+		(GLfloat(render_dims[1]) - GLfloat(0.5)) / tex_h);
+
+	m_vertex_array_upscale->bind();
+	pGl->glDrawArrays(GL_TRIANGLES, 0, 3);
+	m_vertex_array_upscale->release();
+
+	m_shaders_upscale->release();
+	pGl->glBindTexture(GL_TEXTURE_2D, 0);
+	LOGGLERR(pGl);
+}
+
+
+/**
+ * framebuffer for the scaled frame, with the surface's number of samples
+ */
+void GlSceneRenderer::CreateScaledFramebuffer(qgl_funcs *pGl, const std::array<int, 2>& size)
+{
+	DeleteScaledFramebuffer();
+
+	const auto [width, height] = size;
+	const GLsizei samples = std::max(GetContext()->format().samples(), 0);
+
+	// texture that is drawn onto the screen
+	pGl->glActiveTexture(GL_TEXTURE0);
+	pGl->glGenTextures(1, &m_tex_scaled);
+	pGl->glBindTexture(GL_TEXTURE_2D, m_tex_scaled);
+	pGl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	pGl->glBindTexture(GL_TEXTURE_2D, 0);
+
+	// the stencil buffer is needed for the portals
+	pGl->glGenRenderbuffers(1, &m_rbo_scaled_depth);
+	pGl->glBindRenderbuffer(GL_RENDERBUFFER, m_rbo_scaled_depth);
+	pGl->glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, width, height);
+
+	pGl->glGenFramebuffers(1, &m_fbo_scaled);
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, m_fbo_scaled);
+	pGl->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_rbo_scaled_depth);
+
+	bool complete = true;
+	if(samples > 0)
+	{
+		// multisampled render target, resolved into the texture
+		pGl->glGenRenderbuffers(1, &m_rbo_scaled_colour);
+		pGl->glBindRenderbuffer(GL_RENDERBUFFER, m_rbo_scaled_colour);
+		pGl->glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+		pGl->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_rbo_scaled_colour);
+		complete = (pGl->glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+		pGl->glGenFramebuffers(1, &m_fbo_scaled_resolve);
+		pGl->glBindFramebuffer(GL_FRAMEBUFFER, m_fbo_scaled_resolve);
+		pGl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_tex_scaled, 0);
+		complete = complete && (pGl->glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	}
+	else
+	{
+		// render directly into the texture
+		pGl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_tex_scaled, 0);
+		complete = (pGl->glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	}
+
+	pGl->glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	pGl->glBindFramebuffer(GL_FRAMEBUFFER, GetDefaultFramebuffer());
+	LOGGLERR(pGl);
+
+	if(!complete)
+	{
+		std::cerr << "Scaled framebuffer is incomplete." << std::endl;
+		DeleteScaledFramebuffer();
+		return;
+	}
+
+	m_scaled_size = size;
+	m_scaled_samples = samples;
+}
+
+
+/**
+ * delete the framebuffer of the scaled frame, needs a current gl context
+ */
+void GlSceneRenderer::DeleteScaledFramebuffer()
+{
+	auto *pGl = GetGlFunctions();
+	if(!pGl)
+		return;
+
+	for(GLuint *fbo : { &m_fbo_scaled, &m_fbo_scaled_resolve })
+	{
+		if(*fbo)
+			pGl->glDeleteFramebuffers(1, fbo);
+		*fbo = 0;
+	}
+
+	for(GLuint *rbo : { &m_rbo_scaled_colour, &m_rbo_scaled_depth })
+	{
+		if(*rbo)
+			pGl->glDeleteRenderbuffers(1, rbo);
+		*rbo = 0;
+	}
+
+	if(m_tex_scaled)
+		pGl->glDeleteTextures(1, &m_tex_scaled);
+	m_tex_scaled = 0;
+
+	m_scaled_size = { 0, 0 };
+	m_scaled_samples = 0;
+}
+
+
+/**
+ * shaders drawing the scaled frame, without them the frames are always rendered at the screen size
+ */
+void GlSceneRenderer::CreateUpscaleShaders(qgl_funcs *pGl, const std::string& glsl_version)
+{
+	m_shaders_upscale.reset();
+
+	auto fragfile = g_res.FindFile("upscale_frag.shader");
+	auto vertexfile = g_res.FindFile("upscale_vertex.shader");
+
+	if(!fragfile || !vertexfile)
+	{
+		std::cerr << "Upscaling shaders could not be found." << std::endl;
+		return;
+	}
+
+	boost::iostreams::mapped_file_source frag_shader(*fragfile);
+	boost::iostreams::mapped_file_source vertex_shader(*vertexfile);
+
+	if(!frag_shader.is_open() || !vertex_shader.is_open())
+	{
+		std::cerr << "Upscaling shaders could not be loaded." << std::endl;
+		return;
+	}
+
+	std::string strFragShader = frag_shader.data();
+	std::string strVertexShader = vertex_shader.data();
+	for(std::string* strSrc : { &strFragShader, &strVertexShader })
+		algo::replace_all(*strSrc, std::string("${GLSL_VERSION}"), glsl_version);
+
+	auto shaders = std::make_shared<QOpenGLShaderProgram>(this);
+	if(!shaders->addShaderFromSourceCode(QOpenGLShader::Fragment, strFragShader.c_str()) ||
+		!shaders->addShaderFromSourceCode(QOpenGLShader::Vertex, strVertexShader.c_str()) ||
+		!shaders->link())
+	{
+		std::cerr << "Cannot create upscaling shaders." << std::endl;
+
+		std::string strLog = shaders->log().toStdString();
+		if(strLog.size())
+			std::cerr << "Shader log: " << strLog << std::endl;
+		return;
+	}
+
+	m_uniUpscaleFrame = shaders->uniformLocation("frame");
+	m_uniUpscaleTexScale = shaders->uniformLocation("tex_scale");
+	m_uniUpscaleTexMin = shaders->uniformLocation("tex_min");
+	m_uniUpscaleTexMax = shaders->uniformLocation("tex_max");
+
+	shaders->bind();
+	shaders->setUniformValue(m_uniUpscaleFrame, 0);
+	shaders->release();
+
+	// the vertices are generated in the shader, but core profiles need a bound vertex array
+	m_vertex_array_upscale = std::make_shared<QOpenGLVertexArrayObject>();
+	m_vertex_array_upscale->create();
+
+	m_shaders_upscale = shaders;
+	LOGGLERR(pGl);
+}
+
+
+/**
+ * record the gpu time at the start of the frame
+ */
+void GlSceneRenderer::BeginFrameTimer([[maybe_unused]] qgl_funcs *pGl)
+{
+#ifdef _GL_TIMER_QUERIES
+	m_cur_frame_timer.reset();
+	if(!m_dynamicResolutionEnabled)
+		return;
+
+	// if the results of all timers are still pending, this frame is not measured
+	for(std::size_t idx = 0; idx < m_frame_timers.size(); ++idx)
+	{
+		GlFrameTimer& timer = m_frame_timers[idx];
+		if(timer.pending)
+			continue;
+
+		if(!timer.queries[0])
+			pGl->glGenQueries(2, timer.queries);
+
+		timer.scale = m_curRenderScale;
+		pGl->glQueryCounter(timer.queries[0], GL_TIMESTAMP);
+		m_cur_frame_timer = idx;
+		break;
+	}
+#endif
+}
+
+
+/**
+ * record the gpu time at the end of the frame
+ */
+void GlSceneRenderer::EndFrameTimer([[maybe_unused]] qgl_funcs *pGl)
+{
+#ifdef _GL_TIMER_QUERIES
+	if(!m_cur_frame_timer)
+		return;
+
+	GlFrameTimer& timer = m_frame_timers[*m_cur_frame_timer];
+	pGl->glQueryCounter(timer.queries[1], GL_TIMESTAMP);
+	timer.pending = true;
+	m_cur_frame_timer.reset();
+#endif
+}
+
+
+/**
+ * add the finished gpu frame times of previous frames without stalling
+ */
+void GlSceneRenderer::CollectFrameTimers([[maybe_unused]] qgl_funcs *pGl)
+{
+#ifdef _GL_TIMER_QUERIES
+	for(GlFrameTimer& timer : m_frame_timers)
+	{
+		if(!timer.pending)
+			continue;
+
+		GLuint available = 0;
+		pGl->glGetQueryObjectuiv(timer.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if(!available)
+			continue;
+
+		GLuint64 ns[2] = { 0, 0 };
+		pGl->glGetQueryObjectui64v(timer.queries[0], GL_QUERY_RESULT, &ns[0]);
+		pGl->glGetQueryObjectui64v(timer.queries[1], GL_QUERY_RESULT, &ns[1]);
+		timer.pending = false;
+
+		// frames rendered at a previous scale are not representative
+		if(timer.scale != m_curRenderScale || ns[1] < ns[0])
+			continue;
+
+		const t_real_gl ms = t_real_gl(ns[1] - ns[0]) * t_real_gl(1e-6);
+		if(m_gpu_frame_time > 0)
+			m_gpu_frame_time += (ms - m_gpu_frame_time) * t_real_gl(0.2);
+		else
+			m_gpu_frame_time = ms;
+		++m_frames_since_rescale;
+	}
+	LOGGLERR(pGl);
+#endif
+}
+
+
+/**
+ * delete the gpu frame timers, needs a current gl context
+ */
+void GlSceneRenderer::DeleteFrameTimers()
+{
+#ifdef _GL_TIMER_QUERIES
+	auto *pGl = GetGlFunctions();
+	if(!pGl)
+		return;
+
+	for(GlFrameTimer& timer : m_frame_timers)
+	{
+		if(timer.queries[0])
+			pGl->glDeleteQueries(2, timer.queries);
+		timer = GlFrameTimer{};
+	}
+	m_cur_frame_timer.reset();
+#endif
+}
@@ -0,0 +1,421 @@
+/**
+ * gl scene renderer -- texture streaming
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * References:
+ *   - https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dx-graphics-dds-pguide
+ *   - https://registry.khronos.org/KTX/specs/1.0/ktxspec.v1.html
+ *   - https://www.khronos.org/opengl/wiki/S3_Texture_Compression
+ */
+
+#include "GlRenderer.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+
+#include <boost/scope_exit.hpp>
+#include <boost/asio/post.hpp>
+
+#include "src/common/Profiler.h"
+
+
+/**
+ * read a little-endian 32-bit value
+ */
+static std::uint32_t read_u32(const char *data)
+{
+	const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+	return std::uint32_t(bytes[0]) | (std::uint32_t(bytes[1]) << 8) |
+		(std::uint32_t(bytes[2]) << 16) | (std::uint32_t(bytes[3]) << 24);
+}
+
+
+// largest texture dimension accepted from the image headers
+static constexpr std::uint32_t max_texture_size = 1u << 16;
+
+
+/**
+ * get the mip levels of a block-compressed dds file
+ */
+static bool load_dds(const QByteArray& file, GlTextureImage& img)
+{
+	constexpr int header_size = 4 + 124;
+	if(file.size() < header_size || std::memcmp(file.constData(), "DDS ", 4) != 0)
+		return false;
+
+	const char *data = file.constData();
+	const std::uint32_t height = read_u32(data + 12);
+	const std::uint32_t width = read_u32(data + 16);
+	if(width == 0 || height == 0 || width > max_texture_size || height > max_texture_size)
+		return false;
+	img.height = int(height);
+	img.width = int(width);
+	const std::uint32_t num_levels = std::max<std::uint32_t>(read_u32(data + 28), 1);
+	const char *fourcc = data + 84;
+
+	// compressed format and size of a 4x4 block
+	qsizetype offs = header_size;
+	qsizetype block_size = 16;
+	if(std::memcmp(fourcc, "DXT1", 4) == 0)
+	{
+		img.compressed_format = QOpenGLTexture::RGBA_DXT1;
+		block_size = 8;
+	}
+	else if(std::memcmp(fourcc, "DXT3", 4) == 0)
+	{
+		img.compressed_format = QOpenGLTexture::RGBA_DXT3;
+	}
+	else if(std::memcmp(fourcc, "DXT5", 4) == 0)
+	{
+		img.compressed_format = QOpenGLTexture::RGBA_DXT5;
+	}
+	else if(std::memcmp(fourcc, "ATI1", 4) == 0 || std::memcmp(fourcc, "BC4U", 4) == 0)
+	{
+		img.compressed_format = QOpenGLTexture::R_ATI1N_UNorm;
+		block_size = 8;
+	}
+	else if(std::memcmp(fourcc, "ATI2", 4) == 0 || std::memcmp(fourcc, "BC5U", 4) == 0)
+	{
+		img.compressed_format = QOpenGLTexture::RG_ATI2N_UNorm;
+	}
+	else if(std::memcmp(fourcc, "DX10", 4) == 0 && file.size() >= header_size + 20)
+	{
+		// dxgi format of the extended header
+		offs += 20;
+		switch(read_u32(data + header_size))
+		{
+			case 71: img.compressed_format = QOpenGLTexture::RGBA_DXT1; block_size = 8; break;
+			case 72: img.compressed_format = QOpenGLTexture::SRGB_Alpha_DXT1; block_size = 8; break;
+			case 74: img.compressed_format = QOpenGLTexture::RGBA_DXT3; break;
+			case 75: img.compressed_format = QOpenGLTexture::SRGB_Alpha_DXT3; break;
+			case 77: img.compressed_format = QOpenGLTexture::RGBA_DXT5; break;
+			case 78: img.compressed_format = QOpenGLTexture::SRGB_Alpha_DXT5; break;
+			case 80: img.compressed_format = QOpenGLTexture::R_ATI1N_UNorm; block_size = 8; break;
+			case 83: img.compressed_format = QOpenGLTexture::RG_ATI2N_UNorm; break;
+			case 98: img.compressed_format = QOpenGLTexture::RGB_BP_UNorm; break;
+			case 99: img.compressed_format = QOpenGLTexture::SRGB_BP_UNorm; break;
+			default: return false;
+		}
+	}
+	else
+	{
+		// uncompressed dds files are left to the qt image plugins
+		return false;
+	}
+
+	for(std::uint32_t level = 0; level < num_levels && level < 32; ++level)
+	{
+		const qsizetype w = std::max(img.width >> level, 1);
+		const qsizetype h = std::max(img.height >> level, 1);
+		const qsizetype size = ((w + 3) / 4) * ((h + 3) / 4) * block_size;
+		if(size > file.size() - offs)
+			break;
+
+		img.levels.emplace_back(data + offs, size);
+		offs += size;
+	}
+
+	return img.levels.size() != 0;
+}
+
+
+/**
+ * get the mip levels of a compressed ktx (version 1) file,
+ * the internal format is given directly, e.g. bc or etc2
+ */
+static bool load_ktx(const QByteArray& file, GlTextureImage& img)
+{
+	static const unsigned char ident[12] =
+		{ 0xab, 'K', 'T', 'X', ' ', '1', '1', 0xbb, '\r', '\n', 0x1a, '\n' };
+	constexpr int header_size = 64;
+	if(file.size() < header_size || std::memcmp(file.constData(), ident, sizeof(ident)) != 0)
+		return false;
+
+	const char *data = file.constData();
+	if(read_u32(data + 12) != 0x04030201)
+	{
+		std::cerr << "Byte-swapped ktx files are not supported." << std::endl;
+		return false;
+	}
+
+	// only single 2d compressed images, which have a gl type of 0
+	if(read_u32(data + 16) != 0 || read_u32(data + 44) > 1 ||
+		read_u32(data + 48) > 1 || read_u32(data + 52) > 1)
+		return false;
+
+	img.compressed_format = GLenum(read_u32(data + 28));
+	const std::uint32_t width = read_u32(data + 36);
+	const std::uint32_t height = std::max<std::uint32_t>(read_u32(data + 40), 1);
+	if(width == 0 || width > max_texture_size || height > max_texture_size)
+		return false;
+	img.width = int(width);
+	img.height = int(height);
+	const std::uint32_t num_levels = std::max<std::uint32_t>(read_u32(data + 56), 1);
+
+	qsizetype offs = header_size + qsizetype(read_u32(data + 60));  // skip key-value data
+	for(std::uint32_t level = 0; level < num_levels; ++level)
+	{
+		if(offs + 4 > file.size())
+			break;
+		const qsizetype size = qsizetype(read_u32(data + offs));
+		offs += 4;
+		if(offs + size > file.size())
+			break;
+
+		img.levels.emplace_back(data + offs, size);
+		offs += (size + 3) & ~qsizetype(3);  // mip padding
+	}
+
+	return img.levels.size() != 0;
+}
+
+
+/**
+ * decode a texture image, runs in a worker thread,
+ * the file is only read if its contents are not known from a previous load
+ */
+GlTextureImage GlSceneRenderer::DecodeTexture(const std::string& filename, QByteArray file)
+{
+	GlTextureImage img;
+
+	if(file.isEmpty())
+	{
+		QFile qfile(filename.c_str());
+		if(!qfile.open(QIODevice::ReadOnly))
+			return img;
+		file = qfile.readAll();
+	}
+
+	// pre-compressed formats
+	const QString suffix = QFileInfo(filename.c_str()).suffix().toLower();
+	if(suffix == "dds" || suffix == "ktx")
+	{
+		if(suffix == "dds" ? load_dds(file, img) : load_ktx(file, img))
+		{
+			img.file = file;
+			return img;
+		}
+
+		img = GlTextureImage{};
+	}
+
+	// the conversion is done here, so that it is skipped when uploading the image
+	if(QImage image = QImage::fromData(file); !image.isNull())
+	{
+		img.image = image.convertToFormat(QImage::Format_RGBA8888);
+		img.file = file;
+	}
+
+	return img;
+}
+
+
+/**
+ * start decoding a texture's image in the worker pool
+ */
+void GlSceneRenderer::LoadTexture(const std::string& ident, GlSceneTexture& txt)
+{
+	txt.loading = true;
+	txt.failed = false;
+
+	auto task = std::make_shared<std::packaged_task<GlTextureImage()>>(
+		[filename = txt.filename, file = txt.file]() -> GlTextureImage
+	{
+		return DecodeTexture(filename, file);
+	});
+
+	m_texture_loads.emplace_back(GlTextureLoad
+	{
+		.ident = ident,
+		.filename = txt.filename,
+		.image = task->get_future(),
+	});
+
+	boost::asio::post(m_texture_pool, [task]() { (*task)(); });
+
+	if(!m_texture_timer.isActive())
+		m_texture_timer.start(5);
+}
+
+
+/**
+ * upload the textures whose images have been decoded
+ */
+void GlSceneRenderer::UploadLoadedTextures()
+{
+	if(!m_initialised || m_texture_loads.size() == 0)
+	{
+		m_texture_timer.stop();
+		return;
+	}
+
+	BOOST_SCOPE_EXIT(this_)
+	{
+		this_->DoneCurrent();
+	} BOOST_SCOPE_EXIT_END
+	MakeCurrent();
+
+	QMutexLocker _locker{&m_mutexObj};
+	auto *pGl = GetGlFunctions();
+
+	bool uploaded = false;
+	for(auto iter = m_texture_loads.begin(); iter != m_texture_loads.end();)
+	{
+		if(iter->image.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++iter;
+			continue;
+		}
+
+		GlTextureImage img = iter->image.get();
+		QByteArray file = std::move(img.file);
+
+		// the texture could have been removed or replaced in the meantime
+		if(auto txt = m_textures.find(iter->ident); txt != m_textures.end() &&
+			txt->second.loading && txt->second.filename == iter->filename)
+		{
+			txt->second.loading = false;
+			if(UploadTexture(pGl, txt->second, std::move(img)))
+			{
+				txt->second.file = std::move(file);
+				uploaded = true;
+			}
+			else
+			{
+				txt->second.failed = true;
+				std::cerr << "Cannot load texture \"" << iter->filename << "\"." << std::endl;
+			}
+		}
+
+		iter = m_texture_loads.erase(iter);
+	}
+
+	if(m_texture_loads.size() == 0)
+		m_texture_timer.stop();
+	if(uploaded)
+		update();
+}
+
+
+/**
+ * create the gl texture from the decoded image
+ */
+bool GlSceneRenderer::UploadTexture(qgl_funcs *pGl, GlSceneTexture& txt, GlTextureImage&& img)
+{
+	DeleteTexture(pGl, txt);
+
+	if(!img.image.isNull())
+	{
+		// the mipmaps are generated by the gpu
+		txt.texture = std::make_shared<QOpenGLTexture>(img.image, QOpenGLTexture::GenerateMipMaps);
+		txt.texture->setMinMagFilters(QOpenGLTexture::LinearMipMapLinear, QOpenGLTexture::Linear);
+		txt.texture->setWrapMode(QOpenGLTexture::Repeat);
+		txt.vram = std::size_t(img.image.sizeInBytes()) * 4 / 3;
+	}
+	else if(img.levels.size())
+	{
+		LOGGLERR(pGl);
+
+		pGl->glGenTextures(1, &txt.compressed);
+		pGl->glBindTexture(GL_TEXTURE_2D, txt.compressed);
+
+		txt.vram = 0;
+		for(std::size_t level = 0; level < img.levels.size(); ++level)
+		{
+			const QByteArray& data = img.levels[level];
+			pGl->glCompressedTexImage2D(GL_TEXTURE_2D, GLint(level), img.compressed_format,
+				std::max(img.width >> level, 1), std::max(img.height >> level, 1),
+				0, GLsizei(data.size()), data.constData());
+			txt.vram += std::size_t(data.size());
+		}
+
+		pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(img.levels.size() - 1));
+		pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+			img.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		pGl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		pGl->glBindTexture(GL_TEXTURE_2D, 0);
+
+		// the compressed format is not supported by the driver
+		if(GLenum err = pGl->glGetError(); err != GL_NO_ERROR)
+		{
+			std::cerr << "Cannot upload compressed texture with format 0x"
+				<< std::hex << img.compressed_format << std::dec << "." << std::endl;
+			DeleteTexture(pGl, txt);
+			return false;
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	m_texture_vram += txt.vram;
+	return true;
+}
+
+
+/**
+ * delete a texture's gl object, needs a current gl context
+ */
+void GlSceneRenderer::DeleteTexture(qgl_funcs *pGl, GlSceneTexture& txt)
+{
+	if(txt.texture)
+	{
+		txt.texture->destroy();
+		txt.texture = nullptr;
+	}
+
+	if(txt.compressed && pGl)
+		pGl->glDeleteTextures(1, &txt.compressed);
+	txt.compressed = 0;
+
+	m_texture_vram -= std::min(txt.vram, m_texture_vram);
+	txt.vram = 0;
+}
+
+
+/**
+ * release the least recently drawn textures until the memory budget is met,
+ * textures drawn in the current frame are kept
+ */
+void GlSceneRenderer::EvictTextures(qgl_funcs *pGl)
+{
+	if(m_texture_vram_limit == 0 || m_texture_vram <= m_texture_vram_limit)
+		return;
+
+	std::vector<GlSceneTexture*> unused;
+	for(auto& [ident, txt] : m_textures)
+	{
+		if(txt.IsResident() && txt.last_used < m_texture_frame)
+			unused.push_back(&txt);
+	}
+
+	std::sort(unused.begin(), unused.end(),
+		[](const GlSceneTexture* txt1, const GlSceneTexture* txt2) -> bool
+	{
+		return txt1->last_used < txt2->last_used;
+	});
+
+	std::size_t num_evicted = 0;
+	for(GlSceneTexture* txt : unused)
+	{
+		if(m_texture_vram <= m_texture_vram_limit)
+			break;
+
+		DeleteTexture(pGl, *txt);
+		++num_evicted;
+	}
+
+	if(num_evicted)
+		Profiler::GetInstance().AddCount("evicted textures", double(num_evicted));
+}
@@ -0,0 +1,284 @@
+/**
+ * world-space bounding boxes of all scene objects, updated and frustum-tested in one sweep
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ *
+ * References:
+ *   - J. Arvo, "Transforming Axis-Aligned Bounding Boxes", Graphics Gems, pp. 548-550 (1990).
+ *   - https://www.gamedevs.org/uploads/fast-extraction-viewing-frustum-planes-from-world-view-projection-matrix.pdf
+ */
+
+#ifndef __GL_RENDERER_OBJBOUNDS_H__
+#define __GL_RENDERER_OBJBOUNDS_H__
+
+
+#include <array>
+#include <vector>
+#include <type_traits>
+#include <cstdint>
+#include <cmath>
+
+#include "Bvh.h"
+
+#if defined(__SSE__) || defined(_M_X64)
+	#include <xmmintrin.h>
+	#define _OBJBOUNDS_SSE
+#elif defined(__ARM_NEON)
+	#include <arm_neon.h>
+	#define _OBJBOUNDS_NEON
+#endif
+
+
+/**
+ * the boxes are kept as centres and half extents in a structure-of-arrays layout,
+ * so that four single-precision objects are processed at once with sse or neon
+ */
+template<class t_real = float>
+class ObjectBounds
+{
+public:
+	using t_box = BvhBox<t_real>;
+
+	// plane n*x + d, points with a non-negative distance are inside
+	using t_plane = std::array<t_real, 4>;
+	using t_planes = std::array<t_plane, 6>;
+
+	// number of objects per simd operation
+	static constexpr std::size_t WIDTH = 4;
+
+
+public:
+	ObjectBounds() = default;
+
+
+	/**
+	 * set the number of objects, all boxes are reset
+	 */
+	void Resize(std::size_t num)
+	{
+		m_size = num;
+		const std::size_t padded = (num + WIDTH - 1) / WIDTH * WIDTH;
+
+		// the padding is a point at the origin
+		for(auto* arr : { &m_centre, &m_extent, &m_world_centre, &m_world_extent })
+			for(std::vector<t_real>& comp : *arr)
+				comp.assign(padded, t_real(0));
+		for(std::vector<t_real>& comp : m_mat)
+			comp.assign(padded, t_real(0));
+
+		m_unbounded.assign(num, 0);
+	}
+
+
+	std::size_t Size() const { return m_size; }
+
+
+	/**
+	 * set the object-space box, an empty box is never culled
+	 */
+	void SetLocalBox(std::size_t idx, const t_box& box)
+	{
+		m_unbounded[idx] = (box.min[0] > box.max[0]);
+		for(int i=0; i<3; ++i)
+		{
+			m_centre[i][idx] = m_unbounded[idx] ? t_real(0) : box.Centre(i);
+			m_extent[i][idx] = m_unbounded[idx] ? t_real(0) : t_real(0.5)*(box.max[i] - box.min[i]);
+		}
+	}
+
+
+	/**
+	 * set the affine part of an object's world matrix
+	 */
+	template<class t_mat>
+	void SetMatrix(std::size_t idx, const t_mat& mat)
+	{
+		for(int row=0; row<3; ++row)
+			for(int col=0; col<4; ++col)
+				m_mat[row*4 + col][idx] = mat(row, col);
+	}
+
+
+	/**
+	 * transform all object boxes into world space
+	 */
+	void UpdateWorldBoxes()
+	{
+		const std::size_t padded = m_centre[0].size();
+		std::size_t idx = 0;
+
+#if defined(_OBJBOUNDS_SSE) || defined(_OBJBOUNDS_NEON)
+		if constexpr(std::is_same_v<t_real, float>)
+		{
+			for(; idx<padded; idx += WIDTH)
+			{
+				const t_pack c[3] = { load(m_centre[0], idx), load(m_centre[1], idx), load(m_centre[2], idx) };
+				const t_pack e[3] = { load(m_extent[0], idx), load(m_extent[1], idx), load(m_extent[2], idx) };
+
+				for(int row=0; row<3; ++row)
+				{
+					const t_pack m0 = load(m_mat[row*4 + 0], idx);
+					const t_pack m1 = load(m_mat[row*4 + 1], idx);
+					const t_pack m2 = load(m_mat[row*4 + 2], idx);
+					const t_pack m3 = load(m_mat[row*4 + 3], idx);
+
+					store(m_world_centre[row], idx,
+						add(add(mul(m0, c[0]), mul(m1, c[1])), add(mul(m2, c[2]), m3)));
+					store(m_world_extent[row], idx,
+						add(add(mul(abs(m0), e[0]), mul(abs(m1), e[1])), mul(abs(m2), e[2])));
+				}
+			}
+		}
+#endif
+
+		// scalar version
+		for(; idx<padded; ++idx)
+		{
+			for(int row=0; row<3; ++row)
+			{
+				t_real c = m_mat[row*4 + 3][idx];
+				t_real e = 0;
+				for(int col=0; col<3; ++col)
+				{
+					c += m_mat[row*4 + col][idx] * m_centre[col][idx];
+					e += std::abs(m_mat[row*4 + col][idx]) * m_extent[col][idx];
+				}
+
+				m_world_centre[row][idx] = c;
+				m_world_extent[row][idx] = e;
+			}
+		}
+	}
+
+
+	/**
+	 * get an object's box in world space
+	 */
+	t_box GetWorldBox(std::size_t idx) const
+	{
+		t_box box;
+		if(m_unbounded[idx])
+			return box;
+
+		for(int i=0; i<3; ++i)
+		{
+			box.min[i] = m_world_centre[i][idx] - m_world_extent[i][idx];
+			box.max[i] = m_world_centre[i][idx] + m_world_extent[i][idx];
+		}
+		return box;
+	}
+
+
+	/**
+	 * test the world boxes against the planes of a frustum,
+	 * a box is outside if it is completely behind one of the planes
+	 */
+	void Cull(const t_planes& planes, std::vector<std::uint8_t>& inside) const
+	{
+		const std::size_t padded = m_centre[0].size();
+		inside.resize(padded);
+		std::size_t idx = 0;
+
+#if defined(_OBJBOUNDS_SSE) || defined(_OBJBOUNDS_NEON)
+		if constexpr(std::is_same_v<t_real, float>)
+		{
+			for(; idx<padded; idx += WIDTH)
+			{
+				const t_pack c[3] = { load(m_world_centre[0], idx), load(m_world_centre[1], idx), load(m_world_centre[2], idx) };
+				const t_pack e[3] = { load(m_world_extent[0], idx), load(m_world_extent[1], idx), load(m_world_extent[2], idx) };
+
+				unsigned int mask = (1u << WIDTH) - 1u;
+				for(const t_plane& plane : planes)
+				{
+					// distance of the box centre and the largest distance of a corner from it
+					const t_pack dist = add(add(mul(set(plane[0]), c[0]), mul(set(plane[1]), c[1])),
+						add(mul(set(plane[2]), c[2]), set(plane[3])));
+					const t_pack rad = add(add(mul(set(std::abs(plane[0])), e[0]),
+						mul(set(std::abs(plane[1])), e[1])), mul(set(std::abs(plane[2])), e[2]));
+
+					mask &= non_negative(add(dist, rad));
+				}
+
+				for(std::size_t lane=0; lane<WIDTH; ++lane)
+					inside[idx + lane] = (mask >> lane) & 1u;
+			}
+		}
+#endif
+
+		// scalar version
+		for(; idx<padded; ++idx)
+		{
+			bool in = true;
+			for(const t_plane& plane : planes)
+			{
+				t_real dist = plane[3], rad = 0;
+				for(int i=0; i<3; ++i)
+				{
+					dist += plane[i] * m_world_centre[i][idx];
+					rad += std::abs(plane[i]) * m_world_extent[i][idx];
+				}
+
+				if(dist + rad < t_real(0))
+				{
+					in = false;
+					break;
+				}
+			}
+			inside[idx] = in;
+		}
+
+		for(std::size_t obj=0; obj<m_size; ++obj)
+			inside[obj] |= m_unbounded[obj];
+		inside.resize(m_size);
+	}
+
+
+protected:
+#if defined(_OBJBOUNDS_SSE)
+	using t_pack = __m128;
+
+	static t_pack load(const std::vector<t_real>& arr, std::size_t idx) { return _mm_loadu_ps(arr.data() + idx); }
+	static void store(std::vector<t_real>& arr, std::size_t idx, t_pack val) { _mm_storeu_ps(arr.data() + idx, val); }
+	static t_pack set(float val) { return _mm_set1_ps(val); }
+	static t_pack add(t_pack a, t_pack b) { return _mm_add_ps(a, b); }
+	static t_pack mul(t_pack a, t_pack b) { return _mm_mul_ps(a, b); }
+	static t_pack abs(t_pack a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+	static unsigned int non_negative(t_pack a) { return unsigned(_mm_movemask_ps(_mm_cmpge_ps(a, _mm_setzero_ps()))); }
+
+#elif defined(_OBJBOUNDS_NEON)
+	using t_pack = float32x4_t;
+
+	static t_pack load(const std::vector<t_real>& arr, std::size_t idx) { return vld1q_f32(arr.data() + idx); }
+	static void store(std::vector<t_real>& arr, std::size_t idx, t_pack val) { vst1q_f32(arr.data() + idx, val); }
+	static t_pack set(float val) { return vdupq_n_f32(val); }
+	static t_pack add(t_pack a, t_pack b) { return vaddq_f32(a, b); }
+	static t_pack mul(t_pack a, t_pack b) { return vmulq_f32(a, b); }
+	static t_pack abs(t_pack a) { return vabsq_f32(a); }
+	static unsigned int non_negative(t_pack a)
+	{
+		const uint32x4_t cmp = vcgeq_f32(a, vdupq_n_f32(0.f));
+		return (vgetq_lane_u32(cmp, 0) & 1u) | (vgetq_lane_u32(cmp, 1) & 2u)
+			| (vgetq_lane_u32(cmp, 2) & 4u) | (vgetq_lane_u32(cmp, 3) & 8u);
+	}
+#endif
+
+
+private:
+	std::size_t m_size{0};
+
+	// object-space boxes
+	std::array<std::vector<t_real>, 3> m_centre{}, m_extent{};
+
+	// rows of the affine world matrices
+	std::array<std::vector<t_real>, 12> m_mat{};
+
+	// world-space boxes
+	std::array<std::vector<t_real>, 3> m_world_centre{}, m_world_extent{};
+
+	// objects without a box
+	std::vector<std::uint8_t> m_unbounded{};
+};
+
+
+#endif
@@ -0,0 +1,129 @@
+/**
+ * sub-allocation of ranges in a larger buffer
+ * @author Tobias Weber <tweber@ill.fr>
+ * @date oct-2026
+ * @license GPLv3, see 'LICENSE' file
+ */
+
+#ifndef __GL_RENDERER_RANGEALLOC_H__
+#define __GL_RENDERER_RANGEALLOC_H__
+
+
+#include <map>
+#include <optional>
+#include <cstddef>
+
+
+/**
+ * first-fit allocator keeping the free ranges ordered by their offsets,
+ * neighbouring free ranges are merged
+ */
+class RangeAllocator
+{
+public:
+	RangeAllocator(std::size_t capacity = 0)
+	{
+		Reset(capacity);
+	}
+
+
+	/**
+	 * free the whole buffer
+	 */
+	void Reset(std::size_t capacity)
+	{
+		m_capacity = capacity;
+		m_free.clear();
+		if(capacity)
+			m_free.emplace(0, capacity);
+	}
+
+
+	/**
+	 * get a range of the given size whose offset is a multiple of align
+	 */
+	std::optional<std::size_t> Allocate(std::size_t size, std::size_t align = 1)
+	{
+		if(size == 0)
+			size = 1;
+		if(align == 0)
+			align = 1;
+
+		for(auto iter = m_free.begin(); iter != m_free.end(); ++iter)
+		{
+			const std::size_t begin = iter->first;
+			const std::size_t end = iter->first + iter->second;
+			const std::size_t offs = (begin + align - 1) / align * align;
+			if(offs + size > end)
+				continue;
+
+			// the remainders before and after the allocation stay free
+			m_free.erase(iter);
+			if(offs > begin)
+				m_free.emplace(begin, offs - begin);
+			if(offs + size < end)
+				m_free.emplace(offs + size, end - offs - size);
+
+			return offs;
+		}
+
+		return std::nullopt;
+	}
+
+
+	/**
+	 * return a range that has been allocated before
+	 */
+	void Free(std::size_t offs, std::size_t size)
+	{
+		if(size == 0)
+			size = 1;
+
+		auto iter = m_free.emplace(offs, size).first;
+
+		// merge with the following range
+		if(auto next = std::next(iter); next != m_free.end() && iter->first + iter->second == next->first)
+		{
+			iter->second += next->second;
+			m_free.erase(next);
+		}
+
+		// merge with the preceding range
+		if(iter != m_free.begin())
+		{
+			if(auto prev = std::prev(iter); prev->first + prev->second == iter->first)
+			{
+				prev->second += iter->second;
+				m_free.erase(iter);
+			}
+		}
+	}
+
+
+	std::size_t GetCapacity() const { return m_capacity; }
+
+
+	std::size_t GetFree() const
+	{
+		std::size_t size = 0;
+		for(const auto& range : m_free)
+			size += range.second;
+		return size;
+	}
+
+
+	bool IsEmpty() const
+	{
+		return m_free.size() == 1 && m_free.begin()->second == m_capacity;
+	}
+
+
+private:
+	std::size_t m_capacity{0};
+
+	// offset -> size of the free ranges
+	std::map<std::size_t, std::size_t> m_free{};
+};
+
+
+#endif
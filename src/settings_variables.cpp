@@ -38,6 +38,10 @@ t_real g_eps_angular = 0.01 / 180. * m::pi<t_real>;
 t_real g_eps_gui = 1e-4;
 
 
+// scene files
+int g_scene_bake_meshes = 0;
+
+
 // mouse dragging
 t_real g_drag_scale_force = 10.;
 t_real g_drag_scale_momentum = 0.1;
@@ -45,6 +49,13 @@ t_real g_drag_scale_momentum = 0.1;
 
 // render timer TPS
 unsigned int g_timer_tps = 30;
+unsigned int g_timer_idle_tps = 4;
+
+
+// simulation thread and TPS
+int g_sim_thread = 1;
+unsigned int g_sim_tps = 100;
+int g_sim_interpolation = 1;
 
 
 // renderer options
@@ -56,11 +67,34 @@ t_real_gl g_rotation_scale = t_real_gl(0.02);
 int g_light_follows_cursor = 0;
 int g_enable_shadow_rendering = 1;
 
+int g_shadow_map_cache = 1;
+unsigned int g_shadow_map_size = 2048;
+
 int g_enable_portal_rendering = 0;
+unsigned int g_portal_depth = 2;
+
+int g_enable_instancing = 1;
+int g_enable_occlusion_culling = 0;
+int g_gpu_picking = 0;
+t_real_gl g_lod_pixels = 48.;
+t_real_gl g_light_range = 64.;
+unsigned int g_texture_memory = 512;
+
+unsigned int g_msaa_samples = 8;
+int g_polygon_smoothing = 1;
+t_real_gl g_render_scale = 1.;
+int g_dynamic_resolution = 0;
+unsigned int g_target_fps = 60;
 
 int g_draw_bounding_rectangles = 0;
 
 
+// frame profiler
+int g_profiler = 0;
+int g_profiler_overlay = 1;
+unsigned int g_profiler_frames = 240;
+
+
 // gui theme
 QString g_theme = "Fusion";
 
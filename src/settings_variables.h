@@ -53,17 +53,62 @@ extern int g_prec, g_prec_gui;
 // epsilons
 extern t_real g_eps, g_eps_angular, g_eps_gui;
 
+// store the tessellated meshes in binary scene files
+extern int g_scene_bake_meshes;
 
-// render timer ticks per second
+
+// render timer ticks per second, at full rate and while the scene is at rest
 extern unsigned int g_timer_tps;
+extern unsigned int g_timer_idle_tps;
+
+// simulation thread, ticks per second, and interpolation
+extern int g_sim_thread;
+extern unsigned int g_sim_tps;
+extern int g_sim_interpolation;
 
 extern int g_light_follows_cursor;
 extern int g_enable_shadow_rendering;
 
+// shadow map caching and resolution
+extern int g_shadow_map_cache;
+extern unsigned int g_shadow_map_size;
+
 extern int g_enable_portal_rendering;
 
+// maximum recursion depth of portals seen through portals
+extern unsigned int g_portal_depth;
+
+extern int g_enable_instancing;
+extern int g_enable_occlusion_culling;
+
+// find the object under the cursor by rendering object ids
+extern int g_gpu_picking;
+
+// projected object radius in pixels below which coarser meshes are drawn
+extern t_real_gl g_lod_pixels;
+
+// distance beyond which a light has no effect, 0: unbounded
+extern t_real_gl g_light_range;
+
+// gpu memory budget for the textures in MB, 0: unlimited
+extern unsigned int g_texture_memory;
+
+// multisampling of the gl surface, only applied on start-up
+extern unsigned int g_msaa_samples;
+extern int g_polygon_smoothing;
+
+// render resolution relative to the screen's, and its adaptation to the target frame rate
+extern t_real_gl g_render_scale;
+extern int g_dynamic_resolution;
+extern unsigned int g_target_fps;
+
 extern int g_draw_bounding_rectangles;
 
+// frame profiler, its overlay, and the number of recorded frames
+extern int g_profiler;
+extern int g_profiler_overlay;
+extern unsigned int g_profiler_frames;
+
 // camera translation scaling factor
 extern t_real_gl g_move_scale;
 
@@ -106,7 +151,7 @@ extern int g_nested_docks;
 // ----------------------------------------------------------------------------
 // variables register
 // ----------------------------------------------------------------------------
-constexpr std::array<SettingsVariable, 13> g_settingsvariables
+constexpr std::array<SettingsVariable, 35> g_settingsvariables
 {{
 	// epsilons and precisions
 	{
@@ -136,6 +181,14 @@ constexpr std::array<SettingsVariable, 13> g_settingsvariables
 		.value = &g_prec_gui,
 	},
 
+	// scene files
+	{
+		.description = "Store tessellated meshes in scene files.",
+		.key = "settings/scene_bake_meshes",
+		.value = &g_scene_bake_meshes,
+		.editor = SettingsVariableEditor::YESNO,
+	},
+
 	// mouse dragging
 	{
 		.description = "Force scaling.",
@@ -148,6 +201,25 @@ constexpr std::array<SettingsVariable, 13> g_settingsvariables
 		.value = &g_drag_scale_momentum,
 	},
 
+	// simulation options
+	{
+		.description = "Run simulation in its own thread.",
+		.key = "settings/sim_thread",
+		.value = &g_sim_thread,
+		.editor = SettingsVariableEditor::YESNO,
+	},
+	{
+		.description = "Simulation ticks per second.",
+		.key = "settings/sim_tps",
+		.value = &g_sim_tps,
+	},
+	{
+		.description = "Interpolate simulation steps.",
+		.key = "settings/sim_interpolation",
+		.value = &g_sim_interpolation,
+		.editor = SettingsVariableEditor::YESNO,
+	},
+
 	// file options
 	{
 		.description = "Maximum number of recent files.",
@@ -161,6 +233,11 @@ constexpr std::array<SettingsVariable, 13> g_settingsvariables
 		.key = "settings/timer_tps",
 		.value = &g_timer_tps,
 	},
+	{
+		.description = "Timer ticks per second while nothing moves.",
+		.key = "settings/timer_idle_tps",
+		.value = &g_timer_idle_tps,
+	},
 	{
 		.description = "Light follows cursor.",
 		.key = "settings/light_follows_cursor",
@@ -173,18 +250,113 @@ constexpr std::array<SettingsVariable, 13> g_settingsvariables
 		.value = &g_enable_shadow_rendering,
 		.editor = SettingsVariableEditor::YESNO,
 	},
+	{
+		.description = "Re-use the shadow map while the scene is static.",
+		.key = "settings/shadow_map_cache",
+		.value = &g_shadow_map_cache,
+		.editor = SettingsVariableEditor::YESNO,
+	},
+	{
+		.description = "Shadow map resolution.",
+		.key = "settings/shadow_map_size",
+		.value = &g_shadow_map_size,
+	},
 	{
 		.description = "Enable portal rendering.",
 		.key = "settings/enable_portal_rendering",
 		.value = &g_enable_portal_rendering,
 		.editor = SettingsVariableEditor::YESNO,
 	},
+	{
+		.description = "Maximum depth of nested portals.",
+		.key = "settings/portal_depth",
+		.value = &g_portal_depth,
+	},
+	{
+		.description = "Enable instanced rendering.",
+		.key = "settings/enable_instancing",
+		.value = &g_enable_instancing,
+		.editor = SettingsVariableEditor::YESNO,
+	},
+	{
+		.description = "Enable occlusion culling.",
+		.key = "settings/enable_occlusion_culling",
+		.value = &g_enable_occlusion_culling,
+		.editor = SettingsVariableEditor::YESNO,
+	},
+	{
+		.description = "Pick objects on the gpu.",
+		.key = "settings/gpu_picking",
+		.value = &g_gpu_picking,
+		.editor = SettingsVariableEditor::YESNO,
+	},
+	{
+		.description = "Level-of-detail radius in pixels (0: off).",
+		.key = "settings/lod_pixels",
+		.value = &g_lod_pixels,
+	},
+	{
+		.description = "Light range (0: unbounded).",
+		.key = "settings/light_range",
+		.value = &g_light_range,
+	},
+	{
+		.description = "Texture memory budget in MB (0: unlimited).",
+		.key = "settings/texture_memory",
+		.value = &g_texture_memory,
+	},
+	{
+		.description = "Multisampling (needs restart).",
+		.key = "settings/msaa_samples",
+		.value = &g_msaa_samples,
+	},
+	{
+		.description = "Enable polygon smoothing.",
+		.key = "settings/polygon_smoothing",
+		.value = &g_polygon_smoothing,
+		.editor = SettingsVariableEditor::YESNO,
+	},
+	{
+		.description = "Render scale.",
+		.key = "settings/render_scale",
+		.value = &g_render_scale,
+	},
+	{
+		.description = "Enable dynamic resolution.",
+		.key = "settings/dynamic_resolution",
+		.value = &g_dynamic_resolution,
+		.editor = SettingsVariableEditor::YESNO,
+	},
+	{
+		.description = "Target frame rate of the dynamic resolution.",
+		.key = "settings/target_fps",
+		.value = &g_target_fps,
+	},
 	{
 		.description = "Draw bounding rectangles.",
 		.key = "settings/draw_bounding_rectangles",
 		.value = &g_draw_bounding_rectangles,
 		.editor = SettingsVariableEditor::YESNO,
 	},
+
+	// profiler options
+	{
+		.description = "Enable frame profiler.",
+		.key = "settings/profiler",
+		.value = &g_profiler,
+		.editor = SettingsVariableEditor::YESNO,
+	},
+	{
+		.description = "Show frame profiler overlay.",
+		.key = "settings/profiler_overlay",
+		.value = &g_profiler_overlay,
+		.editor = SettingsVariableEditor::YESNO,
+	},
+	{
+		.description = "Number of profiled frames.",
+		.key = "settings/profiler_frames",
+		.value = &g_profiler_frames,
+	},
 }};
 // ----------------------------------------------------------------------------
 
@@ -104,6 +104,7 @@ template<class T> using t_arr2 = t_arr<T, 2>;
 template<class T> using t_arr3 = t_arr<T, 3>;
 template<class T> using t_arr4 = t_arr<T, 2*2>;
 template<class T> using t_arr9 = t_arr<T, 3*3>;
+template<class T> using t_arr16 = t_arr<T, 4*4>;
 
 using t_real = double;
 using t_int = int;
@@ -119,6 +120,7 @@ using t_vec2 = m::vec<t_real, t_arr2, 2>;
 using t_vec3 = m::vec<t_real, t_arr3, 3>;
 using t_mat22 = m::mat<t_real, t_arr4, 2, 2>;
 using t_mat33 = m::mat<t_real, t_arr9, 3, 3>;
+using t_mat44 = m::mat<t_real, t_arr16, 4, 4>;
 
 
 #endif